@@ -0,0 +1,1641 @@
+#include "bench.h"
+#include "heD3.h"
+#include "heAssets.h"
+#include "heBinary.h"
+#include "heLoader.h"
+#include "heUtils.h"
+#include "heWorkerPool.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+#include <cfloat>
+
+/* Headless micro benchmarks for the cpu side of the engine. No window, gl context or win32 call is made here, only
+   the engine functions that run on the cpu are measured. Usage:
+     HiraethBench [--filter name] [--out file.json] [--data folder] [--golden folder] [--update-golden] [--quick]
+   Every case reports the median, p95, minimum and mean time per call as well as the total number of calls. The
+   results are printed as a table and written as json so that runs can be compared by scripts. */
+
+volatile uint64_t benchSink = 0;
+BenchSuite bench;
+
+
+// -- suite
+
+b8 benchShouldRun(BenchSuite const* suite, std::string const& name) {
+    return suite->filter.empty() || name.find(suite->filter) != std::string::npos;
+};
+
+void benchAddResult(BenchSuite* suite, std::string const& name, std::vector<double>& samples, uint64_t const iterations) {
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult* result = &suite->results.emplace_back();
+    result->name        = name;
+    result->iterations  = iterations;
+    result->samples     = (uint32_t) samples.size();
+    if(samples.empty())
+        return;
+
+    size_t p95Index = (size_t) std::ceil(samples.size() * 0.95) - 1;
+    result->median  = samples[samples.size() / 2];
+    result->p95     = samples[std::min(p95Index, samples.size() - 1)];
+    result->min     = samples[0];
+
+    double sum = 0.0;
+    for(double const& all : samples)
+        sum += all;
+    result->mean = sum / samples.size();
+
+    std::cout << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << result->median << std::setw(14) << result->p95 << std::setw(14) << iterations << std::endl;
+};
+
+void benchPrintResults(BenchSuite const* suite) {
+    std::cout << std::endl << std::left << std::setw(40) << "case" << std::right << std::setw(14) << "median ns"
+              << std::setw(14) << "p95 ns" << std::setw(14) << "min ns" << std::setw(14) << "mean ns"
+              << std::setw(14) << "iterations" << std::endl;
+
+    for(BenchResult const& all : suite->results)
+        std::cout << std::left << std::setw(40) << all.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << all.median << std::setw(14) << all.p95 << std::setw(14) << all.min
+                  << std::setw(14) << all.mean << std::setw(14) << all.iterations << std::endl;
+};
+
+b8 benchWriteResults(BenchSuite const* suite) {
+    std::ofstream out(suite->outputFile);
+    if(!out) {
+        std::cout << "Could not open output file [" << suite->outputFile << "]" << std::endl;
+        return false;
+    }
+
+    out << "{\n  \"unit\": \"ns\",\n  \"results\": [\n";
+    out << std::setprecision(3) << std::fixed;
+    for(size_t i = 0; i < suite->results.size(); ++i) {
+        BenchResult const* result = &suite->results[i];
+        out << "    { \"name\": \"" << result->name << "\", \"median\": " << result->median << ", \"p95\": "
+            << result->p95 << ", \"min\": " << result->min << ", \"mean\": " << result->mean
+            << ", \"iterations\": " << result->iterations << ", \"samples\": " << result->samples << " }";
+        if(i + 1 < suite->results.size())
+            out << ",";
+        out << "\n";
+    }
+
+    out << "  ]\n}\n";
+    return true;
+};
+
+b8 benchCheck(BenchSuite* suite, b8 const passed, std::string const& message) {
+    if(!passed) {
+        std::cout << "check failed: " << message << std::endl;
+        suite->failedChecks++;
+    }
+
+    return passed;
+};
+
+b8 benchCheckGolden(BenchSuite* suite, std::string const& name, std::vector<float> const& values, float const tolerance) {
+    std::string fileName = suite->goldenFolder + "/" + name + ".txt";
+    if(suite->updateGolden) {
+        std::filesystem::create_directories(suite->goldenFolder);
+        std::ofstream out(fileName);
+        out << values.size() << "\n" << std::setprecision(9);
+        for(float all : values)
+            out << all << "\n";
+        return benchCheck(suite, (b8) out, "could not write golden file [" + fileName + "]");
+    }
+
+    std::ifstream in(fileName);
+    size_t count = 0;
+    if(!benchCheck(suite, (b8) (in >> count), "missing golden file [" + fileName + "], run with --update-golden"))
+        return false;
+
+    if(!benchCheck(suite, count == values.size(), name + " has " + std::to_string(values.size()) + " values, golden file has " + std::to_string(count)))
+        return false;
+
+    uint32_t mismatches = 0;
+    size_t first = count;
+    for(size_t i = 0; i < count; ++i) {
+        float expected = 0.f;
+        in >> expected;
+        if(!(std::abs(values[i] - expected) <= tolerance)) {
+            if(mismatches++ == 0)
+                first = i;
+        }
+    }
+
+    return benchCheck(suite, mismatches == 0, name + " differs from its golden file in " + std::to_string(mismatches) +
+                      " values (first at " + std::to_string(first) + ")");
+};
+
+
+// -- input data
+
+// writes an obj file of a flat grid with size * size quads (two triangles each) with uvs and normals
+void benchCreateObjFile(std::string const& fileName, uint32_t const size) {
+    std::ofstream out(fileName);
+    out << "# generated by HiraethBench\n";
+    for(uint32_t z = 0; z <= size; ++z)
+        for(uint32_t x = 0; x <= size; ++x)
+            out << "v " << (float) x << " " << std::sin(x * .1f + z * .2f) << " " << (float) z << "\n";
+
+    for(uint32_t z = 0; z <= size; ++z)
+        for(uint32_t x = 0; x <= size; ++x)
+            out << "vt " << x / (float) size << " " << z / (float) size << "\n";
+
+    out << "vn 0 1 0\n";
+
+    for(uint32_t z = 0; z < size; ++z) {
+        for(uint32_t x = 0; x < size; ++x) {
+            uint32_t i0 = z * (size + 1) + x + 1; // obj indices start at one
+            uint32_t i1 = i0 + 1;
+            uint32_t i2 = i0 + size + 1;
+            uint32_t i3 = i2 + 1;
+            out << "f " << i0 << "/" << i0 << "/1 " << i2 << "/" << i2 << "/1 " << i1 << "/" << i1 << "/1\n";
+            out << "f " << i1 << "/" << i1 << "/1 " << i2 << "/" << i2 << "/1 " << i3 << "/" << i3 << "/1\n";
+        }
+    }
+};
+
+// writes the given mesh as binary h3asset (shader name, no textures, four float buffers) without physics
+void benchCreateAssetFile(std::string const& fileName, HeD3MeshBuilder const* mesh) {
+    HeBinaryBuffer buffer;
+    buffer.maxSize = 4096;
+    buffer.ptr     = (char*) malloc(buffer.maxSize);
+    buffer.out.open(fileName, std::ios::out | std::ios::binary);
+
+    heBinaryBufferAddString(&buffer, "3d_pbr");
+    heBinaryBufferAdd(&buffer, '\n');
+    heBinaryBufferAddFloatBuffer(&buffer, mesh->verticesArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh->uvArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh->normalArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh->tangentArray);
+    heBinaryBufferCloseFile(&buffer);
+};
+
+
+// -- cases
+
+void benchMath(BenchSuite* suite) {
+    hm::vec3f position(1.f, 2.f, 3.f);
+    hm::quatf rotation = hm::fromEulerDegrees(hm::vec3f(10.f, 20.f, 30.f));
+    hm::vec3f scale(2.f);
+    hm::mat4f a = hm::createTransformationMatrix(position, rotation, scale);
+    hm::mat4f b = hm::createViewMatrix(hm::vec3f(4.f, 5.f, 6.f), hm::vec3f(15.f, 45.f, 0.f));
+
+    benchRun(suite, "hm/mat4 multiply", [&]() {
+        a = a * b;
+        benchKeep(a);
+    });
+
+    benchRun(suite, "hm/mat4 inverse", [&]() {
+        b = hm::inverse(b);
+        benchKeep(b);
+    });
+
+    benchRun(suite, "hm/mat4 vec4 multiply", [&]() {
+        hm::vec4f v = b * hm::vec4f(position, 1.f);
+        position.x += v.w * 1e-9f;
+        benchKeep(v);
+    });
+
+    benchRun(suite, "hm/transformation matrix (quat)", [&]() {
+        position.x += .001f;
+        a = hm::createTransformationMatrix(position, rotation, scale);
+        benchKeep(a);
+    });
+
+    benchRun(suite, "hm/transformation matrix (euler)", [&]() {
+        position.x += .001f;
+        a = hm::createTransformationMatrix(position, hm::vec3f(10.f, 20.f, 30.f), scale);
+        benchKeep(a);
+    });
+
+    benchRun(suite, "hm/normal matrix", [&]() {
+        a[0][0] += .001f;
+        hm::mat3f normal = hm::transpose(hm::inverse(hm::mat3f(a)));
+        benchKeep(normal);
+    });
+
+    benchRun(suite, "hm/quat from euler", [&]() {
+        position.y += .001f;
+        rotation = hm::fromEulerDegrees(position);
+        benchKeep(rotation);
+    });
+};
+
+void benchBinary(BenchSuite* suite) {
+    const uint32_t FLOAT_COUNT = 65536;
+    std::vector<float> floats(FLOAT_COUNT);
+    for(uint32_t i = 0; i < FLOAT_COUNT; ++i)
+        floats[i] = (float) i;
+
+    // an in-memory buffer that is big enough for all data, so that no stream is touched
+    HeBinaryBuffer buffer;
+    buffer.maxSize = FLOAT_COUNT * sizeof(float) + 1024;
+    buffer.ptr     = (char*) malloc(buffer.maxSize);
+
+    benchRun(suite, "binary/add float buffer (64k)", [&]() {
+        buffer.offset = 0;
+        heBinaryBufferAddFloatBuffer(&buffer, floats);
+        benchKeep(buffer.offset);
+    });
+
+    benchRun(suite, "binary/add ints (1k)", [&]() {
+        buffer.offset = 0;
+        for(int32_t i = 0; i < 1024; ++i)
+            heBinaryBufferAddInt(&buffer, i);
+        benchKeep(buffer.offset);
+    });
+
+    benchRun(suite, "binary/add strings (1k)", [&]() {
+        buffer.offset = 0;
+        for(int32_t i = 0; i < 1024; ++i)
+            heBinaryBufferAddString(&buffer, "res/textures/instances/diffuse.h3asset");
+        benchKeep(buffer.offset);
+    });
+
+    buffer.offset = 0;
+    heBinaryBufferAddFloatBuffer(&buffer, floats);
+    buffer.size = buffer.offset;
+    std::vector<float> output;
+
+    benchRun(suite, "binary/get float buffer (64k)", [&]() {
+        buffer.offset = 0;
+        heBinaryBufferGetFloatBuffer(&buffer, &output);
+        benchKeep(output[FLOAT_COUNT - 1]);
+    });
+
+    buffer.offset = 0;
+    for(int32_t i = 0; i < 1024; ++i)
+        heBinaryBufferAddInt(&buffer, i);
+    buffer.size = buffer.offset;
+
+    benchRun(suite, "binary/get ints (1k)", [&]() {
+        buffer.offset = 0;
+        int32_t value = 0;
+        for(int32_t i = 0; i < 1024; ++i)
+            heBinaryBufferGetInt(&buffer, &value);
+        benchKeep(value);
+    });
+
+    free(buffer.ptr);
+};
+
+void benchLoader(BenchSuite* suite) {
+    const uint32_t GRID_SIZE = 64; // 8192 triangles
+    std::string objFile   = suite->dataFolder + "/grid.obj";
+    std::string assetFile = suite->dataFolder + "/grid.h3asset";
+
+    HeD3MeshBuilder reference;
+    benchCreateObjFile(objFile, GRID_SIZE);
+    if(!benchCheck(suite, heD3MeshBuilderParseObj(&reference, objFile), "could not create obj input file [" + objFile + "]"))
+        return;
+
+    benchCreateAssetFile(assetFile, &reference);
+
+    benchRun(suite, "loader/obj parse (8k tris)", [&]() {
+        HeD3MeshBuilder builder;
+        heD3MeshBuilderParseObj(&builder, objFile);
+        benchKeep(builder.verticesArray.size());
+    });
+
+    benchRun(suite, "loader/h3asset read (8k tris)", [&]() {
+        HeBinaryBuffer buffer;
+        heBinaryBufferOpenFile(&buffer, assetFile, 4096, HE_ACCESS_READ_ONLY);
+
+        std::string shader;
+        heBinaryBufferGetString(&buffer, &shader);
+        while(heBinaryBufferPeek(&buffer) != '\n') {
+            std::string texture;
+            heBinaryBufferGetString(&buffer, &texture);
+        }
+        buffer.offset += 1;
+
+        HeD3MeshBuilder builder;
+        heD3MeshBuilderReadBinary(&builder, &buffer);
+        heBinaryBufferCloseFile(&buffer);
+        benchKeep(builder.verticesArray.size());
+    });
+
+    // what merging one instance into a static batch costs
+    hm::mat4f worldMatrix  = hm::createTransformationMatrix(hm::vec3f(10.f, 0.f, 5.f), hm::quatf(0.f, .38f, 0.f, .92f), hm::vec3f(2.f));
+    hm::mat3f normalMatrix = hm::transpose(hm::inverse(hm::mat3f(worldMatrix)));
+    benchRun(suite, "loader/append to static batch (8k tris)", [&]() {
+        HeD3MeshBuilder batch;
+        heD3MeshBuilderAppend(&batch, &reference, worldMatrix, normalMatrix);
+        benchKeep(batch.verticesArray.size());
+    });
+
+    // the lod has to hit the target, keep every triangle facing up and keep the borders of the grid in place
+    {
+        uint32_t target = (uint32_t) reference.verticesArray.size() / 36;
+        HeD3MeshBuilder lod;
+        heD3MeshBuilderSimplify(&reference, &lod, target);
+
+        uint32_t triangles = (uint32_t) lod.verticesArray.size() / 9;
+        benchCheck(suite, triangles <= target && triangles >= target * 9 / 10,
+                   "simplified mesh has " + std::to_string(triangles) + " triangles instead of " + std::to_string(target));
+
+        uint32_t broken = 0;
+        hm::vec3f min(FLT_MAX), max(-FLT_MAX), referenceMin(FLT_MAX), referenceMax(-FLT_MAX);
+        for(uint32_t i = 0; i < triangles; ++i) {
+            float const* v = &lod.verticesArray[i * 9];
+            hm::vec3f a(v[0], v[1], v[2]), b(v[3], v[4], v[5]), c(v[6], v[7], v[8]);
+            hm::vec3f normal = hm::cross(b - a, c - a);
+            if(normal.y <= 1e-4f) // degenerate or flipped
+                ++broken;
+
+            for(hm::vec3f const& p : { a, b, c }) {
+                min = hm::vec3f(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+                max = hm::vec3f(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+            }
+        }
+
+        for(size_t i = 0; i < reference.verticesArray.size(); i += 3) {
+            hm::vec3f p(reference.verticesArray[i], reference.verticesArray[i + 1], reference.verticesArray[i + 2]);
+            referenceMin = hm::vec3f(std::min(referenceMin.x, p.x), std::min(referenceMin.y, p.y), std::min(referenceMin.z, p.z));
+            referenceMax = hm::vec3f(std::max(referenceMax.x, p.x), std::max(referenceMax.y, p.y), std::max(referenceMax.z, p.z));
+        }
+
+        benchCheck(suite, broken == 0, "simplified mesh has " + std::to_string(broken) + " degenerate or flipped triangles");
+        benchCheck(suite, min.x == referenceMin.x && min.z == referenceMin.z && max.x == referenceMax.x && max.z == referenceMax.z &&
+                   min.y >= referenceMin.y - 1e-4f && max.y <= referenceMax.y + 1e-4f, "simplified mesh does not keep the bounds of the grid");
+    }
+
+    // generating one lod in the converter
+    benchRun(suite, "loader/simplify mesh (8k -> 2k tris)", [&]() {
+        HeD3MeshBuilder lod;
+        heD3MeshBuilderSimplify(&reference, &lod, (uint32_t) reference.verticesArray.size() / 36);
+        benchKeep(lod.verticesArray.size());
+    });
+};
+
+void benchStrings(BenchSuite* suite) {
+    std::string face = "f 1021/1021/1 1086/1086/1 1022/1022/1";
+    std::string path = "res/textures/instances/cerberus/diffuse.png";
+    std::string line = "i:res/assets/bin/cerberus.h3asset,0.000000001.000000002.000000000.00000000";
+
+    benchRun(suite, "string/split (obj face)", [&]() {
+        std::vector<std::string> parts = heStringSplit(face, ' ');
+        benchKeep(parts.size());
+    });
+
+    benchRun(suite, "string/split (level line)", [&]() {
+        std::vector<std::string> parts = heStringSplit(line, ',');
+        benchKeep(parts.size());
+    });
+
+    benchRun(suite, "string/replace all (string)", [&]() {
+        std::string result = heStringReplaceAll(path, "/", "\\\\");
+        benchKeep(result.size());
+    });
+
+    benchRun(suite, "string/replace all (char)", [&]() {
+        std::string result = heStringReplaceAll(path, '/', '\\');
+        benchKeep(result.size());
+    });
+
+    benchRun(suite, "string/starts with", [&]() {
+        b8 result = heStringStartsWith(face, "f ");
+        benchKeep(result);
+    });
+
+    benchRun(suite, "string/eat spaces", [&]() {
+        std::string copy = "    #version 330 core   ";
+        heStringEatSpacesLeft(copy);
+        heStringEatSpacesRight(copy);
+        benchKeep(copy.size());
+    });
+};
+
+void benchRandom(BenchSuite* suite) {
+    HeRandom random;
+    heRandomCreate(&random, 1);
+
+    // the batch functions against their ranges. The counts are not a multiple of four so that the scalar tail runs
+    // too, and every lane has to produce every value of a small range (the even and odd lanes are multiplied apart)
+    for(uint32_t const count : { 1001u, 1003u }) {
+        std::string const suffix = " (" + std::to_string(count) + ")";
+        std::vector<int32_t> values(count + 1, INT32_MAX);
+        heRandomFillInts(&random, values.data(), count, -3, 3);
+        uint32_t outside = 0, missing = 0;
+        for(uint32_t i = 0; i < count; ++i)
+            outside += values[i] < -3 || values[i] > 3;
+        for(uint32_t lane = 0; lane < 4; ++lane) {
+            for(int32_t value = -3; value <= 3; ++value) {
+                b8 found = false;
+                for(uint32_t i = lane; i < count && !found; i += 4)
+                    found = values[i] == value;
+                missing += !found;
+            }
+        }
+
+        benchCheck(suite, outside == 0 && values[count] == INT32_MAX, "fill ints wrote " + std::to_string(outside) + " values outside of [-3, 3]" + suffix);
+        benchCheck(suite, missing == 0, "fill ints never returned " + std::to_string(missing) + " of the values of [-3, 3] in a lane" + suffix);
+
+        // a large range needs the full upper half of the product, the mean is checked to be about zero
+        heRandomFillInts(&random, values.data(), count, -1000000000, 1000000000);
+        double mean = 0.;
+        outside = 0;
+        for(uint32_t i = 0; i < count; ++i) {
+            outside += values[i] < -1000000000 || values[i] > 1000000000;
+            mean    += values[i] / (double) count;
+        }
+
+        benchCheck(suite, outside == 0 && std::abs(mean) < 1e8, "fill ints over [-1e9, 1e9] has " + std::to_string(outside) + " values outside and a mean of " +
+                   std::to_string(mean) + suffix);
+
+        // the full range wraps to zero and uses the bits as they are
+        heRandomFillInts(&random, values.data(), count, INT32_MIN, INT32_MAX);
+        uint32_t negative = 0;
+        for(uint32_t i = 0; i < count; ++i)
+            negative += values[i] < 0;
+        benchCheck(suite, negative > count / 3 && negative < count / 3 * 2, "fill ints over the full range returned " + std::to_string(negative) +
+                   " negative values" + suffix);
+
+        std::vector<float> floats(count + 1, NAN);
+        heRandomFillFloats(&random, floats.data(), count, -2.f, 5.f);
+        outside = 0;
+        mean    = 0.;
+        for(uint32_t i = 0; i < count; ++i) {
+            outside += !(floats[i] >= -2.f && floats[i] < 5.f);
+            mean    += floats[i] / (double) count;
+        }
+
+        benchCheck(suite, outside == 0 && std::isnan(floats[count]) && std::abs(mean - 1.5) < .3, "fill floats has " + std::to_string(outside) +
+                   " values outside of [-2, 5) and a mean of " + std::to_string(mean) + suffix);
+
+        // the same seed gives the same numbers
+        HeRandom a, b;
+        heRandomCreate(&a, 7);
+        heRandomCreate(&b, 7);
+        std::vector<int32_t> other(count);
+        heRandomFillInts(&a, values.data(), count, 0, 1000);
+        heRandomFillInts(&b, other.data(), count, 0, 1000);
+        benchCheck(suite, std::equal(other.begin(), other.end(), values.begin()), "fill ints differs between two generators with the same seed" + suffix);
+
+        // streams are reproducible per (seed, index), and independent between indices and seeds
+        HeRandomStream first, second, neighbour, reseeded;
+        heRandomStreamCreate(&first, 3, 5);
+        heRandomStreamCreate(&second, 3, 5);
+        heRandomStreamCreate(&neighbour, 3, 6);
+        heRandomStreamCreate(&reseeded, 4, 5);
+        uint32_t different = 0, sameNeighbour = 0, sameSeed = 0, wrongPosition = 0;
+        for(uint32_t i = 0; i < count; ++i) {
+            uint32_t value = heRandomStreamNext(&first);
+            different     += value != heRandomStreamNext(&second);
+            sameNeighbour += value == heRandomStreamNext(&neighbour);
+            sameSeed      += value == heRandomStreamNext(&reseeded);
+            wrongPosition += value != heRandomStreamGet(&second, i);
+        }
+
+        benchCheck(suite, different == 0 && wrongPosition == 0, "stream differs for the same seed and index in " + std::to_string(different + wrongPosition) +
+                   " numbers" + suffix);
+        benchCheck(suite, sameNeighbour < 3 && sameSeed < 3, "streams of different indices or seeds share " + std::to_string(sameNeighbour + sameSeed) +
+                   " numbers" + suffix);
+    }
+
+    benchRun(suite, "random/float", [&]() {
+        float value = heRandomFloat(&random, -1.f, 1.f);
+        benchKeep(value);
+    });
+
+    benchRun(suite, "random/int", [&]() {
+        int32_t value = heRandomInt(&random, 0, 100);
+        benchKeep(value);
+    });
+
+    std::vector<float> floats(1024);
+    std::vector<int32_t> ints(1024);
+    benchRun(suite, "random/fill floats (1024)", [&]() {
+        heRandomFillFloats(&random, floats.data(), (uint32_t) floats.size(), -1.f, 1.f);
+        benchKeep(floats[0]);
+    });
+
+    benchRun(suite, "random/fill ints (1024)", [&]() {
+        heRandomFillInts(&random, ints.data(), (uint32_t) ints.size(), 0, 100);
+        benchKeep(ints[0]);
+    });
+
+    HeRandomStream stream;
+    heRandomStreamCreate(&stream, 1, 0);
+    benchRun(suite, "random/stream float", [&]() {
+        float value = heRandomStreamFloat(&stream, -1.f, 1.f);
+        benchKeep(value);
+    });
+
+    HePerlinNoise noise;
+    hePerlinNoiseCreate(&noise);
+    hm::vec3d position(.5, .25, .125);
+
+    benchRun(suite, "noise/perlin 3d", [&]() {
+        position.x += .01;
+        double value = hePerlinNoise3D(&noise, position);
+        benchKeep(value);
+    });
+
+    // whole grids of 4096 points per iteration, compare per point with the scalar perlin noise above
+    const char* NOISE_NAMES[] = { "perlin", "simplex", "value", "cellular" };
+    std::vector<float> grid(16 * 16 * 16);
+    for(uint8_t type = 0; type < 4; ++type) {
+        HeNoise settings;
+        settings.type      = (HeNoiseType) type;
+        settings.frequency = .1f;
+        benchRun(suite, std::string("noise/") + NOISE_NAMES[type] + " 2d (grid 64x64)", [&]() {
+            heNoiseFillGrid2D(&settings, grid.data(), hm::vec2f(.5f, .25f), hm::vec2f(1.f), 64, 64);
+            benchKeep(grid[0]);
+        });
+
+        benchRun(suite, std::string("noise/") + NOISE_NAMES[type] + " 3d (grid 16x16x16)", [&]() {
+            heNoiseFillGrid3D(&settings, grid.data(), hm::vec3f(.5f, .25f, .125f), hm::vec3f(1.f), 16, 16, 16);
+            benchKeep(grid[0]);
+        });
+    }
+
+    // every type, dimension and fractal has to stay in [-1, 1] over a lot of random positions. The positions have their
+    // own generator so that every run checks the same ones. The simplex scale is only close to exact, so its extremes
+    // may be off by a bit
+    const char* FRACTAL_NAMES[] = { "", " fbm", " ridged", " warped" };
+    uint32_t const sampleCount = 200003;
+    std::vector<float> sampleX(sampleCount), sampleY(sampleCount), sampleZ(sampleCount), samples(sampleCount);
+    HeRandom positions;
+    heRandomCreate(&positions, 3);
+    heRandomFillFloats(&positions, sampleX.data(), sampleCount, -500.f, 500.f);
+    heRandomFillFloats(&positions, sampleY.data(), sampleCount, -500.f, 500.f);
+    heRandomFillFloats(&positions, sampleZ.data(), sampleCount, -500.f, 500.f);
+    for(uint8_t type = 0; type < 4; ++type) {
+        for(uint8_t fractalType = 0; fractalType < 4; ++fractalType) {
+            HeNoise settings;
+            settings.type          = (HeNoiseType) type;
+            settings.fractal       = (fractalType == 3) ? HE_NOISE_FRACTAL_FBM : (HeNoiseFractal) fractalType;
+            settings.warpAmplitude = (fractalType == 3) ? 1.f : 0.f;
+            settings.seed          = 11 * type + fractalType;
+            for(uint8_t dimension = 2; dimension <= 3; ++dimension) {
+                if(dimension == 2)
+                    heNoiseSample2D(&settings, sampleX.data(), sampleY.data(), samples.data(), sampleCount);
+                else
+                    heNoiseSample3D(&settings, sampleX.data(), sampleY.data(), sampleZ.data(), samples.data(), sampleCount);
+
+                float min = FLT_MAX, max = -FLT_MAX;
+                for(float const& sample : samples) {
+                    min = std::min(min, sample);
+                    max = std::max(max, sample);
+                }
+
+                benchCheck(suite, min >= -1.0001f && max <= 1.0001f, std::string(NOISE_NAMES[type]) + " " + std::to_string(dimension) + "d" + FRACTAL_NAMES[fractalType] +
+                           " noise is in [" + std::to_string(min) + ", " + std::to_string(max) + "], not in [-1, 1]");
+            }
+        }
+    }
+
+    HeNoise fractal;
+    fractal.type          = HE_NOISE_TYPE_SIMPLEX;
+    fractal.fractal       = HE_NOISE_FRACTAL_FBM;
+    fractal.octaves       = 4;
+    fractal.frequency     = .02f;
+    fractal.warpAmplitude = 1.f;
+    benchRun(suite, "noise/simplex 2d fbm, 4 octaves, warped (grid 64x64)", [&]() {
+        heNoiseFillGrid2D(&fractal, grid.data(), hm::vec2f(.5f, .25f), hm::vec2f(1.f), 64, 64);
+        benchKeep(grid[0]);
+    });
+};
+
+void benchParticles(BenchSuite* suite) {
+    // the atlas is only used for its dimensions, no gl texture is created
+    HeTexture texture;
+    texture.size = hm::vec2i(256);
+    HeSpriteAtlas atlas;
+    atlas.texture = &texture;
+    atlas.rows    = 4;
+    atlas.columns = 4;
+    atlas.count   = 16;
+
+    HeD3Level level;
+    level.camera.viewMatrix = hm::createViewMatrix(hm::vec3f(0.f, 2.f, 5.f), hm::vec3f(15.f, 30.f, 0.f));
+
+    { // bursts only fill the free room of the pool, and the living particles stay packed at its start. After the
+      // burst dies out, 300 particles per second that live one second on average give about 300 living particles
+        HeParticleSource source;
+        heParticleSourceCreate(&source, HeD3Transformation(hm::vec3f(0.f)), &atlas, 5, 1000);
+        source.emitter.type    = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+        source.emitter.sphere  = 1.f;
+        source.emitter.minTime = .5f;
+        source.emitter.maxTime = 1.5f;
+        source.emissionRate    = 300.f;
+        heRandomCreate(&source.emitter.random, 2);
+        uint32_t first  = heParticleSourceEmitBurst(&source, 700);
+        uint32_t second = heParticleSourceEmitBurst(&source, 700);
+        uint32_t third  = heParticleSourceEmitBurst(&source, 700);
+        benchCheck(suite, first == 700 && second == 300 && third == 0 && source.aliveCount == 1000,
+                   "bursts of 700 into a pool of 1000 spawned " + std::to_string(first) + ", " + std::to_string(second) + " and " + std::to_string(third));
+
+        uint32_t overflows = 0, dead = 0;
+        for(uint32_t i = 0; i < 300; ++i) {
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+            overflows += source.aliveCount > source.particleCount;
+            for(uint32_t j = 0; j < source.aliveCount; ++j)
+                dead += source.particles.remaining[j] <= 0.f;
+        }
+
+        benchCheck(suite, overflows == 0, "more particles alive than the pool holds in " + std::to_string(overflows) + " updates");
+        benchCheck(suite, dead == 0, std::to_string(dead) + " dead particles were left among the living ones");
+        benchCheck(suite, source.aliveCount >= 240 && source.aliveCount <= 360, std::to_string(source.aliveCount) +
+                   " particles alive at 300 per second with one second of life");
+        free(source.dataBuffer);
+    }
+
+    { // 10 particles per second at 60 updates per second, the fractions must add up instead of being dropped
+        HeParticleSource source;
+        heParticleSourceCreate(&source, HeD3Transformation(hm::vec3f(0.f)), &atlas, 5, 100);
+        source.emitter.minTime = 100.f;
+        source.emitter.maxTime = 100.f;
+        source.emissionRate    = 10.f;
+        heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+        b8 carried = source.aliveCount == 0 && std::abs(source.emissionCarry - 1.f / 6.f) < 1e-4f;
+        for(uint32_t i = 1; i < 60; ++i)
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+        benchCheck(suite, carried && source.aliveCount >= 9 && source.aliveCount <= 10 && source.emissionCarry >= 0.f && source.emissionCarry < 1.f,
+                   "an emission rate of 10 spawned " + std::to_string(source.aliveCount) + " particles in one second");
+        free(source.dataBuffer);
+    }
+
+    const uint32_t COUNTS[] = { 1000, 10000, 100000 };
+    for(uint32_t const& count : COUNTS) {
+        HeParticleSource source;
+        heParticleSourceCreate(&source, HeD3Transformation(hm::vec3f(0.f)), &atlas, 5, count);
+        source.emitter.type = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+        source.emitter.sphere = 1.f;
+        heRandomCreate(&source.emitter.random, 1);
+        // keep the pool full, dead particles are replaced in the same update
+        source.maxNewParticlesPerUpdate = count;
+        heParticleSourceEmitBurst(&source, count);
+
+        benchRun(suite, "particles/update (" + std::to_string(count) + ")", [&]() {
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+            benchKeep(source.dataBuffer[0]);
+        });
+
+        // heParticleSourceDestroy would also destroy the atlas texture
+        free(source.dataBuffer);
+    }
+
+    { // a large pool that is mostly empty only costs its living particles
+        HeParticleSource source;
+        heParticleSourceCreate(&source, HeD3Transformation(hm::vec3f(0.f)), &atlas, 5, 100000);
+        source.emitter.type   = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+        source.emitter.sphere = 1.f;
+        source.emissionRate   = 1000.f;
+        heRandomCreate(&source.emitter.random, 1);
+        for(uint32_t i = 0; i < 120; ++i) // reach the steady state
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+
+        benchRun(suite, "particles/update (100000 pool, 1000 per second)", [&]() {
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+            benchKeep(source.aliveCount);
+        });
+
+        free(source.dataBuffer);
+    }
+
+    { // a full pool of slow smoke sorted back to front in every update. The order of the last update is usually
+      // only repaired, the full sort is what happens when the view or the particles change a lot
+        HeParticleSource source;
+        heParticleSourceCreate(&source, HeD3Transformation(hm::vec3f(0.f)), &atlas, 5, 100000);
+        source.emitter.type     = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+        source.emitter.sphere   = 4.f;
+        source.emitter.minSpeed = .05f;
+        source.emitter.maxSpeed = .2f;
+        source.emitter.minTime  = 2.f;
+        source.emitter.maxTime  = 6.f;
+        source.gravity          = 0.f;
+        source.maxNewParticlesPerUpdate = 100000;
+        source.depthSort        = true;
+        heRandomCreate(&source.emitter.random, 1);
+        heParticleSourceEmitBurst(&source, 100000);
+        for(uint32_t i = 0; i < 60; ++i)
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+
+        // the instances must be back to front, i.e. with ascending view depth. The sort only uses 16 bits of the depth
+        // range, so very close particles may be swapped
+        hm::mat4f const& view = level.camera.viewMatrix;
+        for(uint32_t i = 1; i < source.aliveCount; ++i) {
+            hm::vec3f const& a = source.dataBuffer[i - 1].position;
+            hm::vec3f const& b = source.dataBuffer[i].position;
+            if(!benchCheck(suite, view[0][2] * a.x + view[1][2] * a.y + view[2][2] * a.z <= view[0][2] * b.x + view[1][2] * b.y + view[2][2] * b.z + 1e-3f,
+                           "particles are not sorted back to front"))
+                break;
+        }
+
+        benchRun(suite, "particles/update (100000, depth sorted)", [&]() {
+            heParticleSourceUpdate(&source, 1.f / 60.f, &level);
+            benchKeep(source.dataBuffer[0]);
+        });
+
+        benchRun(suite, "particles/depth sort (100000, unchanged)", [&]() {
+            heParticleSourceSortByDepth(&source, view);
+            benchKeep(source.drawOrder[0]);
+        });
+
+        benchRun(suite, "particles/depth sort (100000, from scratch)", [&]() {
+            source.drawOrder.clear();
+            heParticleSourceSortByDepth(&source, view);
+            benchKeep(source.drawOrder[0]);
+        });
+
+        free(source.dataBuffer);
+    }
+
+    { // a few large sources updated with 1, 2, 4... threads. Every thread count must give exactly the same particles
+        const uint32_t SOURCE_COUNT   = 4;
+        const uint32_t PARTICLE_COUNT = 100000;
+        auto createSources = [&](HeD3Level* target) {
+            for(uint32_t i = 0; i < SOURCE_COUNT; ++i) {
+                HeParticleSource* source = &target->particles.emplace_back();
+                heParticleSourceCreate(source, HeD3Transformation(hm::vec3f((float) i, 0.f, 0.f)), &atlas, 5, PARTICLE_COUNT);
+                source->emitter.type   = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+                source->emitter.sphere = 1.f;
+                source->emissionRate   = PARTICLE_COUNT * 1.5f;
+                heRandomCreate(&source->emitter.random, i + 1);
+                heParticleSourceEmitBurst(source, PARTICLE_COUNT / 2);
+            }
+        };
+
+        // a hash over the instance data of all sources after a fixed number of updates
+        auto simulate = [&](HeD3Level* target) -> uint64_t {
+            for(uint32_t i = 0; i < 30; ++i)
+                heD3LevelUpdateParticles(target, 1.f / 60.f);
+
+            uint64_t hash = 14695981039346656037ull;
+            for(auto const& all : target->particles) {
+                unsigned char const* bytes = (unsigned char const*) all.dataBuffer;
+                for(size_t i = 0; i < all.aliveCount * sizeof(HeParticleInstance); ++i)
+                    hash = (hash ^ bytes[i]) * 1099511628211ull;
+                hash = (hash ^ all.aliveCount) * 1099511628211ull;
+            }
+            return hash;
+        };
+
+        uint64_t expected = 0;
+        uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+        for(uint32_t threads = 1; threads <= cores; threads *= 2) {
+            if(threads > 1)
+                heWorkerPoolCreate(&heWorkerPool, threads - 1);
+
+            HeD3Level particles;
+            particles.camera.viewMatrix = level.camera.viewMatrix;
+            createSources(&particles);
+            uint64_t hash = simulate(&particles);
+            if(threads == 1)
+                expected = hash;
+            else
+                benchCheck(suite, hash == expected, "particles differ between 1 and " + std::to_string(threads) + " threads");
+
+            benchRun(suite, "particles/level update (4x100000, " + std::to_string(threads) + " threads)", [&]() {
+                heD3LevelUpdateParticles(&particles, 1.f / 60.f);
+                benchKeep(particles.particles.back().aliveCount);
+            });
+
+            heWorkerPoolDestroy(&heWorkerPool);
+            for(auto& all : particles.particles)
+                free(all.dataBuffer);
+        }
+    }
+};
+
+void benchAssets(BenchSuite* suite) {
+    const uint32_t ENTRY_COUNT = 1000;
+    std::vector<std::string> names;
+    names.reserve(ENTRY_COUNT);
+    for(uint32_t i = 0; i < ENTRY_COUNT; ++i) {
+        names.emplace_back("res/assets/bin/bench_asset_" + std::to_string(i) + ".h3asset");
+        heAssetPool.meshPool[names.back()];
+        heAssetPool.materialPool[names.back()];
+        heAssetPool.spriteAtlasPool[names.back()];
+    }
+
+    uint32_t index = 0;
+    benchRun(suite, "assets/mesh lookup", [&]() {
+        HeVao* vao = heAssetPoolGetMesh(names[index++ % ENTRY_COUNT]);
+        benchKeep(vao);
+    });
+
+    benchRun(suite, "assets/material lookup", [&]() {
+        HeMaterial* material = heAssetPoolGetMaterial(names[index++ % ENTRY_COUNT]);
+        benchKeep(material);
+    });
+
+    benchRun(suite, "assets/sprite atlas lookup", [&]() {
+        HeSpriteAtlas* atlas = heAssetPoolGetSpriteAtlas(names[index++ % ENTRY_COUNT]);
+        benchKeep(atlas);
+    });
+
+    std::string missing = "res/assets/bin/not_in_pool.h3asset";
+    benchRun(suite, "assets/material lookup (miss)", [&]() {
+        HeMaterial* material = heAssetPoolGetMaterial(missing);
+        benchKeep(material);
+    });
+
+    for(std::string const& all : names) {
+        heAssetPool.meshPool.erase(all);
+        heAssetPool.materialPool.erase(all);
+        heAssetPool.spriteAtlasPool.erase(all);
+    }
+};
+
+void benchLevel(BenchSuite* suite) {
+    const uint32_t INSTANCE_COUNT = 10000;
+    HeD3Level level;
+    HeVao mesh; // only the bounds are used
+    mesh.boundsMin    = hm::vec3f(-.5f);
+    mesh.boundsMax    = hm::vec3f(.5f);
+    mesh.boundsRadius = hm::length(mesh.boundsMax);
+    std::vector<HeD3InstanceId> ids;
+    ids.reserve(INSTANCE_COUNT);
+    for(uint32_t i = 0; i < INSTANCE_COUNT; ++i) {
+        HeD3Instance* instance = heD3LevelAddInstance(&level);
+        instance->mesh = &mesh;
+        instance->transformation.position = hm::vec3f((float) (i % 100), 0.f, (float) (i / 100));
+        ids.emplace_back(instance->id);
+    }
+
+    benchRun(suite, "level/update instances (10k)", [&]() {
+        for(uint32_t i = 0; i < (uint32_t) level.instances.size(); ++i)
+            heD3LevelUpdateInstance(&level, i);
+        benchKeep(level.instances.size());
+    });
+
+    benchRun(suite, "level/update matrices (10k)", [&]() {
+        for(uint32_t i = 0; i < (uint32_t) level.instances.size(); ++i) {
+            level.instanceFlags[i] |= HE_D3_INSTANCE_FLAG_DIRTY;
+            heD3LevelUpdateInstanceMatrices(&level, i);
+        }
+        benchKeep(level.instanceWorldMatrices[0]);
+    });
+
+    HeD3Frustum frustum;
+    hm::mat4f projection = hm::createPerspectiveProjectionMatrix(70.f, 16.f / 9.f, .1f, 1000.f);
+    hm::mat4f view       = hm::createViewMatrix(hm::vec3f(50.f, 2.f, -10.f), hm::vec3f(0.f, 180.f, 0.f));
+    heD3FrustumUpdatePlanes(&frustum, projection * view);
+    benchRun(suite, "level/frustum cull (10k)", [&]() {
+        uint32_t culled = heD3LevelCullInstances(&level, &frustum);
+        benchKeep(culled);
+    });
+
+    // the four-wide culling must agree with the scalar test. The count is not a multiple of four so that the tail runs
+    // too, and the instances are scattered around the camera so that many boxes cross the planes
+    {
+        HeD3Level scattered;
+        HeRandom random;
+        heRandomCreate(&random, 5);
+        for(uint32_t i = 0; i < 1003; ++i) {
+            HeD3Instance* instance = heD3LevelAddInstance(&scattered);
+            instance->mesh = &mesh;
+            instance->transformation.position = hm::vec3f(heRandomFloat(&random, -20.f, 120.f), heRandomFloat(&random, -40.f, 40.f), heRandomFloat(&random, -30.f, 110.f));
+            instance->transformation.scale    = hm::vec3f(heRandomFloat(&random, .1f, 8.f));
+        }
+
+        heD3LevelCullInstances(&scattered, &frustum);
+        std::vector<uint32_t> expected;
+        for(uint32_t i = 0; i < (uint32_t) scattered.instances.size(); ++i)
+            if(heD3FrustumContainsBox(&frustum, scattered.instanceBoundsCenters[i], scattered.instanceBoundsExtents[i]))
+                expected.emplace_back(i);
+
+        benchCheck(suite, scattered.visibleInstances == expected && !expected.empty() && expected.size() < scattered.instances.size(),
+                   "frustum culling returned " + std::to_string(scattered.visibleInstances.size()) + " instances, the scalar test " +
+                   std::to_string(expected.size()));
+    }
+
+    // 4 shaders with 16 materials each (a quarter of them transparent), all instances are drawn
+    HeShaderProgram shaders[4];
+    HeMaterial materials[64];
+    for(uint32_t i = 0; i < 4; ++i)
+        shaders[i].programId = i + 1;
+    for(uint32_t i = 0; i < 64; ++i) {
+        materials[i].shader      = &shaders[i % 4];
+        materials[i].transparent = (i % 4 == 3);
+    }
+
+    for(uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        level.instances[i].material = &materials[(i * 7) % 64];
+
+    level.camera.viewMatrix = view;
+    level.visibleInstances.resize(INSTANCE_COUNT);
+    for(uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+        level.visibleInstances[i] = i;
+
+    benchRun(suite, "level/build render queue (10k)", [&]() {
+        heD3LevelBuildRenderQueue(&level);
+        benchKeep(level.renderQueue.opaqueCount);
+    });
+
+    // opaque draws must be grouped by material, transparent ones must be back to front. The key only keeps 7 bits of
+    // the mantissa of the distance, so close draws may be swapped. The queue is built again in case the case above
+    // was filtered out
+    heD3LevelBuildRenderQueue(&level);
+    HeD3RenderQueue const& queue = level.renderQueue;
+    auto distance = [&view](hm::vec3f const& p) { return -(view[0][2] * p.x + view[1][2] * p.y + view[2][2] * p.z + view[3][2]); };
+    uint32_t materialChanges = 0;
+    for(size_t i = 1; i < queue.items.size(); ++i) {
+        HeD3Instance const* a = &level.instances[queue.items[i - 1].index];
+        HeD3Instance const* b = &level.instances[queue.items[i].index];
+        if(i < queue.opaqueCount && a->material != b->material)
+            materialChanges++;
+        if(i > queue.opaqueCount && !benchCheck(suite, distance(level.instanceBoundsCenters[queue.items[i - 1].index]) >=
+                                                distance(level.instanceBoundsCenters[queue.items[i].index]) * .99f, "transparent draws are not sorted back to front"))
+            break;
+    }
+
+    // 48 opaque materials, so 47 changes between them
+    benchCheck(suite, queue.opaqueCount == INSTANCE_COUNT / 4 * 3 && materialChanges == 47, "render queue is not grouped by material");
+
+    benchRun(suite, "level/build tree (10k)", [&]() {
+        heD3LevelBuildTree(&level);
+        benchKeep(level.instanceTree.root);
+    });
+
+    uint32_t results[1024];
+    benchRun(suite, "level/tree frustum query (10k)", [&]() {
+        uint32_t count = heBvhQueryFrustum(&level.instanceTree, frustum.planes, results, 1024);
+        benchKeep(count);
+    });
+
+    benchRun(suite, "level/tree sphere query (10k)", [&]() {
+        uint32_t count = heBvhQuerySphere(&level.instanceTree, hm::vec3f(50.f, 0.f, 50.f), 5.f, results, 1024);
+        benchKeep(count);
+    });
+
+    benchRun(suite, "level/raycast (10k)", [&]() {
+        HeD3Instance* hit = heD3LevelRaycastInstance(&level, hm::vec3f(-10.f, 0.f, 50.5f), hm::vec3f(1.f, 0.f, 0.f), 1000.f, nullptr);
+        benchKeep(hit);
+    });
+
+    // the ray passes through a whole row of instances, the closest one must be found no matter how many boxes it hits
+    heD3LevelBuildTree(&level);
+    float rayDistance = 0.f;
+    HeD3Instance* rayHit = heD3LevelRaycastInstance(&level, hm::vec3f(-10.f, 0.f, 50.5f), hm::vec3f(1.f, 0.f, 0.f), 1000.f, &rayDistance);
+    HeD3Instance* rayExpected = nullptr;
+    float rayExpectedDistance = 1000.f;
+    for(uint32_t i = 0; i < (uint32_t) level.instances.size(); ++i) {
+        hm::vec3f min = level.instanceBoundsCenters[i] - level.instanceBoundsExtents[i];
+        hm::vec3f max = level.instanceBoundsCenters[i] + level.instanceBoundsExtents[i];
+        if(50.5f < min.z || 50.5f > max.z || 0.f < min.y || 0.f > max.y || max.x < -10.f)
+            continue;
+
+        float entry = std::max(min.x + 10.f, 0.f);
+        if(entry < rayExpectedDistance) {
+            rayExpected         = &level.instances[i];
+            rayExpectedDistance = entry;
+        }
+    }
+
+    // the ray runs along the border of two rows, so either of two instances may be returned
+    benchCheck(suite, rayHit != nullptr && rayExpected != nullptr && std::abs(rayDistance - rayExpectedDistance) <= 1e-4f,
+               "raycast did not return the closest instance");
+
+    // the queries against brute force. The tree tests the boxes fattened by its margin, so the results must be exactly
+    // the instances whose fattened box overlaps, which includes all instances whose actual box overlaps
+    std::vector<uint32_t> queryResults(INSTANCE_COUNT);
+    auto checkQuery = [&](std::string const& name, uint32_t const count, std::function<b8(hm::vec3f const&, hm::vec3f const&)> const& overlaps) {
+        std::vector<uint32_t> found(queryResults.begin(), queryResults.begin() + count);
+        std::sort(found.begin(), found.end());
+        std::vector<uint32_t> fattened;
+        uint32_t missed = 0;
+        for(uint32_t i = 0; i < (uint32_t) level.instances.size(); ++i) {
+            hm::vec3f const& center = level.instanceBoundsCenters[i];
+            hm::vec3f const& extent = level.instanceBoundsExtents[i];
+            if(extent.x < 0.f)
+                continue;
+
+            if(overlaps(center, extent + hm::vec3f(level.instanceTree.margin)))
+                fattened.emplace_back(level.instances[i].id.index);
+            if(overlaps(center, extent) && !std::binary_search(found.begin(), found.end(), level.instances[i].id.index))
+                missed++;
+        }
+
+        std::sort(fattened.begin(), fattened.end());
+        benchCheck(suite, found == fattened && missed == 0 && !found.empty(), name + " query returned " + std::to_string(found.size()) + " instances, " +
+                   std::to_string(fattened.size()) + " fattened boxes overlap and " + std::to_string(missed) + " overlapping instances are missing");
+    };
+
+    hm::vec3f const queryMin(20.3f, -1.f, 30.7f), queryMax(27.9f, .2f, 36.1f);
+    checkQuery("box", heBvhQueryBox(&level.instanceTree, queryMin, queryMax, queryResults.data(), INSTANCE_COUNT), [&](hm::vec3f const& center, hm::vec3f const& extent) {
+        return center.x - extent.x <= queryMax.x && center.x + extent.x >= queryMin.x && center.y - extent.y <= queryMax.y && center.y + extent.y >= queryMin.y &&
+            center.z - extent.z <= queryMax.z && center.z + extent.z >= queryMin.z;
+    });
+
+    hm::vec3f const sphereCenter(50.f, 0.f, 50.f);
+    float const sphereRadius = 5.3f;
+    checkQuery("sphere", heBvhQuerySphere(&level.instanceTree, sphereCenter, sphereRadius, queryResults.data(), INSTANCE_COUNT), [&](hm::vec3f const& center, hm::vec3f const& extent) {
+        hm::vec3f offset = center - sphereCenter;
+        hm::vec3f outside(std::max(std::abs(offset.x) - extent.x, 0.f), std::max(std::abs(offset.y) - extent.y, 0.f), std::max(std::abs(offset.z) - extent.z, 0.f));
+        return hm::length2(outside) <= sphereRadius * sphereRadius;
+    });
+
+    checkQuery("frustum", heBvhQueryFrustum(&level.instanceTree, frustum.planes, queryResults.data(), INSTANCE_COUNT), [&](hm::vec3f const& center, hm::vec3f const& extent) {
+        return heD3FrustumContainsBox(&frustum, center, extent);
+    });
+
+    uint32_t index = 0;
+    benchRun(suite, "level/get instance by id", [&]() {
+        HeD3Instance* instance = heD3LevelGetInstanceById(&level, ids[index++ % INSTANCE_COUNT]);
+        benchKeep(instance);
+    });
+
+    benchRun(suite, "level/remove + add instance", [&]() {
+        uint32_t i = index++ % INSTANCE_COUNT;
+        heD3LevelRemoveInstanceById(&level, ids[i]);
+        ids[i] = heD3LevelAddInstance(&level)->id;
+    });
+
+    // 100 rigs of 99 children in chains of three, only the roots move
+    HeD3Level rigs;
+    std::vector<HeD3InstanceId> roots;
+    for(uint32_t i = 0; i < INSTANCE_COUNT; ++i) {
+        HeD3Instance* instance = heD3LevelAddInstance(&rigs);
+        instance->mesh = &mesh;
+        instance->transformation.position = hm::vec3f(1.f, 0.f, 0.f);
+        if(i % 100 == 0)
+            roots.emplace_back(instance->id);
+        else
+            heD3LevelSetInstanceParent(&rigs, instance->id, (i % 3 == 0) ? roots.back() : HeD3InstanceId{ instance->id.index - 1, 1 });
+    }
+
+    heD3LevelUpdateBounds(&rigs);
+    float time = 0.f;
+    benchRun(suite, "level/propagate hierarchy (10k)", [&]() {
+        time += .01f;
+        for(HeD3InstanceId const& all : roots)
+            heD3LevelSetInstanceRotation(&rigs, heD3LevelGetInstanceById(&rigs, all), hm::quatf(0.f, std::sin(time), 0.f, std::cos(time)));
+        heD3LevelUpdateTransforms(&rigs);
+        benchKeep(rigs.instanceWorldMatrices.back());
+    });
+
+    // a random hierarchy against the product of the local matrices along the parent chain. After moving some nodes and
+    // removing a few parents (whose children become roots), only the moved subtrees and the new roots may be rebuilt.
+    // The normal matrices of all other instances are poisoned before the update (the children only read the world
+    // matrices) and must stay untouched
+    HeD3Level tree;
+    HeRandom random;
+    heRandomCreate(&random, 9);
+    std::vector<HeD3InstanceId> nodes;
+    for(uint32_t i = 0; i < 2000; ++i) {
+        HeD3Instance* instance = heD3LevelAddInstance(&tree);
+        instance->mesh = &mesh;
+        instance->transformation.position = hm::vec3f(heRandomFloat(&random, -2.f, 2.f), heRandomFloat(&random, -2.f, 2.f), heRandomFloat(&random, -2.f, 2.f));
+        instance->transformation.rotation = hm::fromEulerDegrees(hm::vec3f(heRandomFloat(&random, -180.f, 180.f), heRandomFloat(&random, -180.f, 180.f), 0.f));
+        instance->transformation.scale    = hm::vec3f(heRandomFloat(&random, .8f, 1.2f), heRandomFloat(&random, .8f, 1.2f), heRandomFloat(&random, .8f, 1.2f));
+        if(i > 0 && heRandomInt(&random, 0, 4) > 0)
+            heD3LevelSetInstanceParent(&tree, instance->id, nodes[heRandomInt(&random, std::max((int32_t) i - 20, 0), (int32_t) i - 1)]);
+        nodes.emplace_back(instance->id);
+    }
+
+    auto checkHierarchy = [&](std::string const& when) {
+        float maxError = 0.f;
+        for(uint32_t i = 0; i < (uint32_t) tree.instances.size(); ++i) {
+            hm::mat4f expected(1.f);
+            for(HeD3Instance const* node = &tree.instances[i]; node != nullptr; node = heD3LevelGetInstanceById(&tree, node->parent))
+                expected = hm::createTransformationMatrix(node->transformation.position, node->transformation.rotation, node->transformation.scale) * expected;
+            for(uint8_t c = 0; c < 4; ++c)
+                for(uint8_t r = 0; r < 4; ++r)
+                    maxError = std::max(maxError, std::abs(tree.instanceWorldMatrices[i][c][r] - expected[c][r]));
+        }
+
+        benchCheck(suite, maxError < 1e-3f, "world matrices " + when + " are off by " + std::to_string(maxError));
+    };
+
+    heD3LevelUpdateTransforms(&tree);
+    checkHierarchy("of a new hierarchy");
+
+    // the slots of the moved instances and of the new roots
+    std::vector<uint32_t> changed;
+    for(uint32_t i = 0; i < (uint32_t) nodes.size(); i += 13) {
+        HeD3Instance* instance = heD3LevelGetInstanceById(&tree, nodes[i]);
+        heD3LevelSetInstancePosition(&tree, instance, instance->transformation.position + hm::vec3f(.5f, -.25f, 1.f));
+        changed.emplace_back(nodes[i].index);
+    }
+
+    uint32_t removedParents = 0;
+    for(uint32_t i = 5; i < (uint32_t) nodes.size() && removedParents < 20; i += 17) {
+        HeD3Instance* instance = heD3LevelGetInstanceById(&tree, nodes[i]);
+        if(instance == nullptr || instance->firstChild == UINT32_MAX)
+            continue;
+
+        for(uint32_t child = instance->firstChild; child != UINT32_MAX; child = tree.instances[tree.instanceSlots[child].denseIndex].nextSibling)
+            changed.emplace_back(child);
+        heD3LevelRemoveInstanceById(&tree, nodes[i]);
+        removedParents++;
+    }
+
+    uint32_t expectedDirty = 0;
+    for(uint32_t i = 0; i < (uint32_t) tree.instances.size(); ++i) {
+        b8 dirty = false;
+        for(HeD3Instance const* node = &tree.instances[i]; node != nullptr && !dirty; node = heD3LevelGetInstanceById(&tree, node->parent))
+            dirty = std::find(changed.begin(), changed.end(), node->id.index) != changed.end();
+        if(dirty)
+            expectedDirty++;
+        else
+            tree.instanceNormalMatrices[i] = hm::mat3f(0.f);
+    }
+
+    heD3LevelUpdateTransforms(&tree);
+    uint32_t rebuilt = 0, wrong = 0;
+    for(uint32_t i = 0; i < (uint32_t) tree.instances.size(); ++i)
+        rebuilt += tree.instanceNormalMatrices[i][0][0] != 0.f || tree.instanceNormalMatrices[i][1][1] != 0.f;
+
+    for(uint32_t i = 0; i < (uint32_t) tree.dirtyInstances.size(); ++i)
+        for(uint32_t const& index : tree.dirtyInstances[i])
+            wrong += tree.instances[index].depth != i;
+
+    benchCheck(suite, removedParents == 20 && rebuilt == expectedDirty && expectedDirty < tree.instances.size() / 2,
+               "the hierarchy update rebuilt " + std::to_string(rebuilt) + " instances instead of the " + std::to_string(expectedDirty) + " dirty ones");
+    benchCheck(suite, wrong == 0, std::to_string(wrong) + " instances were updated at the wrong depth level");
+    checkHierarchy("after moving nodes and removing parents");
+};
+
+void benchLights(BenchSuite* suite) {
+    const uint32_t LIGHT_COUNT = 127;
+    HeD3Level level;
+    level.camera.projectionMatrix = hm::createPerspectiveProjectionMatrix(70.f, 16.f / 9.f, .1f, 1000.f);
+    level.camera.viewMatrix       = hm::createViewMatrix(hm::vec3f(0.f, 2.f, 0.f), hm::vec3f(0.f, 180.f, 0.f));
+    HeD3LightSource* sun = &level.lights.emplace_back(); // without shadow map, that would need a context
+    sun->type   = HE_LIGHT_SOURCE_TYPE_DIRECTIONAL;
+    sun->vector = hm::vec3f(0.f, -1.f, 0.f);
+    sun->colour = hm::colour(255, 255, 255, 1.f);
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> position(-50.f, 50.f);
+    for(uint32_t i = 1; i < LIGHT_COUNT; ++i)
+        heD3LightSourceCreatePoint(&level, hm::vec3f(position(random), 1.f, position(random)), 1.f, .35f, .44f, hm::colour(255, 200, 150, 1.f));
+
+    benchRun(suite, "lights/cluster grid", [&]() {
+        level.lightClusters.farPlane = 0.f; // force a rebuild
+        heD3LightClustersUpdateGrid(&level.lightClusters, level.camera.projectionMatrix, .1f, 1000.f);
+        benchKeep(level.lightClusters.clusterMin[0]);
+    });
+
+    benchRun(suite, "lights/cluster assignment (127)", [&]() {
+        heD3LevelUpdateLightClusters(&level);
+        benchKeep(level.lightClusters.lightIndices.size());
+    });
+
+    // a sun, a point and a spot light in front of the camera and a point light behind it. The sun must be the first
+    // light of every cluster, the others must be in exactly the clusters that their range reaches (tested against
+    // every cluster box), never outside of the slices of their depth range and always in the cluster of their center
+    {
+        HeD3Level lit;
+        lit.camera.projectionMatrix = level.camera.projectionMatrix;
+        lit.camera.viewMatrix       = hm::createViewMatrix(hm::vec3f(0.f), hm::vec3f(0.f));
+        lit.camera.frustum.viewInfo.nearPlane = .1f;
+        lit.camera.frustum.viewInfo.farPlane  = 1000.f;
+        HeD3LightSource* litSun = &lit.lights.emplace_back();
+        litSun->type   = HE_LIGHT_SOURCE_TYPE_DIRECTIONAL;
+        litSun->vector = hm::vec3f(0.f, -1.f, 0.f);
+        litSun->colour = hm::colour(255, 255, 255, 1.f);
+        heD3LightSourceCreatePoint(&lit, hm::vec3f(2.f, -1.f, -20.f), 1.f, .35f, .44f, hm::colour(255, 255, 255, .1f));
+        heD3LightSourceCreateSpot(&lit, hm::vec3f(-10.f, 4.f, -60.f), hm::vec3f(0.f, 0.f, -1.f), 20.f, 30.f, 1.f, .35f, .44f, hm::colour(255, 255, 255, .1f));
+        heD3LightSourceCreatePoint(&lit, hm::vec3f(0.f, 0.f, 30.f), 1.f, .35f, .44f, hm::colour(255, 255, 255, .1f));
+        heD3LevelUpdateLightClusters(&lit);
+
+        HeD3LightClusters const* clusters = &lit.lightClusters;
+        uint32_t const tiles = clusters->sizeX * clusters->sizeY;
+        uint32_t const count = tiles * clusters->sizeZ;
+        uint32_t sunMissing = 0;
+        for(uint32_t i = 0; i < count; ++i)
+            sunMissing += clusters->clusterData[i * 2 + 1] == 0 || clusters->lightIndices[clusters->clusterData[i * 2]] != 0;
+        benchCheck(suite, sunMissing == 0, "the directional light is missing in " + std::to_string(sunMissing) + " clusters");
+
+        uint32_t index = 0;
+        for(HeD3LightSource const& all : lit.lights) {
+            uint32_t light = index++;
+            if(light == 0)
+                continue; // the sun
+
+            hm::vec3f center = hm::vec3f(lit.camera.viewMatrix * hm::vec4f(all.vector, 1.f));
+            float range = heD3LightSourceGetRange(&all);
+            float depth = -center.z;
+            // the slices are spaced logarithmically between the near and the far plane
+            float sliceScale = clusters->sizeZ / std::log(1000.f / .1f);
+            int32_t minSlice = (int32_t) std::floor(std::log(std::max(depth - range, .1f) / .1f) * sliceScale);
+            int32_t maxSlice = (int32_t) std::floor(std::log(std::max(depth + range, .1f) / .1f) * sliceScale);
+
+            uint32_t wrong = 0, outside = 0, found = 0;
+            for(uint32_t i = 0; i < count; ++i) {
+                uint32_t const* data = &clusters->clusterData[i * 2];
+                b8 listed = std::find(clusters->lightIndices.begin() + data[0], clusters->lightIndices.begin() + data[0] + data[1], light) !=
+                            clusters->lightIndices.begin() + data[0] + data[1];
+                hm::vec3f closest(std::min(std::max(center.x, clusters->clusterMin[i].x), clusters->clusterMax[i].x),
+                                  std::min(std::max(center.y, clusters->clusterMin[i].y), clusters->clusterMax[i].y),
+                                  std::min(std::max(center.z, clusters->clusterMin[i].z), clusters->clusterMax[i].z));
+                b8 reached = hm::length2(center - closest) <= range * range && depth + range > .1f;
+                int32_t slice = (int32_t) (i / tiles);
+                wrong   += listed != reached;
+                outside += listed && (slice < minSlice || slice > maxSlice);
+                found   += listed;
+            }
+
+            std::string name = "light " + std::to_string(light);
+            benchCheck(suite, wrong == 0, name + " is binned wrong in " + std::to_string(wrong) + " clusters");
+            benchCheck(suite, outside == 0, name + " is in " + std::to_string(outside) + " clusters outside of its slices " +
+                       std::to_string(minSlice) + " to " + std::to_string(maxSlice));
+            if(depth - range > .1f) {
+                uint32_t const* data = &clusters->clusterData[heD3LightClustersGetIndex(clusters, center) * 2];
+                benchCheck(suite, found > 1 && std::count(clusters->lightIndices.begin() + data[0], clusters->lightIndices.begin() + data[0] + data[1], light) == 1,
+                           name + " is not in the cluster of its center");
+            } else if(depth + range < 0.f)
+                benchCheck(suite, found == 0, name + " behind the camera is in " + std::to_string(found) + " clusters");
+        }
+
+        // positions on the camera plane or behind it are clamped into the first slice
+        uint32_t const onPlane = heD3LightClustersGetIndex(clusters, hm::vec3f(0.f));
+        uint32_t const behind  = heD3LightClustersGetIndex(clusters, hm::vec3f(-3.f, 2.f, 5.f));
+        benchCheck(suite, onPlane < tiles && behind < tiles, "positions at or behind the camera fall into clusters " + std::to_string(onPlane) +
+                   " and " + std::to_string(behind) + " instead of the first slice");
+    }
+
+    // a field of 8k boxes around the camera, lit by the sun and a spot light
+    HeVao mesh;
+    mesh.boundsMin    = hm::vec3f(-.5f);
+    mesh.boundsMax    = hm::vec3f(.5f);
+    mesh.boundsRadius = hm::length(mesh.boundsMax);
+    for(uint32_t i = 0; i < 8000; ++i) {
+        HeD3Instance* instance = heD3LevelAddInstance(&level);
+        instance->mesh = &mesh;
+        instance->transformation.position = hm::vec3f((float) (i % 100) - 50.f, 0.f, (float) (i / 100) - 40.f);
+    }
+
+    heD3LevelUpdateBounds(&level);
+    heD3FrustumUpdatePlanes(&level.camera.frustum, level.camera.projectionMatrix * level.camera.viewMatrix);
+    level.camera.frustum.viewInfo.nearPlane = .1f;
+    level.camera.frustum.viewInfo.farPlane  = 1000.f;
+    sun->vector = hm::vec3f(.3f, -1.f, .2f);
+    benchRun(suite, "lights/shadow cascades (4)", [&]() {
+        heD3ShadowMapUpdateCascades(&sun->shadows, sun, &level.camera);
+        benchKeep(sun->shadows.cascades[3].splitDepth);
+    });
+
+    benchRun(suite, "lights/shadow casters (directional, 8k)", [&]() {
+        benchKeep(heD3LevelCullShadowCasters(&level, sun));
+    });
+
+    HeD3LightSource* spot = &level.lights.emplace_back();
+    spot->type   = HE_LIGHT_SOURCE_TYPE_SPOT;
+    spot->vector = hm::vec3f(0.f, 5.f, -10.f);
+    spot->colour = hm::colour(255, 255, 255, 1.f);
+    float spotData[8] = { 0.f, -.7071f, -.7071f, .9f, .8f, 1.f, .09f, .032f };
+    std::copy(spotData, spotData + 8, spot->data);
+    benchRun(suite, "lights/shadow casters (spot, 8k)", [&]() {
+        benchKeep(heD3LevelCullShadowCasters(&level, spot));
+    });
+
+    // the light volumes and the shadow sweep on single boxes. The camera sits at the origin and looks down -z with a
+    // fov of 90 degrees, both lights are 10 units in front of it and reach about 16 units
+    HeD3Level casterLevel;
+    casterLevel.camera.viewMatrix       = hm::mat4f(1.f);
+    casterLevel.camera.projectionMatrix = hm::createPerspectiveProjectionMatrix(90.f, 1.f, .1f, 1000.f);
+    casterLevel.camera.frustum.viewInfo.nearPlane = .1f;
+    casterLevel.camera.frustum.viewInfo.farPlane  = 1000.f;
+    heD3FrustumUpdatePlanes(&casterLevel.camera.frustum, casterLevel.camera.projectionMatrix);
+    HeD3Frustum const* cameraFrustum = &casterLevel.camera.frustum;
+    hm::vec3f const unit(.5f);
+
+    HeD3LightSource point;
+    point.type   = HE_LIGHT_SOURCE_TYPE_POINT;
+    point.vector = hm::vec3f(0.f, 0.f, -10.f);
+    point.colour = hm::colour(255, 255, 255, 1.f);
+    point.data[0] = 1.f;
+    point.data[2] = 1.f;
+    float const range = heD3LightSourceGetRange(&point);
+    benchCheck(suite, heD3LightVolumeContainsBox(&point, range, point.vector, unit), "point light does not contain the box around it");
+    benchCheck(suite, heD3LightVolumeContainsBox(&point, range, point.vector + hm::vec3f(range + .4f, 0.f, 0.f), unit), "point light misses a box at its range");
+    benchCheck(suite, !heD3LightVolumeContainsBox(&point, range, point.vector + hm::vec3f(range + .6f, 0.f, 0.f), unit), "point light contains a box beyond its range");
+    benchCheck(suite, !heD3LightVolumeContainsBox(&point, range, point.vector + hm::vec3f(range * .8f, range * .8f, 0.f), unit),
+               "point light contains a box in the corner of its bounds, outside of the sphere");
+
+    HeD3LightSource cone;
+    cone.type   = HE_LIGHT_SOURCE_TYPE_SPOT;
+    cone.vector = point.vector;
+    cone.colour = point.colour;
+    float const coneData[8] = { 0.f, 0.f, -1.f, .9f, .866f, 1.f, 0.f, 1.f }; // the outer cone has 30 degrees
+    std::copy(coneData, coneData + 8, cone.data);
+    auto coneBox = [&](float const degrees, float const distance) {
+        float radians = degrees * (float) hm::PI / 180.f;
+        return cone.vector + hm::vec3f(std::sin(radians), 0.f, -std::cos(radians)) * distance;
+    };
+
+    benchCheck(suite, heD3LightVolumeContainsBox(&cone, range, coneBox(0.f, 8.f), unit), "spot light misses a box on its axis");
+    benchCheck(suite, heD3LightVolumeContainsBox(&cone, range, coneBox(25.f, 8.f), unit), "spot light misses a box inside its cone");
+    benchCheck(suite, !heD3LightVolumeContainsBox(&cone, range, coneBox(60.f, 8.f), unit), "spot light contains a box outside of its cone");
+    benchCheck(suite, !heD3LightVolumeContainsBox(&cone, range, coneBox(180.f, 5.f), unit), "spot light contains a box behind it");
+    benchCheck(suite, !heD3LightVolumeContainsBox(&cone, range, coneBox(0.f, range + 1.f), unit), "spot light contains a box on its axis beyond its range");
+
+    // boxes outside of a plane only cast into the frustum if the light is further out than they are
+    HeD3LightSource down;
+    down.type   = HE_LIGHT_SOURCE_TYPE_DIRECTIONAL;
+    down.vector = hm::vec3f(0.f, -1.f, 0.f);
+    HeD3LightSource outside = point;
+    outside.vector = hm::vec3f(-60.f, 0.f, -10.f);
+    benchCheck(suite, heD3ShadowReachesFrustum(cameraFrustum, &down, down.vector, hm::vec3f(0.f, 0.f, -20.f), unit), "shadow of a visible box is culled");
+    benchCheck(suite, heD3ShadowReachesFrustum(cameraFrustum, &down, down.vector, hm::vec3f(0.f, 40.f, -20.f), unit), "shadow of a box above the view is culled");
+    benchCheck(suite, !heD3ShadowReachesFrustum(cameraFrustum, &down, down.vector, hm::vec3f(0.f, -40.f, -20.f), unit), "shadow of a box below the view is kept");
+    benchCheck(suite, !heD3ShadowReachesFrustum(cameraFrustum, &point, down.vector, hm::vec3f(0.f, 0.f, 5.f), unit),
+               "shadow of a box behind the camera, lit from the front, is kept");
+    benchCheck(suite, !heD3ShadowReachesFrustum(cameraFrustum, &point, down.vector, hm::vec3f(-30.f, 0.f, -10.f), unit),
+               "shadow of a box left of the view, lit from the view, is kept");
+    benchCheck(suite, heD3ShadowReachesFrustum(cameraFrustum, &outside, down.vector, hm::vec3f(-30.f, 0.f, -10.f), unit),
+               "shadow of a box left of the view, lit from further left, is culled");
+
+    // the box of the shadow map of a directional light, through the culling of the level. The map reaches 40 units
+    // into the view and 10 units up towards the light
+    const hm::vec3f CASTER_POSITIONS[] = { hm::vec3f(0.f, 0.f, -20.f), hm::vec3f(0.f, 5.f, -20.f), hm::vec3f(0.f, 0.f, -300.f), hm::vec3f(0.f, 100.f, -20.f) };
+    for(hm::vec3f const& position : CASTER_POSITIONS) {
+        HeD3Instance* instance = heD3LevelAddInstance(&casterLevel);
+        instance->mesh = &mesh;
+        instance->transformation.position = position;
+    }
+
+    heD3LevelUpdateBounds(&casterLevel);
+    HeD3LightSource* casterSun = &casterLevel.lights.emplace_back();
+    casterSun->type   = HE_LIGHT_SOURCE_TYPE_DIRECTIONAL;
+    casterSun->vector = down.vector;
+    heD3ShadowMapUpdateCascades(&casterSun->shadows, casterSun, &casterLevel.camera);
+    heD3LevelCullShadowCasters(&casterLevel, casterSun);
+    benchCheck(suite, casterSun->shadows.casters == std::vector<uint32_t>({ 0, 1 }), "the directional light found " + std::to_string(casterSun->shadows.casters.size()) +
+               " casters instead of the two boxes inside its shadow map");
+
+    // and the point and spot volume through the same culling
+    casterLevel.lights.emplace_back(point);
+    heD3LevelCullShadowCasters(&casterLevel, &casterLevel.lights.back());
+    benchCheck(suite, casterLevel.lights.back().shadows.casters == std::vector<uint32_t>({ 0, 1 }), "the point light found " +
+               std::to_string(casterLevel.lights.back().shadows.casters.size()) + " casters instead of the two boxes in its range");
+
+    // the cascades only move in whole texels. A camera move far below a texel must keep every projection bit for bit,
+    // a move of a few texels of the first cascade must move every cascade by a whole number of its own texels
+    HeD3LightSource cascadeSun;
+    cascadeSun.type   = HE_LIGHT_SOURCE_TYPE_DIRECTIONAL;
+    cascadeSun.vector = hm::vec3f(.3f, -1.f, .2f);
+    HeD3ShadowMap* cascadeMap = &cascadeSun.shadows;
+    HeD3Camera cascadeCamera  = casterLevel.camera;
+    auto moveCascadeCamera = [&](float const x) {
+        cascadeCamera.viewMatrix = hm::createViewMatrix(hm::vec3f(x, 0.f, 0.f), hm::vec3f(0.f));
+        heD3ShadowMapUpdateCascades(cascadeMap, &cascadeSun, &cascadeCamera);
+    };
+
+    moveCascadeCamera(0.f);
+    hm::mat4f projections[HeD3ShadowMap::MAX_CASCADES];
+    for(uint8_t i = 0; i < cascadeMap->cascadeCount; ++i)
+        projections[i] = cascadeMap->cascades[i].projectionMatrix;
+    float const texel = 2.f / cascadeMap->cascades[0].projectionMatrix[0][0] / (float) cascadeMap->resolution.x;
+
+    moveCascadeCamera(texel * .01f);
+    uint8_t moved = 0;
+    for(uint8_t i = 0; i < cascadeMap->cascadeCount; ++i)
+        moved += std::memcmp(&projections[i], &cascadeMap->cascades[i].projectionMatrix, sizeof(hm::mat4f)) != 0;
+    benchCheck(suite, moved == 0, std::to_string(moved) + " cascades changed when the camera moved a hundredth of a texel");
+
+    moveCascadeCamera(texel * 3.f);
+    float worstFraction = 0.f;
+    for(uint8_t i = 0; i < cascadeMap->cascadeCount; ++i) {
+        hm::mat4f const& projection = cascadeMap->cascades[i].projectionMatrix;
+        for(uint8_t axis = 0; axis < 2; ++axis) {
+            // the translation of an orthographic projection is -center / half size, a texel is 2 / resolution of it
+            float texels   = (projection[3][axis] - projections[i][3][axis]) * (float) ((axis == 0) ? cascadeMap->resolution.x : cascadeMap->resolution.y) / 2.f;
+            worstFraction  = std::max(worstFraction, std::abs(texels - std::round(texels)));
+        }
+
+        if(projection[0][0] != projections[i][0][0] || projection[1][1] != projections[i][1][1])
+            worstFraction = 1.f;
+    }
+
+    benchCheck(suite, std::memcmp(&projections[0], &cascadeMap->cascades[0].projectionMatrix, sizeof(hm::mat4f)) != 0 && worstFraction < .01f,
+               "the cascades moved by " + std::to_string(worstFraction) + " of a texel when the camera moved three texels");
+
+    // the static cache rebuilds exactly the cascades whose projection changed, and all of them when the light or the
+    // static geometry changed
+    moveCascadeCamera(0.f);
+    uint8_t const initial   = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    uint8_t const unchanged = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    moveCascadeCamera(texel * .01f);
+    uint8_t const subTexel  = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    benchCheck(suite, initial == 0xf && unchanged == 0 && subTexel == 0, "the cache rebuilt cascades " + std::to_string(initial) + ", " +
+               std::to_string(unchanged) + " and " + std::to_string(subTexel) + " instead of all, none and none");
+
+    for(uint8_t i = 0; i < cascadeMap->cascadeCount; ++i)
+        projections[i] = cascadeMap->cascades[i].projectionMatrix;
+    moveCascadeCamera(texel * 3.f);
+    uint8_t changed = 0;
+    for(uint8_t i = 0; i < cascadeMap->cascadeCount; ++i)
+        if(std::memcmp(&projections[i], &cascadeMap->cascades[i].projectionMatrix, sizeof(hm::mat4f)) != 0)
+            changed |= 1 << i;
+    uint8_t const shifted = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    benchCheck(suite, shifted == changed && (shifted & 1), "the cache rebuilt cascades " + std::to_string(shifted) +
+               " after a move of three texels, the projections of " + std::to_string(changed) + " changed");
+
+    // a single moved cascade, the others keep their cache
+    cascadeMap->cascades[2].projectionMatrix[3][0] += 2.f / (float) cascadeMap->resolution.x;
+    uint8_t const single = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    benchCheck(suite, single == 1 << 2, "the cache rebuilt cascades " + std::to_string(single) + " when only the third one moved");
+
+    casterLevel.staticRevision++;
+    uint8_t const revision = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    cascadeSun.vector = hm::vec3f(.3f, -1.f, .21f);
+    moveCascadeCamera(texel * 3.f);
+    uint8_t const rotated = heD3ShadowMapUpdateCache(cascadeMap, &casterLevel);
+    benchCheck(suite, revision == 0xf && rotated == 0xf, "the cache rebuilt cascades " + std::to_string(revision) + " after a static change and " +
+               std::to_string(rotated) + " after the light turned instead of all");
+};
+
+void benchOcclusion(BenchSuite* suite) {
+    // a corridor: two walls (each a grid of 2k triangles) left and right of the camera, one wall at the end and a
+    // grid of boxes behind all of them
+    std::vector<hm::vec3f> wall;
+    for(uint32_t y = 0; y < 32; ++y) {
+        for(uint32_t x = 0; x < 32; ++x) {
+            hm::vec3f p0((float) x / 32.f - .5f, (float) y / 32.f - .5f, 0.f);
+            hm::vec3f p1 = p0 + hm::vec3f(1.f / 32.f, 0.f, 0.f);
+            hm::vec3f p2 = p0 + hm::vec3f(1.f / 32.f, 1.f / 32.f, 0.f);
+            hm::vec3f p3 = p0 + hm::vec3f(0.f, 1.f / 32.f, 0.f);
+            wall.insert(wall.end(), { p0, p1, p2, p0, p2, p3 });
+        }
+    }
+
+    hm::mat4f walls[3] = {
+        hm::createTransformationMatrix(hm::vec3f(-4.f, 0.f, -20.f), hm::quatf(0.f, .7071f, 0.f, .7071f), hm::vec3f(40.f, 10.f, 1.f)),
+        hm::createTransformationMatrix(hm::vec3f( 4.f, 0.f, -20.f), hm::quatf(0.f, .7071f, 0.f, .7071f), hm::vec3f(40.f, 10.f, 1.f)),
+        hm::createTransformationMatrix(hm::vec3f( 0.f, 0.f, -30.f), hm::quatf(0.f, 0.f,    0.f, 1.f),    hm::vec3f(10.f, 10.f, 1.f)),
+    };
+
+    std::vector<hm::vec3f> boxes;
+    for(uint32_t i = 0; i < 1024; ++i)
+        boxes.emplace_back((float) (i % 32) * 2.f - 32.f, 0.f, -40.f - (float) (i / 32) * 2.f);
+
+    hm::mat4f projection = hm::createPerspectiveProjectionMatrix(70.f, 16.f / 9.f, .1f, 1000.f);
+    hm::mat4f view       = hm::createViewMatrix(hm::vec3f(0.f), hm::vec3f(0.f));
+
+    // a small fixed scene whose rasterized depth and visibility results are compared against the checked in golden
+    // files: the end of the corridor and a tilted wall in front of it, with boxes in front of, between and behind
+    // the walls and peeking out at their edges
+    {
+        hm::mat4f scene[2] = {
+            hm::createTransformationMatrix(hm::vec3f(2.f, .5f, -30.f), hm::quatf(0.f, 0.f, 0.f, 1.f),    hm::vec3f(36.f, 14.f, 1.f)),
+            hm::createTransformationMatrix(hm::vec3f(-2.3f, -.7f, -9.f), hm::quatf(.1f, .3f, 0.f, .95f), hm::vec3f(6.f, 4.f, 1.f)),
+        };
+
+        HeOcclusionBuffer small;
+        heOcclusionBufferCreate(&small, 64, 32);
+        heOcclusionBufferClear(&small, projection * view);
+        for(auto const& all : scene)
+            heOcclusionBufferAddOccluder(&small, &wall, all);
+        heOcclusionBufferRender(&small);
+
+        std::vector<float> visibility;
+        for(int32_t z = 0; z < 4; ++z)
+            for(int32_t x = -3; x <= 3; ++x)
+                for(int32_t y = -1; y <= 1; ++y)
+                    visibility.emplace_back((float) heOcclusionBufferTestBox(&small, hm::vec3f(x * 2.1f, y * 2.7f, -8.f - z * 8.3f), hm::vec3f(.6f)));
+
+        benchCheckGolden(suite, "occlusion_depth", small.depth, 1e-6f);
+        benchCheckGolden(suite, "occlusion_visibility", visibility, 0.f);
+    }
+
+    HeOcclusionBuffer buffer;
+    heOcclusionBufferCreate(&buffer, 256, 128);
+
+    benchRun(suite, "occlusion/render occluders (6k tris)", [&]() {
+        heOcclusionBufferClear(&buffer, projection * view);
+        for(auto const& all : walls)
+            heOcclusionBufferAddOccluder(&buffer, &wall, all);
+        heOcclusionBufferRender(&buffer);
+        benchKeep(buffer.tiles[0]);
+    });
+
+    benchRun(suite, "occlusion/test boxes (1024)", [&]() {
+        uint32_t visible = 0;
+        for(auto const& all : boxes)
+            visible += heOcclusionBufferTestBox(&buffer, all, hm::vec3f(.5f));
+        benchKeep(visible);
+    });
+};
+
+void benchScene(BenchSuite* suite) {
+    // a headless scene: instances that all move every frame, some of them in small rigs, attached lights and
+    // particle sources. Updated with 1, 2, 4... threads to show how the level update scales
+    const uint32_t INSTANCE_COUNT = 8000;
+    const uint32_t SOURCE_COUNT   = 48;
+    const uint32_t LIGHT_COUNT    = 32;
+
+    HeTexture texture;
+    texture.size = hm::vec2i(256);
+    HeSpriteAtlas atlas;
+    atlas.texture = &texture;
+    atlas.rows    = 4;
+    atlas.columns = 4;
+    atlas.count   = 16;
+
+    HeVao mesh;
+    mesh.boundsMin    = hm::vec3f(-.5f);
+    mesh.boundsMax    = hm::vec3f(.5f);
+    mesh.boundsRadius = hm::length(mesh.boundsMax);
+
+    HeD3Level level;
+    level.camera.viewMatrix = hm::createViewMatrix(hm::vec3f(0.f, 2.f, 5.f), hm::vec3f(15.f, 30.f, 0.f));
+    std::vector<HeD3InstanceId> roots;
+    for(uint32_t i = 0; i < INSTANCE_COUNT; ++i) {
+        HeD3Instance* instance = heD3LevelAddInstance(&level);
+        instance->mesh = &mesh;
+        instance->transformation.position = hm::vec3f((float) (i % 100), 0.f, (float) (i / 100));
+        if(i % 4 == 0)
+            roots.emplace_back(instance->id);
+        else {
+            instance->transformation.position = hm::vec3f(0.f, 1.f, 0.f);
+            heD3LevelSetInstanceParent(&level, instance->id, roots.back());
+        }
+    }
+
+    for(uint32_t i = 0; i < LIGHT_COUNT; ++i) {
+        HeD3LightSource* light = heD3LightSourceCreatePoint(&level, hm::vec3f(0.f, 2.f, 0.f), 1.f, .35f, .44f, hm::colour(255, 200, 150, 1.f));
+        light->parent      = roots[i * (uint32_t) roots.size() / LIGHT_COUNT];
+        light->localVector = hm::vec3f(0.f, 2.f, 0.f);
+    }
+
+    for(uint32_t i = 0; i < SOURCE_COUNT; ++i) {
+        HeParticleSource* source = &level.particles.emplace_back();
+        heParticleSourceCreate(source, HeD3Transformation(hm::vec3f(0.f, 1.f, 0.f)), &atlas, 5, 1000);
+        source->emitter.type   = HE_PARTICLE_EMITTER_TYPE_SPHERE;
+        source->emitter.sphere = 1.f;
+        source->parent         = roots[i * (uint32_t) roots.size() / SOURCE_COUNT];
+        heRandomCreate(&source->emitter.random, i);
+        source->maxNewParticlesPerUpdate = source->particleCount;
+        heParticleSourceEmitBurst(source, source->particleCount);
+    }
+
+    heD3LevelUpdateBounds(&level);
+    uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+    for(uint32_t threads = 1; threads <= cores; threads *= 2) {
+        if(threads > 1) // a count of 0 would start the default number of workers
+            heWorkerPoolCreate(&heWorkerPool, threads - 1);
+        float time = 0.f;
+        benchRun(suite, "scene/level update (" + std::to_string(threads) + " threads)", [&]() {
+            time += .01f;
+            for(HeD3InstanceId const& all : roots) {
+                HeD3Instance* instance = heD3LevelGetInstanceById(&level, all);
+                instance->transformation.position.y = std::sin(time);
+                level.instanceFlags[heD3LevelGetInstanceIndex(&level, instance)] |= HE_D3_INSTANCE_FLAG_DIRTY;
+            }
+
+            heD3LevelUpdate(&level, 1.f / 60.f);
+            benchKeep(level.particles.back().dataBuffer[0]);
+        });
+
+        heWorkerPoolDestroy(&heWorkerPool);
+    }
+
+    // heParticleSourceDestroy would also destroy the atlas texture
+    for(auto& all : level.particles)
+        free(all.dataBuffer);
+};
+
+
+int main(int argc, char** argv) {
+    for(int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if(arg == "--filter" && i + 1 < argc)
+            bench.filter = argv[++i];
+        else if(arg == "--out" && i + 1 < argc)
+            bench.outputFile = argv[++i];
+        else if(arg == "--data" && i + 1 < argc)
+            bench.dataFolder = argv[++i];
+        else if(arg == "--golden" && i + 1 < argc)
+            bench.goldenFolder = argv[++i];
+        else if(arg == "--update-golden")
+            bench.updateGolden = true;
+        else if(arg == "--quick") {
+            bench.maxCaseTime = .1;
+            bench.minSamples  = 5;
+        } else {
+            std::cout << "usage: " << argv[0] << " [--filter name] [--out file.json] [--data folder] [--golden folder] [--update-golden] [--quick]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::filesystem::create_directories(bench.dataFolder);
+    std::cout << std::left << std::setw(40) << "case" << std::right << std::setw(14) << "median ns"
+              << std::setw(14) << "p95 ns" << std::setw(14) << "iterations" << std::endl;
+
+    benchMath(&bench);
+    benchBinary(&bench);
+    benchLoader(&bench);
+    benchStrings(&bench);
+    benchRandom(&bench);
+    benchParticles(&bench);
+    benchAssets(&bench);
+    benchLevel(&bench);
+    benchLights(&bench);
+    benchOcclusion(&bench);
+    benchScene(&bench);
+
+    benchPrintResults(&bench);
+    b8 written = benchWriteResults(&bench);
+    if(bench.failedChecks > 0)
+        std::cout << bench.failedChecks << " checks failed" << std::endl;
+    return (written && bench.failedChecks == 0) ? 0 : 1;
+};
@@ -0,0 +1,109 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "heTypes.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;   // total number of timed calls over all samples
+    uint32_t samples    = 0;   // number of timed batches
+    double   median     = 0.0; // nanoseconds per call
+    double   p95        = 0.0; // nanoseconds per call
+    double   min        = 0.0; // nanoseconds per call
+    double   mean       = 0.0; // nanoseconds per call
+};
+
+struct BenchSuite {
+    std::vector<BenchResult> results;
+
+    // only cases whose name contains this string are run. Empty runs everything
+    std::string filter;
+    // the file the machine readable results (json) are written to
+    std::string outputFile = "bench_results.json";
+    // the folder generated input files (obj, h3asset) are written to
+    std::string dataFolder = "bench_data";
+    // the folder the checked in reference outputs are read from
+    std::string goldenFolder = "golden";
+    // if set, the reference outputs are written instead of compared (after an intended change of the results)
+    b8 updateGolden = false;
+
+    double   minSampleTime = 0.002; // seconds one batch should at least take, the batch size is scaled up to reach that
+    double   maxCaseTime   = 1.0;   // seconds spent sampling a single case (after calibration)
+    uint32_t minSamples    = 20;    // at least this many batches are timed, even if maxCaseTime is exceeded
+    uint32_t maxSamples    = 500;
+
+    // the number of correctness checks that failed, the run fails if this is not 0
+    uint32_t failedChecks  = 0;
+};
+
+// everything written to this cant be optimized away by the compiler
+extern volatile uint64_t benchSink;
+
+// makes sure the compiler keeps the computation of value
+template<typename T>
+inline void benchKeep(T const& value) {
+    benchSink = benchSink + *(volatile unsigned char const*) &value;
+};
+
+// returns the current time in seconds of a monotonic clock
+inline double benchTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+};
+
+// returns true if a case with that name should run
+extern b8 benchShouldRun(BenchSuite const* suite, std::string const& name);
+// sorts the collected samples (nanoseconds per call) and stores the statistics as result in the suite
+extern void benchAddResult(BenchSuite* suite, std::string const& name, std::vector<double>& samples, uint64_t const iterations);
+// prints all results as table into cout
+extern void benchPrintResults(BenchSuite const* suite);
+// writes all results as json to the suites output file
+extern b8 benchWriteResults(BenchSuite const* suite);
+// records a correctness check. If it did not pass, the message is printed and the run will fail. Returns passed
+extern b8 benchCheck(BenchSuite* suite, b8 const passed, std::string const& message);
+// compares values against the reference file name in the golden folder. Every value may differ by tolerance, else
+// the check fails with the number of mismatches. Returns true if all values matched
+extern b8 benchCheckGolden(BenchSuite* suite, std::string const& name, std::vector<float> const& values, float const tolerance);
+
+// runs func in batches and records the time per call. The batch size is doubled until one batch takes at least
+// minSampleTime (this doubles as warm up), then batches are timed until maxCaseTime is used up or maxSamples is
+// reached
+template<typename F>
+void benchRun(BenchSuite* suite, std::string const& name, F&& func) {
+    if(!benchShouldRun(suite, name))
+        return;
+
+    // calibrate
+    uint64_t batch = 1;
+    while(true) {
+        double start = benchTime();
+        for(uint64_t i = 0; i < batch; ++i)
+            func();
+
+        if(benchTime() - start >= suite->minSampleTime || batch >= (1ull << 30))
+            break;
+        batch *= 2;
+    }
+
+    // sample
+    std::vector<double> samples;
+    samples.reserve(suite->maxSamples);
+    double   caseStart  = benchTime();
+    uint64_t iterations = 0;
+    while(samples.size() < suite->maxSamples &&
+          (samples.size() < suite->minSamples || benchTime() - caseStart < suite->maxCaseTime)) {
+        double start = benchTime();
+        for(uint64_t i = 0; i < batch; ++i)
+            func();
+        double end = benchTime();
+
+        samples.emplace_back((end - start) * 1e9 / (double) batch);
+        iterations += batch;
+    }
+
+    benchAddResult(suite, name, samples, iterations);
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef BENCH_COMPAT_H
+#define BENCH_COMPAT_H
+
+/* Force included into every file of the headless linux build (see CMakeLists.txt). Provides the msvc specific functions
+   the engine uses on the cpu side, so that the engine sources compile unchanged with gcc and clang. */
+
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+inline int localtime_s(struct tm* out, time_t const* time) {
+    return (localtime_r(time, out) != nullptr) ? 0 : 1;
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "heGlLayer.h"
+#include "hePhysics.h"
+#include "heWin32Layer.h"
+#include "heCore.h"
+
+/* The window, gl and physics functions that the cpu side of the engine references, for the headless linux build of
+   the benchmarks (see CMakeLists.txt). Nothing here is ever drawn or simulated: gl objects keep their vertex data on
+   the cpu so that meshes can still be read back, everything else does nothing. */
+
+
+// -- core
+
+void heConsolePrint(std::string const& message) {};
+
+b8 heIsMainThread() {
+    return true;
+};
+
+void heWin32FolderCreate(std::string const& path) {
+    std::filesystem::create_directories(path);
+};
+
+
+// -- physics
+
+void hePhysicsComponentCreate(HePhysicsComponent* component, HePhysicsShapeInfo& shape) {};
+void hePhysicsComponentSetTransform(HePhysicsComponent* component, HeD3Transformation const& transform) {};
+void hePhysicsComponentSetPosition(HePhysicsComponent* component, hm::vec3f const& position) {};
+
+hm::vec3f hePhysicsComponentGetPosition(HePhysicsComponent const* component) {
+    return hm::vec3f(0.f);
+};
+
+hm::quatf hePhysicsComponentGetRotation(HePhysicsComponent const* component) {
+    return hm::quatf(0.f, 0.f, 0.f, 1.f);
+};
+
+hm::vec3f hePhysicsActorSimpleGetEyePosition(HePhysicsActorSimple const* actor) {
+    return hm::vec3f(0.f);
+};
+
+void hePhysicsLevelCreate(HePhysicsLevel* level, HePhysicsLevelInfo const& info) {};
+void hePhysicsLevelDestroy(HePhysicsLevel* level) {};
+void hePhysicsLevelAddComponent(HePhysicsLevel* level, HePhysicsComponent const* component) {};
+void hePhysicsLevelUpdate(HePhysicsLevel* level, float const delta) {};
+
+
+// -- shaders
+
+void heShaderCreateProgram(HeShaderProgram* program, std::string const& file) {};
+void heShaderCreateProgram(HeShaderProgram* program, std::string const& vertexShader, std::string const& framentShader) {};
+void heShaderCreateProgram(HeShaderProgram* program, std::string const& vertexShader, std::string const& geometryShader, std::string const& framentShader) {};
+void heShaderCreateCompute(HeShaderProgram* program, std::string const& shaderFile) {};
+void heShaderDestroy(HeShaderProgram* program) {};
+void heShaderBind(HeShaderProgram* program) {};
+void heShaderUnbind() {};
+void heShaderRunCompute(HeShaderProgram* program, uint32_t const groupsX, uint32_t const groupsY, uint32_t const groupsZ) {};
+
+HeUniformId heShaderGetUniformId(std::string const& name) {
+    static std::unordered_map<std::string, HeUniformId> ids;
+    return ids.emplace(name, (HeUniformId) ids.size()).first->second;
+};
+
+int32_t heShaderGetSamplerLocation(HeShaderProgram* program, std::string const& sampler, int8_t const requestedSlot) {
+    return requestedSlot;
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, float const value) {};
+void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, int32_t const value) {};
+void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, hm::vec2f const& value) {};
+
+
+// -- buffers
+
+void heVboGetData(HeVbo const* vbo, std::vector<float>* data) {
+    *data = vbo->dataf;
+};
+
+void heVaoCreate(HeVao* vao, HeVaoType const type) {
+    vao->type = type;
+};
+
+void heVaoAddData(HeVao* vao, std::vector<float> const& data, uint8_t const dimensions, HeVboUsage const usage) {
+    HeVbo* vbo         = &vao->vbos.emplace_back();
+    vbo->dataf         = data;
+    vbo->dimensions    = dimensions;
+    vbo->verticesCount = (uint32_t) data.size() / dimensions;
+    if(vao->vbos.size() == 1)
+        vao->verticesCount = vbo->verticesCount;
+};
+
+void heVaoAddVboData(HeVao* vao, HeVbo* vbo, int8_t const attributeIndex) {};
+void heVaoBind(HeVao const* vao) {};
+void heVaoUnbind(HeVao const* vao) {};
+
+void heVaoDestroy(HeVao* vao) {
+    vao->vbos.clear();
+    vao->verticesCount = 0;
+};
+
+void heFboCreate(HeFbo* fbo) {};
+void heFboCreateDepthTextureAttachment(HeFbo* fbo) {};
+void heFboDisableColourAttachment(HeFbo* fbo) {};
+void heFboValidate(HeFbo const* fbo) {};
+void heFboUnbind() {};
+
+
+// -- textures
+
+void heTextureCreateEmptyCubeMap(HeTexture* texture) {};
+void heTextureCreateFromBuffer(HeTexture* texture) {};
+void heTextureLoadFromImageFile(HeTexture* texture, std::string const& fileName, b8 const compress) {};
+void heTextureLoadFromHdrImageFile(HeTexture* texture, std::string const& fileName) {};
+void heTextureLoadFromCubemapFile(HeTexture* texture, std::string const& fileName, b8 const compress) {};
+void heTextureLoadFromHdrCubemapFile(HeTexture* texture, std::string const& fileName) {};
+void heTextureLoadFromCompressedFile(HeTexture* texture, std::string const& fileName) {};
+void heTextureBind(HeTexture const* texture, int8_t const slot) {};
+void heTextureUnbind(int8_t const slot, b8 const cubeMap) {};
+void heImageTextureBind(HeTexture const* texture, int8_t const slot, int8_t const level, int8_t const layer, HeAccessType const access) {};
+void heTextureDestroy(HeTexture* texture) {};
@@ -13,6 +13,7 @@
 #include "heCore.h"
 #include "heDebugUtils.h"
 #include "heUi.h"
+#include "heWorkerPool.h"
 #include <windows.h>
 #include <thread>
 #include <vector>
@@ -196,6 +197,7 @@ int main() {
     heGlPrintInfo();
 
     hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
+    heWorkerPoolCreate(&heWorkerPool);
     
     // set shit up
     HeScaledFont font;
@@ -274,6 +276,7 @@ int main() {
 
     HE_DEBUG("Cleaning up...");
     heD3LevelDestroy(&app.level);
+    heWorkerPoolDestroy(&heWorkerPool);
     heRenderEngineDestroy(&app.engine);
     heWindowDestroy(&app.window);
     HE_DEBUG("Successfull shutdown");
@@ -377,20 +380,20 @@ void _onClientConnect(HnClient* client, HnLocalClient* local) {
     Player* p = &app.players[local->clientId];
     p->client = local;
 
-    HeD3Instance* instance = &app.level.instances.emplace_back();
+    HeD3Instance* instance = heD3LevelAddInstance(&app.level);
     heD3InstanceLoadBinary("res/assets/bin/player.h3asset", instance, nullptr);
     HE_LOG("Loaded instance!");
-    hnLocalClientHookVariable(client, local, "position", &instance->transformation.position);
-    hnLocalClientHookVariable(client, local, "rotation", &instance->transformation.rotation);
+    hnLocalClientHookVariable(client, local, "position", &p->position);
+    hnLocalClientHookVariable(client, local, "rotation", &p->rotation);
     hnLocalClientHookVariable(client, local, "velocity", &p->velocity);
     hnLocalClientHookVariable(client, local, "name",     &p->name);
 
-    p->model = instance;
+    p->model = instance->id;
 };
 
 void _onClientDisconnect(HnClient* client, HnLocalClient* local) {
     Player* p = &app.players[local->clientId];
-    heD3LevelRemoveInstance(&app.level, p->model);
+    heD3LevelRemoveInstanceById(&app.level, p->model);
     app.players.erase(local->clientId);
 };
 
@@ -462,9 +465,9 @@ void createWorld(HeWindow* window) {
     heD3SkyboxCreate(&app.level.skybox, "res/textures/hdr/pink_sunrise.hdr");
     heD3Level = &app.level;
 
-    HeD3Instance* instance = &app.level.instances.emplace_back();
+    HeD3Instance* instance = heD3LevelAddInstance(&app.level);
     heD3InstanceLoadBinary("res/assets/bin/player.h3asset", instance, nullptr);
-    instance->transformation.position = hm::vec3f(5, 0, -5);
+    heD3InstanceSetPosition(instance, hm::vec3f(5, 0, -5));
 
     HeParticleSource* particles = &app.level.particles.emplace_back();
     heParticleSourceCreate(particles, HeD3Transformation(), heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png", 1, 1, 1), 0, 1000);
@@ -506,6 +509,7 @@ int main() {
 
     app.engine.renderMode = HE_RENDER_MODE_FORWARD;
     heRenderEngineCreate(&app.engine, &app.window);
+    heWorkerPoolCreate(&heWorkerPool);
     hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
     heRenderEngine = &app.engine;
 
@@ -601,9 +605,12 @@ int main() {
                 heRenderEngineFinishD3(&app.engine);
                 heProfilerFrameMark("d3 final", hm::colour(255, 0, 255));
 
-                for(auto const& all : app.players) {
-                    all.second.model->transformation.position += all.second.velocity;
-                    hm::vec3f playerPosition = all.second.model->transformation.position + hm::vec3f(0, 2.2f, 0);
+                for(auto& all : app.players) {
+                    HeD3Instance* model = heD3LevelGetInstanceById(&app.level, all.second.model);
+                    all.second.position += all.second.velocity;
+                    heD3InstanceSetRotation(model, all.second.rotation);
+                    heD3InstanceSetPosition(model, all.second.position);
+                    hm::vec3f playerPosition = all.second.position + hm::vec3f(0, 2.2f, 0);
                     hm::vec3f screenSpace    = heSpaceWorldToScreen(playerPosition, &app.level.camera, &app.window);
                     if(screenSpace.z > 0.f)
                         heUiPushText(&app.engine, &scaledFont, std::string(all.second.name), hm::vec2f(screenSpace.x, screenSpace.y), hm::colour(255, 200, 100), HE_TEXT_ALIGN_CENTER);
@@ -655,6 +662,7 @@ int main() {
 #endif
 
     commandThread.detach();
+    heWorkerPoolDestroy(&heWorkerPool);
     heRenderEngineDestroy(&app.engine);
     heWindowDestroy(&app.window);
     return 0;
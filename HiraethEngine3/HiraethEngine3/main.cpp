@@ -13,6 +13,7 @@
 #include "src/heCore.h"
 #include "src/heDebugUtils.h"
 #include "src/heUi.h"
+#include "src/heWorkerPool.h"
 #include <windows.h>
 #include <thread>
 #include <vector>
@@ -121,6 +122,8 @@ void enterGameState() {
     heWin32TimerStart();
     heD3LevelLoad("res/level/level0.h3level", &app.level, USE_PHYSICS, true);
     heD3LevelGetInstance(&app.level, 13)->material->emission = hm::colour(255, 0, 0, 255, 10); // suzanne
+    heD3LevelBuildStaticBatches(&app.level);
+    app.level.occlusionCulling = true;
     app.level.camera.frustum.viewInfo.fov = 90;
 
     heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png", 2, 2, 4); // load and set up once so we can use it later
@@ -136,7 +139,7 @@ void enterGameState() {
     heParticleSourceCreate(lampParticles, HeD3Transformation(hm::vec3f(-3.07f, 4.07f, -2.03f)), heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png"), 3, 200);
 
     HeParticleSource* dustParticles = &app.level.particles.emplace_back();
-    dustParticles->maxNewParticlesPerUpdate = 100;
+    dustParticles->maxNewParticlesPerUpdate = 1000;
     dustParticles->gravity           = .05f;
     dustParticles->emitter.type      = HE_PARTICLE_EMITTER_TYPE_BOX;
     dustParticles->emitter.box       = hm::vec3f(10.f, .75f, 10.f);
@@ -148,7 +151,7 @@ void enterGameState() {
     dustParticles->emitter.maxSize   = 0.03f; 
     dustParticles->emitter.minColour = hm::colour(20, 3.f);
     dustParticles->emitter.maxColour = hm::colour(100, 3.f);
-    heParticleSourceCreate(dustParticles, HeD3Transformation(hm::vec3f(0.f, .75f, 0.f)), heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png"), 0, 200);
+    heParticleSourceCreate(dustParticles, HeD3Transformation(hm::vec3f(0.f, .75f, 0.f)), heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png"), 0, 100000);
 
 #if USE_PHYSICS == 1
 	HePhysicsShapeInfo actorShape;
@@ -196,6 +199,7 @@ int main() {
 	heGlPrintInfo();
 
 	heRenderEngineCreate(&app.engine, &app.window, HE_RENDER_MODE_FORWARD);
+	heWorkerPoolCreate(&heWorkerPool);
 	hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
 	heUiCreate(&app.engine);
 
@@ -275,6 +279,7 @@ int main() {
 
     HE_DEBUG("Cleaning up...");
     heD3LevelDestroy(&app.level);
+    heWorkerPoolDestroy(&heWorkerPool);
     heRenderEngineDestroy(&app.engine);
     heWindowDestroy(&app.window);
     HE_DEBUG("Successfull shutdown");
@@ -378,20 +383,20 @@ void _onClientConnect(HnClient* client, HnLocalClient* local) {
 	Player* p = &app.players[local->clientId];
 	p->client = local;
 
-	HeD3Instance* instance = &app.level.instances.emplace_back();
+	HeD3Instance* instance = heD3LevelAddInstance(&app.level);
 	heD3InstanceLoadBinary("res/assets/bin/player.h3asset", instance, nullptr);
 	HE_LOG("Loaded instance!");
-	hnLocalClientHookVariable(client, local, "position", &instance->transformation.position);
-	hnLocalClientHookVariable(client, local, "rotation", &instance->transformation.rotation);
+	hnLocalClientHookVariable(client, local, "position", &p->position);
+	hnLocalClientHookVariable(client, local, "rotation", &p->rotation);
 	hnLocalClientHookVariable(client, local, "velocity", &p->velocity);
 	hnLocalClientHookVariable(client, local, "name",     &p->name);
 	
-	p->model = instance;
+	p->model = instance->id;
 };
 
 void _onClientDisconnect(HnClient* client, HnLocalClient* local) {
 	Player* p = &app.players[local->clientId];
-	heD3LevelRemoveInstance(&app.level, p->model);
+	heD3LevelRemoveInstanceById(&app.level, p->model);
 	app.players.erase(local->clientId);
 };
 
@@ -463,9 +468,9 @@ void createWorld(HeWindow* window) {
 	heD3SkyboxCreate(&app.level.skybox, "res/textures/hdr/pink_sunrise.hdr");
     heD3Level = &app.level;
 
-	HeD3Instance* instance = &app.level.instances.emplace_back();
+	HeD3Instance* instance = heD3LevelAddInstance(&app.level);
     heD3InstanceLoadBinary("res/assets/bin/player.h3asset", instance, nullptr);
-	instance->transformation.position = hm::vec3f(5, 0, -5);
+	heD3InstanceSetPosition(instance, hm::vec3f(5, 0, -5));
 
     HeParticleSource* particles = &app.level.particles.emplace_back();
     heParticleSourceCreate(particles, HeD3Transformation(), heAssetPoolGetSpriteAtlas("res/textures/particleAtlas.png", 1, 1, 1), 0, 1000);
@@ -507,6 +512,7 @@ int main() {
 	
     app.engine.renderMode = HE_RENDER_MODE_FORWARD;
 	heRenderEngineCreate(&app.engine, &app.window);
+	heWorkerPoolCreate(&heWorkerPool);
 	hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
 	heRenderEngine = &app.engine;
 
@@ -602,9 +608,12 @@ int main() {
                 heRenderEngineFinishD3(&app.engine);
                 heProfilerFrameMark("d3 final", hm::colour(255, 0, 255));
 
-                for(auto const& all : app.players) {
-                    all.second.model->transformation.position += all.second.velocity;
-                    hm::vec3f playerPosition = all.second.model->transformation.position + hm::vec3f(0, 2.2f, 0);
+                for(auto& all : app.players) {
+                    HeD3Instance* model = heD3LevelGetInstanceById(&app.level, all.second.model);
+                    all.second.position += all.second.velocity;
+                    heD3InstanceSetRotation(model, all.second.rotation);
+                    heD3InstanceSetPosition(model, all.second.position);
+                    hm::vec3f playerPosition = all.second.position + hm::vec3f(0, 2.2f, 0);
                     hm::vec3f screenSpace    = heSpaceWorldToScreen(playerPosition, &app.level.camera, &app.window);
                     if(screenSpace.z > 0.f)
                         heUiPushText(&app.engine, &scaledFont, std::string(all.second.name), hm::vec2f(screenSpace.x, screenSpace.y), hm::colour(255, 200, 100), HE_TEXT_ALIGN_CENTER);
@@ -656,6 +665,7 @@ int main() {
 #endif
 
 	commandThread.detach();
+	heWorkerPoolDestroy(&heWorkerPool);
 	heRenderEngineDestroy(&app.engine);
 	heWindowDestroy(&app.window);
 	return 0;
@@ -17,7 +17,9 @@ enum GameState {
 
 struct Player {
     HnLocalClient* client = nullptr;
-    HeD3Instance*  model  = nullptr;
+    HeD3InstanceId model;
+    hm::vec3f      position;
+    hm::quatf      rotation = hm::quatf(0.f, 0.f, 0.f, 1.f);
     char name[200] = { 0 };
     hm::vec3f velocity;
 };
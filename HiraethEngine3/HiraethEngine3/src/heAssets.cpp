@@ -281,10 +281,10 @@ hm::vec4f heSpriteAtlasGetUvs(HeSpriteAtlas* atlas, uint32_t const index) {
 HeMaterial* heMaterialCreatePbr(std::string const& name, HeTexture* diffuseTexture, HeTexture* normalTexture, HeTexture* armTexture) {
     HeMaterial* mat = heAssetPoolGetNewMaterial(name);
     mat->shader = heAssetPoolGetShader("3d_pbr");
-    mat->textures["diffuse"] = diffuseTexture;
-    mat->textures["normal"]  = normalTexture;
-    mat->textures["arm"]     = armTexture;
-    mat->type                = heMaterialGetType("3d_pbr");
+    heMaterialSetTexture(mat, "diffuse", diffuseTexture);
+    heMaterialSetTexture(mat, "normal",  normalTexture);
+    heMaterialSetTexture(mat, "arm",     armTexture);
+    mat->type   = heMaterialGetType("3d_pbr");
     return mat;
 };
 
@@ -298,6 +298,32 @@ uint32_t heMaterialGetType(std::string const& shaderName) {
     return id;
 };
 
+// the entries of an unordered map keep their address when other entries are added, so only the id of a new entry
+// needs to be added
+void heMaterialSetTexture(HeMaterial* material, std::string const& name, HeTexture* texture) {
+    auto result = material->textures.insert_or_assign(name, texture);
+    if(result.second)
+        material->textureIds.emplace_back(HeMaterialTexture{ heShaderGetUniformId("t_" + name), &result.first->second });
+};
+
+HeTexture* heMaterialGetTexture(HeMaterial const* material, HeUniformId const sampler) {
+    for(HeMaterialTexture const& all : material->textureIds)
+        if(all.id == sampler)
+            return *all.texture;
+
+    return nullptr;
+};
+
+void heMaterialUpdateUniformIds(HeMaterial* material) {
+    material->uniformIds.clear();
+    for(auto const& all : material->uniforms)
+        material->uniformIds.emplace_back(HeMaterialUniform{ heShaderGetUniformId("u_" + all.first), &all.second });
+
+    material->textureIds.clear();
+    for(auto const& all : material->textures)
+        material->textureIds.emplace_back(HeMaterialTexture{ heShaderGetUniformId("t_" + all.first), &all.second });
+};
+
 
 // -- font
 
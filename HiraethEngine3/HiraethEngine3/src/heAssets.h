@@ -20,17 +20,36 @@ struct HeTextFile {
     uint32_t      version      = 0;
 };
 
+// a uniform or texture of a material with the id of its prefixed name, see HeMaterial::uniformIds
+struct HeMaterialUniform {
+    HeUniformId         id   = 0;
+    HeShaderData const* data = nullptr;
+};
+
+struct HeMaterialTexture {
+    HeUniformId       id      = 0;
+    HeTexture* const* texture = nullptr;
+};
+
 struct HeMaterial {
     // a type id, dependant of the shader. All materials with the same shader have the same type.
     uint32_t type = 0;
     // pointer to a shader in the asset pool
     HeShaderProgram* shader = nullptr;
-    // name of the sampler (without the t_ prefix) and a pointer to the asset pool
+    // name of the sampler (without the t_ prefix) and a pointer to the asset pool. Only change this through
+    // heMaterialSetTexture
     std::unordered_map<std::string, HeTexture*> textures;
-    // name of the uniform and some data
+    // name of the uniform and some data. heMaterialUpdateUniformIds must be called after entries were added
     std::unordered_map<std::string, HeShaderData> uniforms;
+    // the ids of "u_" + the name of every uniform and "t_" + the name of every texture, pointing to their entries in
+    // the maps above, so that loading the material needs no string operations, see heMaterialUpdateUniformIds
+    std::vector<HeMaterialUniform> uniformIds;
+    std::vector<HeMaterialTexture> textureIds;
 
     hm::colour emission = hm::colour(0);
+    // whether this material is blended over the things behind it. Transparent draws are done after all opaque ones,
+    // back to front
+    b8 transparent = false;
 };
 
 struct HeFont {
@@ -169,6 +188,14 @@ extern HE_API hm::vec4f heSpriteAtlasGetUvs(HeSpriteAtlas* atlas, uint32_t const
 extern HE_API HeMaterial* heMaterialCreatePbr(std::string const& name, HeTexture* diffuseTexture, HeTexture* normalTexture, HeTexture* armTexture);
 // returns the type id for given shader. This is used for grouping materials by their shader.
 extern HE_API uint32_t heMaterialGetType(std::string const& shaderName);
+// sets the texture of the sampler with given name (without the t_ prefix) in the material
+extern HE_API void heMaterialSetTexture(HeMaterial* material, std::string const& name, HeTexture* texture);
+// returns the texture of the sampler with given id (with the t_ prefix) in the material or nullptr if the material
+// has no such texture
+extern HE_API HeTexture* heMaterialGetTexture(HeMaterial const* material, HeUniformId const sampler);
+// rebuilds the uniform and texture ids of the material. This has to be called after uniforms were added or the
+// material was copied, textures are kept up to date by heMaterialSetTexture
+extern HE_API void heMaterialUpdateUniformIds(HeMaterial* material);
 
 
 // -- fonts
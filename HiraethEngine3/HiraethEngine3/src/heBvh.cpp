@@ -0,0 +1,524 @@
+#include "hepch.h"
+#include "heBvh.h"
+#include <cfloat>
+
+// -- utils
+
+inline float heBvhArea(hm::vec3f const& min, hm::vec3f const& max) {
+    hm::vec3f d = max - min;
+    return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+};
+
+inline void heBvhUnion(hm::vec3f const& minA, hm::vec3f const& maxA, hm::vec3f const& minB, hm::vec3f const& maxB, hm::vec3f* min, hm::vec3f* max) {
+    *min = hm::vec3f(std::min(minA.x, minB.x), std::min(minA.y, minB.y), std::min(minA.z, minB.z));
+    *max = hm::vec3f(std::max(maxA.x, maxB.x), std::max(maxA.y, maxB.y), std::max(maxA.z, maxB.z));
+};
+
+inline float heBvhUnionArea(HeBvhNode const& a, hm::vec3f const& minB, hm::vec3f const& maxB) {
+    hm::vec3f min, max;
+    heBvhUnion(a.min, a.max, minB, maxB, &min, &max);
+    return heBvhArea(min, max);
+};
+
+inline b8 heBvhContains(HeBvhNode const& node, hm::vec3f const& min, hm::vec3f const& max) {
+    return node.min.x <= min.x && node.min.y <= min.y && node.min.z <= min.z &&
+        node.max.x >= max.x && node.max.y >= max.y && node.max.z >= max.z;
+};
+
+inline b8 heBvhIsLeaf(HeBvhNode const& node) {
+    return node.left == -1;
+};
+
+// slab test of a ray against the box of a node. Writes the distance along the ray where the box is entered into
+// distance and returns true if that happens before maxDistance
+inline b8 heBvhRayEnters(HeBvhNode const& node, hm::vec3f const& origin, hm::vec3f const& inverse, float const maxDistance, float* distance) {
+    float tmin = 0.f, tmax = maxDistance;
+    for(uint8_t i = 0; i < 3; ++i) {
+        float t0 = (node.min[i] - origin[i]) * inverse[i];
+        float t1 = (node.max[i] - origin[i]) * inverse[i];
+        tmin = std::max(tmin, std::min(t0, t1));
+        tmax = std::min(tmax, std::max(t0, t1));
+    }
+
+    *distance = tmin;
+    return tmin <= tmax;
+};
+
+// sets the box and height of an inner node from its children
+inline void heBvhRefit(HeBvh* bvh, int32_t const index) {
+    HeBvhNode* node        = &bvh->nodes[index];
+    HeBvhNode const& left  = bvh->nodes[node->left];
+    HeBvhNode const& right = bvh->nodes[node->right];
+    heBvhUnion(left.min, left.max, right.min, right.max, &node->min, &node->max);
+    node->height = 1 + std::max(left.height, right.height);
+};
+
+int32_t heBvhAllocateNode(HeBvh* bvh) {
+    int32_t index;
+    if(bvh->freeList != -1) {
+        index          = bvh->freeList;
+        bvh->freeList  = bvh->nodes[index].parent;
+        bvh->nodes[index] = HeBvhNode();
+    } else {
+        index = (int32_t) bvh->nodes.size();
+        bvh->nodes.emplace_back();
+    }
+
+    bvh->nodes[index].height = 0;
+    return index;
+};
+
+void heBvhFreeNode(HeBvh* bvh, int32_t const index) {
+    bvh->nodes[index].parent = bvh->freeList;
+    bvh->nodes[index].height = -1;
+    bvh->freeList = index;
+};
+
+// replaces the child oldChild of parent with newChild, or sets the root if parent is -1
+inline void heBvhReplaceChild(HeBvh* bvh, int32_t const parent, int32_t const oldChild, int32_t const newChild) {
+    if(parent == -1)
+        bvh->root = newChild;
+    else if(bvh->nodes[parent].left == oldChild)
+        bvh->nodes[parent].left = newChild;
+    else
+        bvh->nodes[parent].right = newChild;
+};
+
+// performs a left or right rotation if the subtree at a is imbalanced. Returns the index of the new subtree root
+int32_t heBvhBalance(HeBvh* bvh, int32_t const a) {
+    HeBvhNode* nodeA = &bvh->nodes[a];
+    if(heBvhIsLeaf(*nodeA) || nodeA->height < 2)
+        return a;
+
+    int32_t b = nodeA->left;
+    int32_t c = nodeA->right;
+    int32_t balance = bvh->nodes[c].height - bvh->nodes[b].height;
+
+    if(balance > 1) {
+        // rotate c up
+        HeBvhNode* nodeC = &bvh->nodes[c];
+        int32_t f = nodeC->left;
+        int32_t g = nodeC->right;
+
+        nodeC->left   = a;
+        nodeC->parent = nodeA->parent;
+        nodeA->parent = c;
+        heBvhReplaceChild(bvh, nodeC->parent, a, c);
+
+        if(bvh->nodes[f].height > bvh->nodes[g].height) {
+            nodeC->right = f;
+            nodeA->right = g;
+            bvh->nodes[g].parent = a;
+        } else {
+            nodeC->right = g;
+            nodeA->right = f;
+            bvh->nodes[f].parent = a;
+        }
+
+        heBvhRefit(bvh, a);
+        heBvhRefit(bvh, c);
+        return c;
+    }
+
+    if(balance < -1) {
+        // rotate b up
+        HeBvhNode* nodeB = &bvh->nodes[b];
+        int32_t d = nodeB->left;
+        int32_t e = nodeB->right;
+
+        nodeB->left   = a;
+        nodeB->parent = nodeA->parent;
+        nodeA->parent = b;
+        heBvhReplaceChild(bvh, nodeB->parent, a, b);
+
+        if(bvh->nodes[d].height > bvh->nodes[e].height) {
+            nodeB->right = d;
+            nodeA->left  = e;
+            bvh->nodes[e].parent = a;
+        } else {
+            nodeB->right = e;
+            nodeA->left  = d;
+            bvh->nodes[d].parent = a;
+        }
+
+        heBvhRefit(bvh, a);
+        heBvhRefit(bvh, b);
+        return b;
+    }
+
+    return a;
+};
+
+// refits and balances all nodes from index up to the root
+void heBvhFixUpwards(HeBvh* bvh, int32_t index) {
+    while(index != -1) {
+        index = heBvhBalance(bvh, index);
+        heBvhRefit(bvh, index);
+        index = bvh->nodes[index].parent;
+    }
+};
+
+void heBvhInsertLeaf(HeBvh* bvh, int32_t const leaf) {
+    if(bvh->root == -1) {
+        bvh->root = leaf;
+        bvh->nodes[leaf].parent = -1;
+        return;
+    }
+
+    // walk down the tree and find the sibling that increases the total surface area the least
+    hm::vec3f const min = bvh->nodes[leaf].min;
+    hm::vec3f const max = bvh->nodes[leaf].max;
+    int32_t index = bvh->root;
+    while(!heBvhIsLeaf(bvh->nodes[index])) {
+        HeBvhNode const& node = bvh->nodes[index];
+        float area         = heBvhArea(node.min, node.max);
+        float combinedArea = heBvhUnionArea(node, min, max);
+
+        // cost of creating a new parent for this node and the leaf
+        float cost = 2.f * combinedArea;
+        // minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.f * (combinedArea - area);
+
+        HeBvhNode const& left  = bvh->nodes[node.left];
+        HeBvhNode const& right = bvh->nodes[node.right];
+        float costLeft  = heBvhUnionArea(left,  min, max) + inheritanceCost;
+        float costRight = heBvhUnionArea(right, min, max) + inheritanceCost;
+        if(!heBvhIsLeaf(left))
+            costLeft  -= heBvhArea(left.min, left.max);
+        if(!heBvhIsLeaf(right))
+            costRight -= heBvhArea(right.min, right.max);
+
+        if(cost < costLeft && cost < costRight)
+            break;
+
+        index = (costLeft < costRight) ? node.left : node.right;
+    }
+
+    // create a new parent for the sibling and the leaf
+    int32_t sibling   = index;
+    int32_t oldParent = bvh->nodes[sibling].parent;
+    int32_t newParent = heBvhAllocateNode(bvh);
+    HeBvhNode* parent = &bvh->nodes[newParent];
+    parent->parent = oldParent;
+    parent->left   = sibling;
+    parent->right  = leaf;
+    heBvhReplaceChild(bvh, oldParent, sibling, newParent);
+    bvh->nodes[sibling].parent = newParent;
+    bvh->nodes[leaf].parent    = newParent;
+
+    heBvhFixUpwards(bvh, newParent);
+};
+
+void heBvhRemoveLeaf(HeBvh* bvh, int32_t const leaf) {
+    if(leaf == bvh->root) {
+        bvh->root = -1;
+        return;
+    }
+
+    int32_t parent  = bvh->nodes[leaf].parent;
+    int32_t grand   = bvh->nodes[parent].parent;
+    int32_t sibling = (bvh->nodes[parent].left == leaf) ? bvh->nodes[parent].right : bvh->nodes[parent].left;
+
+    // the sibling takes the place of the parent
+    heBvhReplaceChild(bvh, grand, parent, sibling);
+    bvh->nodes[sibling].parent = grand;
+    heBvhFreeNode(bvh, parent);
+
+    if(grand != -1)
+        heBvhFixUpwards(bvh, grand);
+};
+
+// recursively builds a subtree of given leaves using binned sah. Returns the root of that subtree
+int32_t heBvhBuildRecursive(HeBvh* bvh, int32_t* leaves, uint32_t const count) {
+    if(count == 1)
+        return leaves[0];
+
+    const uint32_t BIN_COUNT = 12;
+    auto centroid = [bvh](int32_t const leaf, uint8_t const axis) -> float {
+        return bvh->nodes[leaf].min[axis] + bvh->nodes[leaf].max[axis];
+    };
+
+    // bounds of the centroids
+    hm::vec3f cmin(FLT_MAX), cmax(-FLT_MAX);
+    for(uint32_t i = 0; i < count; ++i) {
+        for(uint8_t axis = 0; axis < 3; ++axis) {
+            float c = centroid(leaves[i], axis);
+            cmin[axis] = std::min(cmin[axis], c);
+            cmax[axis] = std::max(cmax[axis], c);
+        }
+    }
+
+    // find the cheapest split plane over all axes
+    float   bestCost  = FLT_MAX;
+    uint8_t bestAxis  = 0;
+    int32_t bestSplit = -1;
+    for(uint8_t axis = 0; axis < 3; ++axis) {
+        float extent = cmax[axis] - cmin[axis];
+        if(extent <= 0.f)
+            continue;
+
+        hm::vec3f binMin[BIN_COUNT], binMax[BIN_COUNT];
+        uint32_t  binCount[BIN_COUNT] = { 0 };
+        for(uint32_t i = 0; i < BIN_COUNT; ++i) {
+            binMin[i] = hm::vec3f(FLT_MAX);
+            binMax[i] = hm::vec3f(-FLT_MAX);
+        }
+
+        for(uint32_t i = 0; i < count; ++i) {
+            HeBvhNode const& node = bvh->nodes[leaves[i]];
+            uint32_t bin = std::min(BIN_COUNT - 1, (uint32_t) ((centroid(leaves[i], axis) - cmin[axis]) / extent * BIN_COUNT));
+            heBvhUnion(binMin[bin], binMax[bin], node.min, node.max, &binMin[bin], &binMax[bin]);
+            binCount[bin]++;
+        }
+
+        // sweep from the right to get the area of everything right of a split
+        float    rightArea[BIN_COUNT];
+        uint32_t rightCount[BIN_COUNT];
+        hm::vec3f min(FLT_MAX), max(-FLT_MAX);
+        uint32_t  sum = 0;
+        for(uint32_t i = BIN_COUNT - 1; i > 0; --i) {
+            heBvhUnion(min, max, binMin[i], binMax[i], &min, &max);
+            sum += binCount[i];
+            rightArea[i]  = (sum > 0) ? heBvhArea(min, max) : 0.f;
+            rightCount[i] = sum;
+        }
+
+        // sweep from the left and evaluate every split
+        min = hm::vec3f(FLT_MAX);
+        max = hm::vec3f(-FLT_MAX);
+        sum = 0;
+        for(uint32_t i = 0; i < BIN_COUNT - 1; ++i) {
+            heBvhUnion(min, max, binMin[i], binMax[i], &min, &max);
+            sum += binCount[i];
+            if(sum == 0 || rightCount[i + 1] == 0)
+                continue;
+
+            float cost = sum * heBvhArea(min, max) + rightCount[i + 1] * rightArea[i + 1];
+            if(cost < bestCost) {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = (int32_t) i + 1;
+            }
+        }
+    }
+
+    uint32_t middle;
+    if(bestSplit != -1) {
+        float extent = cmax[bestAxis] - cmin[bestAxis];
+        int32_t* split = std::partition(leaves, leaves + count, [&](int32_t const leaf) {
+            return std::min(BIN_COUNT - 1, (uint32_t) ((centroid(leaf, bestAxis) - cmin[bestAxis]) / extent * BIN_COUNT)) < (uint32_t) bestSplit;
+        });
+        middle = (uint32_t) (split - leaves);
+    } else {
+        // all centroids are in the same spot, just split in half
+        middle = count / 2;
+    }
+
+    int32_t left  = heBvhBuildRecursive(bvh, leaves, middle);
+    int32_t right = heBvhBuildRecursive(bvh, leaves + middle, count - middle);
+    int32_t index = heBvhAllocateNode(bvh);
+    bvh->nodes[index].left  = left;
+    bvh->nodes[index].right = right;
+    bvh->nodes[left].parent  = index;
+    bvh->nodes[right].parent = index;
+    heBvhRefit(bvh, index);
+    return index;
+};
+
+// traverses the tree and collects all leaves for which overlaps returns true. overlaps is called for inner nodes
+// as well, subtrees are skipped if it returns false
+template<typename F>
+uint32_t heBvhQuery(HeBvh const* bvh, F&& overlaps, uint32_t* results, float* distances, uint32_t const maxResults) {
+    if(bvh->root == -1 || maxResults == 0)
+        return 0;
+
+    int32_t  stack[HeBvh::MAX_DEPTH];
+    uint32_t stackSize = 0;
+    uint32_t count     = 0;
+    stack[stackSize++] = bvh->root;
+
+    while(stackSize > 0) {
+        HeBvhNode const& node = bvh->nodes[stack[--stackSize]];
+        float distance = 0.f;
+        if(!overlaps(node, &distance))
+            continue;
+
+        if(heBvhIsLeaf(node)) {
+            if(distances)
+                distances[count] = distance;
+            results[count++] = node.data;
+            if(count == maxResults)
+                break;
+        } else if(stackSize + 2 <= HeBvh::MAX_DEPTH) {
+            stack[stackSize++] = node.left;
+            stack[stackSize++] = node.right;
+        }
+    }
+
+    return count;
+};
+
+
+// -- tree
+
+int32_t heBvhInsert(HeBvh* bvh, hm::vec3f const& min, hm::vec3f const& max, uint32_t const data) {
+    int32_t leaf    = heBvhAllocateNode(bvh);
+    HeBvhNode* node = &bvh->nodes[leaf];
+    node->min  = min - hm::vec3f(bvh->margin);
+    node->max  = max + hm::vec3f(bvh->margin);
+    node->data = data;
+    heBvhInsertLeaf(bvh, leaf);
+    bvh->leafCount++;
+    return leaf;
+};
+
+void heBvhRemove(HeBvh* bvh, int32_t const leaf) {
+    heBvhRemoveLeaf(bvh, leaf);
+    heBvhFreeNode(bvh, leaf);
+    bvh->leafCount--;
+};
+
+b8 heBvhMove(HeBvh* bvh, int32_t const leaf, hm::vec3f const& min, hm::vec3f const& max) {
+    if(heBvhContains(bvh->nodes[leaf], min, max))
+        return false;
+
+    heBvhRemoveLeaf(bvh, leaf);
+    bvh->nodes[leaf].min = min - hm::vec3f(bvh->margin);
+    bvh->nodes[leaf].max = max + hm::vec3f(bvh->margin);
+    heBvhInsertLeaf(bvh, leaf);
+    return true;
+};
+
+void heBvhBuild(HeBvh* bvh, hm::vec3f const* mins, hm::vec3f const* maxs, uint32_t const* data, uint32_t const count, int32_t* leaves) {
+    heBvhClear(bvh);
+    if(count == 0)
+        return;
+
+    bvh->nodes.reserve(count * 2);
+    std::vector<int32_t> indices(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        int32_t leaf    = heBvhAllocateNode(bvh);
+        HeBvhNode* node = &bvh->nodes[leaf];
+        node->min  = mins[i] - hm::vec3f(bvh->margin);
+        node->max  = maxs[i] + hm::vec3f(bvh->margin);
+        node->data = data[i];
+        indices[i] = leaf;
+        if(leaves)
+            leaves[i] = leaf;
+    }
+
+    bvh->root = heBvhBuildRecursive(bvh, indices.data(), count);
+    bvh->nodes[bvh->root].parent = -1;
+    bvh->leafCount = count;
+};
+
+void heBvhClear(HeBvh* bvh) {
+    bvh->nodes.clear();
+    bvh->root      = -1;
+    bvh->freeList  = -1;
+    bvh->leafCount = 0;
+};
+
+
+// -- queries
+
+uint32_t heBvhQueryBox(HeBvh const* bvh, hm::vec3f const& min, hm::vec3f const& max, uint32_t* results, uint32_t const maxResults) {
+    return heBvhQuery(bvh, [&](HeBvhNode const& node, float*) {
+        return node.min.x <= max.x && node.max.x >= min.x &&
+            node.min.y <= max.y && node.max.y >= min.y &&
+            node.min.z <= max.z && node.max.z >= min.z;
+    }, results, nullptr, maxResults);
+};
+
+uint32_t heBvhQuerySphere(HeBvh const* bvh, hm::vec3f const& center, float const radius, uint32_t* results, uint32_t const maxResults) {
+    float const radius2 = radius * radius;
+    return heBvhQuery(bvh, [&](HeBvhNode const& node, float*) {
+        // distance from the center to the closest point in the box
+        float distance2 = 0.f;
+        for(uint8_t i = 0; i < 3; ++i) {
+            float d = std::max(node.min[i] - center[i], 0.f) + std::max(center[i] - node.max[i], 0.f);
+            distance2 += d * d;
+        }
+
+        return distance2 <= radius2;
+    }, results, nullptr, maxResults);
+};
+
+uint32_t heBvhQueryFrustum(HeBvh const* bvh, hm::vec4f const* planes, uint32_t* results, uint32_t const maxResults) {
+    return heBvhQuery(bvh, [&](HeBvhNode const& node, float*) {
+        hm::vec3f center = (node.min + node.max) / 2.f;
+        hm::vec3f extent = (node.max - node.min) / 2.f;
+        for(uint8_t i = 0; i < 6; ++i) {
+            hm::vec4f const& p = planes[i];
+            float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float radius   = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+            if(distance + radius < 0.f)
+                return false;
+        }
+
+        return true;
+    }, results, nullptr, maxResults);
+};
+
+uint32_t heBvhQueryRay(HeBvh const* bvh, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, uint32_t* results, float* distances, uint32_t const maxResults) {
+    hm::vec3f const inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+    return heBvhQuery(bvh, [&](HeBvhNode const& node, float* distance) {
+        return heBvhRayEnters(node, origin, inverse, maxDistance, distance);
+    }, results, distances, maxResults);
+};
+
+uint32_t heBvhRaycast(HeBvh const* bvh, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, std::function<float(uint32_t)> const& hit, float* distance) {
+    hm::vec3f const inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+    uint32_t closest      = UINT32_MAX;
+    float closestDistance = maxDistance;
+
+    // the nodes still to visit with the distance at which the ray enters them
+    int32_t  stack[HeBvh::MAX_DEPTH];
+    float    entries[HeBvh::MAX_DEPTH];
+    uint32_t stackSize = 0;
+    float    entry     = 0.f;
+    if(bvh->root != -1 && heBvhRayEnters(bvh->nodes[bvh->root], origin, inverse, closestDistance, &entry)) {
+        stack[stackSize]     = bvh->root;
+        entries[stackSize++] = entry;
+    }
+
+    while(stackSize > 0) {
+        --stackSize;
+        // the ray may have been shortened since this node was pushed
+        if(entries[stackSize] > closestDistance)
+            continue;
+
+        HeBvhNode const& node = bvh->nodes[stack[stackSize]];
+        if(heBvhIsLeaf(node)) {
+            float d = hit(node.data);
+            if(d >= 0.f && d < closestDistance) {
+                closest         = node.data;
+                closestDistance = d;
+            }
+
+            continue;
+        }
+
+        // push the farther child first so that the nearer one is visited next
+        float leftEntry, rightEntry;
+        b8 left  = heBvhRayEnters(bvh->nodes[node.left],  origin, inverse, closestDistance, &leftEntry);
+        b8 right = heBvhRayEnters(bvh->nodes[node.right], origin, inverse, closestDistance, &rightEntry);
+        if(left && right && stackSize + 2 <= HeBvh::MAX_DEPTH) {
+            b8 leftFirst = leftEntry <= rightEntry;
+            stack[stackSize]     = leftFirst ? node.right : node.left;
+            entries[stackSize++] = leftFirst ? rightEntry : leftEntry;
+            stack[stackSize]     = leftFirst ? node.left : node.right;
+            entries[stackSize++] = leftFirst ? leftEntry : rightEntry;
+        } else if(left && stackSize < HeBvh::MAX_DEPTH) {
+            stack[stackSize]     = node.left;
+            entries[stackSize++] = leftEntry;
+        } else if(right && stackSize < HeBvh::MAX_DEPTH) {
+            stack[stackSize]     = node.right;
+            entries[stackSize++] = rightEntry;
+        }
+    }
+
+    if(distance)
+        *distance = closestDistance;
+    return closest;
+};
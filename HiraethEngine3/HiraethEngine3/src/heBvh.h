@@ -0,0 +1,86 @@
+#ifndef HE_BVH_H
+#define HE_BVH_H
+
+#include "heTypes.h"
+#include "hm/hm.hpp"
+#include <functional>
+
+struct HeBvhNode {
+    // the bounds of this node. For leaves this is the fattened box of the object, for inner nodes the union of both
+    // children
+    hm::vec3f min;
+    hm::vec3f max;
+    // the parent node, or the next node in the free list if this node is unused
+    int32_t   parent = -1;
+    // the two children of an inner node. Both are -1 for leaves
+    int32_t   left   = -1;
+    int32_t   right  = -1;
+    // the height of this node in the tree, leaves have height 0. Unused nodes have height -1
+    int32_t   height = -1;
+    // user data of a leaf (i.e. the slot of an instance)
+    uint32_t  data   = 0;
+};
+
+// a dynamic axis aligned bounding box tree. Leaves are stored with a margin around their actual box so that small
+// movements dont change the tree at all, larger movements reinsert the leaf. Inserts keep the tree balanced through
+// rotations. Static content should be added with heBvhBuild which builds the tree top down using the surface area
+// heuristic. All queries write into caller provided buffers and never allocate
+struct HeBvh {
+    std::vector<HeBvhNode> nodes;
+    // the index of the root node, -1 if the tree is empty
+    int32_t  root      = -1;
+    // the first unused node
+    int32_t  freeList  = -1;
+    // the number of leaves in the tree
+    uint32_t leafCount = 0;
+    // the distance that leaf boxes are extended by in every direction
+    float    margin    = 0.1f;
+
+    // the size of the traversal stack of the queries. Balanced trees stay far below this
+    static const uint32_t MAX_DEPTH = 128;
+};
+
+
+// -- tree
+
+// inserts a new leaf with given box and user data into the tree. Returns the id of the leaf, which is needed to
+// move or remove it later
+extern HE_API int32_t heBvhInsert(HeBvh* bvh, hm::vec3f const& min, hm::vec3f const& max, uint32_t const data);
+// removes the given leaf from the tree
+extern HE_API void heBvhRemove(HeBvh* bvh, int32_t const leaf);
+// updates the box of a leaf. If the new box still fits into the fattened box of the leaf, nothing changes.
+// Otherwise the leaf is reinserted. Returns true if the tree changed
+extern HE_API b8 heBvhMove(HeBvh* bvh, int32_t const leaf, hm::vec3f const& min, hm::vec3f const& max);
+// rebuilds the whole tree from given boxes and user data using a binned surface area heuristic. This is much better
+// than inserting the boxes one by one and should be used for static content. The ids of the leaves are written
+// into leaves (if not nullptr), in the same order as the boxes
+extern HE_API void heBvhBuild(HeBvh* bvh, hm::vec3f const* mins, hm::vec3f const* maxs, uint32_t const* data, uint32_t const count, int32_t* leaves);
+// removes all nodes from the tree
+extern HE_API void heBvhClear(HeBvh* bvh);
+
+
+// -- queries
+
+// The box, sphere, frustum and ray queries test the fattened boxes of the leaves, so the results are conservative:
+// they contain every object that overlaps, but also objects that are up to margin away. Test the actual bounds of
+// the results if that matters (heBvhRaycast does this through its callback)
+
+// writes the user data of all leaves whose fattened box overlaps the given box into results. Returns the number of
+// results written, which is at most maxResults
+extern HE_API uint32_t heBvhQueryBox(HeBvh const* bvh, hm::vec3f const& min, hm::vec3f const& max, uint32_t* results, uint32_t const maxResults);
+// writes the user data of all leaves whose fattened box overlaps the given sphere into results
+extern HE_API uint32_t heBvhQuerySphere(HeBvh const* bvh, hm::vec3f const& center, float const radius, uint32_t* results, uint32_t const maxResults);
+// writes the user data of all leaves whose fattened box is at least partially inside the six planes into results.
+// The planes are stored as normal (xyz, pointing inwards) and distance (w), see HeD3Frustum
+extern HE_API uint32_t heBvhQueryFrustum(HeBvh const* bvh, hm::vec4f const* planes, uint32_t* results, uint32_t const maxResults);
+// writes the user data of all leaves whose fattened box is hit by the ray into results, and the distance along the ray
+// where the box was entered into distances (if not nullptr). direction must be normalized. The results are not sorted
+extern HE_API uint32_t heBvhQueryRay(HeBvh const* bvh, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, uint32_t* results, float* distances, uint32_t const maxResults);
+// returns the user data of the closest object hit by the ray or UINT32_MAX if nothing is hit before maxDistance. The
+// leaves are visited closest first and the ray is shortened with every hit, so far away subtrees are skipped. hit is
+// called with the user data of every leaf whose box is reached and returns the distance to the actual object along
+// the ray, or a negative value if it is missed. The distance of the closest hit is written into distance (if not
+// nullptr). direction must be normalized
+extern HE_API uint32_t heBvhRaycast(HeBvh const* bvh, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, std::function<float(uint32_t)> const& hit, float* distance);
+
+#endif
@@ -3,12 +3,13 @@
 #include "heBinary.h"
 #include "heAssets.h"
 #include "heCore.h"
+#include "heLoader.h"
 
 #pragma warning(push, 0)
 #include "..\stb_image.h"
 #pragma warning(pop)
 
-void heBinaryConvertD3InstanceFile(std::string const& inFile, std::string const& outFile) {
+void heBinaryConvertD3InstanceFile(std::string const& inFile, std::string const& outFile, uint32_t const lodCount) {
     HeTextFile in;
     in.skipEmptyLines = false;
     heTextFileOpen(&in, inFile, 0, false);
@@ -37,36 +38,53 @@ void heBinaryConvertD3InstanceFile(std::string const& inFile, std::string const&
     heBinaryBufferAdd(&buffer, '\n');
     float result = 0.f;
     
-    // parse vertices
-    {
-        std::vector<float> vertices;
-        while(heTextFileGetFloat(&in, &result))
-            vertices.emplace_back(result);
-        heBinaryBufferAddFloatBuffer(&buffer, vertices);
-    }
-    
-    // parse uvs
-    {
-        std::vector<float> uvs;
-        while(heTextFileGetFloat(&in, &result))
-            uvs.emplace_back(result);
-        heBinaryBufferAddFloatBuffer(&buffer, uvs);
-    }
-    
-    // parse normals
-    {
-        std::vector<float> normals;
-        while(heTextFileGetFloat(&in, &result))
-            normals.emplace_back(result);
-        heBinaryBufferAddFloatBuffer(&buffer, normals);
-    }
-    
-    // parse tangents
+    // parse mesh
+    HeD3MeshBuilder mesh;
+    while(heTextFileGetFloat(&in, &result))
+        mesh.verticesArray.emplace_back(result);
+    while(heTextFileGetFloat(&in, &result))
+        mesh.uvArray.emplace_back(result);
+    while(heTextFileGetFloat(&in, &result))
+        mesh.normalArray.emplace_back(result);
+    while(heTextFileGetFloat(&in, &result))
+        mesh.tangentArray.emplace_back(result);
+
+    heBinaryBufferAddFloatBuffer(&buffer, mesh.verticesArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh.uvArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh.normalArray);
+    heBinaryBufferAddFloatBuffer(&buffer, mesh.tangentArray);
+
+    // generate lods. Every lod has about half the triangles of the previous one and is used once the instance
+    // covers less than half the screen size of the previous one. Lods that barely simplify the mesh are skipped
+    // (and end the chain), the error bound keeps the silhouette from collapsing on small meshes
     {
-        std::vector<float> tangents;
-        while(heTextFileGetFloat(&in, &result))
-            tangents.emplace_back(result);
-        heBinaryBufferAddFloatBuffer(&buffer, tangents);
+        std::vector<HeD3MeshBuilder> lods;
+        std::vector<float> screenSizes;
+        lods.reserve(lodCount);
+        HeD3MeshBuilder const* previous = &mesh;
+        for(uint32_t i = 0; i < lodCount; ++i) {
+            uint32_t triangles = (uint32_t) previous->verticesArray.size() / 9;
+            HeD3MeshBuilder lod;
+            heD3MeshBuilderSimplify(previous, &lod, triangles / 2, .01f * (float) (1 << i));
+            if(lod.verticesArray.size() / 9 > triangles * 3 / 4 || lod.verticesArray.empty())
+                break;
+
+            lods.emplace_back(std::move(lod));
+            screenSizes.emplace_back(.5f / (float) (1 << i));
+            previous = &lods.back();
+        }
+
+        if(!lods.empty()) {
+            heBinaryBufferAddInt(&buffer, HE_ASSET_CHUNK_LODS);
+            heBinaryBufferAddInt(&buffer, (uint32_t) lods.size());
+            for(size_t i = 0; i < lods.size(); ++i) {
+                heBinaryBufferAddFloat(&buffer, screenSizes[i]);
+                heBinaryBufferAddFloatBuffer(&buffer, lods[i].verticesArray);
+                heBinaryBufferAddFloatBuffer(&buffer, lods[i].uvArray);
+                heBinaryBufferAddFloatBuffer(&buffer, lods[i].normalArray);
+                heBinaryBufferAddFloatBuffer(&buffer, lods[i].tangentArray);
+            }
+        }
     }
     
     // parse physics
@@ -5,8 +5,9 @@
 
 struct HeTexture;
 
-// converts a d3 instance file from ascii to binary
-extern HE_API void heBinaryConvertD3InstanceFile(std::string const& inFile, std::string const& outFile);
+// converts a d3 instance file from ascii to binary. Also generates up to lodCount simplified versions of the mesh
+// (each with about half the triangles of the previous one) and stores them in the binary file
+extern HE_API void heBinaryConvertD3InstanceFile(std::string const& inFile, std::string const& outFile, uint32_t const lodCount = 3);
 // loads a texture, compresses it and then exports that texture into the out file
 extern HE_API void heTextureCompress(std::string const& inFile, std::string const& outFile);
 // exports that compressed texture into the out file
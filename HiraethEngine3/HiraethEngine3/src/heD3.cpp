@@ -2,24 +2,76 @@
 #include "heD3.h"
 #include "heCore.h"
 #include "heWin32Layer.h"
+#include "heWorkerPool.h"
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cfloat>
 
 HeD3Level* heD3Level = nullptr;
+// how far (relative) the projected size of an instance must be past the screen size of a lod before it switches
+static const float LOD_HYSTERESIS = .1f;
+// the size of the occlusion buffer in pixels
+static const uint16_t OCCLUSION_WIDTH  = 256;
+static const uint16_t OCCLUSION_HEIGHT = 128;
+// the maximum number of occluders rendered per frame
+static const uint32_t OCCLUSION_MAX_OCCLUDERS = 32;
+// visible meshes that cover at least this much of the screen height are used as occluders
+static const float OCCLUSION_MIN_SCREEN_SIZE = .3f;
+// occluders are drawn with the first lod that has at most this many triangles, meshes without such a lod are skipped
+static const uint32_t OCCLUSION_MAX_TRIANGLES = 4096;
+// the number of particles of a source that are updated as a single task. This does not depend on the number of
+// threads, so that the result of the update does not either
+static const uint32_t PARTICLE_CHUNK_SIZE = 4096;
+// the depth sort of particles repairs the order of the last update with an insertion sort as long as that needs at
+// most this many moves per particle and at most this fraction of the particles is new. Otherwise the whole order is
+// radix sorted again
+static const float PARTICLE_SORT_MAX_MOVES = 1.f;
+static const float PARTICLE_SORT_MAX_NEW   = .125f;
+
+
+// -- utils
+
+// returns the fraction of the screen height that the bounding sphere around given box covers
+inline float heD3GetScreenSize(hm::vec3f const& center, hm::vec3f const& extent, hm::vec3f const& cameraPosition, float const projectionScale) {
+    float distance = hm::length(center - cameraPosition);
+    return hm::length(extent) * projectionScale / std::max(distance, FLT_EPSILON);
+};
+
+// returns an orthographic projection of the given view space box. The view looks down the negative z axis, so max.z
+// is mapped to the near plane and min.z to the far plane
+inline hm::mat4f heD3CreateOrthographicMatrix(hm::vec3f const& min, hm::vec3f const& max) {
+    hm::mat4f projection(1.f);
+    projection[0][0] =  2.f / (max.x - min.x);
+    projection[1][1] =  2.f / (max.y - min.y);
+    projection[2][2] = -2.f / (max.z - min.z);
+    projection[3][0] = -(max.x + min.x) / (max.x - min.x);
+    projection[3][1] = -(max.y + min.y) / (max.y - min.y);
+    projection[3][2] =  (max.z + min.z) / (max.z - min.z);
+    return projection;
+};
 
 
 // -- instance
 
-void heD3InstanceUpdate(HeD3Instance* instance) {
-    // update physics
-    if(instance->physics) {
-        instance->transformation.position = hePhysicsComponentGetPosition(instance->physics);
-        instance->transformation.rotation = hePhysicsComponentGetRotation(instance->physics);
-    }
+void heD3InstanceSelectLod(HeD3Instance* instance, hm::vec3f const& boundsCenter, hm::vec3f const& boundsExtent, hm::vec3f const& cameraPosition, float const projectionScale) {
+    std::vector<HeVaoLod> const& lods = instance->mesh->lods;
+    float size = heD3GetScreenSize(boundsCenter, boundsExtent, cameraPosition, projectionScale);
+
+    uint8_t lod = std::min(instance->lod, (uint8_t) lods.size());
+    while(lod < lods.size() && size < lods[lod].screenSize * (1.f - LOD_HYSTERESIS))
+        lod++;
+    while(lod > 0 && size > lods[lod - 1].screenSize * (1.f + LOD_HYSTERESIS))
+        lod--;
+    instance->lod = lod;
 };
 
-void heD3InstanceSetPosition(HeD3Instance* instance, hm::vec3f const& position) {
-    instance->transformation.position = position;
-    if(instance->physics)
-        hePhysicsComponentSetPosition(instance->physics, position);
+HeVao* heD3InstanceGetMesh(HeD3Instance const* instance) {
+    return (instance->lod == 0) ? instance->mesh : instance->mesh->lods[instance->lod - 1].vao;
+};
+
+b8 heD3InstanceIsStatic(HeD3Instance const* instance) {
+    return instance->mesh != nullptr && instance->material != nullptr && instance->parent.generation == 0 &&
+        instance->firstChild == UINT32_MAX && (instance->physics == nullptr || instance->physics->shapeInfo.mass == 0.f);
 };
 
 
@@ -31,7 +83,7 @@ void heD3FrustumUpdate(HeD3Frustum* frustum, HeWindow* window, hm::vec3f const&
         rotationMat = hm::rotate(rotationMat, (float) -rotation.y, hm::vec3f(0, 1, 0));
         rotationMat = hm::rotate(rotationMat, (float) -rotation.x, hm::vec3f(1, 0, 0));
 
-        float fov        = (float) std::tanf(frustum->viewInfo.fov * (float) hm::PI / 360.f);
+        float fov        = (float) std::tan(frustum->viewInfo.fov * (float) hm::PI / 360.f);
         float farHeight  = frustum->viewInfo.farPlane * fov;
         float farWidth   = farHeight * window->windowInfo.aspectRatio;
         float nearHeight = frustum->viewInfo.nearPlane * fov;
@@ -93,7 +145,7 @@ void heD3FrustumUpdateWithMatrix(HeD3Frustum* frustum, HeWindow* window, hm::vec
         rotationMat = hm::rotate(rotationMat, (float) -rotation.y, hm::vec3f(0, 1, 0));
         rotationMat = hm::rotate(rotationMat, (float) -rotation.x, hm::vec3f(1, 0, 0));
    
-        float fov        = (float) std::tanf(frustum->viewInfo.fov * (float) hm::PI / 360.f);
+        float fov        = (float) std::tan(frustum->viewInfo.fov * (float) hm::PI / 360.f);
         float farHeight  = frustum->viewInfo.farPlane * fov;
         float farWidth   = farHeight * window->windowInfo.aspectRatio;
         float nearHeight = frustum->viewInfo.nearPlane * fov;
@@ -149,6 +201,33 @@ void heD3FrustumUpdateWithMatrix(HeD3Frustum* frustum, HeWindow* window, hm::vec
     }
 };
 
+void heD3FrustumUpdatePlanes(HeD3Frustum* frustum, hm::mat4f const& viewProjection) {
+    // each plane is the fourth row of the matrix plus or minus one of the other rows
+    hm::mat4f const& m = viewProjection;
+    for(uint8_t i = 0; i < 6; ++i) {
+        uint8_t row = i / 2;
+        float sign  = (i % 2 == 0) ? 1.f : -1.f;
+        hm::vec4f plane(m[0][3] + sign * m[0][row], m[1][3] + sign * m[1][row], m[2][3] + sign * m[2][row], m[3][3] + sign * m[3][row]);
+        float length = hm::length(hm::vec3f(plane));
+        frustum->planes[i] = plane * (1.f / length);
+    }
+};
+
+b8 heD3FrustumContainsBox(HeD3Frustum const* frustum, hm::vec3f const& center, hm::vec3f const& extent) {
+    if(extent.x < 0.f)
+        return true;
+    
+    for(uint8_t i = 0; i < 6; ++i) {
+        hm::vec4f const& p = frustum->planes[i];
+        float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float radius   = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+        if(distance + radius < 0.f)
+            return false;
+    }
+
+    return true;
+};
+
 
 // -- camera
 
@@ -207,31 +286,390 @@ HeD3LightSource* heD3LightSourceCreatePoint(HeD3Level* level, hm::vec3f const& p
     return light;
 };
 
+float heD3LightSourceGetRange(HeD3LightSource const* light) {
+    float const* attenuation;
+    if(light->type == HE_LIGHT_SOURCE_TYPE_POINT)
+        attenuation = &light->data[0];
+    else if(light->type == HE_LIGHT_SOURCE_TYPE_SPOT)
+        attenuation = &light->data[5];
+    else
+        return -1.f;
+
+    // solve 1 / (c + l * d + q * d^2) = 1 / (256 * brightness) for d
+    float brightness = std::max(light->colour.r, std::max(light->colour.g, light->colour.b)) / 255.f * light->colour.i;
+    if(brightness <= 0.f)
+        return 0.f;
+    
+    float c = attenuation[0] - 256.f * brightness;
+    float l = attenuation[1];
+    float q = attenuation[2];
+    if(q > 0.f)
+        return (-l + std::sqrt(l * l - 4.f * q * c)) / (2.f * q);
+    else if(l > 0.f)
+        return std::max(-c / l, 0.f);
+    
+    return -1.f;
+};
+
 void heD3ShadowMapCreate(HeD3ShadowMap* shadowMap, HeD3LightSource* source) {
+    shadowMap->cascadeCount  = std::min(std::max(shadowMap->cascadeCount, (uint8_t) 1), HeD3ShadowMap::MAX_CASCADES);
     source->castShadows      = true;
     shadowMap->viewMatrix    = hm::mat4f(1.0f);
-    shadowMap->depthFbo.size = shadowMap->resolution;
+    shadowMap->depthFbo.size = shadowMap->resolution * hm::vec2i(std::min(shadowMap->cascadeCount, (uint8_t) 2), (shadowMap->cascadeCount + 1) / 2);
     heFboCreate(&shadowMap->depthFbo);
     heFboCreateDepthTextureAttachment(&shadowMap->depthFbo);
     heFboDisableColourAttachment(&shadowMap->depthFbo);
     heFboValidate(&shadowMap->depthFbo);
+
+    if(shadowMap->cacheStatic) {
+        shadowMap->staticFbo.size = shadowMap->depthFbo.size;
+        heFboCreate(&shadowMap->staticFbo);
+        heFboCreateDepthTextureAttachment(&shadowMap->staticFbo);
+        heFboDisableColourAttachment(&shadowMap->staticFbo);
+        heFboValidate(&shadowMap->staticFbo);
+    }
+    
     heFboUnbind();
 };
 
+void heD3ShadowMapUpdateCascades(HeD3ShadowMap* shadowMap, HeD3LightSource const* source, HeD3Camera const* camera) {
+    { // rotate the view towards the light
+        hm::vec3f forward = hm::normalize(source->vector);
+        hm::vec3f up      = (std::abs(forward.y) > .99f) ? hm::vec3f(1.f, 0.f, 0.f) : hm::vec3f(0.f, 1.f, 0.f);
+        hm::vec3f right   = hm::normalize(hm::cross(forward, up));
+        up = hm::cross(right, forward);
+
+        shadowMap->viewMatrix = hm::mat4f(1.f);
+        shadowMap->viewMatrix[0][0] = right.x;    shadowMap->viewMatrix[1][0] = right.y;    shadowMap->viewMatrix[2][0] = right.z;
+        shadowMap->viewMatrix[0][1] = up.x;       shadowMap->viewMatrix[1][1] = up.y;       shadowMap->viewMatrix[2][1] = up.z;
+        shadowMap->viewMatrix[0][2] = -forward.x; shadowMap->viewMatrix[1][2] = -forward.y; shadowMap->viewMatrix[2][2] = -forward.z;
+    }
+
+    // maps [-1:1] to [0:1], built at compile time
+    constexpr hm::mat4f OFFSET_MATRIX = hm::scale(hm::translate(hm::mat4f(1.f), hm::vec3f(.5f)), hm::vec3f(.5f));
+    uint8_t const columns = std::min(shadowMap->cascadeCount, (uint8_t) 2);
+    uint8_t const rows    = (shadowMap->cascadeCount + 1) / 2;
+
+    hm::mat4f inverseView = hm::inverse(camera->viewMatrix);
+    float nearPlane = camera->frustum.viewInfo.nearPlane;
+    float farPlane  = std::min(shadowMap->shadowDistance, camera->frustum.viewInfo.farPlane);
+    float tanX      = 1.f / camera->projectionMatrix[0][0];
+    float tanY      = 1.f / camera->projectionMatrix[1][1];
+    hm::vec3f unionMin(FLT_MAX), unionMax(-FLT_MAX);
+
+    float sliceStart = nearPlane;
+    for(uint8_t i = 0; i < shadowMap->cascadeCount; ++i) {
+        HeD3ShadowCascade* cascade = &shadowMap->cascades[i];
+        float t           = (float) (i + 1) / (float) shadowMap->cascadeCount;
+        float uniform     = nearPlane + (farPlane - nearPlane) * t;
+        float logarithmic = nearPlane * std::pow(farPlane / nearPlane, t);
+        cascade->splitDepth = uniform + (logarithmic - uniform) * shadowMap->splitWeight;
+
+        // the bounding sphere of the slice. Its size does not change when the camera rotates, and rounding the
+        // radius keeps it from changing because of precision issues
+        hm::vec3f corners[8];
+        hm::vec3f center(0.f);
+        for(uint8_t j = 0; j < 8; ++j) {
+            float depth = (j < 4) ? sliceStart : cascade->splitDepth;
+            hm::vec4f view(((j & 1) ? 1.f : -1.f) * depth * tanX, ((j & 2) ? 1.f : -1.f) * depth * tanY, -depth, 1.f);
+            corners[j] = hm::vec3f(inverseView * view);
+            center += corners[j];
+        }
+
+        center = center * (1.f / 8.f);
+        float radius = 0.f;
+        for(uint8_t j = 0; j < 8; ++j)
+            radius = std::max(radius, hm::length(corners[j] - center));
+        radius = std::ceil(radius * 16.f) / 16.f;
+
+        // move the cascade in whole texels
+        hm::vec3f lightCenter(shadowMap->viewMatrix * hm::vec4f(center, 1.f));
+        float texelSize = 2.f * radius / (float) shadowMap->resolution.x;
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+        // snap the depth as well (with one texel of padding), so that the projection stays exactly the same and the
+        // cached cascade stays valid while the camera moves less than a texel
+        lightCenter.z = std::floor(lightCenter.z / texelSize) * texelSize;
+
+        // the view looks down the negative z axis, so the box reaches from -(z + radius + offset) to -(z - radius)
+        hm::vec3f min(lightCenter.x - radius, lightCenter.y - radius, lightCenter.z - radius - texelSize);
+        hm::vec3f max(lightCenter.x + radius, lightCenter.y + radius, lightCenter.z + radius + texelSize + shadowMap->offset);
+        hm::mat4f const& projection = cascade->projectionMatrix = heD3CreateOrthographicMatrix(min, max);
+        unionMin = hm::vec3f(std::min(unionMin.x, min.x), std::min(unionMin.y, min.y), std::min(unionMin.z, min.z));
+        unionMax = hm::vec3f(std::max(unionMax.x, max.x), std::max(unionMax.y, max.y), std::max(unionMax.z, max.z));
+
+        // the place of the cascade in the atlas
+        hm::vec2f scale(1.f / (float) columns, 1.f / (float) rows);
+        hm::vec2f offset((float) (i % 2) * scale.x, (float) (i / 2) * scale.y);
+        cascade->atlasRect = hm::vec4f(offset.x, offset.y, offset.x + scale.x, offset.y + scale.y);
+        hm::mat4f atlas = hm::scale(hm::translate(hm::mat4f(1.f), hm::vec3f(offset.x, offset.y, 0.f)), hm::vec3f(scale.x, scale.y, 1.f));
+        cascade->shadowSpaceMatrix = atlas * OFFSET_MATRIX * projection * shadowMap->viewMatrix;
+        heD3FrustumUpdatePlanes(&cascade->frustum, projection * shadowMap->viewMatrix);
+        sliceStart = cascade->splitDepth;
+    }
+
+    // a box around all cascades, in the view space of the light
+    shadowMap->projectionMatrix = heD3CreateOrthographicMatrix(unionMin, unionMax);
+};
+
+uint8_t heD3ShadowMapUpdateCache(HeD3ShadowMap* shadowMap, HeD3Level const* level) {
+    b8 rebuildAll = !shadowMap->cacheValid || shadowMap->cachedRevision != level->staticRevision ||
+        std::memcmp(&shadowMap->cachedViewMatrix, &shadowMap->viewMatrix, sizeof(hm::mat4f)) != 0;
+
+    uint8_t outdated = 0;
+    for(uint8_t i = 0; i < shadowMap->cascadeCount; ++i) {
+        HeD3ShadowCascade* cascade = &shadowMap->cascades[i];
+        if(rebuildAll || std::memcmp(&cascade->cachedProjection, &cascade->projectionMatrix, sizeof(hm::mat4f)) != 0) {
+            cascade->cachedProjection = cascade->projectionMatrix;
+            outdated |= 1 << i;
+        }
+    }
+
+    shadowMap->cachedViewMatrix = shadowMap->viewMatrix;
+    shadowMap->cachedRevision   = level->staticRevision;
+    shadowMap->cacheValid       = true;
+    return outdated;
+};
+
 
 // -- level
 
+HeD3Instance* heD3LevelAddInstance(HeD3Level* level) {
+    uint32_t slotIndex;
+    if(level->freeInstanceSlot != UINT32_MAX) {
+        slotIndex               = level->freeInstanceSlot;
+        level->freeInstanceSlot = level->instanceSlots[slotIndex].denseIndex;
+    } else {
+        slotIndex = (uint32_t) level->instanceSlots.size();
+        level->instanceSlots.emplace_back();
+    }
+
+    HeD3InstanceSlot* slot = &level->instanceSlots[slotIndex];
+    slot->denseIndex       = (uint32_t) level->instances.size();
+
+    level->instanceWorldMatrices.emplace_back(1.f);
+    level->instanceNormalMatrices.emplace_back(1.f);
+    level->instanceBoundsCenters.emplace_back(0.f);
+    level->instanceBoundsExtents.emplace_back(-1.f);
+    level->instanceFlags.emplace_back(HE_D3_INSTANCE_FLAG_DIRTY);
+
+    HeD3Instance* instance = &level->instances.emplace_back();
+    instance->id.index      = slotIndex;
+    instance->id.generation = slot->generation;
+    return instance;
+};
+
 void heD3LevelRemoveInstance(HeD3Level* level, HeD3Instance* instance) {
+    if(instance < level->instances.data() || instance >= level->instances.data() + level->instances.size())
+        return;
+
+    // copy the id, the instance will be overwritten by the last instance
+    HeD3InstanceId id = instance->id;
+    heD3LevelRemoveInstanceById(level, id);
+};
+
+// splits the static batch that given instance was merged into up again. All instances of that batch are drawn on
+// their own from now on, the emptied batch is kept (so that the indices of the other batches stay the same) but
+// skipped until the batches are rebuilt
+void heD3LevelSplitStaticBatch(HeD3Level* level, HeD3Instance const* instance) {
+    for(auto& all : level->staticBatches) {
+        if(std::find(all.instances.begin(), all.instances.end(), instance->id.index) == all.instances.end())
+            continue;
+
+        for(uint32_t slot : all.instances)
+            level->instanceFlags[level->instanceSlots[slot].denseIndex] &= ~HE_D3_INSTANCE_FLAG_BATCHED;
+
+        level->occluderMeshes.erase(&all.vao);
+        heVaoDestroy(&all.vao);
+        all.instances.clear();
+        all.instanceCount = 0;
+        level->staticRevision++;
+        break;
+    }
+};
+
+void heD3LevelRemoveInstanceById(HeD3Level* level, HeD3InstanceId const& id) {
+    HeD3Instance const* removed = heD3LevelGetInstanceById(level, id);
+    if(removed == nullptr)
+        return;
+
+    if(level->instanceFlags[heD3LevelGetInstanceIndex(level, removed)] & HE_D3_INSTANCE_FLAG_BATCHED)
+        heD3LevelSplitStaticBatch(level, removed);
+
+    // detach from the parent and turn all children into roots
+    heD3LevelSetInstanceParent(level, id, HeD3InstanceId());
+    while(level->instances[level->instanceSlots[id.index].denseIndex].firstChild != UINT32_MAX) {
+        HeD3Instance* child = heD3LevelGetInstanceFromSlot(level, level->instances[level->instanceSlots[id.index].denseIndex].firstChild);
+        heD3LevelSetInstanceParent(level, child->id, HeD3InstanceId());
+    }
+
+    HeD3InstanceSlot* slot = &level->instanceSlots[id.index];
+    uint32_t denseIndex    = slot->denseIndex;
+    if(heD3InstanceIsStatic(&level->instances[denseIndex]))
+        level->staticRevision++;
+    
+    if(level->instances[denseIndex].bvhLeaf != -1)
+        heBvhRemove(&level->instanceTree, level->instances[denseIndex].bvhLeaf);
+
+    // swap the last instance into the gap
+    if(denseIndex != level->instances.size() - 1) {
+        level->instances[denseIndex]              = std::move(level->instances.back());
+        level->instanceWorldMatrices[denseIndex]  = level->instanceWorldMatrices.back();
+        level->instanceNormalMatrices[denseIndex] = level->instanceNormalMatrices.back();
+        level->instanceBoundsCenters[denseIndex]  = level->instanceBoundsCenters.back();
+        level->instanceBoundsExtents[denseIndex]  = level->instanceBoundsExtents.back();
+        level->instanceFlags[denseIndex]          = level->instanceFlags.back();
+        level->instanceSlots[level->instances[denseIndex].id.index].denseIndex = denseIndex;
+    }
+
+    level->instances.pop_back();
+    level->instanceWorldMatrices.pop_back();
+    level->instanceNormalMatrices.pop_back();
+    level->instanceBoundsCenters.pop_back();
+    level->instanceBoundsExtents.pop_back();
+    level->instanceFlags.pop_back();
+
+    // invalidate all ids of this slot and put it into the free list
+    slot->generation++;
+    if(slot->generation == 0)
+        slot->generation = 1;
+    slot->denseIndex        = level->freeInstanceSlot;
+    level->freeInstanceSlot = id.index;
+};
+
+void heD3LevelUpdateInstance(HeD3Level* level, uint32_t const index) {
+    HeD3Instance* instance = &level->instances[index];
+
+    // update physics
+    if(instance->physics) {
+        hm::vec3f position = hePhysicsComponentGetPosition(instance->physics);
+        hm::quatf rotation = hePhysicsComponentGetRotation(instance->physics);
+
+        // only invalidate the matrices if the body actually moved, resting bodies keep their cache
+        hm::vec3f& p = instance->transformation.position;
+        hm::quatf& r = instance->transformation.rotation;
+        if(p.x != position.x || p.y != position.y || p.z != position.z ||
+           r.x != rotation.x || r.y != rotation.y || r.z != rotation.z || r.w != rotation.w) {
+            p = position;
+            r = rotation;
+            level->instanceFlags[index] |= HE_D3_INSTANCE_FLAG_DIRTY;
+        }
+    }
+};
+
+void heD3LevelSetInstancePosition(HeD3Level* level, HeD3Instance* instance, hm::vec3f const& position) {
+    instance->transformation.position = position;
+    level->instanceFlags[heD3LevelGetInstanceIndex(level, instance)] |= HE_D3_INSTANCE_FLAG_DIRTY;
+    if(instance->physics)
+        hePhysicsComponentSetPosition(instance->physics, position);
+};
+
+void heD3LevelSetInstanceRotation(HeD3Level* level, HeD3Instance* instance, hm::quatf const& rotation) {
+    instance->transformation.rotation = rotation;
+    level->instanceFlags[heD3LevelGetInstanceIndex(level, instance)] |= HE_D3_INSTANCE_FLAG_DIRTY;
+    if(instance->physics)
+        hePhysicsComponentSetTransform(instance->physics, instance->transformation);
+};
+
+void heD3LevelSetInstanceScale(HeD3Level* level, HeD3Instance* instance, hm::vec3f const& scale) {
+    instance->transformation.scale = scale;
+    level->instanceFlags[heD3LevelGetInstanceIndex(level, instance)] |= HE_D3_INSTANCE_FLAG_DIRTY;
+};
+
+// builds the matrices and bounds of the instance with given index. parentMatrix is the world matrix of the parent,
+// or nullptr if the instance has none
+void heD3LevelBuildInstanceMatrices(HeD3Level* level, uint32_t const index, hm::mat4f const* parentMatrix) {
+    HeD3Instance const* instance = &level->instances[index];
+    hm::mat4f& worldMatrix = level->instanceWorldMatrices[index];
+    worldMatrix = hm::createTransformationMatrix(instance->transformation.position, instance->transformation.rotation, instance->transformation.scale);
+    if(parentMatrix)
+        worldMatrix = *parentMatrix * worldMatrix;
+    level->instanceNormalMatrices[index] = hm::transpose(hm::inverse(hm::mat3f(worldMatrix)));
+    level->instanceFlags[index] &= ~HE_D3_INSTANCE_FLAG_DIRTY;
+
+    if(instance->mesh && instance->mesh->boundsRadius >= 0.f) {
+        // transform the center and project the rotated and scaled box back onto the world axes
+        hm::mat4f const& m    = worldMatrix;
+        hm::vec3f localCenter = (instance->mesh->boundsMin + instance->mesh->boundsMax) / 2.f;
+        hm::vec3f localExtent = (instance->mesh->boundsMax - instance->mesh->boundsMin) / 2.f;
+        hm::vec3f& extent     = level->instanceBoundsExtents[index];
+        level->instanceBoundsCenters[index] = hm::vec3f(m * hm::vec4f(localCenter, 1.f));
+        for(uint8_t i = 0; i < 3; ++i)
+            extent[i] = std::abs(m[0][i]) * localExtent.x + std::abs(m[1][i]) * localExtent.y + std::abs(m[2][i]) * localExtent.z;
+    } else
+        level->instanceBoundsExtents[index] = hm::vec3f(-1.f);
+};
+
+void heD3LevelUpdateInstanceMatrices(HeD3Level* level, uint32_t const index) {
+    if(!(level->instanceFlags[index] & HE_D3_INSTANCE_FLAG_DIRTY) || level->instances[index].parent.generation != 0)
+        return;
+
+    heD3LevelBuildInstanceMatrices(level, index, nullptr);
+};
+
+// moves the instances that changed in the last heD3LevelUpdateTransforms in the instance tree
+void heD3LevelUpdateInstanceTree(HeD3Level* level) {
+    for(auto const& depth : level->dirtyInstances) {
+        for(uint32_t index : depth) {
+            HeD3Instance& all = level->instances[index];
+            hm::vec3f const& center = level->instanceBoundsCenters[index];
+            hm::vec3f const& extent = level->instanceBoundsExtents[index];
+            b8 hasBounds = extent.x >= 0.f;
+            if(hasBounds && all.bvhLeaf == -1)
+                all.bvhLeaf = heBvhInsert(&level->instanceTree, center - extent, center + extent, all.id.index);
+            else if(hasBounds)
+                heBvhMove(&level->instanceTree, all.bvhLeaf, center - extent, center + extent);
+            else if(all.bvhLeaf != -1) {
+                heBvhRemove(&level->instanceTree, all.bvhLeaf);
+                all.bvhLeaf = -1;
+            }
+        }
+    }
+};
+
+// moves the attached lights with their parent
+void heD3LevelUpdateLights(HeD3Level* level) {
+    for(auto& all : level->lights) {
+        HeD3Instance const* parent = heD3LevelGetInstanceById(level, all.parent);
+        if(parent == nullptr)
+            continue;
+
+        hm::mat4f const& parentMatrix = level->instanceWorldMatrices[heD3LevelGetInstanceIndex(level, parent)];
+        hm::mat3f rotation(parentMatrix);
+        hm::vec3f vector = (all.type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL) ? hm::normalize(rotation * all.localVector) : hm::vec3f(parentMatrix * hm::vec4f(all.localVector, 1.f));
+        if(vector.x != all.vector.x || vector.y != all.vector.y || vector.z != all.vector.z) {
+            all.vector = vector;
+            all.update = true;
+        }
+
+        if(all.type == HE_LIGHT_SOURCE_TYPE_SPOT) {
+            hm::vec3f direction = hm::normalize(rotation * all.localDirection);
+            if(direction.x != all.data[0] || direction.y != all.data[1] || direction.z != all.data[2]) {
+                all.data[0] = direction.x;
+                all.data[1] = direction.y;
+                all.data[2] = direction.z;
+                all.update  = true;
+            }
+        }
+    }
+};
+
+// moves all lights in the light tree. Lights are few, so just check all of them
+void heD3LevelUpdateLightTree(HeD3Level* level) {
     uint32_t index = 0;
-    for(HeD3Instance& all : level->instances) {
-        if(&all == instance)
-            break;
+    for(auto& all : level->lights) {
+        float range = all.active ? heD3LightSourceGetRange(&all) : -1.f;
+        if(range >= 0.f && all.bvhLeaf == -1)
+            all.bvhLeaf = heBvhInsert(&level->lightTree, all.vector - hm::vec3f(range), all.vector + hm::vec3f(range), index);
+        else if(range >= 0.f)
+            heBvhMove(&level->lightTree, all.bvhLeaf, all.vector - hm::vec3f(range), all.vector + hm::vec3f(range));
+        else if(all.bvhLeaf != -1) {
+            heBvhRemove(&level->lightTree, all.bvhLeaf);
+            all.bvhLeaf = -1;
+        }
+
         index++;
     }
-    
-    auto it = level->instances.begin();
-    std::advance(it, index);
-    level->instances.erase(it);
 };
 
 void heD3LevelUpdate(HeD3Level* level, float const delta) {
@@ -242,27 +680,629 @@ void heD3LevelUpdate(HeD3Level* level, float const delta) {
             level->camera.position = hePhysicsActorSimpleGetEyePosition(level->physics.actor);
     }
         
-    // update all instances
-    for(auto& all : level->instances)
-        heD3InstanceUpdate(&all);
+    // sync the instances with their physics bodies. Reads the bodies, writes only the instance itself
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) level->instances.size(), 256, [level](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i)
+            heD3LevelUpdateInstance(level, i);
+    });
 
-    // update all particle sources
-    for(auto& all : level->particles)
-        heParticleSourceUpdate(&all, delta, level);
+    // rebuild the matrices one depth level at a time (in parallel per level), then move them in the tree
+    heD3LevelUpdateTransforms(level);
+    heD3LevelUpdateInstanceTree(level);
+
+    // update the particle sources and lights after the transforms, so that attached ones follow the current
+    // position of their parent
+    heD3LevelUpdateParticles(level, delta);
+    heD3LevelUpdateLights(level);
+    heD3LevelUpdateLightTree(level);
 };
 
 void heD3LevelDestroy(HeD3Level* level) {
     hePhysicsLevelDestroy(&level->physics);
+    heD3LevelClearStaticBatches(level);
 
     level->instances.clear();
+    level->instanceWorldMatrices.clear();
+    level->instanceNormalMatrices.clear();
+    level->instanceBoundsCenters.clear();
+    level->instanceBoundsExtents.clear();
+    level->instanceFlags.clear();
+    level->instanceSlots.clear();
+    level->freeInstanceSlot = UINT32_MAX;
+    heBvhClear(&level->instanceTree);
+    heBvhClear(&level->lightTree);
     level->lights.clear();
     level->particles.clear();
 };
 
-HeD3Instance* heD3LevelGetInstance(HeD3Level* level, uint16_t const index) {
-    auto begin = level->instances.begin();
-    std::advance(begin, index);
-    return &(*begin);
+void heD3LevelUpdateBounds(HeD3Level* level) {
+    heD3LevelUpdateTransforms(level);
+    heD3LevelUpdateInstanceTree(level);
+    heD3LevelUpdateLights(level);
+    heD3LevelUpdateLightTree(level);
+};
+
+void heD3LevelBuildTree(HeD3Level* level) {
+    std::vector<hm::vec3f> mins, maxs;
+    std::vector<uint32_t>  slots;
+    std::vector<int32_t>   leaves;
+    mins.reserve(level->instances.size());
+    maxs.reserve(level->instances.size());
+    slots.reserve(level->instances.size());
+
+    heD3LevelUpdateTransforms(level);
+    for(uint32_t i = 0; i < (uint32_t) level->instances.size(); ++i) {
+        HeD3Instance& all = level->instances[i];
+        all.bvhLeaf = -1;
+        if(level->instanceBoundsExtents[i].x < 0.f)
+            continue;
+
+        mins.emplace_back(level->instanceBoundsCenters[i] - level->instanceBoundsExtents[i]);
+        maxs.emplace_back(level->instanceBoundsCenters[i] + level->instanceBoundsExtents[i]);
+        slots.emplace_back(all.id.index);
+    }
+
+    leaves.resize(slots.size());
+    heBvhBuild(&level->instanceTree, mins.data(), maxs.data(), slots.data(), (uint32_t) slots.size(), leaves.data());
+    for(size_t i = 0; i < slots.size(); ++i)
+        heD3LevelGetInstanceFromSlot(level, slots[i])->bvhLeaf = leaves[i];
+};
+
+// removes the instance from the child list of its parent
+void heD3LevelUnlinkInstance(HeD3Level* level, HeD3Instance* instance) {
+    HeD3Instance* parent = heD3LevelGetInstanceById(level, instance->parent);
+    if(parent != nullptr) {
+        uint32_t* link = &parent->firstChild;
+        while(*link != instance->id.index)
+            link = &heD3LevelGetInstanceFromSlot(level, *link)->nextSibling;
+        *link = instance->nextSibling;
+    }
+
+    instance->parent      = HeD3InstanceId();
+    instance->nextSibling = UINT32_MAX;
+};
+
+b8 heD3LevelSetInstanceParent(HeD3Level* level, HeD3InstanceId const& id, HeD3InstanceId const& parentId) {
+    HeD3Instance* instance = heD3LevelGetInstanceById(level, id);
+    HeD3Instance* parent   = heD3LevelGetInstanceById(level, parentId);
+    if(instance == nullptr || (parent == nullptr && parentId.generation != 0))
+        return false;
+
+    for(HeD3Instance* ancestor = parent; ancestor != nullptr; ancestor = heD3LevelGetInstanceById(level, ancestor->parent)) {
+        if(ancestor == instance) {
+            HE_ERROR("Cannot attach an instance to itself or one of its children");
+            return false;
+        }
+    }
+
+    // attaching or detaching changes whether the instance, its old parent (losing its last child) or its new parent
+    // (getting its first child) count as static
+    HeD3Instance* oldParent = heD3LevelGetInstanceById(level, instance->parent);
+    b8 wasStatic[3] = { heD3InstanceIsStatic(instance), oldParent != nullptr && heD3InstanceIsStatic(oldParent),
+                        parent != nullptr && heD3InstanceIsStatic(parent) };
+    
+    heD3LevelUnlinkInstance(level, instance);
+    if(parent != nullptr) {
+        instance->parent      = parent->id;
+        instance->nextSibling = parent->firstChild;
+        parent->firstChild    = id.index;
+    }
+
+    if(wasStatic[0] != heD3InstanceIsStatic(instance) ||
+       (oldParent != nullptr && wasStatic[1] != heD3InstanceIsStatic(oldParent)) ||
+       (parent != nullptr && wasStatic[2] != heD3InstanceIsStatic(parent)))
+        level->staticRevision++;
+
+    // the depth of the whole subtree changes
+    std::vector<uint32_t> stack = { id.index };
+    while(!stack.empty()) {
+        HeD3Instance* current = heD3LevelGetInstanceFromSlot(level, stack.back());
+        stack.pop_back();
+        HeD3Instance* currentParent = heD3LevelGetInstanceById(level, current->parent);
+        current->depth = (currentParent != nullptr) ? currentParent->depth + 1 : 0;
+        for(uint32_t child = current->firstChild; child != UINT32_MAX; child = heD3LevelGetInstanceFromSlot(level, child)->nextSibling)
+            stack.emplace_back(child);
+    }
+
+    level->instanceFlags[heD3LevelGetInstanceIndex(level, instance)] |= HE_D3_INSTANCE_FLAG_DIRTY;
+    return true;
+};
+
+// rebuilds the matrices of the instances in [begin, end) of a single depth level
+void heD3LevelBuildMatrices(HeD3Level* level, uint32_t const* indices, uint32_t const begin, uint32_t const end) {
+    for(uint32_t i = begin; i < end; ++i) {
+        HeD3Instance const* parent = heD3LevelGetInstanceById(level, level->instances[indices[i]].parent);
+        heD3LevelBuildInstanceMatrices(level, indices[i], (parent != nullptr) ? &level->instanceWorldMatrices[heD3LevelGetInstanceIndex(level, parent)] : nullptr);
+    }
+};
+
+void heD3LevelUpdateTransforms(HeD3Level* level) {
+    std::vector<std::vector<uint32_t>>& depths = level->dirtyInstances;
+    for(auto& all : depths)
+        all.clear();
+
+    // collect the instances that changed themselves. Only the flags are read for the instances that did not change
+    for(uint32_t i = 0; i < (uint32_t) level->instances.size(); ++i) {
+        if(!(level->instanceFlags[i] & HE_D3_INSTANCE_FLAG_DIRTY))
+            continue;
+
+        // the batch still has the old transform baked into its vertices
+        HeD3Instance const* instance = &level->instances[i];
+        if(level->instanceFlags[i] & HE_D3_INSTANCE_FLAG_BATCHED)
+            heD3LevelSplitStaticBatch(level, instance);
+        
+        if(heD3InstanceIsStatic(instance))
+            level->staticRevision++;
+        
+        if(instance->depth >= depths.size())
+            depths.resize(instance->depth + 1);
+        depths[instance->depth].emplace_back(i);
+    }
+
+    // walk down the hierarchy one depth level at a time. All parents of a level are final before it is processed, so
+    // the instances of one level can be updated in any order (and in parallel)
+    for(size_t d = 0; d < depths.size(); ++d) {
+        // children inherit the change of their parent
+        for(size_t i = 0; i < depths[d].size(); ++i) {
+            uint32_t child = level->instances[depths[d][i]].firstChild;
+            while(child != UINT32_MAX) {
+                uint32_t denseIndex = level->instanceSlots[child].denseIndex;
+                HeD3Instance const* instance = &level->instances[denseIndex];
+                if(!(level->instanceFlags[denseIndex] & HE_D3_INSTANCE_FLAG_DIRTY)) {
+                    level->instanceFlags[denseIndex] |= HE_D3_INSTANCE_FLAG_DIRTY;
+                    if(d + 1 >= depths.size())
+                        depths.resize(d + 2);
+                    depths[d + 1].emplace_back(denseIndex);
+                }
+
+                child = instance->nextSibling;
+            }
+        }
+
+        uint32_t const* indices = depths[d].data();
+        heWorkerPoolRun(&heWorkerPool, (uint32_t) depths[d].size(), 1024, [level, indices](uint32_t begin, uint32_t end) {
+            heD3LevelBuildMatrices(level, indices, begin, end);
+        });
+    }
+
+};
+
+HeD3Instance* heD3LevelRaycastInstance(HeD3Level* level, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, float* distance) {
+    // the tree stores fattened boxes, so test the actual bounds of the hit instances again
+    hm::vec3f const inverse(1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+    uint32_t slot = heBvhRaycast(&level->instanceTree, origin, direction, maxDistance, [&](uint32_t const slot) {
+        uint32_t index = level->instanceSlots[slot].denseIndex;
+        hm::vec3f const& center = level->instanceBoundsCenters[index];
+        hm::vec3f const& extent = level->instanceBoundsExtents[index];
+        float tmin = 0.f, tmax = maxDistance;
+        for(uint8_t j = 0; j < 3; ++j) {
+            float t0 = (center[j] - extent[j] - origin[j]) * inverse[j];
+            float t1 = (center[j] + extent[j] - origin[j]) * inverse[j];
+            tmin = std::max(tmin, std::min(t0, t1));
+            tmax = std::min(tmax, std::max(t0, t1));
+        }
+
+        return (tmin <= tmax) ? tmin : -1.f;
+    }, distance);
+
+    return (slot != UINT32_MAX) ? heD3LevelGetInstanceFromSlot(level, slot) : nullptr;
+};
+
+uint32_t heD3LevelCullInstances(HeD3Level* level, HeD3Frustum const* frustum) {
+    level->visibleInstances.clear();
+    level->visibleBatches.clear();
+    level->visibleParticles.clear();
+    heD3LevelUpdateBounds(level);
+
+    // broadcast every plane (and the absolute normal) into registers once
+    __m128 const zero     = _mm_setzero_ps();
+    __m128 const signMask = _mm_set1_ps(-0.f);
+    __m128 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+    for(uint8_t i = 0; i < 6; ++i) {
+        px[i] = _mm_set1_ps(frustum->planes[i].x);
+        py[i] = _mm_set1_ps(frustum->planes[i].y);
+        pz[i] = _mm_set1_ps(frustum->planes[i].z);
+        pw[i] = _mm_set1_ps(frustum->planes[i].w);
+        ax[i] = _mm_andnot_ps(signMask, px[i]);
+        ay[i] = _mm_andnot_ps(signMask, py[i]);
+        az[i] = _mm_andnot_ps(signMask, pz[i]);
+    }
+
+    uint32_t const count = (uint32_t) level->instances.size();
+    hm::vec3f const* centers = level->instanceBoundsCenters.data();
+    hm::vec3f const* extents = level->instanceBoundsExtents.data();
+    uint8_t const* flags     = level->instanceFlags.data();
+    uint32_t batched = 0;
+    uint32_t i = 0;
+    for(; i + 4 <= count; i += 4) {
+        hm::vec3f const* c = &centers[i];
+        hm::vec3f const* e = &extents[i];
+        __m128 cx = _mm_setr_ps(c[0].x, c[1].x, c[2].x, c[3].x);
+        __m128 cy = _mm_setr_ps(c[0].y, c[1].y, c[2].y, c[3].y);
+        __m128 cz = _mm_setr_ps(c[0].z, c[1].z, c[2].z, c[3].z);
+        __m128 ex = _mm_setr_ps(e[0].x, e[1].x, e[2].x, e[3].x);
+        __m128 ey = _mm_setr_ps(e[0].y, e[1].y, e[2].y, e[3].y);
+        __m128 ez = _mm_setr_ps(e[0].z, e[1].z, e[2].z, e[3].z);
+
+        // a box is outside if it is completely behind any plane
+        __m128 outside = zero;
+        for(uint8_t p = 0; p < 6; ++p) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, px[p]), _mm_mul_ps(cy, py[p])), _mm_add_ps(_mm_mul_ps(cz, pz[p]), pw[p]));
+            __m128 radius   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ax[p]), _mm_mul_ps(ey, ay[p])), _mm_mul_ps(ez, az[p]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        // boxes without bounds are always visible
+        int32_t visible = (~_mm_movemask_ps(outside) | _mm_movemask_ps(_mm_cmplt_ps(ex, zero))) & 0xf;
+        for(uint32_t j = 0; j < 4; ++j) {
+            b8 isBatched = (flags[i + j] & HE_D3_INSTANCE_FLAG_BATCHED) != 0;
+            batched += isBatched;
+            if((visible & (1 << j)) && !isBatched && level->instances[i + j].mesh != nullptr)
+                level->visibleInstances.emplace_back(i + j);
+        }
+    }
+
+    for(; i < count; ++i) {
+        b8 isBatched = (flags[i] & HE_D3_INSTANCE_FLAG_BATCHED) != 0;
+        batched += isBatched;
+        if(!isBatched && level->instances[i].mesh != nullptr && heD3FrustumContainsBox(frustum, centers[i], extents[i]))
+            level->visibleInstances.emplace_back(i);
+    }
+
+    // batches are few compared to the instances, so just test them one by one
+    for(uint32_t j = 0; j < (uint32_t) level->staticBatches.size(); ++j) {
+        HeD3StaticBatch const* batch = &level->staticBatches[j];
+        if(batch->instanceCount > 0 && heD3FrustumContainsBox(frustum, batch->boundsCenter, batch->boundsExtent))
+            level->visibleBatches.emplace_back(j);
+    }
+
+    for(auto& all : level->particles)
+        if(heD3FrustumContainsBox(frustum, all.boundsCenter, all.boundsExtent))
+            level->visibleParticles.emplace_back(&all);
+
+    // batched instances are not culled on their own
+    return count - batched - (uint32_t) level->visibleInstances.size();
+};
+
+// returns the positions of the mesh (or of its first lod with few enough triangles) that are drawn when the mesh is
+// used as an occluder, or nullptr if the mesh is too detailed. The positions are read back from the gpu once and
+// then cached in the level
+std::vector<hm::vec3f> const* heD3LevelGetOccluderMesh(HeD3Level* level, HeVao const* mesh) {
+    auto it = level->occluderMeshes.find(mesh);
+    if(it != level->occluderMeshes.end())
+        return it->second.empty() ? nullptr : &it->second;
+
+    std::vector<hm::vec3f>* vertices = &level->occluderMeshes[mesh];
+    HeVao const* vao = mesh;
+    for(size_t i = 0; vao != nullptr && vao->verticesCount > OCCLUSION_MAX_TRIANGLES * 3; ++i)
+        vao = (i < mesh->lods.size()) ? mesh->lods[i].vao : nullptr;
+
+    if(vao == nullptr || vao->vbos.empty() || vao->vbos[0].dimensions != 3)
+        return nullptr;
+
+    std::vector<float> data;
+    heVboGetData(&vao->vbos[0], &data);
+    vertices->reserve(data.size() / 3);
+    for(size_t i = 0; i + 2 < data.size(); i += 3)
+        vertices->emplace_back(data[i], data[i + 1], data[i + 2]);
+    return vertices->empty() ? nullptr : vertices;
+};
+
+uint32_t heD3LevelCullOccluded(HeD3Level* level) {
+    HeOcclusionBuffer* buffer = &level->occlusion;
+    if(buffer->width == 0)
+        heOcclusionBufferCreate(buffer, OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    heOcclusionBufferClear(buffer, level->camera.projectionMatrix * level->camera.viewMatrix);
+
+    // pick the occluders: marked instances first, then the meshes that cover most of the screen. index is the
+    // position in visibleInstances, or in visibleBatches for batches
+    struct Candidate {
+        float    size;
+        uint32_t index;
+        b8       batch;
+    };
+
+    float projectionScale = level->camera.projectionMatrix[1][1];
+    std::vector<Candidate> candidates;
+    for(uint32_t i = 0; i < (uint32_t) level->visibleInstances.size(); ++i) {
+        uint32_t index = level->visibleInstances[i];
+        if(level->instanceBoundsExtents[index].x < 0.f)
+            continue;
+
+        float size = (level->instanceFlags[index] & HE_D3_INSTANCE_FLAG_OCCLUDER) ? FLT_MAX :
+            heD3GetScreenSize(level->instanceBoundsCenters[index], level->instanceBoundsExtents[index], level->camera.position, projectionScale);
+        if(size >= OCCLUSION_MIN_SCREEN_SIZE)
+            candidates.emplace_back(Candidate{ size, i, false });
+    }
+
+    for(uint32_t i = 0; i < (uint32_t) level->visibleBatches.size(); ++i) {
+        HeD3StaticBatch const* batch = &level->staticBatches[level->visibleBatches[i]];
+        float size = heD3GetScreenSize(batch->boundsCenter, batch->boundsExtent, level->camera.position, projectionScale);
+        if(size >= OCCLUSION_MIN_SCREEN_SIZE)
+            candidates.emplace_back(Candidate{ size, i, true });
+    }
+
+    size_t occluderCount = std::min(candidates.size(), (size_t) OCCLUSION_MAX_OCCLUDERS);
+    std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end(), [](Candidate const& a, Candidate const& b) {
+        return a.size > b.size;
+    });
+
+    // occluders are always visible (testing them against themselves could hide them because of precision issues)
+    std::vector<uint8_t> visibleInstances(level->visibleInstances.size(), 0);
+    std::vector<uint8_t> visibleBatches(level->visibleBatches.size(), 0);
+    for(size_t i = 0; i < occluderCount; ++i) {
+        Candidate const& candidate = candidates[i];
+        if(candidate.batch) {
+            std::vector<hm::vec3f> const* vertices = heD3LevelGetOccluderMesh(level, &level->staticBatches[level->visibleBatches[candidate.index]].vao);
+            if(vertices != nullptr) {
+                heOcclusionBufferAddOccluder(buffer, vertices, hm::mat4f(1.f));
+                visibleBatches[candidate.index] = true;
+            }
+        } else {
+            uint32_t index = level->visibleInstances[candidate.index];
+            std::vector<hm::vec3f> const* vertices = heD3LevelGetOccluderMesh(level, level->instances[index].mesh);
+            if(vertices != nullptr) {
+                heOcclusionBufferAddOccluder(buffer, vertices, level->instanceWorldMatrices[index]);
+                visibleInstances[candidate.index] = true;
+            }
+        }
+    }
+
+    heOcclusionBufferRender(buffer);
+
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) level->visibleInstances.size(), 256, [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i) {
+            hm::vec3f const& center = level->instanceBoundsCenters[level->visibleInstances[i]];
+            hm::vec3f const& extent = level->instanceBoundsExtents[level->visibleInstances[i]];
+            if(!visibleInstances[i])
+                visibleInstances[i] = extent.x < 0.f || heOcclusionBufferTestBox(buffer, center, extent);
+        }
+    });
+
+    for(uint32_t i = 0; i < (uint32_t) level->visibleBatches.size(); ++i) {
+        HeD3StaticBatch const* batch = &level->staticBatches[level->visibleBatches[i]];
+        if(!visibleBatches[i])
+            visibleBatches[i] = heOcclusionBufferTestBox(buffer, batch->boundsCenter, batch->boundsExtent);
+    }
+
+    // remove the hidden instances and batches, keeping the order
+    uint32_t culled = 0;
+    uint32_t kept   = 0;
+    for(uint32_t i = 0; i < (uint32_t) level->visibleInstances.size(); ++i) {
+        if(visibleInstances[i])
+            level->visibleInstances[kept++] = level->visibleInstances[i];
+    }
+
+    culled += (uint32_t) level->visibleInstances.size() - kept;
+    level->visibleInstances.resize(kept);
+
+    kept = 0;
+    for(uint32_t i = 0; i < (uint32_t) level->visibleBatches.size(); ++i) {
+        if(visibleBatches[i])
+            level->visibleBatches[kept++] = level->visibleBatches[i];
+    }
+
+    level->visibleBatches.resize(kept);
+    return culled;
+};
+
+// returns true if the shadow of given box can reach the inside of the camera frustum. The shadow of a box that is
+// outside of a plane moves further out if the light is behind that box (as seen from the plane), so the box can be
+// culled. Directional lights are infinitely far away in the opposite of direction
+b8 heD3ShadowReachesFrustum(HeD3Frustum const* frustum, HeD3LightSource const* light, hm::vec3f const& direction, hm::vec3f const& center, hm::vec3f const& extent) {
+    for(uint8_t i = 0; i < 6; ++i) {
+        hm::vec4f const& p = frustum->planes[i];
+        float distance = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float radius   = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+        if(distance + radius >= 0.f)
+            continue;
+
+        if(light->type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL) {
+            if(p.x * direction.x + p.y * direction.y + p.z * direction.z <= 0.f)
+                return false;
+        } else if(distance + radius < p.x * light->vector.x + p.y * light->vector.y + p.z * light->vector.z + p.w)
+            return false;
+    }
+
+    return true;
+};
+
+// returns true if given box is inside the volume lit by a point or spot light with given range
+b8 heD3LightVolumeContainsBox(HeD3LightSource const* light, float const range, hm::vec3f const& center, hm::vec3f const& extent) {
+    // distance from the light to the closest point of the box
+    hm::vec3f offset = center - light->vector;
+    hm::vec3f outside(std::max(std::abs(offset.x) - extent.x, 0.f), std::max(std::abs(offset.y) - extent.y, 0.f), std::max(std::abs(offset.z) - extent.z, 0.f));
+    if(hm::length2(outside) > range * range)
+        return false;
+
+    if(light->type != HE_LIGHT_SOURCE_TYPE_SPOT)
+        return true;
+
+    // test the bounding sphere of the box against the cone of the outer circle
+    float radius  = hm::length(extent);
+    hm::vec3f axis(light->data[0], light->data[1], light->data[2]);
+    float along   = hm::dot(offset, axis);
+    float across  = std::sqrt(std::max(hm::length2(offset) - along * along, 0.f));
+    float cosine  = light->data[4];
+    float sine    = std::sqrt(std::max(1.f - cosine * cosine, 0.f));
+    return along >= -radius && cosine * across - along * sine <= radius;
+};
+
+uint32_t heD3LevelCullShadowCasters(HeD3Level* level, HeD3LightSource* light) {
+    HeD3ShadowMap* shadowMap = &light->shadows;
+    shadowMap->casters.clear();
+    shadowMap->casterBatches.clear();
+
+    HeD3Frustum lightVolume;
+    hm::vec3f direction;
+    float range = -1.f;
+    if(light->type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL) {
+        heD3FrustumUpdatePlanes(&lightVolume, shadowMap->projectionMatrix * shadowMap->viewMatrix);
+        direction = hm::normalize(light->vector);
+    } else
+        range = heD3LightSourceGetRange(light);
+
+    auto isCaster = [&](hm::vec3f const& center, hm::vec3f const& extent) -> b8 {
+        if(extent.x < 0.f)
+            return true;
+
+        if(light->type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL) {
+            if(!heD3FrustumContainsBox(&lightVolume, center, extent))
+                return false;
+        } else if(range >= 0.f && !heD3LightVolumeContainsBox(light, range, center, extent))
+            return false;
+
+        return heD3ShadowReachesFrustum(&level->camera.frustum, light, direction, center, extent);
+    };
+
+    for(uint32_t i = 0; i < (uint32_t) level->instances.size(); ++i) {
+        if(!(level->instanceFlags[i] & HE_D3_INSTANCE_FLAG_BATCHED) && level->instances[i].mesh != nullptr &&
+           isCaster(level->instanceBoundsCenters[i], level->instanceBoundsExtents[i]))
+            shadowMap->casters.emplace_back(i);
+    }
+
+    for(uint32_t i = 0; i < (uint32_t) level->staticBatches.size(); ++i) {
+        HeD3StaticBatch const* batch = &level->staticBatches[i];
+        if(batch->instanceCount > 0 && isCaster(batch->boundsCenter, batch->boundsExtent))
+            shadowMap->casterBatches.emplace_back(i);
+    }
+
+    return (uint32_t) (shadowMap->casters.size() + shadowMap->casterBatches.size());
+};
+
+void heD3LevelSelectLods(HeD3Level* level) {
+    float projectionScale = level->camera.projectionMatrix[1][1];
+    for(uint32_t index : level->visibleInstances) {
+        HeD3Instance* instance = &level->instances[index];
+        if(!instance->mesh->lods.empty() && level->instanceBoundsExtents[index].x >= 0.f)
+            heD3InstanceSelectLod(instance, level->instanceBoundsCenters[index], level->instanceBoundsExtents[index], level->camera.position, projectionScale);
+    }
+};
+
+// the upper 16 bits of the view distance of given world space point. Positive floats compare the same as their bits,
+// so this keeps the order of the distances (with less precision further away)
+static inline uint64_t heD3RenderQueueDepth(hm::mat4f const& view, hm::vec3f const& position) {
+    float distance = -(view[0][2] * position.x + view[1][2] * position.y + view[2][2] * position.z + view[3][2]);
+    distance = std::max(distance, 0.f);
+    uint32_t bits;
+    memcpy(&bits, &distance, sizeof(float));
+    return bits >> 16;
+};
+
+// builds the sort key of a single draw, see HeD3RenderQueue
+static inline uint64_t heD3RenderQueueKey(HeMaterial const* material, HeVao const* mesh, uint64_t const depth) {
+    uint64_t shader   = material->shader->programId & 0x3ff;
+    uint64_t hashed   = ((uint64_t) (uintptr_t) material * 0x9e3779b97f4a7c15ull) >> 48;
+    uint64_t vao      = mesh->vaoId & 0xffff;
+    if(!material->transparent)
+        return (shader << 52) | (hashed << 36) | (vao << 20) | (depth << 4);
+    else
+        return (1ull << 62) | ((0xffff - depth) << 46) | (shader << 36) | (hashed << 20) | (vao << 4);
+};
+
+// least significant digit radix sort over the bytes of the keys. Bytes that are the same in all keys (i.e. unused
+// bits or a single shader) are skipped
+static void heD3RenderQueueSort(HeD3RenderQueue* queue) {
+    size_t const count = queue->items.size();
+    if(count < 2)
+        return;
+
+    uint32_t histograms[8][256] = {};
+    for(HeD3RenderItem const& all : queue->items)
+        for(uint32_t i = 0; i < 8; ++i)
+            histograms[i][(all.key >> (i * 8)) & 0xff]++;
+
+    queue->scratch.resize(count);
+    HeD3RenderItem* source = queue->items.data();
+    HeD3RenderItem* target = queue->scratch.data();
+    for(uint32_t i = 0; i < 8; ++i) {
+        uint32_t* histogram = histograms[i];
+        if(histogram[(source[0].key >> (i * 8)) & 0xff] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for(uint32_t j = 0; j < 256; ++j) {
+            uint32_t c = histogram[j];
+            histogram[j] = offset;
+            offset += c;
+        }
+
+        for(size_t j = 0; j < count; ++j)
+            target[histogram[(source[j].key >> (i * 8)) & 0xff]++] = source[j];
+
+        std::swap(source, target);
+    }
+
+    if(source != queue->items.data())
+        queue->items.swap(queue->scratch);
+};
+
+void heD3LevelBuildRenderQueue(HeD3Level* level) {
+    HeD3RenderQueue* queue = &level->renderQueue;
+    hm::mat4f const& view  = level->camera.viewMatrix;
+    queue->items.clear();
+    queue->items.reserve(level->visibleInstances.size() + level->visibleBatches.size());
+
+    for(uint32_t index : level->visibleInstances) {
+        HeD3Instance const* instance = &level->instances[index];
+        if(instance->material == nullptr)
+            continue;
+
+        // instances without bounds are sorted by their origin
+        hm::mat4f const& worldMatrix = level->instanceWorldMatrices[index];
+        hm::vec3f position = (level->instanceBoundsExtents[index].x >= 0.f) ? level->instanceBoundsCenters[index] : hm::vec3f(worldMatrix[3][0], worldMatrix[3][1], worldMatrix[3][2]);
+        uint64_t depth     = heD3RenderQueueDepth(view, position);
+        queue->items.emplace_back(HeD3RenderItem{ heD3RenderQueueKey(instance->material, heD3InstanceGetMesh(instance), depth), index, false });
+    }
+
+    for(uint32_t index : level->visibleBatches) {
+        HeD3StaticBatch const* batch = &level->staticBatches[index];
+        uint64_t depth = heD3RenderQueueDepth(view, batch->boundsCenter);
+        queue->items.emplace_back(HeD3RenderItem{ heD3RenderQueueKey(batch->material, &batch->vao, depth), index, true });
+    }
+
+    heD3RenderQueueSort(queue);
+
+    queue->opaqueCount = 0;
+    while(queue->opaqueCount < queue->items.size() && (queue->items[queue->opaqueCount].key >> 62) == 0)
+        queue->opaqueCount++;
+};
+
+void heD3LevelClearStaticBatches(HeD3Level* level) {
+    for(auto& all : level->staticBatches) {
+        level->occluderMeshes.erase(&all.vao);
+        heVaoDestroy(&all.vao);
+    }
+
+    for(auto& all : level->instanceFlags)
+        all &= ~HE_D3_INSTANCE_FLAG_BATCHED;
+
+    level->staticBatches.clear();
+    level->visibleBatches.clear();
+    level->staticRevision++;
+};
+
+HeD3Instance* heD3LevelGetInstance(HeD3Level* level, uint32_t const index) {
+    return &level->instances[index];
+};
+
+uint32_t heD3LevelGetInstanceIndex(HeD3Level const* level, HeD3Instance const* instance) {
+    return (uint32_t) (instance - level->instances.data());
+};
+
+HeD3Instance* heD3LevelGetInstanceFromSlot(HeD3Level* level, uint32_t const slot) {
+    return &level->instances[level->instanceSlots[slot].denseIndex];
+};
+
+HeD3Instance* heD3LevelGetInstanceById(HeD3Level* level, HeD3InstanceId const& id) {
+    if(id.index >= level->instanceSlots.size())
+        return nullptr;
+
+    HeD3InstanceSlot const& slot = level->instanceSlots[id.index];
+    if(slot.generation != id.generation)
+        return nullptr;
+
+    return &level->instances[slot.denseIndex];
 };
 
 HeD3LightSource* heD3LevelGetLightSource(HeD3Level* level, uint16_t const index) {
@@ -272,6 +1312,212 @@ HeD3LightSource* heD3LevelGetLightSource(HeD3Level* level, uint16_t const index)
 };
 
 
+// -- light clusters
+
+// returns the z slice that a view space depth falls into, clamped to the grid
+uint32_t heD3LightClustersGetSlice(HeD3LightClusters const* clusters, float const depth) {
+    float slice = std::log(std::max(depth, clusters->nearPlane)) * clusters->depthScale - clusters->depthBias;
+    return std::min((uint32_t) std::max(slice, 0.f), clusters->sizeZ - 1);
+};
+
+// returns the view space depth at which given slice starts
+float heD3LightClustersGetSliceDepth(HeD3LightClusters const* clusters, uint32_t const slice) {
+    return clusters->nearPlane * std::pow(clusters->farPlane / clusters->nearPlane, slice / (float) clusters->sizeZ);
+};
+
+// returns the tile that a normalized device coordinate falls into, clamped to the grid
+uint32_t heD3LightClustersGetTile(float const ndc, uint32_t const size) {
+    float tile = std::floor((ndc * 0.5f + 0.5f) * size);
+    return (uint32_t) std::min(std::max(tile, 0.f), (float) (size - 1));
+};
+
+// bins the lights into the slices [firstSlice, lastSlice). The cluster offsets written into clusterData are relative
+// to the indices of their slice, so that all slices can be binned independently
+void heD3LightClustersBinSlices(HeD3LightClusters* clusters, uint32_t const firstSlice, uint32_t const lastSlice) {
+    uint32_t const tiles   = clusters->sizeX * clusters->sizeY;
+    uint32_t const globals = (uint32_t) clusters->globalLights.size();
+
+    for(uint32_t z = firstSlice; z < lastSlice; ++z) {
+        std::vector<uint32_t>& pairs   = clusters->slicePairs[z];
+        std::vector<uint32_t>& indices = clusters->sliceIndices[z];
+        uint32_t* data  = &clusters->clusterData[z * tiles * 2];
+        float sliceNear = heD3LightClustersGetSliceDepth(clusters, z);
+        float sliceFar  = heD3LightClustersGetSliceDepth(clusters, z + 1);
+        pairs.clear();
+
+        // collect (tile, light) pairs
+        for(HeD3ClusterLight const& light : clusters->lights) {
+            if(z < light.minSlice || z > light.maxSlice)
+                continue;
+
+            // the screen rect of the sphere inside the depth range of this slice. x / depth is monotonic in the
+            // depth, so the extremes are at the ends of the range
+            float depth = -light.center.z;
+            float nearDepth = std::max(sliceNear, depth - light.radius);
+            float farDepth  = std::min(sliceFar,  depth + light.radius);
+            float x0 = light.center.x - light.radius, x1 = light.center.x + light.radius;
+            float y0 = light.center.y - light.radius, y1 = light.center.y + light.radius;
+            float minX = std::min(x0 / nearDepth, x0 / farDepth) * clusters->projectionX;
+            float maxX = std::max(x1 / nearDepth, x1 / farDepth) * clusters->projectionX;
+            float minY = std::min(y0 / nearDepth, y0 / farDepth) * clusters->projectionY;
+            float maxY = std::max(y1 / nearDepth, y1 / farDepth) * clusters->projectionY;
+            if(maxX < -1.f || minX > 1.f || maxY < -1.f || minY > 1.f)
+                continue;
+
+            uint32_t tx0 = heD3LightClustersGetTile(minX, clusters->sizeX), tx1 = heD3LightClustersGetTile(maxX, clusters->sizeX);
+            uint32_t ty0 = heD3LightClustersGetTile(minY, clusters->sizeY), ty1 = heD3LightClustersGetTile(maxY, clusters->sizeY);
+            float radius2 = light.radius * light.radius;
+            for(uint32_t y = ty0; y <= ty1; ++y) {
+                for(uint32_t x = tx0; x <= tx1; ++x) {
+                    uint32_t tile = y * clusters->sizeX + x;
+                    hm::vec3f const& min = clusters->clusterMin[z * tiles + tile];
+                    hm::vec3f const& max = clusters->clusterMax[z * tiles + tile];
+
+                    // distance from the sphere center to the closest point of the box
+                    float dx = light.center.x - std::min(std::max(light.center.x, min.x), max.x);
+                    float dy = light.center.y - std::min(std::max(light.center.y, min.y), max.y);
+                    float dz = light.center.z - std::min(std::max(light.center.z, min.z), max.z);
+                    if(dx * dx + dy * dy + dz * dz <= radius2) {
+                        pairs.emplace_back(tile);
+                        pairs.emplace_back(light.index);
+                    }
+                }
+            }
+        }
+
+        // sort the pairs by tile, keeping the order of the lights. The global lights come first in every cluster
+        for(uint32_t i = 0; i < tiles; ++i)
+            data[i * 2 + 1] = globals;
+        for(size_t i = 0; i < pairs.size(); i += 2)
+            data[pairs[i] * 2 + 1]++;
+
+        uint32_t offset = 0;
+        for(uint32_t i = 0; i < tiles; ++i) {
+            data[i * 2] = offset;
+            offset += data[i * 2 + 1];
+            data[i * 2 + 1] = globals;
+        }
+
+        indices.resize(offset);
+        for(uint32_t i = 0; i < tiles; ++i)
+            std::copy(clusters->globalLights.begin(), clusters->globalLights.end(), indices.begin() + data[i * 2]);
+
+        for(size_t i = 0; i < pairs.size(); i += 2) {
+            uint32_t* cluster = &data[pairs[i] * 2];
+            indices[cluster[0] + cluster[1]++] = pairs[i + 1];
+        }
+    }
+};
+
+void heD3LightClustersUpdateGrid(HeD3LightClusters* clusters, hm::mat4f const& projectionMatrix, float const nearPlane, float const farPlane) {
+    uint32_t const tiles = clusters->sizeX * clusters->sizeY;
+    uint32_t const count = tiles * clusters->sizeZ;
+    if(clusters->clusterMin.size() == count && clusters->projectionX == projectionMatrix[0][0] &&
+       clusters->projectionY == projectionMatrix[1][1] && clusters->nearPlane == nearPlane && clusters->farPlane == farPlane)
+        return;
+
+    clusters->projectionX = projectionMatrix[0][0];
+    clusters->projectionY = projectionMatrix[1][1];
+    clusters->nearPlane   = nearPlane;
+    clusters->farPlane    = farPlane;
+    clusters->depthScale  = clusters->sizeZ / std::log(farPlane / nearPlane);
+    clusters->depthBias   = std::log(nearPlane) * clusters->depthScale;
+    clusters->clusterMin.resize(count);
+    clusters->clusterMax.resize(count);
+
+    for(uint32_t z = 0; z < clusters->sizeZ; ++z) {
+        float nearDepth = heD3LightClustersGetSliceDepth(clusters, z);
+        float farDepth  = heD3LightClustersGetSliceDepth(clusters, z + 1);
+        for(uint32_t y = 0; y < clusters->sizeY; ++y) {
+            float y0 = -1.f + 2.f * y / clusters->sizeY, y1 = -1.f + 2.f * (y + 1) / clusters->sizeY;
+            for(uint32_t x = 0; x < clusters->sizeX; ++x) {
+                float x0 = -1.f + 2.f * x / clusters->sizeX, x1 = -1.f + 2.f * (x + 1) / clusters->sizeX;
+                // the tile is a pyramid from the camera, so its box in view space spans the corners at both depths
+                uint32_t index = z * tiles + y * clusters->sizeX + x;
+                clusters->clusterMin[index] = hm::vec3f(std::min(x0 * nearDepth, x0 * farDepth) / clusters->projectionX,
+                                                        std::min(y0 * nearDepth, y0 * farDepth) / clusters->projectionY, -farDepth);
+                clusters->clusterMax[index] = hm::vec3f(std::max(x1 * nearDepth, x1 * farDepth) / clusters->projectionX,
+                                                        std::max(y1 * nearDepth, y1 * farDepth) / clusters->projectionY, -nearDepth);
+            }
+        }
+    }
+};
+
+uint32_t heD3LightClustersBuild(HeD3LightClusters* clusters, HeD3Level const* level, hm::mat4f const& viewMatrix) {
+    uint32_t const tiles = clusters->sizeX * clusters->sizeY;
+    clusters->clusterData.resize(tiles * clusters->sizeZ * 2);
+    clusters->slicePairs.resize(clusters->sizeZ);
+    clusters->sliceIndices.resize(clusters->sizeZ);
+    clusters->lights.clear();
+    clusters->globalLights.clear();
+
+    // transform all lights into view space and drop the ones outside of the depth range
+    uint32_t index = 0;
+    for(auto const& all : level->lights) {
+        if(index >= HeD3LightClusters::MAX_LIGHTS)
+            break;
+
+        float range = all.active ? heD3LightSourceGetRange(&all) : 0.f;
+        if(range < 0.f)
+            clusters->globalLights.emplace_back(index);
+        else if(range > 0.f) {
+            HeD3ClusterLight light;
+            light.center = hm::vec3f(viewMatrix * hm::vec4f(all.vector, 1.f));
+            light.radius = range;
+            light.index  = index;
+            float depth  = -light.center.z;
+            if(depth + range > clusters->nearPlane && depth - range < clusters->farPlane) {
+                light.minSlice = heD3LightClustersGetSlice(clusters, depth - range);
+                light.maxSlice = heD3LightClustersGetSlice(clusters, depth + range);
+                clusters->lights.emplace_back(light);
+            }
+        }
+
+        index++;
+    }
+
+    // bin the slices one at a time, the lights usually pile up in the near slices so bigger batches would be
+    // uneven. Few lights are not worth waking the workers
+    uint32_t batch = (clusters->lights.size() < 16) ? clusters->sizeZ : 1;
+    heWorkerPoolRun(&heWorkerPool, clusters->sizeZ, batch, [clusters](uint32_t begin, uint32_t end) {
+        heD3LightClustersBinSlices(clusters, begin, end);
+    });
+
+    // concatenate the slices
+    uint32_t total = 0;
+    for(auto const& all : clusters->sliceIndices)
+        total += (uint32_t) all.size();
+    clusters->lightIndices.resize(total);
+
+    uint32_t offset = 0;
+    for(uint32_t z = 0; z < clusters->sizeZ; ++z) {
+        std::vector<uint32_t> const& indices = clusters->sliceIndices[z];
+        uint32_t* data = &clusters->clusterData[z * tiles * 2];
+        for(uint32_t i = 0; i < tiles; ++i)
+            data[i * 2] += offset;
+        std::copy(indices.begin(), indices.end(), clusters->lightIndices.begin() + offset);
+        offset += (uint32_t) indices.size();
+    }
+
+    return total;
+};
+
+uint32_t heD3LightClustersGetIndex(HeD3LightClusters const* clusters, hm::vec3f const& viewPosition) {
+    // like the slice, positions in front of the near plane (or behind the camera) are clamped to it
+    float depth = std::max(-viewPosition.z, clusters->nearPlane);
+    uint32_t z  = heD3LightClustersGetSlice(clusters, depth);
+    uint32_t x  = heD3LightClustersGetTile(viewPosition.x * clusters->projectionX / depth, clusters->sizeX);
+    uint32_t y  = heD3LightClustersGetTile(viewPosition.y * clusters->projectionY / depth, clusters->sizeY);
+    return (z * clusters->sizeY + y) * clusters->sizeX + x;
+};
+
+void heD3LevelUpdateLightClusters(HeD3Level* level) {
+    HeD3Camera const* camera = &level->camera;
+    heD3LightClustersUpdateGrid(&level->lightClusters, camera->projectionMatrix, camera->frustum.viewInfo.nearPlane, camera->frustum.viewInfo.farPlane);
+    heD3LightClustersBuild(&level->lightClusters, level, camera->viewMatrix);
+};
+
+
 // -- skybox
 
 void heD3SkyboxCreate(HeD3Skybox* skybox, std::string const& hdrFile) {
@@ -346,89 +1592,512 @@ void heD3SkyboxLoad(HeD3Skybox* skybox, std::string const& fileName) {
 
 // -- particles
 
+// returns the number of chunks that count particles are split into
+uint32_t heParticleSourceGetChunkCount(uint32_t const count) {
+    return (count + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+};
+
 void heParticleSourceCreate(HeParticleSource* source, HeD3Transformation const& transformation, HeSpriteAtlas* atlas, uint32_t const atlasIndex, uint32_t const particleCount) {
     source->atlas         = atlas;
     source->particleCount = particleCount;
     source->atlasIndex    = atlasIndex;
-    source->particles     = (HeParticle*) malloc(particleCount * sizeof(HeParticle));
-    source->dataBuffer    = (float*) malloc((size_t) particleCount * source->FLOATS_PER_PARTICLE * sizeof(float));
+    source->dataBuffer    = (HeParticleInstance*) malloc((size_t) particleCount * sizeof(HeParticleInstance));
     source->emitter.transformation = transformation;
+    source->emitter.origin         = transformation.position;
     heRandomCreate(&source->emitter.random, 0);
-    memset(source->particles,  0, sizeof(source->particles));
-    memset(source->dataBuffer, 0, sizeof(source->dataBuffer));
+    std::fill_n(source->dataBuffer, particleCount, HeParticleInstance{});
+
+    HeParticleData* data = &source->particles;
+    for(std::vector<float>* all : { &data->positionX, &data->positionY, &data->positionZ, &data->velocityX, &data->velocityY, &data->velocityZ, &data->remaining, &data->scale })
+        all->assign(particleCount, 0.f);
+    data->colour.assign(particleCount, 0);
+    data->intensity.assign(particleCount, 0);
+    data->drawIndex.assign(particleCount, UINT32_MAX);
+    source->chunks.assign(heParticleSourceGetChunkCount(particleCount), HeParticleChunk());
+    source->drawOrder.reserve(particleCount);
+    source->sortDepths.assign(particleCount, 0.f);
+    source->sortKeys.assign(particleCount, 0);
+    source->sortPairs.reserve(particleCount);
+    source->sortScratch.reserve(particleCount);
 };
 
 void heParticleSourceDestroy(HeParticleSource* source) {
     heTextureDestroy(source->atlas->texture);
-    free(source->particles);
     free(source->dataBuffer);
+    source->particles = HeParticleData();
+    source->chunks.clear();
+    source->drawOrder.clear();
+    source->sortDepths.clear();
+    source->sortKeys.clear();
+    source->sortPairs.clear();
+    source->sortScratch.clear();
 };
 
-void heParticleSourceSpawnParticle(HeParticleEmitter* source, HeParticle* particle) {
-    particle->transformation.scale    = hm::vec3f(heRandomFloat(&source->random, source->minSize, source->maxSize));
+void heParticleSourceSpawnParticle(HeParticleSource* source, uint32_t const index) {
+    HeParticleEmitter* emitter = &source->emitter;
+    HeParticleData* data       = &source->particles;
+    data->scale[index] = heRandomFloat(&emitter->random, emitter->minSize, emitter->maxSize);
 
-    hm::vec3f position = source->transformation.position; // point emitter
+    hm::vec3f position = emitter->origin; // point emitter
     // find random position in the emitter
-    if(source->type == HE_PARTICLE_EMITTER_TYPE_BOX) {
-        position.x += heRandomFloat(&source->random, -source->box.x, source->box.x);
-        position.y += heRandomFloat(&source->random, -source->box.y, source->box.y);
-        position.z += heRandomFloat(&source->random, -source->box.z, source->box.z);
-    } else if(source->type == HE_PARTICLE_EMITTER_TYPE_SPHERE) {
+    if(emitter->type == HE_PARTICLE_EMITTER_TYPE_BOX) {
+        position.x += heRandomFloat(&emitter->random, -emitter->box.x, emitter->box.x);
+        position.y += heRandomFloat(&emitter->random, -emitter->box.y, emitter->box.y);
+        position.z += heRandomFloat(&emitter->random, -emitter->box.z, emitter->box.z);
+    } else if(emitter->type == HE_PARTICLE_EMITTER_TYPE_SPHERE) {
         // find random direction into the sphere, and then scale to be maximum the radius
         hm::vec3f velocity;
-        velocity.x = heRandomFloat(&source->random, -1, 1);
-        velocity.y = heRandomFloat(&source->random, -1, 1);
-        velocity.z = heRandomFloat(&source->random, -1, 1);
-        position += velocity * heRandomFloat(&source->random, 0, source->sphere); 
+        velocity.x = heRandomFloat(&emitter->random, -1, 1);
+        velocity.y = heRandomFloat(&emitter->random, -1, 1);
+        velocity.z = heRandomFloat(&emitter->random, -1, 1);
+        position += velocity * heRandomFloat(&emitter->random, 0, emitter->sphere); 
     }
     
-    particle->transformation.position = position;
-    particle->transformation.rotation = hm::quatf();
-    particle->velocity = hm::vec3f(heRandomFloat(&source->random, -1, 1), heRandomFloat(&source->random, -1, 1), heRandomFloat(&source->random, -1, 1)) * heRandomFloat(&source->random, source->minSpeed, source->maxSpeed);
-    particle->colour                  = hm::interpolateColour(source->minColour, source->maxColour, heRandomFloat(&source->random, 0.f, 1.f));
-    particle->remaining               = heRandomFloat(&source->random, source->minTime, source->maxTime);
+    data->positionX[index] = position.x;
+    data->positionY[index] = position.y;
+    data->positionZ[index] = position.z;
+    hm::vec3f velocity = hm::vec3f(heRandomFloat(&emitter->random, -1, 1), heRandomFloat(&emitter->random, -1, 1), heRandomFloat(&emitter->random, -1, 1)) * heRandomFloat(&emitter->random, emitter->minSpeed, emitter->maxSpeed);
+    data->velocityX[index] = velocity.x;
+    data->velocityY[index] = velocity.y;
+    data->velocityZ[index] = velocity.z;
+    
+    hm::colour colour   = hm::interpolateColour(emitter->minColour, emitter->maxColour, heRandomFloat(&emitter->random, 0.f, 1.f));
+    data->colour[index]    = hm::encodeColour(colour);
+    data->intensity[index] = (uint16_t) std::min(colour.i * 256.f, 65535.f);
+    data->remaining[index] = heRandomFloat(&emitter->random, emitter->minTime, emitter->maxTime);
+    data->drawIndex[index] = UINT32_MAX;
 };
 
-void heParticleSourceUpdate(HeParticleSource* source, float const delta, HeD3Level* level) {
-    uint32_t created = 0;
-
-    for(uint32_t i = 0; i < source->particleCount; ++i) {
-        HeParticle* particle = &source->particles[i];
-        uint32_t offset = i * source->FLOATS_PER_PARTICLE;
-        particle->remaining -= delta;
-        if(particle->remaining > 0.f) {
-            particle->velocity.y -= source->gravity * delta;
-            particle->transformation.position += particle->velocity * delta;
-        } else {
-            heParticleSourceSpawnParticle(&source->emitter, particle);
-            created++;
+// moves the particle at index from to index to of the pool, overwriting the particle there
+void heParticleDataMove(HeParticleData* data, uint32_t const from, uint32_t const to) {
+    data->positionX[to] = data->positionX[from];
+    data->positionY[to] = data->positionY[from];
+    data->positionZ[to] = data->positionZ[from];
+    data->velocityX[to] = data->velocityX[from];
+    data->velocityY[to] = data->velocityY[from];
+    data->velocityZ[to] = data->velocityZ[from];
+    data->remaining[to] = data->remaining[from];
+    data->scale[to]     = data->scale[from];
+    data->colour[to]    = data->colour[from];
+    data->intensity[to] = data->intensity[from];
+    data->drawIndex[to] = data->drawIndex[from];
+};
+
+uint32_t heParticleSourceEmitBurst(HeParticleSource* source, uint32_t const count) {
+    HeParticleEmitter* emitter = &source->emitter;
+    HeParticleData* data       = &source->particles;
+    HeRandom* random           = &emitter->random;
+    uint32_t const spawned     = std::min(count, source->particleCount - source->aliveCount);
+    uint32_t const begin       = source->aliveCount;
+    if(spawned == 0)
+        return 0;
+
+    // the same as heParticleSourceSpawnParticle, but every attribute is generated for all new particles at once.
+    // The remaining time is filled last, so its array holds the other random factors until then
+    float* factors = &data->remaining[begin];
+    heRandomFillFloats(random, &data->scale[begin], spawned, emitter->minSize, emitter->maxSize);
+
+    float* positions[3] = { &data->positionX[begin], &data->positionY[begin], &data->positionZ[begin] };
+    if(emitter->type == HE_PARTICLE_EMITTER_TYPE_BOX) {
+        for(uint8_t j = 0; j < 3; ++j)
+            heRandomFillFloats(random, positions[j], spawned, -emitter->box[j], emitter->box[j]);
+        for(uint8_t j = 0; j < 3; ++j)
+            for(uint32_t i = 0; i < spawned; ++i)
+                positions[j][i] += emitter->origin[j];
+    } else if(emitter->type == HE_PARTICLE_EMITTER_TYPE_SPHERE) {
+        for(uint8_t j = 0; j < 3; ++j)
+            heRandomFillFloats(random, positions[j], spawned, -1.f, 1.f);
+        heRandomFillFloats(random, factors, spawned, 0.f, emitter->sphere);
+        for(uint8_t j = 0; j < 3; ++j)
+            for(uint32_t i = 0; i < spawned; ++i)
+                positions[j][i] = emitter->origin[j] + positions[j][i] * factors[i];
+    } else {
+        for(uint8_t j = 0; j < 3; ++j)
+            std::fill(positions[j], positions[j] + spawned, emitter->origin[j]);
+    }
+
+    float* velocities[3] = { &data->velocityX[begin], &data->velocityY[begin], &data->velocityZ[begin] };
+    for(uint8_t j = 0; j < 3; ++j)
+        heRandomFillFloats(random, velocities[j], spawned, -1.f, 1.f);
+    heRandomFillFloats(random, factors, spawned, emitter->minSpeed, emitter->maxSpeed);
+    for(uint8_t j = 0; j < 3; ++j)
+        for(uint32_t i = 0; i < spawned; ++i)
+            velocities[j][i] *= factors[i];
+
+    heRandomFillFloats(random, factors, spawned, 0.f, 1.f);
+    for(uint32_t i = 0; i < spawned; ++i) {
+        hm::colour colour = hm::interpolateColour(emitter->minColour, emitter->maxColour, factors[i]);
+        data->colour[begin + i]    = hm::encodeColour(colour);
+        data->intensity[begin + i] = (uint16_t) std::min(colour.i * 256.f, 65535.f);
+    }
+
+    heRandomFillFloats(random, factors, spawned, emitter->minTime, emitter->maxTime);
+    std::fill(&data->drawIndex[begin], &data->drawIndex[begin] + spawned, UINT32_MAX);
+    source->aliveCount += spawned;
+    return spawned;
+};
+
+// moves the living particles of a chunk four at a time and removes its dead ones by moving the last living particle
+// of the chunk into their place. Chunks only touch their own particles, so they can be simulated in parallel
+void heParticleSourceSimulateChunk(HeParticleSource* source, uint32_t const chunk, float const delta) {
+    HeParticleData* data = &source->particles;
+    uint32_t const begin = chunk * PARTICLE_CHUNK_SIZE;
+    uint32_t end         = std::min(begin + PARTICLE_CHUNK_SIZE, source->aliveCount);
+    float const gravity  = source->gravity * delta;
+    
+    __m128 const deltas    = _mm_set1_ps(delta);
+    __m128 const gravities = _mm_set1_ps(gravity);
+    uint32_t i = begin;
+    for(; i + 4 <= end; i += 4) {
+        __m128 remaining = _mm_sub_ps(_mm_loadu_ps(&data->remaining[i]), deltas);
+        __m128 velocityY = _mm_sub_ps(_mm_loadu_ps(&data->velocityY[i]), gravities);
+        _mm_storeu_ps(&data->remaining[i], remaining);
+        _mm_storeu_ps(&data->velocityY[i], velocityY);
+        _mm_storeu_ps(&data->positionX[i], _mm_add_ps(_mm_loadu_ps(&data->positionX[i]), _mm_mul_ps(_mm_loadu_ps(&data->velocityX[i]), deltas)));
+        _mm_storeu_ps(&data->positionY[i], _mm_add_ps(_mm_loadu_ps(&data->positionY[i]), _mm_mul_ps(velocityY, deltas)));
+        _mm_storeu_ps(&data->positionZ[i], _mm_add_ps(_mm_loadu_ps(&data->positionZ[i]), _mm_mul_ps(_mm_loadu_ps(&data->velocityZ[i]), deltas)));
+    }
+
+    for(; i < end; ++i) {
+        data->remaining[i] -= delta;
+        data->velocityY[i] -= gravity;
+        data->positionX[i] += data->velocityX[i] * delta;
+        data->positionY[i] += data->velocityY[i] * delta;
+        data->positionZ[i] += data->velocityZ[i] * delta;
+    }
+
+    i = begin;
+    while(i < end) {
+        if(data->remaining[i] <= 0.f)
+            heParticleDataMove(data, --end, i);
+        else
+            ++i;
+    }
+
+    source->chunks[chunk].alive = end - begin;
+};
+
+// moves the living particles behind the last gap of the simulated chunks into the gaps, so that all living particles
+// are at the start of the pool again. Then updates the origin and emits new particles
+void heParticleSourceEmit(HeParticleSource* source, uint32_t const chunkCount, float const delta, HeD3Level* level) {
+    HeParticleData* data = &source->particles;
+    uint32_t total = 0;
+    for(uint32_t i = 0; i < chunkCount; ++i)
+        total += source->chunks[i].alive;
+
+    // the gaps are filled from the back, so that every particle is moved at most once
+    uint32_t filler    = chunkCount;
+    uint32_t fillBegin = 0, fillEnd = 0;
+    for(uint32_t i = 0; i < chunkCount && i * PARTICLE_CHUNK_SIZE < total; ++i) {
+        uint32_t gapEnd = std::min((i + 1) * PARTICLE_CHUNK_SIZE, total);
+        for(uint32_t gap = i * PARTICLE_CHUNK_SIZE + source->chunks[i].alive; gap < gapEnd; ++gap) {
+            while(fillBegin == fillEnd) {
+                --filler;
+                fillBegin = std::max(filler * PARTICLE_CHUNK_SIZE, total);
+                fillEnd   = std::max(filler * PARTICLE_CHUNK_SIZE + source->chunks[filler].alive, fillBegin);
+            }
+
+            heParticleDataMove(data, --fillEnd, gap);
+        }
+    }
+
+    source->aliveCount = total;
+
+    HeD3Instance const* parent = heD3LevelGetInstanceById(level, source->parent);
+    if(parent != nullptr)
+        source->emitter.origin = hm::vec3f(level->instanceWorldMatrices[heD3LevelGetInstanceIndex(level, parent)] * hm::vec4f(source->emitter.transformation.position, 1.f));
+    else
+        source->emitter.origin = source->emitter.transformation.position;
+
+    uint32_t count = source->maxNewParticlesPerUpdate;
+    if(source->emissionRate > 0.f) {
+        source->emissionCarry += source->emissionRate * delta;
+        count = (uint32_t) source->emissionCarry;
+        source->emissionCarry -= (float) count;
+    }
+        
+    heParticleSourceEmitBurst(source, count);
+};
+
+// sorts the given pairs by their upper 32 bits (the key, which must be below 2^16) with two passes of eight bits.
+// Passes in which all keys have the same digit are skipped. The result ends up in pairs, scratch must have the same
+// size
+void heParticleRadixSort(std::vector<uint64_t>& pairs, std::vector<uint64_t>& scratch) {
+    uint32_t const count = (uint32_t) pairs.size();
+    if(count == 0)
+        return;
+    
+    uint32_t histograms[2][256] = {};
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t const key = (uint32_t) (pairs[i] >> 32);
+        ++histograms[0][key & 0xff];
+        ++histograms[1][key >> 8];
+    }
+
+    for(uint8_t pass = 0; pass < 2; ++pass) {
+        uint32_t* histogram = histograms[pass];
+        uint32_t const shift = 32 + pass * 8;
+        if(histogram[(pairs[0] >> shift) & 0xff] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for(uint32_t i = 0; i < 256; ++i) {
+            uint32_t const size = histogram[i];
+            histogram[i] = offset;
+            offset += size;
+        }
+
+        for(uint32_t i = 0; i < count; ++i)
+            scratch[histogram[(pairs[i] >> shift) & 0xff]++] = pairs[i];
+
+        std::swap(pairs, scratch);
+    }
+};
+
+void heParticleSourceSortByDepth(HeParticleSource* source, hm::mat4f const& viewMatrix) {
+    HeParticleData* data           = &source->particles;
+    std::vector<float>& depths     = source->sortDepths;
+    std::vector<uint32_t>& keys    = source->sortKeys;
+    std::vector<uint64_t>& pairs   = source->sortPairs;
+    std::vector<uint64_t>& scratch = source->sortScratch;
+    std::vector<uint32_t>& order   = source->drawOrder;
+    uint32_t const count           = source->aliveCount;
+
+    { // the keys are the view space depth, mapped from the depth range of the particles to 16 bits. Particles
+      // further away have a lower depth and a lower key, so ascending keys are back to front
+        __m128 const rowX = _mm_set1_ps(viewMatrix[0][2]);
+        __m128 const rowY = _mm_set1_ps(viewMatrix[1][2]);
+        __m128 const rowZ = _mm_set1_ps(viewMatrix[2][2]);
+        __m128 minDepth = _mm_set1_ps(FLT_MAX);
+        __m128 maxDepth = _mm_set1_ps(-FLT_MAX);
+        uint32_t i = 0;
+        for(; i + 4 <= count; i += 4) {
+            __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data->positionX[i]), rowX), _mm_mul_ps(_mm_loadu_ps(&data->positionY[i]), rowY)),
+                                      _mm_mul_ps(_mm_loadu_ps(&data->positionZ[i]), rowZ));
+            minDepth = _mm_min_ps(minDepth, depth);
+            maxDepth = _mm_max_ps(maxDepth, depth);
+            _mm_storeu_ps(&depths[i], depth);
+        }
+
+        float lanes[2][4];
+        _mm_storeu_ps(lanes[0], minDepth);
+        _mm_storeu_ps(lanes[1], maxDepth);
+        float low  = std::min(std::min(lanes[0][0], lanes[0][1]), std::min(lanes[0][2], lanes[0][3]));
+        float high = std::max(std::max(lanes[1][0], lanes[1][1]), std::max(lanes[1][2], lanes[1][3]));
+        for(; i < count; ++i) {
+            depths[i] = data->positionX[i] * viewMatrix[0][2] + data->positionY[i] * viewMatrix[1][2] + data->positionZ[i] * viewMatrix[2][2];
+            low  = std::min(low, depths[i]);
+            high = std::max(high, depths[i]);
+        }
+
+        // clamped, since the farthest particle may round just past the range
+        float const scale = high > low ? 65535.f / (high - low) : 0.f;
+        __m128 const offsets = _mm_set1_ps(low);
+        __m128 const scales  = _mm_set1_ps(scale);
+        __m128 const limit   = _mm_set1_ps(65535.f);
+        for(i = 0; i + 4 <= count; i += 4)
+            _mm_storeu_si128((__m128i*) &keys[i], _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&depths[i]), offsets), scales), limit)));
+        for(; i < count; ++i)
+            keys[i] = (uint32_t) std::min((depths[i] - low) * scale, 65535.f);
+    }
+
+    // every particle is sorted as its key in the upper and its index in the lower half of a pair, so that the sort
+    // only reads memory in order. The particles that survived the last sort are put into their old order (every
+    // draw index is unique, so every survivor gets its own slot), the new ones are collected behind them
+    uint32_t const previous = (uint32_t) order.size();
+    pairs.assign(previous, UINT64_MAX);
+    scratch.clear();
+    for(uint32_t i = 0; i < count; ++i) {
+        uint64_t const pair = ((uint64_t) keys[i] << 32) | i;
+        uint32_t const index = data->drawIndex[i];
+        if(index < previous)
+            pairs[index] = pair;
+        else
+            scratch.emplace_back(pair);
+    }
+
+    uint32_t survivors = 0;
+    for(uint32_t i = 0; i < previous; ++i)
+        if(pairs[i] != UINT64_MAX)
+            pairs[survivors++] = pairs[i];
+    pairs.resize(survivors);
+
+    // if the particles only moved a bit since the last update, the old order is almost sorted and repairing it with
+    // an insertion sort is cheaper than a full sort. Like the radix sort it keeps the order of equal keys, so that
+    // particles at the same depth do not flicker
+    uint32_t const fresh = (uint32_t) scratch.size();
+    b8 coherent = fresh <= count * PARTICLE_SORT_MAX_NEW;
+    uint64_t moves = (uint64_t) (count * PARTICLE_SORT_MAX_MOVES) + 1;
+    for(uint32_t i = 1; coherent && i < survivors; ++i) {
+        uint64_t const pair = pairs[i];
+        uint64_t const key  = pair >> 32;
+        uint32_t j = i;
+        while(j > 0 && (pairs[j - 1] >> 32) > key) {
+            pairs[j] = pairs[j - 1];
+            --j;
+            if(--moves == 0) {
+                coherent = false;
+                break;
+            }
         }
 
-        // build trans mat and add to vbo
-        hm::mat4f transMat = hm::translate(hm::mat4f(1.0f), particle->transformation.position);
-
-        // transpose view matrix into trans matrix so that we cancel the rotation
-        transMat[0][0] = level->camera.viewMatrix[0][0];
-        transMat[1][0] = level->camera.viewMatrix[0][1];
-        transMat[2][0] = level->camera.viewMatrix[0][2];
-        transMat[0][1] = level->camera.viewMatrix[1][0];
-        transMat[1][1] = level->camera.viewMatrix[1][1];
-        transMat[2][1] = level->camera.viewMatrix[1][2];
-        transMat[0][2] = level->camera.viewMatrix[2][0];
-        transMat[1][2] = level->camera.viewMatrix[2][1];
-        transMat[2][2] = level->camera.viewMatrix[2][2];
-        transMat = hm::scale(transMat, particle->transformation.scale);
-
-        float colour[4];
-        colour[0] = hm::getR(&particle->colour);
-        colour[1] = hm::getG(&particle->colour);
-        colour[2] = hm::getB(&particle->colour);
-        colour[3] = hm::getA(&particle->colour);
-
-        hm::vec4f uvs = heSpriteAtlasGetUvs(source->atlas, source->atlasIndex);
-            
-        memcpy(&source->dataBuffer[offset], &transMat[0][0], 16 * sizeof(float));
-        memcpy(&source->dataBuffer[offset + 16], &colour[0], 4 * sizeof(float));
-        memcpy(&source->dataBuffer[offset + 20], &uvs.x, 4 * sizeof(float));
+        pairs[j] = pair;
+    }
+
+    if(coherent) {
+        // sort the new particles on their own and merge them into the survivors from the back
+        std::sort(scratch.begin(), scratch.end());
+        pairs.resize(count);
+        uint32_t target = count, s = survivors, f = fresh;
+        while(f > 0) {
+            if(s > 0 && (pairs[s - 1] >> 32) > (scratch[f - 1] >> 32))
+                pairs[--target] = pairs[--s];
+            else
+                pairs[--target] = scratch[--f];
+        }
+    } else {
+        pairs.insert(pairs.end(), scratch.begin(), scratch.end());
+        scratch.resize(count);
+        heParticleRadixSort(pairs, scratch);
+    }
+
+    order.resize(count);
+    for(uint32_t i = 0; i < count; ++i) {
+        uint32_t const particle = (uint32_t) pairs[i];
+        order[i] = particle;
+        data->drawIndex[particle] = i;
+    }
+};
+
+// computes the bounds of a chunk of living particles and writes their instance data. If the source is depth sorted,
+// the chunk writes the instances of its range of the draw order instead of its own particles
+void heParticleSourceBuildChunk(HeParticleSource* source, uint32_t const chunk) {
+    HeParticleData const* data = &source->particles;
+    HeParticleChunk* result    = &source->chunks[chunk];
+    uint32_t const begin       = chunk * PARTICLE_CHUNK_SIZE;
+    uint32_t const end         = std::min(begin + PARTICLE_CHUNK_SIZE, source->aliveCount);
+    
+    __m128 minX = _mm_set1_ps(FLT_MAX),  minY = minX, minZ = minX;
+    __m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+    __m128 scale = _mm_setzero_ps();
+    uint32_t i = begin;
+    for(; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(&data->positionX[i]);
+        __m128 y = _mm_loadu_ps(&data->positionY[i]);
+        __m128 z = _mm_loadu_ps(&data->positionZ[i]);
+        minX  = _mm_min_ps(minX, x); minY = _mm_min_ps(minY, y); minZ = _mm_min_ps(minZ, z);
+        maxX  = _mm_max_ps(maxX, x); maxY = _mm_max_ps(maxY, y); maxZ = _mm_max_ps(maxZ, z);
+        scale = _mm_max_ps(scale, _mm_loadu_ps(&data->scale[i]));
+    }
+
+    float lanes[7][4];
+    _mm_storeu_ps(lanes[0], minX); _mm_storeu_ps(lanes[1], minY); _mm_storeu_ps(lanes[2], minZ);
+    _mm_storeu_ps(lanes[3], maxX); _mm_storeu_ps(lanes[4], maxY); _mm_storeu_ps(lanes[5], maxZ);
+    _mm_storeu_ps(lanes[6], scale);
+    result->boundsMin = hm::vec3f(FLT_MAX);
+    result->boundsMax = hm::vec3f(-FLT_MAX);
+    result->maxScale  = 0.f;
+    for(uint8_t j = 0; j < 4; ++j) {
+        result->boundsMin = hm::vec3f(std::min(result->boundsMin.x, lanes[0][j]), std::min(result->boundsMin.y, lanes[1][j]), std::min(result->boundsMin.z, lanes[2][j]));
+        result->boundsMax = hm::vec3f(std::max(result->boundsMax.x, lanes[3][j]), std::max(result->boundsMax.y, lanes[4][j]), std::max(result->boundsMax.z, lanes[5][j]));
+        result->maxScale  = std::max(result->maxScale, lanes[6][j]);
     }
+
+    for(; i < end; ++i) {
+        result->boundsMin = hm::vec3f(std::min(result->boundsMin.x, data->positionX[i]), std::min(result->boundsMin.y, data->positionY[i]), std::min(result->boundsMin.z, data->positionZ[i]));
+        result->boundsMax = hm::vec3f(std::max(result->boundsMax.x, data->positionX[i]), std::max(result->boundsMax.y, data->positionY[i]), std::max(result->boundsMax.z, data->positionZ[i]));
+        result->maxScale  = std::max(result->maxScale, data->scale[i]);
+    }
+
+    uint16_t const atlasIndex = (uint16_t) source->atlasIndex;
+    for(i = begin; i < end; ++i) {
+        uint32_t const particle      = source->depthSort ? source->drawOrder[i] : i;
+        HeParticleInstance* instance = &source->dataBuffer[i];
+        instance->position   = hm::vec3f(data->positionX[particle], data->positionY[particle], data->positionZ[particle]);
+        instance->size       = data->scale[particle];
+        instance->colour     = data->colour[particle];
+        instance->atlasIndex = atlasIndex;
+        instance->intensity  = data->intensity[particle];
+    }
+};
+
+// merges the bounds of all built chunks into the bounds of the source
+void heParticleSourceMergeBounds(HeParticleSource* source) {
+    if(source->aliveCount == 0) {
+        // nothing to draw, an empty box is culled unless the origin is visible
+        source->boundsCenter = source->emitter.origin;
+        source->boundsExtent = hm::vec3f(0.f);
+        return;
+    }
+    
+    hm::vec3f boundsMin(FLT_MAX);
+    hm::vec3f boundsMax(-FLT_MAX);
+    float maxScale = 0.f;
+    for(uint32_t i = 0; i < heParticleSourceGetChunkCount(source->aliveCount); ++i) {
+        HeParticleChunk const* chunk = &source->chunks[i];
+        boundsMin = hm::vec3f(std::min(boundsMin.x, chunk->boundsMin.x), std::min(boundsMin.y, chunk->boundsMin.y), std::min(boundsMin.z, chunk->boundsMin.z));
+        boundsMax = hm::vec3f(std::max(boundsMax.x, chunk->boundsMax.x), std::max(boundsMax.y, chunk->boundsMax.y), std::max(boundsMax.z, chunk->boundsMax.z));
+        maxScale  = std::max(maxScale, chunk->maxScale);
+    }
+
+    source->boundsCenter = (boundsMin + boundsMax) / 2.f;
+    source->boundsExtent = (boundsMax - boundsMin) / 2.f + hm::vec3f(maxScale);
+};
+
+void heParticleSourceUpdate(HeParticleSource* source, float const delta, HeD3Level* level) {
+    uint32_t chunkCount = heParticleSourceGetChunkCount(source->aliveCount);
+    for(uint32_t i = 0; i < chunkCount; ++i)
+        heParticleSourceSimulateChunk(source, i, delta);
+
+    heParticleSourceEmit(source, chunkCount, delta, level);
+    if(source->depthSort)
+        heParticleSourceSortByDepth(source, level->camera.viewMatrix);
+    
+    chunkCount = heParticleSourceGetChunkCount(source->aliveCount);
+    for(uint32_t i = 0; i < chunkCount; ++i)
+        heParticleSourceBuildChunk(source, i);
+
+    heParticleSourceMergeBounds(source);
+};
+
+void heD3LevelUpdateParticles(HeD3Level* level, float const delta) {
+    std::vector<HeParticleSource*> sources;
+    sources.reserve(level->particles.size());
+    for(auto& all : level->particles)
+        sources.emplace_back(&all);
+
+    // every task is a chunk of a source, so that large sources are split over the workers as well
+    std::vector<std::pair<HeParticleSource*, uint32_t>> chunks;
+    auto collectChunks = [&]() {
+        chunks.clear();
+        for(HeParticleSource* all : sources)
+            for(uint32_t i = 0; i < heParticleSourceGetChunkCount(all->aliveCount); ++i)
+                chunks.emplace_back(all, i);
+    };
+
+    collectChunks();
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) chunks.size(), 1, [&chunks, delta](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i)
+            heParticleSourceSimulateChunk(chunks[i].first, chunks[i].second, delta);
+    });
+
+    // the gaps, the emission and the depth sort need the whole source (and its random generator), so this is one
+    // task per source
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) sources.size(), 1, [&sources, level, delta](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i) {
+            heParticleSourceEmit(sources[i], heParticleSourceGetChunkCount(sources[i]->aliveCount), delta, level);
+            if(sources[i]->depthSort)
+                heParticleSourceSortByDepth(sources[i], level->camera.viewMatrix);
+        }
+    });
+
+    // each chunk writes the instance data of its own particles
+    collectChunks();
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) chunks.size(), 1, [&chunks](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i)
+            heParticleSourceBuildChunk(chunks[i].first, chunks[i].second);
+    });
+
+    for(HeParticleSource* all : sources)
+        heParticleSourceMergeBounds(all);
 };
@@ -2,6 +2,8 @@
 #define HE_D3_H
 
 #include "heAssets.h"
+#include "heBvh.h"
+#include "heOcclusion.h"
 #include "hePhysics.h"
 #include "heUtils.h"
 
@@ -16,19 +18,47 @@ struct HeD3Transformation {
     HeD3Transformation(hm::vec3f const& pos) : position(pos), scale(1.f), rotation(0.f, 0.f, 0.f, 1.f) {};
 };
 
+// a stable reference to an instance in a level. Instances are stored densely and move around when other instances
+// are removed, so anything that needs to refer to an instance over multiple frames should store this id instead
+// of a pointer. The generation of a slot is increased whenever its instance is removed, so ids of removed instances
+// are detected as invalid (generation 0 is never used)
+struct HeD3InstanceId {
+    uint32_t index      = 0; // index into the levels slot array
+    uint32_t generation = 0;
+};
+
+// maps an id to the current position of its instance in the levels dense instance array
+struct HeD3InstanceSlot {
+    // index into the dense instance array, or the next free slot if this slot is unused
+    uint32_t denseIndex = 0;
+    uint32_t generation = 1;
+};
+
 struct HeD3Instance {
+    // the id of this instance in its level. Only valid if this instance was added through heD3LevelAddInstance
+    HeD3InstanceId id;
     // pointer to a vao in the asset pool
     HeVao* mesh                 = nullptr;
     // pointer to a material in the asset pool
     HeMaterial* material        = nullptr;
     // (possibly) a pointer to a member of the component list in the HeD3Level's physics level
     HePhysicsComponent* physics = nullptr;
-    // world space transformation of this instance
+    // transformation of this instance, relative to the parent if it has one and in world space otherwise. If this
+    // is modified directly (not through the setters), the instance must be flagged as dirty in its level so that the
+    // cached matrices are rebuilt
     HeD3Transformation transformation;
-    // a list of indices from the levels light list that apply to this instance.
-    // This list should be updated whenever a light or this instance is moved. The size of this list is
-    // determined by the light count in the render engine
-    std::vector<uint32_t> lightIndices;
+    // the instance this instance is attached to, see heD3LevelSetInstanceParent. Instances with physics should not
+    // have a parent, the physics always work in world space
+    HeD3InstanceId parent;
+    // the first child of this instance and the next child of the parent (as slot index), UINT32_MAX if there is none
+    uint32_t firstChild  = UINT32_MAX;
+    uint32_t nextSibling = UINT32_MAX;
+    // the number of ancestors of this instance
+    uint32_t depth       = 0;
+    // the leaf of this instance in the levels instance tree, -1 if it has no bounds
+    int32_t bvhLeaf = -1;
+    // the level of detail this instance is drawn with, 0 is the full mesh. See heD3InstanceSelectLod
+    uint8_t lod = 0;
     
 #ifdef HE_ENABLE_NAMES
     std::string name;
@@ -56,6 +86,9 @@ struct HeD3Frustum {
     // index 0 are the lowest coordinates in each direction (of the corners)
     // index 1 are the highest coordinates in each direction (of the corners)
     hm::vec3f bounds[2];
+    // the six clipping planes (left, right, bottom, top, near, far) as normal (xyz) and distance (w). The normals
+    // point into the frustum. Updated from the view projection matrix in heD3FrustumUpdatePlanes
+    hm::vec4f planes[6];
     HeD3ViewInformation viewInfo;
 };
 
@@ -75,17 +108,49 @@ struct HeD3Camera {
     float gamma     = 1.f; // disable gamma correction
 };
 
+struct HeD3ShadowCascade {
+    hm::mat4f projectionMatrix; // the orthographic projection of this cascade, in the view space of the shadow map
+    hm::mat4f shadowSpaceMatrix; // converts from world space to the uv (and depth) of this cascade in the atlas
+    HeD3Frustum frustum; // the planes of the box of this cascade, used for culling the casters of this cascade
+    hm::vec4f atlasRect; // the part of the atlas used by this cascade (min uv in xy, max uv in zw)
+    float     splitDepth = 0.f; // the view depth of the camera at which this cascade ends
+    hm::mat4f cachedProjection; // the projection that the static casters in the cache were rendered with
+};
+
+// a shadow map of a directional light. The camera frustum (up to shadowDistance) is split into slices along the
+// view depth, and each slice gets its own orthographic cascade. Close cascades cover a small area and therefore have
+// sharp shadows. All cascades are rendered into the same depth texture (the atlas), which is two cascades wide.
+// Cascades are fitted around the bounding sphere of their slice and moved in whole texels, so that their shadows
+// dont shimmer when the camera moves or rotates
 struct HeD3ShadowMap {
+    static const uint8_t MAX_CASCADES = 4;
+
     HeFbo depthFbo;
-    HeD3Frustum frustum; // frustum of the shadow map box
-    hm::mat4f projectionMatrix; // the orthographic projection matrix used for rendering the shadow map
-    hm::mat4f viewMatrix; // the view matrix used for rendering the shadow map
-    hm::mat4f offsetMatrix; // maps coordinates in range [-1:1] (transform output) to uv range
-    hm::mat4f shadowSpaceMatrix; // matrix to convert from world space to the texture map
+    HeD3ShadowCascade cascades[MAX_CASCADES];
+    hm::mat4f projectionMatrix; // the orthographic projection around all cascades, used for culling the casters
+    hm::mat4f viewMatrix; // the view matrix used for rendering the shadow map (only a rotation towards the light)
     
     float     shadowDistance = 40.f; // the length of the shadow map. Objects farther away from the camera do not cast shadows
-    float     offset         = 10.f;
-    hm::vec2i resolution     = 4096;
+    float     offset         = 10.f; // how far the cascades reach towards the light, so that objects outside of the view cast shadows as well
+    hm::vec2i resolution     = 1024; // the resolution of a single cascade
+    uint8_t   cascadeCount   = 4;    // the number of cascades used, at most MAX_CASCADES. Must be set before creating the map
+    // how the camera frustum is split into cascades. 0 splits it into slices of the same depth, 1 into slices whose
+    // depth grows by the same factor (logarithmic). Values in between blend both
+    float     splitWeight    = .75f;
+
+    // the instances (dense indices) and static batches that are rendered into this map, see
+    // heD3LevelCullShadowCasters
+    std::vector<uint32_t> casters;
+    std::vector<uint32_t> casterBatches;
+
+    // static instances (see heD3InstanceIsStatic) and static batches are rendered into staticFbo only when the light,
+    // a cascade or the static geometry of the level changed. Every frame the cache is copied into depthFbo and only
+    // the other casters are rendered on top of it. Must be set before creating the map
+    b8        cacheStatic    = true;
+    HeFbo     staticFbo;
+    hm::mat4f cachedViewMatrix; // the view matrix that the cache was rendered with
+    uint32_t  cachedRevision = 0; // the static revision of the level that the cache was rendered with
+    b8        cacheValid     = false; // set to false to rebuild all cascades of the cache in the next frame
 };
 
 struct HeD3LightSource {
@@ -117,6 +182,13 @@ struct HeD3LightSource {
     
     b8 castShadows = false;
     HeD3ShadowMap shadows;
+    // the leaf of this light in the levels light tree, -1 for lights without a limited range (directional)
+    int32_t bvhLeaf = -1;
+    // the instance this light is attached to. If the parent is valid, vector (and the direction of spot lights) are
+    // computed from localVector (and localDirection) and the world matrix of the parent in every level update
+    HeD3InstanceId parent;
+    hm::vec3f localVector;
+    hm::vec3f localDirection;
 };
 
 struct HeD3Skybox {
@@ -124,16 +196,52 @@ struct HeD3Skybox {
     HeTexture* irradiance = nullptr;
 };
 
-struct HeParticle {
-    HeD3Transformation transformation; // xy rotation is ignored for particles, only z works (axis into the display). The position is relative to the particle source
-    hm::colour colour; // hdr colour
-    float remaining = 0.f; // as long as this value is above 0, this particle is alive
-    hm::vec3f velocity; // velocity of this particle, set at spawn
+// the particles of a source, stored as one array per attribute (structure of arrays) so that the update can work on
+// four particles at a time. Every array has one entry per particle of the source
+struct HeParticleData {
+    // world space position
+    std::vector<float> positionX, positionY, positionZ;
+    // velocity, set at spawn and pulled down by the gravity of the source
+    std::vector<float> velocityX, velocityY, velocityZ;
+    // as long as this value is above 0, the particle is alive
+    std::vector<float> remaining;
+    // the size of the particle in world space
+    std::vector<float> scale;
+    // rgba colour (packed with hm::encodeColour) and its hdr intensity in 8.8 fixed point, set at spawn
+    std::vector<uint32_t> colour;
+    std::vector<uint16_t> intensity;
+    // the position of the particle in the draw order of the last depth sort, or UINT32_MAX if it was spawned since
+    // then (see HeParticleSource::depthSort)
+    std::vector<uint32_t> drawIndex;
+};
+
+// the state of a range of particles of a source while it is updated, see heD3LevelUpdateParticles
+struct HeParticleChunk {
+    // the number of living particles at the start of the chunk after its dead particles were removed
+    uint32_t  alive    = 0;
+    // the bounds of the living particles of the chunk and their largest size
+    hm::vec3f boundsMin;
+    hm::vec3f boundsMax;
+    float     maxScale = 0.f;
+};
+
+// the data of a single particle that is uploaded for instanced rendering. The quad is turned towards the camera and
+// the uvs are looked up in the vertex shader, since both are the same for all particles of a source
+struct HeParticleInstance {
+    hm::vec3f position;       // world space
+    float     size       = 0.f;
+    uint32_t  colour     = 0; // rgba, packed with hm::encodeColour
+    uint16_t  atlasIndex = 0; // the sprite in the atlas of the source
+    uint16_t  intensity  = 0; // hdr intensity of the colour in 8.8 fixed point
 };
 
 struct HeParticleEmitter {
     HeParticleEmitterType type;
+    // the transformation of the emitter, relative to the parent of the source if it has one
     HeD3Transformation    transformation;
+    // the world space position that new particles are spawned around, updated from the transformation (and parent)
+    // of the source in every update
+    hm::vec3f             origin;
     HeRandom              random;
     
     float minSize  = 0.01f, maxSize  = 0.1f;
@@ -152,25 +260,145 @@ HeParticleEmitter() : box(0.f), type(HE_PARTICLE_EMITTER_TYPE_NONE) {};
 struct HeParticleSource {
     HeSpriteAtlas* atlas         = nullptr;
     uint32_t       atlasIndex    = 0;
+    // the size of the pool, specified in the particles create function
     uint32_t       particleCount = 0;
+    // the number of living particles. These are always the first aliveCount particles of the pool, dead particles are
+    // replaced by the last living one. Only living particles are updated and rendered
+    uint32_t       aliveCount    = 0;
 
     HeParticleEmitter emitter;
-    HeParticle*       particles  = nullptr; // a pointer to an array of particles, the size of which is specified in the particles create function
-    float*            dataBuffer = nullptr; // a float pointer that contains all necessary instanced data for the particles, that is the transformation matrix, uvs and colours
+    HeParticleData    particles; // the pool of particles of this source
+    HeParticleInstance* dataBuffer = nullptr; // the instance data of the living particles, rebuilt in every update
+    // the pool split into ranges that are updated as separate tasks
+    std::vector<HeParticleChunk> chunks;
 
     // gravity that pulls down all particles per update
     float    gravity                  = 9.81f;
-    // how many new particles to spawn per update (or respawn dead ones). If weve already spawned that many particles in an update, the other dead ones remaing dead
+    // how many new particles to spawn per update if emissionRate is 0. New particles are only spawned while the pool
+    // has room for them
     uint32_t maxNewParticlesPerUpdate = 1;
+    // how many new particles to spawn per second. If this is above 0, it is used instead of maxNewParticlesPerUpdate
+    float    emissionRate             = 0.f;
+    // the fraction of a particle that the emission rate did not spawn yet, carried over to the next update
+    float    emissionCarry            = 0.f;
     // whether to use additive blending. Useful for when many particles are overlapping and these parts should be brighter, for example fire
     b8 additive = false;
     // whether these particles cast and receive shadows
     b8 enableShadows = true;
+    // whether the particles are drawn back to front, which alpha blended particles need to look right. This sorts
+    // the particles in every update, additive particles look the same in any order
+    b8 depthSort = false;
+    // the living particles (as index into the pool) in the order they are drawn, only used if depthSort is set
+    std::vector<uint32_t> drawOrder;
+    // the view depth of every living particle, the depth as 16 bit integer and the keys paired with their particle,
+    // used while sorting
+    std::vector<float>    sortDepths;
+    std::vector<uint32_t> sortKeys;
+    std::vector<uint64_t> sortPairs;
+    std::vector<uint64_t> sortScratch;
+    // world space bounding box around all particles (center and half size), updated every frame. Negative until the
+    // first update, so that new sources are not culled
+    hm::vec3f boundsCenter;
+    hm::vec3f boundsExtent = hm::vec3f(-1.f);
+    // the instance this source is attached to. New particles are spawned relative to the parent, living particles
+    // are not moved with it
+    HeD3InstanceId parent;
     
-    // 4x4 transMat = 16
-    // hdr colour   =  4
-    // uvs          =  4
-    static const uint32_t FLOATS_PER_PARTICLE = 24; // constant so its easier to change
+    // position = 3
+    // size     = 1
+    // colour   = 1 (rgba8)
+    // sprite   = 1 (atlas index and intensity)
+    static const uint32_t FLOATS_PER_PARTICLE = sizeof(HeParticleInstance) / sizeof(float);
+};
+
+// a point or spot light prepared for binning into the clusters
+struct HeD3ClusterLight {
+    // the position of the light in view space
+    hm::vec3f center;
+    // the range of the light, see heD3LightSourceGetRange
+    float     radius   = 0.f;
+    // the index of the light in the lights of the level
+    uint32_t  index    = 0;
+    // the first and last z slice that the light reaches into
+    uint32_t  minSlice = 0;
+    uint32_t  maxSlice = 0;
+};
+
+// a view space grid of clusters (froxels) over the camera frustum. The screen is split into tiles and the depth range
+// into slices that get exponentially thicker with the distance. Every cluster lists the lights that reach into it,
+// so that forward+ shading only loops over the lights near a fragment instead of all lights of the level
+struct HeD3LightClusters {
+    // the number of clusters along the screen width, the screen height and the view depth
+    uint32_t sizeX = 16;
+    uint32_t sizeY = 9;
+    uint32_t sizeZ = 24;
+
+    // the offset into lightIndices and the number of lights of every cluster (two values per cluster). Clusters
+    // are ordered by x, then y, then z
+    std::vector<uint32_t> clusterData;
+    // the lights of all clusters, as index into the lights of the level
+    std::vector<uint32_t> lightIndices;
+
+    // the view space bounding boxes of all clusters, rebuilt when the projection changes
+    std::vector<hm::vec3f> clusterMin;
+    std::vector<hm::vec3f> clusterMax;
+    // the slice of a view space depth d is log(d) * depthScale - depthBias
+    float depthScale  = 0.f;
+    float depthBias   = 0.f;
+    // the projection the grid was built for
+    float projectionX = 0.f;
+    float projectionY = 0.f;
+    float nearPlane   = 0.f;
+    float farPlane    = 0.f;
+
+    // scratch memory of the binning, reused every frame
+    std::vector<HeD3ClusterLight>      lights;
+    std::vector<uint32_t>              globalLights;
+    std::vector<std::vector<uint32_t>> slicePairs;
+    std::vector<std::vector<uint32_t>> sliceIndices;
+
+    // the number of lights the forward shaders can hold (maxLightCount in 3d_shader.glh). All lights after that
+    // are ignored
+    static const uint32_t MAX_LIGHTS = 127;
+};
+
+// the merged geometry of static instances that share a material and are close to each other, drawn with a single
+// draw call. The vertices are in world space
+struct HeD3StaticBatch {
+    // pointer to the material in the asset pool that all merged instances use
+    HeMaterial* material = nullptr;
+    // the merged vertices, uvs, normals and tangents. Owned by the batch
+    HeVao vao;
+    // world space bounding box of the batch (center and half size)
+    hm::vec3f boundsCenter;
+    hm::vec3f boundsExtent;
+    // the number of instances merged into this batch. 0 if the batch was split up again because one of its
+    // instances changed, such batches are skipped everywhere until the batches are rebuilt
+    uint32_t instanceCount = 0;
+    // the slots of the merged instances
+    std::vector<uint32_t> instances;
+};
+
+// a single draw of the render queue
+struct HeD3RenderItem {
+    // see HeD3RenderQueue
+    uint64_t key   = 0;
+    // the index of the instance in the instances of the level, or of the batch in its static batches
+    uint32_t index = 0;
+    b8       batch = false;
+};
+
+// the visible instances and batches of a level in the order they are drawn, rebuilt every frame. The key of every
+// draw is (from the highest bits) its pass, then for opaque draws its shader, material, mesh and view depth (front to
+// back), for transparent draws its view depth (back to front), shader, material and mesh. Sorting by the key groups
+// draws that share state, so that each shader and material is only loaded once per pass
+struct HeD3RenderQueue {
+    // the sorted draws, all opaque ones first
+    std::vector<HeD3RenderItem> items;
+    // the number of opaque draws at the start of items
+    uint32_t opaqueCount = 0;
+    // used while sorting
+    std::vector<HeD3RenderItem> scratch;
 };
 
 struct HeD3Level {
@@ -178,11 +406,63 @@ struct HeD3Level {
     HeD3Skybox skybox;
     HePhysicsLevel physics;
 
-    std::list<HeD3Instance> instances;
+    // all instances of this level, tightly packed. Removing an instance moves the last instance into its place, so
+    // pointers into this array are only valid until the next instance is added or removed
+    std::vector<HeD3Instance>     instances;
+    // the data of the instances that the update, culling and render loops go over, parallel to instances (same
+    // index, moved along when an instance is removed) so that these loops do not pull the rest of the instances
+    // into the cache. The cached world space transformation matrices, built from the transformation of the
+    // instances when they are dirty
+    std::vector<hm::mat4f>        instanceWorldMatrices;
+    // the cached normal matrices (transposed inverse of the upper 3x3 of the world matrix)
+    std::vector<hm::mat3f>        instanceNormalMatrices;
+    // the world space bounding boxes of the meshes (center and half size), rebuilt together with the matrices. A
+    // negative extent means the mesh has no bounds and is never culled
+    std::vector<hm::vec3f>        instanceBoundsCenters;
+    std::vector<hm::vec3f>        instanceBoundsExtents;
+    // the HeD3InstanceFlags of every instance. Moving or removing a batched instance splits its batch up again,
+    // instances that are not marked as occluder are only used as one if they cover a large part of the screen
+    std::vector<uint8_t>          instanceFlags;
+    // the slots that HeD3InstanceIds point to
+    std::vector<HeD3InstanceSlot> instanceSlots;
+    // the first unused slot in instanceSlots, the free slots form a list through their denseIndex
+    uint32_t                      freeInstanceSlot = UINT32_MAX;
     std::list<HeD3LightSource> lights;
     std::list<HeParticleSource> particles;
+
+    // spatial index over the world space bounds of all instances with a mesh. The leaves store the slot index of the
+    // instance (see heD3LevelGetInstanceFromSlot). Kept in sync by heD3LevelUpdateBounds
+    HeBvh instanceTree;
+    // spatial index over the range of all point and spot lights. The leaves store the index of the light in lights
+    HeBvh lightTree;
+    
+    // the indices of the instances that passed the last frustum culling, see heD3LevelCullInstances
+    std::vector<uint32_t>          visibleInstances;
+    // the particle sources that passed the last frustum culling. Sorted back to front when the level is rendered
+    std::vector<HeParticleSource*> visibleParticles;
+    // the merged static geometry of the level, see heD3LevelBuildStaticBatches
+    std::vector<HeD3StaticBatch>   staticBatches;
+    // the indices of the static batches that passed the last frustum culling
+    std::vector<uint32_t>          visibleBatches;
+    // the visible instances and batches in draw order, see heD3LevelBuildRenderQueue
+    HeD3RenderQueue                renderQueue;
+    // the lights of every cluster of the camera frustum, used in forward+ rendering
+    HeD3LightClusters              lightClusters;
+    // the cpu depth buffer that the occluders are rendered into, see heD3LevelCullOccluded
+    HeOcclusionBuffer              occlusion;
+    // the positions of all meshes that were used as occluders, read back once from the gpu
+    std::unordered_map<HeVao const*, std::vector<hm::vec3f>> occluderMeshes;
+    // the dirty instances (dense indices) grouped by their depth in the hierarchy, filled during
+    // heD3LevelUpdateTransforms
+    std::vector<std::vector<uint32_t>> dirtyInstances;
+    // increased whenever a static instance is moved or removed or the static batches change, so that cached shadow
+    // maps notice when they are out of date
+    uint32_t staticRevision = 0;
     
     double time   = 0.0;   // time of the level, increased everytime the frame is rendered. 
+    // whether visible instances and batches that are hidden behind occluders are culled as well. This pays off in
+    // dense (indoor) levels, open levels should leave this disabled
+    b8 occlusionCulling = false;
     b8 freeCamera = false; // only important when physics are used. If this is true (with physics), the cameras position will not be updated from the physics actor but can be moved around freely by simply modifying its position
 
     std::string name;
@@ -194,11 +474,16 @@ extern HeD3Level* heD3Level;
 
 // -- instance
 
-// updates all components of this instance
-extern HE_API void heD3InstanceUpdate(HeD3Instance* instance);
-// sets the new position of the entity. This should always be used over directly setting the instances position
-// as this will also update the components
-extern HE_API void heD3InstanceSetPosition(HeD3Instance* instance, hm::vec3f const& position);
+// picks the level of detail of the instance from the projected size of its world space bounds (center and half
+// size), seen from given camera position. projectionScale is the vertical scale of the projection matrix
+// (projectionMatrix[1][1]). An instance only switches once it is clearly past the screen size of a lod, so that it
+// does not flicker between two of them
+extern HE_API void heD3InstanceSelectLod(HeD3Instance* instance, hm::vec3f const& boundsCenter, hm::vec3f const& boundsExtent, hm::vec3f const& cameraPosition, float const projectionScale);
+// returns the mesh of the current level of detail of the instance
+extern HE_API inline HeVao* heD3InstanceGetMesh(HeD3Instance const* instance);
+// returns true if this instance never moves and can be merged into a static batch. That is the case if it has a
+// mesh and material, is not part of a hierarchy and has no physics body or a massless one
+extern HE_API b8 heD3InstanceIsStatic(HeD3Instance const* instance);
 
 
 // -- frustum
@@ -210,6 +495,11 @@ extern HE_API void heD3FrustumUpdate(HeD3Frustum* frustum, HeWindow* window, hm:
 // used when creating the projection matrix (clip / render distance). This will transform all corners with given
 // matrix which is useful if youre not working in world space (i.e. shadow box)
 extern HE_API void heD3FrustumUpdateWithMatrix(HeD3Frustum* frustum, HeWindow* window, hm::vec3f const& position, hm::vec3f const& rotation, hm::mat4f const& matrix);
+// extracts the clipping planes of the frustum from the combined projection * view matrix
+extern HE_API void heD3FrustumUpdatePlanes(HeD3Frustum* frustum, hm::mat4f const& viewProjection);
+// returns true if the given box (world space center and half size) is at least partially inside the frustum
+// planes. Boxes with a negative extent are always inside
+extern HE_API b8 heD3FrustumContainsBox(HeD3Frustum const* frustum, hm::vec3f const& center, hm::vec3f const& extent);
 
 
 // -- camera
@@ -236,26 +526,133 @@ extern HE_API HeD3LightSource* heD3LightSourceCreateSpot(HeD3Level* level, hm::v
 // the linear value controls the normal decay, can be around 0.045
 // the quadratic value controls the light in far distance, can be around 0.0075
 extern HE_API HeD3LightSource* heD3LightSourceCreatePoint(HeD3Level* level, hm::vec3f const& position, float const constLightValue, float const linearLightValue, float const quadraticLightValue, hm::colour const& colour);
-// sets up a shadow map. The resolution must already be set before this call
+// returns the distance at which the light of a point or spot light becomes negligible (below 1/256 of its
+// brightest channel). Returns a negative value for lights with unlimited range
+extern HE_API float heD3LightSourceGetRange(HeD3LightSource const* light);
+// returns true if given box (world space center and half size) is at least partially inside the volume lit by a
+// point light (the sphere of range) or a spot light (its outer cone, cut off at range)
+extern HE_API b8 heD3LightVolumeContainsBox(HeD3LightSource const* light, float const range, hm::vec3f const& center, hm::vec3f const& extent);
+// returns false if the shadow that given box casts away from the light can not reach the inside of the frustum, i.e.
+// if the box is outside of a plane and the light is on the inner side of it. direction is the normalized direction
+// of directional lights and unused for other lights
+extern HE_API b8 heD3ShadowReachesFrustum(HeD3Frustum const* frustum, HeD3LightSource const* light, hm::vec3f const& direction, hm::vec3f const& center, hm::vec3f const& extent);
+// sets up a shadow map. The resolution and cascade count must already be set before this call
 extern HE_API void heD3ShadowMapCreate(HeD3ShadowMap* shadowMap, HeD3LightSource* source);
+// fits the cascades of the shadow map of a directional light around the slices of the cameras frustum. The view
+// and projection matrix of the camera must be up to date
+extern HE_API void heD3ShadowMapUpdateCascades(HeD3ShadowMap* shadowMap, HeD3LightSource const* source, HeD3Camera const* camera);
+// returns the cascades (bit i for cascade i) whose static casters must be rendered into the cache again, because
+// the light, the cascade or the static geometry of the level changed since they were cached. The cache is marked as
+// up to date afterwards. The cascades must already be updated
+extern HE_API uint8_t heD3ShadowMapUpdateCache(HeD3ShadowMap* shadowMap, HeD3Level const* level);
 
 
 // -- level
 
+// adds a new default instance to the level and returns a pointer to it. The pointer is only valid until the next
+// instance is added or removed, the id of the new instance is stored in instance->id
+extern HE_API HeD3Instance* heD3LevelAddInstance(HeD3Level* level);
 // removes the HeD3Instance that instance points to from the level, if it does exist there and instance is a
-// valid pointer.
+// valid pointer. The last instance of the level is moved into its place
 extern HE_API void heD3LevelRemoveInstance(HeD3Level* level, HeD3Instance* instance);
-// updates all instances in given level (components). This should be called after the physics update (positions
-// will be updated) but before rendering
+// removes the instance with given id from the level. Does nothing if the id is no longer valid
+extern HE_API void heD3LevelRemoveInstanceById(HeD3Level* level, HeD3InstanceId const& id);
+// updates all components of the instance with given index in the level
+extern HE_API void heD3LevelUpdateInstance(HeD3Level* level, uint32_t const index);
+// sets the new position of the instance. This should always be used over directly setting the instances position
+// as this will also update the components
+extern HE_API void heD3LevelSetInstancePosition(HeD3Level* level, HeD3Instance* instance, hm::vec3f const& position);
+// sets the new rotation of the instance and marks the cached matrices as dirty
+extern HE_API void heD3LevelSetInstanceRotation(HeD3Level* level, HeD3Instance* instance, hm::quatf const& rotation);
+// sets the new scale of the instance and marks the cached matrices as dirty
+extern HE_API void heD3LevelSetInstanceScale(HeD3Level* level, HeD3Instance* instance, hm::vec3f const& scale);
+// rebuilds the world and normal matrix of the instance with given index if its transformation is dirty. This is
+// called by the renderer before an instance is drawn, so all passes of a frame share the same matrices. Use
+// heD3LevelUpdateBounds to update all instances, which also keeps the instance tree in sync. Instances with a
+// parent are only updated by heD3LevelUpdateTransforms
+extern HE_API void heD3LevelUpdateInstanceMatrices(HeD3Level* level, uint32_t const index);
+// updates the physics, all instances, particle sources and lights of the level. The physics are stepped on the
+// calling thread, the other phases run in parallel on the worker pool (if it was created). Each phase only writes
+// to the objects it updates, so the result does not depend on the number of threads
 extern HE_API void heD3LevelUpdate(HeD3Level* level, float const delta);
-// cleans up all instances and (if used) the physics of this level
+// cleans up all instances, static batches and (if used) the physics of this level
 extern HE_API void heD3LevelDestroy(HeD3Level* level);
-// returns the instance with given index from the list of instances in the level
-extern HE_API inline HeD3Instance* heD3LevelGetInstance(HeD3Level* level, uint16_t const index);
+// updates the matrices and bounds of all instances and moves the instances and lights that changed in the spatial
+// trees of the level. heD3LevelUpdate does the same in its phases, call this before culling after moving instances
+// outside of it
+extern HE_API void heD3LevelUpdateBounds(HeD3Level* level);
+// attaches an instance to parent, so that its transformation is relative to the world matrix of the parent from now
+// on. An invalid parent (i.e. HeD3InstanceId()) detaches the instance. The transformation itself is not changed.
+// Returns false if either id is invalid or the parent is the instance itself or one of its children
+extern HE_API b8 heD3LevelSetInstanceParent(HeD3Level* level, HeD3InstanceId const& instance, HeD3InstanceId const& parent);
+// rebuilds the world matrices of all dirty instances and their children, top down one depth level at a time. Only
+// dirty subtrees are touched, and large depth levels are split over the worker pool. Called by
+// heD3LevelUpdateBounds
+extern HE_API void heD3LevelUpdateTransforms(HeD3Level* level);
+// updates all particle sources of the level on the worker pool. Large sources are split into chunks of a fixed
+// size, which are simulated and written into the instance data in parallel. Only removing the dead particles and
+// emitting new ones (and the depth sort) is done once per source. The result does not depend on the number of
+// threads. Called by heD3LevelUpdate
+extern HE_API void heD3LevelUpdateParticles(HeD3Level* level, float const delta);
+// rebuilds the instance tree of the level from scratch with the surface area heuristic. This gives a better tree
+// than incremental inserts and should be done once static content is loaded
+extern HE_API void heD3LevelBuildTree(HeD3Level* level);
+// returns the instance whose bounding box is hit first by given ray, or nullptr if no box is hit. direction must be
+// normalized. If distance is not nullptr, the distance to the hit box is stored in there
+extern HE_API HeD3Instance* heD3LevelRaycastInstance(HeD3Level* level, hm::vec3f const& origin, hm::vec3f const& direction, float const maxDistance, float* distance);
+// culls all instances, static batches and particle sources of the level against the planes of given frustum and
+// stores the visible ones in visibleInstances, visibleBatches and visibleParticles. Batched instances are skipped.
+// This updates the matrices (and bounds) of all instances. Boxes are tested four at a time. Returns the number of
+// culled instances
+extern HE_API uint32_t heD3LevelCullInstances(HeD3Level* level, HeD3Frustum const* frustum);
+// removes all visible instances and batches that are hidden behind occluders from visibleInstances and
+// visibleBatches. Occluders are the visible instances marked as occluder and the meshes that cover the largest part
+// of the screen, which are rasterized into a small depth buffer on the worker pool. Must be called after
+// heD3LevelCullInstances. Returns the number of culled instances
+extern HE_API uint32_t heD3LevelCullOccluded(HeD3Level* level);
+// collects the instances and static batches that can cast a shadow of given light onto something in the camera
+// frustum into the casters of the lights shadow map. A caster must overlap the lights volume (the projection box of
+// the shadow map for directional lights, the cone for spot lights and the range for point lights) and its shadow
+// (the caster swept away from the light) must reach the camera frustum. For directional lights, the projection of
+// the shadow map must be up to date. Returns the number of instances and batches found
+extern HE_API uint32_t heD3LevelCullShadowCasters(HeD3Level* level, HeD3LightSource* light);
+// selects the level of detail of all visible instances for the levels camera, see heD3InstanceSelectLod
+extern HE_API void heD3LevelSelectLods(HeD3Level* level);
+// fills the render queue of the level with the visible instances (that have a material) and batches and sorts it
+// with a radix sort. Must be called after the culling and the lod selection, since the key depends on the mesh
+extern HE_API void heD3LevelBuildRenderQueue(HeD3Level* level);
+// destroys all static batches of the level, their instances are drawn on their own again
+extern HE_API void heD3LevelClearStaticBatches(HeD3Level* level);
+// returns the instance with given index from the dense array of instances in the level. Indices change when
+// instances are removed
+extern HE_API inline HeD3Instance* heD3LevelGetInstance(HeD3Level* level, uint32_t const index);
+// returns the instance in given slot of the level (i.e. a result of an instance tree query)
+extern HE_API inline HeD3Instance* heD3LevelGetInstanceFromSlot(HeD3Level* level, uint32_t const slot);
+// returns the instance with given id or nullptr if that instance was removed
+extern HE_API HeD3Instance* heD3LevelGetInstanceById(HeD3Level* level, HeD3InstanceId const& id);
+// returns the index of the instance in the dense array of instances in the level, which is also the index of its
+// matrices, bounds and flags
+extern HE_API uint32_t heD3LevelGetInstanceIndex(HeD3Level const* level, HeD3Instance const* instance);
 // returns the light source with given index from the list of lights in the level
 extern HE_API inline HeD3LightSource* heD3LevelGetLightSource(HeD3Level* level, uint16_t const index);
 
 
+// -- light clusters
+
+// rebuilds the view space bounds of all clusters if the projection, the planes or the grid size changed since the
+// last call. projectionMatrix must be a symmetric perspective projection
+extern HE_API void heD3LightClustersUpdateGrid(HeD3LightClusters* clusters, hm::mat4f const& projectionMatrix, float const nearPlane, float const farPlane);
+// assigns all active lights of the level to the clusters that their range overlaps, using the view space of given
+// view matrix. Lights without a limited range (directional) are put into every cluster. The grid must be up to
+// date. The z slices are binned in parallel on the worker pool. Returns the total number of light indices
+extern HE_API uint32_t heD3LightClustersBuild(HeD3LightClusters* clusters, HeD3Level const* level, hm::mat4f const& viewMatrix);
+// returns the index of the cluster that given view space position falls into, the same way the shaders do.
+// Positions closer than the near plane or behind the camera fall into the first slice
+extern HE_API uint32_t heD3LightClustersGetIndex(HeD3LightClusters const* clusters, hm::vec3f const& viewPosition);
+// updates the grid and the lights of the clusters of the level from its camera
+extern HE_API void heD3LevelUpdateLightClusters(HeD3Level* level);
+
+
 // -- skybox
 
 // loads a skybox from given hdr image. This will unmap the equirectangular image onto a cube map and also create
@@ -274,11 +671,19 @@ extern HE_API void heD3SkyboxLoad(HeD3Skybox* skybox, std::string const& fileNam
 extern HE_API void heParticleSourceCreate(HeParticleSource* source, HeD3Transformation const& transformation, HeSpriteAtlas* atlas, uint32_t const atlasIndex, uint32_t const particleCount);
 // destroys the given particle source and frees all associated data
 extern HE_API void heParticleSourceDestroy(HeParticleSource* source);
-// assigns new data to the particle. The position will be in the emitter (bounding box dependant of type), the
-// velocity will be set and a random colour is generated
-extern HE_API void heParticleSourceSpawnParticle(HeParticleEmitter* source, HeParticle* particle);
-// updates the particle source by updating the position of the particles (velocity, gravity) and spawning new
-// particles for the dead ones
+// assigns new data to the particle with given index. The position will be in the emitter (bounding box dependant of
+// type), the velocity will be set and a random colour is generated
+extern HE_API void heParticleSourceSpawnParticle(HeParticleSource* source, uint32_t const index);
+// spawns up to count new particles at once (i.e. for an explosion), as far as the pool has room for them. Returns
+// the number of spawned particles
+extern HE_API uint32_t heParticleSourceEmitBurst(HeParticleSource* source, uint32_t const count);
+// sorts the living particles back to front by their depth in the given view matrix into the draw order of the
+// source. If the particles did not move much relative to each other, the order of the last sort is repaired with an
+// insertion sort, otherwise it is rebuilt with a radix sort. Called by the update if depthSort is set
+extern HE_API void heParticleSourceSortByDepth(HeParticleSource* source, hm::mat4f const& viewMatrix);
+// updates the particle source by updating the position of the living particles (velocity, gravity), removing the
+// dead ones and emitting new particles. Particles are moved four at a time and their instance data is rebuilt. This
+// runs on the calling thread, see heD3LevelUpdateParticles for updating all sources in parallel
 extern HE_API void heParticleSourceUpdate(HeParticleSource* source, float const delta, HeD3Level* level);
 
 #endif
@@ -489,6 +489,22 @@ void heProfilerAddEntry(std::string const& name, double const duration) {
     heProfilerAddEntry(name, duration, c);
 };
 
+void heProfilerAddCounter(std::string const& name, uint64_t const value) {
+    for(uint32_t i = 0; i < heProfiler.counterOffset; ++i) {
+        if(heProfiler.counters[i].name == name) {
+            heProfiler.counters[i].value += value;
+            return;
+        }
+    }
+
+    if(heProfiler.counterOffset == 16)
+        return;
+
+    HeProfiler::HeProfilerCounter* counter = &heProfiler.counters[heProfiler.counterOffset++];
+    counter->name  = name;
+    counter->value = value;
+};
+
 void heProfilerRender(HeRenderEngine* engine) { 
     if(heProfiler.displayed) {
         // render profiler  
@@ -526,6 +542,13 @@ void heProfilerRender(HeRenderEngine* engine) {
         // draw frame time
         heUiRenderText(engine, &heProfiler.font, "Frame: " + std::to_string((int) (1. / engine->window->frameTime)) + " (" + std::to_string(engine->window->frameTime) + ")", hm::vec2f(10, yoffset), hm::colour(255));
 
+        // draw counters
+        for(uint32_t i = 0; i < heProfiler.counterOffset; ++i) {
+            yoffset -= 15;
+            heUiRenderText(engine, &heProfiler.font, heProfiler.counters[i].name + ":", hm::vec2f(10 + colourQuadSize.x + 5, yoffset), hm::colour(255));
+            heUiRenderText(engine, &heProfiler.font, std::to_string(heProfiler.counters[i].value), hm::vec2f(10 + colourQuadSize.x + 155, yoffset), hm::colour(255), HE_TEXT_ALIGN_RIGHT);
+        }
+
         // draw sleep time
         float remaining = (MAX_WIDTH * engine->window->windowInfo.size.x) - xoffset;
         if(remaining > 0.f)
@@ -534,19 +557,20 @@ void heProfilerRender(HeRenderEngine* engine) {
 };
 
 void heProfilerFrameStart() {
-    heProfiler.currentMark = heWin32TimeGet();
-    heProfiler.entryOffset = 0;
+    heProfiler.currentMark   = heWin32TimeGet();
+    heProfiler.entryOffset   = 0;
+    heProfiler.counterOffset = 0;
 };
 
 void heProfilerFrameMark(std::string const& name, hm::colour const& colour) {
-    __int64 now = heWin32TimeGet();
+    int64_t now = heWin32TimeGet();
     double duration = heWin32TimeCalculateMs(now - heProfiler.currentMark);
     heProfiler.currentMark = now;
     heProfilerAddEntry(name, duration, colour);
 };
 
 void heProfilerFrameMark(std::string const& name) {
-    __int64 now = heWin32TimeGet();
+    int64_t now = heWin32TimeGet();
     double duration = heWin32TimeCalculateMs(now - heProfiler.currentMark);
     heProfiler.currentMark = now;
     heProfilerAddEntry(name, duration);
@@ -28,10 +28,18 @@ struct HeProfiler {
             name(name), duration(duration), colour(colour) {};
     };
     
-    __int64 currentMark = 0; // marks a time stamp
+    // a named number that is collected over one frame, i.e. how many instances were culled
+    struct HeProfilerCounter {
+        std::string name;
+        uint64_t    value = 0;
+    };
+    
+    int64_t currentMark = 0; // marks a time stamp
     uint32_t entryOffset = 0;
+    uint32_t counterOffset = 0;
     b8 displayed = false;
     HeProfilerEntry entries[20];
+    HeProfilerCounter counters[16];
     HeScaledFont font;
 };
 
@@ -114,6 +122,8 @@ extern HE_API inline void heProfilerCreate(HeFont const* font);
 extern HE_API inline void heProfilerAddEntry(std::string const& name, double duration, hm::colour const& colour);
 // adds a new entry with a random colour
 extern HE_API inline void heProfilerAddEntry(std::string const& name, double duration);
+// adds value to the counter with given name for this frame. The counter is created if it doesnt exist yet
+extern HE_API void heProfilerAddCounter(std::string const& name, uint64_t const value);
 // starts a new profiler frame by resetting the recorded entries and the time mark
 extern HE_API inline void heProfilerFrameStart();
 // marks a new profiler. This should be called after the frame step was completed
@@ -19,6 +19,238 @@
 #pragma warning(pop)
 
 float maxAnisotropicValue = -1.f;
+HeGlState heGlState;
+
+
+// -- gl state
+
+void heGlStateInvalidate() {
+    b8 validate           = heGlState.validate;
+    uint64_t issuedCalls  = heGlState.issuedCalls;
+    uint64_t skippedCalls = heGlState.skippedCalls;
+    heGlState              = HeGlState();
+    heGlState.validate     = validate;
+    heGlState.issuedCalls  = issuedCalls;
+    heGlState.skippedCalls = skippedCalls;
+};
+
+void heGlStateFlushCounters() {
+    heProfilerAddCounter("gl calls issued",  heGlState.issuedCalls);
+    heProfilerAddCounter("gl calls skipped", heGlState.skippedCalls);
+    heGlState.issuedCalls  = 0;
+    heGlState.skippedCalls = 0;
+};
+
+// compares a cached value to the real gl state (queried with glGetIntegerv) and warns if they differ
+void heGlStateValidate(uint32_t const parameter, uint32_t const cached, std::string const& name) {
+    int32_t actual = 0;
+    glGetIntegerv(parameter, &actual);
+    if((uint32_t) actual != cached)
+        HE_WARNING("Gl state cache is out of sync: " + name + " is " + std::to_string(actual) + " but cached as " + std::to_string(cached));
+};
+
+// returns true (and counts the skipped call) if the cached value already is the wanted one
+b8 heGlStateMatches(uint32_t const cached, uint32_t const wanted) {
+    if(cached == wanted) {
+        heGlState.skippedCalls++;
+        return true;
+    }
+
+    heGlState.issuedCalls++;
+    return false;
+};
+
+void heGlUseProgram(uint32_t const program) {
+    if(heGlStateMatches(heGlState.program, program)) {
+        if(heGlState.validate)
+            heGlStateValidate(GL_CURRENT_PROGRAM, program, "program");
+        return;
+    }
+
+    glUseProgram(program);
+    heGlState.program = program;
+};
+
+// returns true if the vao was bound, false if it already was
+b8 heGlBindVertexArray(uint32_t const vao) {
+    if(heGlStateMatches(heGlState.vao, vao)) {
+        if(heGlState.validate)
+            heGlStateValidate(GL_VERTEX_ARRAY_BINDING, vao, "vao");
+        return false;
+    }
+
+    glBindVertexArray(vao);
+    heGlState.vao = vao;
+    return true;
+};
+
+// binds the fbo to the draw and read target (GL_FRAMEBUFFER) or just one of them. Returns true if the fbo was bound,
+// false if it already was
+b8 heGlBindFramebuffer(uint32_t const target, uint32_t const fbo) {
+    b8 draw = target != GL_READ_FRAMEBUFFER && heGlState.drawFbo != fbo;
+    b8 read = target != GL_DRAW_FRAMEBUFFER && heGlState.readFbo != fbo;
+    if(!draw && !read) {
+        heGlState.skippedCalls++;
+        if(heGlState.validate) {
+            if(target != GL_READ_FRAMEBUFFER)
+                heGlStateValidate(GL_DRAW_FRAMEBUFFER_BINDING, fbo, "draw fbo");
+            if(target != GL_DRAW_FRAMEBUFFER)
+                heGlStateValidate(GL_READ_FRAMEBUFFER_BINDING, fbo, "read fbo");
+        }
+        return false;
+    }
+
+    glBindFramebuffer((draw && read) ? GL_FRAMEBUFFER : (draw ? GL_DRAW_FRAMEBUFFER : GL_READ_FRAMEBUFFER), fbo);
+    heGlState.issuedCalls++;
+    if(draw)
+        heGlState.drawFbo = fbo;
+    if(read)
+        heGlState.readFbo = fbo;
+    return true;
+};
+
+void heGlViewport(int32_t const x, int32_t const y, int32_t const width, int32_t const height) {
+    int32_t* viewport = heGlState.viewport;
+    if(viewport[0] == x && viewport[1] == y && viewport[2] == width && viewport[3] == height) {
+        heGlState.skippedCalls++;
+        if(heGlState.validate) {
+            int32_t actual[4];
+            glGetIntegerv(GL_VIEWPORT, actual);
+            if(memcmp(actual, viewport, sizeof(actual)) != 0)
+                HE_WARNING("Gl state cache is out of sync: viewport");
+        }
+        return;
+    }
+
+    glViewport(x, y, width, height);
+    heGlState.issuedCalls++;
+    viewport[0] = x;
+    viewport[1] = y;
+    viewport[2] = width;
+    viewport[3] = height;
+};
+
+void heGlActiveTexture(uint32_t const unit) {
+    if(heGlStateMatches(heGlState.activeUnit, unit)) {
+        if(heGlState.validate)
+            heGlStateValidate(GL_ACTIVE_TEXTURE, GL_TEXTURE0 + unit, "active texture");
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    heGlState.activeUnit = unit;
+};
+
+// returns the query for the texture bound to given target of the active unit
+uint32_t heGlTextureBindingQuery(uint32_t const target) {
+    switch(target) {
+    case GL_TEXTURE_CUBE_MAP:
+        return GL_TEXTURE_BINDING_CUBE_MAP;
+    case GL_TEXTURE_BUFFER:
+        return GL_TEXTURE_BINDING_BUFFER;
+    case GL_TEXTURE_2D_MULTISAMPLE:
+        return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+    default:
+        return GL_TEXTURE_BINDING_2D;
+    }
+};
+
+// binds the texture to target of the given unit. A target of 0 unbinds the 2d and the cube map target of the unit
+void heGlBindTexture(uint32_t const unit, uint32_t const target, uint32_t const texture) {
+    // samplers that were not found in the shader have a slot of -1, binding to it would only replace the texture of
+    // the active unit
+    if(unit == HeGlState::UNKNOWN) {
+        heGlState.skippedCalls++;
+        return;
+    }
+
+    heGlActiveTexture(unit);
+    if(unit < HeGlState::MAX_TEXTURE_UNITS && heGlState.textureTargets[unit] == target && heGlState.textures[unit] == texture) {
+        heGlState.skippedCalls++;
+        if(heGlState.validate && target != 0)
+            heGlStateValidate(heGlTextureBindingQuery(target), texture, "texture (unit " + std::to_string(unit) + ")");
+        return;
+    }
+
+    if(target == 0) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    } else
+        glBindTexture(target, texture);
+
+    heGlState.issuedCalls++;
+    if(unit < HeGlState::MAX_TEXTURE_UNITS) {
+        heGlState.textureTargets[unit] = target;
+        heGlState.textures[unit]       = texture;
+    }
+};
+
+// binds the texture to target of the active unit (or unit 0 if that is not known), i.e. for uploading data
+void heGlBindTexture(uint32_t const target, uint32_t const texture) {
+    heGlBindTexture((heGlState.activeUnit == HeGlState::UNKNOWN) ? 0 : heGlState.activeUnit, target, texture);
+};
+
+// deletes the texture and forgets it everywhere it is cached. Deleted textures are unbound by gl and their name may
+// be reused
+void heGlDeleteTexture(uint32_t const* texture) {
+    for(uint32_t i = 0; i < HeGlState::MAX_TEXTURE_UNITS; ++i) {
+        if(heGlState.textures[i] == *texture) {
+            heGlState.textureTargets[i] = HeGlState::UNKNOWN;
+            heGlState.textures[i]       = HeGlState::UNKNOWN;
+        }
+    }
+
+    glDeleteTextures(1, texture);
+};
+
+void heGlBindUniformBuffer(uint32_t const location, uint32_t const buffer) {
+    if(location < HeGlState::MAX_UBO_BINDINGS && heGlState.ubos[location] == buffer) {
+        heGlState.skippedCalls++;
+        if(heGlState.validate) {
+            int32_t actual = 0;
+            glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, location, &actual);
+            if((uint32_t) actual != buffer)
+                HE_WARNING("Gl state cache is out of sync: ubo binding " + std::to_string(location));
+        }
+        return;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, location, buffer);
+    heGlState.issuedCalls++;
+    if(location < HeGlState::MAX_UBO_BINDINGS)
+        heGlState.ubos[location] = buffer;
+};
+
+// enables or disables a capability that is cached in state
+void heGlSetCapability(uint32_t const capability, uint32_t* state, b8 const enabled) {
+    if(heGlStateMatches(*state, enabled)) {
+        if(heGlState.validate && (b8) glIsEnabled(capability) != enabled)
+            HE_WARNING("Gl state cache is out of sync: capability " + std::to_string(capability));
+        return;
+    }
+
+    if(enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+    *state = enabled;
+};
+
+void heGlBlendFunc(uint32_t const source, uint32_t const destination) {
+    if(heGlState.blendSource == source && heGlState.blendDestination == destination) {
+        heGlState.skippedCalls++;
+        if(heGlState.validate) {
+            heGlStateValidate(GL_BLEND_SRC_RGB, source, "blend source");
+            heGlStateValidate(GL_BLEND_DST_RGB, destination, "blend destination");
+        }
+        return;
+    }
+
+    glBlendFunc(source, destination);
+    heGlState.issuedCalls++;
+    heGlState.blendSource      = source;
+    heGlState.blendDestination = destination;
+};
 
 
 // -- ubos
@@ -59,11 +291,14 @@ void heUboUpdateData(HeUbo* ubo, uint32_t const offset, uint32_t const size, voi
 };
 
 void heUboBind(HeUbo const* ubo, uint32_t const location) {
-    glBindBufferBase(GL_UNIFORM_BUFFER, location, ubo->uboId);
+    heGlBindUniformBuffer(location, ubo->uboId);
 };
 
 void heUboDestroy(HeUbo* ubo) {
     free(ubo->buffer);
+    for(uint32_t i = 0; i < HeGlState::MAX_UBO_BINDINGS; ++i)
+        if(heGlState.ubos[i] == ubo->uboId)
+            heGlState.ubos[i] = HeGlState::UNKNOWN;
     glDeleteBuffers(1, &ubo->uboId);
     ubo->uboId     = 0;
     ubo->totalSize = 0;
@@ -72,6 +307,40 @@ void heUboDestroy(HeUbo* ubo) {
 };
 
 
+// --- Texture buffers
+
+void heTextureBufferCreate(HeTextureBuffer* buffer, HeColourFormat const format) {
+    buffer->format = format;
+    buffer->size   = 0;
+    glGenBuffers(1, &buffer->bufferId);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->bufferId);
+    glBufferData(GL_TEXTURE_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+
+    glGenTextures(1, &buffer->textureId);
+    heGlBindTexture(GL_TEXTURE_BUFFER, buffer->textureId);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer->bufferId);
+    heGlBindTexture(GL_TEXTURE_BUFFER, 0);
+};
+
+void heTextureBufferUpdate(HeTextureBuffer* buffer, void const* data, uint32_t const size) {
+    buffer->size = size;
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer->bufferId);
+    glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+};
+
+void heTextureBufferBind(HeTextureBuffer const* buffer, int8_t const slot) {
+    heGlBindTexture(slot, GL_TEXTURE_BUFFER, buffer->textureId);
+};
+
+void heTextureBufferDestroy(HeTextureBuffer* buffer) {
+    heGlDeleteTexture(&buffer->textureId);
+    glDeleteBuffers(1, &buffer->bufferId);
+    buffer->textureId = 0;
+    buffer->bufferId  = 0;
+    buffer->size      = 0;
+};
+
+
 // --- Shaders
 
 std::string heShaderLoadSource(std::string const& file, std::unordered_map<std::string, uint32_t>& includeFiles);
@@ -186,6 +455,48 @@ uint32_t heShaderLoadFromFile(std::string const& file, uint32_t type, std::unord
 };
 
 
+// the interned uniform names indexed by their id, and the ids of all names
+std::vector<std::string> uniformNames;
+std::unordered_map<std::string, HeUniformId> uniformIds;
+
+// fills the location tables of the program with all its active uniforms, so that uniforms loaded by id need no
+// string lookups later
+void heShaderResolveUniforms(HeShaderProgram* program) {
+    program->uniformLocations.assign(uniformNames.size(), -2);
+    program->samplerSlots.assign(uniformNames.size(), -2);
+
+    int32_t uniformCount = 0;
+    glGetProgramInterfaceiv(program->programId, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+    GLenum const properties[2] = { GL_NAME_LENGTH, GL_LOCATION };
+    std::vector<GLchar> nameData;
+    for(int32_t i = 0; i < uniformCount; ++i) {
+        GLint values[2];
+        glGetProgramResourceiv(program->programId, GL_UNIFORM, i, 2, properties, 2, NULL, values);
+        if(values[1] == -1)
+            continue; // part of a uniform block
+
+        nameData.resize(values[0]); // length of the name
+        glGetProgramResourceName(program->programId, GL_UNIFORM, i, (GLsizei) nameData.size(), NULL, &nameData[0]);
+        std::string name((char*) &nameData[0], nameData.size() - 1);
+        program->uniforms[name] = values[1];
+        HeUniformId id = heShaderGetUniformId(name);
+        if(id >= program->uniformLocations.size())
+            program->uniformLocations.resize(id + 1, -2);
+        program->uniformLocations[id] = values[1];
+
+        // arrays are named with their first element, but usually loaded by their name
+        if(name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            name.resize(name.size() - 3);
+            program->uniforms[name] = values[1];
+            id = heShaderGetUniformId(name);
+            if(id >= program->uniformLocations.size())
+                program->uniformLocations.resize(id + 1, -2);
+            program->uniformLocations[id] = values[1];
+        }
+    }
+};
+
 void heShaderCompileProgram(HeShaderProgram* program) {
     glLinkProgram(program->programId);
     
@@ -197,9 +508,10 @@ void heShaderCompileProgram(HeShaderProgram* program) {
         glGetProgramInfoLog(program->programId, 512, NULL, infoLog);
         HE_ERROR("Unable to link shader program:\n" + std::string(infoLog));
         program->programId = 0;
-    }
+    } else
+        heShaderResolveUniforms(program);
     
-    glUseProgram(program->programId);
+    heGlUseProgram(program->programId);
 };
 
 void heShaderLoadCompute(HeShaderProgram* program, std::string const& computeShader) {
@@ -336,21 +648,25 @@ void heShaderCreateProgram(HeShaderProgram* program, std::string const& file) {
 
 void heShaderBind(HeShaderProgram* program) {
     heShaderCheckReload(program);
-    glUseProgram(program->programId);
+    heGlUseProgram(program->programId);
 };
 
 void heShaderUnbind() {
-    glUseProgram(0);
+    heGlUseProgram(0);
 };
 
 void heShaderDestroy(HeShaderProgram* program) {
     if(program == nullptr)
         return;
 
+    if(heGlState.program == program->programId)
+        heGlState.program = HeGlState::UNKNOWN;
     glDeleteProgram(program->programId);
     program->programId = 0;
     program->uniforms.clear();
     program->samplers.clear();
+    program->uniformLocations.clear();
+    program->samplerSlots.clear();
 };
 
 void heShaderRunCompute(HeShaderProgram* program, uint32_t const groupsX, uint32_t const groupsY, uint32_t const groupsZ) {
@@ -535,6 +851,48 @@ int32_t heShaderGetSamplerLocation(HeShaderProgram* program, std::string const&
     return location;
 };
 
+HeUniformId heShaderGetUniformId(std::string const& name) {
+    auto it = uniformIds.find(name);
+    if(it != uniformIds.end())
+        return it->second;
+
+    HeUniformId id = (HeUniformId) uniformNames.size();
+    uniformNames.emplace_back(name);
+    uniformIds[name] = id;
+    return id;
+};
+
+std::string const& heShaderGetUniformName(HeUniformId const uniform) {
+    return uniformNames[uniform];
+};
+
+int32_t heShaderGetUniformLocation(HeShaderProgram* program, HeUniformId const uniform) {
+    if(uniform >= program->uniformLocations.size())
+        program->uniformLocations.resize(uniform + 1, -2);
+
+    int32_t location = program->uniformLocations[uniform];
+    if(location == -2) {
+        // not an active uniform of the shader (or interned after it was linked)
+        location = heShaderGetUniformLocation(program, uniformNames[uniform]);
+        program->uniformLocations[uniform] = location;
+    }
+
+    return location;
+};
+
+int32_t heShaderGetSamplerLocation(HeShaderProgram* program, HeUniformId const sampler, int8_t const requestedSlot) {
+    if(sampler >= program->samplerSlots.size())
+        program->samplerSlots.resize(sampler + 1, -2);
+
+    int32_t slot = program->samplerSlots[sampler];
+    if(slot == -2) {
+        slot = heShaderGetSamplerLocation(program, uniformNames[sampler], requestedSlot);
+        program->samplerSlots[sampler] = slot;
+    }
+
+    return slot;
+};
+
 void heShaderClearSamplers(HeShaderProgram const* program) {
     for(auto const& all : program->samplers)
         heTextureBind(nullptr, all.second);
@@ -642,6 +1000,66 @@ void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformNam
     };
 };
 
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, float const value) {
+    glUniform1f(heShaderGetUniformLocation(program, uniform), value);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, double const value) {
+    glUniform1d(heShaderGetUniformLocation(program, uniform), value);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, int32_t const value) {
+    glUniform1i(heShaderGetUniformLocation(program, uniform), value);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, uint32_t const value) {
+    glUniform1i(heShaderGetUniformLocation(program, uniform), value);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::mat3f const& value) {
+    glUniformMatrix3fv(heShaderGetUniformLocation(program, uniform), 1, false, &value[0][0]);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::mat4f const& value) {
+    glUniformMatrix4fv(heShaderGetUniformLocation(program, uniform), 1, false, &value[0][0]);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec2f const& value) {
+    glUniform2f(heShaderGetUniformLocation(program, uniform), value.x, value.y);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec3f const& value) {
+    glUniform3f(heShaderGetUniformLocation(program, uniform), value.x, value.y, value.z);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec4f const& value) {
+    glUniform4f(heShaderGetUniformLocation(program, uniform), value.x, value.y, value.z, value.w);
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::colour const& value) {
+    glUniform4f(heShaderGetUniformLocation(program, uniform), getR(&value), getG(&value), getB(&value), getA(&value));
+};
+
+void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, HeShaderData const* data) {
+    switch (data->type) {
+    case HE_DATA_TYPE_INT:
+        heShaderLoadUniform(program, uniform, data->_int);
+        break;
+        
+    case HE_DATA_TYPE_FLOAT:
+        heShaderLoadUniform(program, uniform, data->_float);
+        break;
+        
+    case HE_DATA_TYPE_VEC2:
+        heShaderLoadUniform(program, uniform, data->_vec2);
+        break;
+        
+    case HE_DATA_TYPE_COLOUR:
+        heShaderLoadUniform(program, uniform, data->_colour);
+        break;
+    };
+};
+
 
 // --- Buffers
 
@@ -710,6 +1128,17 @@ void heVboDestroy(HeVbo* vbo) {
     vbo->memory        = 0;
 };
 
+void heVboGetData(HeVbo const* vbo, std::vector<float>* data) {
+    if(!vbo->dataf.empty()) {
+        *data = vbo->dataf;
+        return;
+    }
+
+    data->resize((size_t) vbo->verticesCount * vbo->dimensions);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo->vboId);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, data->size() * sizeof(float), data->data());
+};
+
 void heVaoCreate(HeVao* vao, HeVaoType const type) {
     HE_CRASH_LOG();
     glGenVertexArrays(1, &vao->vaoId);
@@ -718,13 +1147,19 @@ void heVaoCreate(HeVao* vao, HeVaoType const type) {
     vao->vbos.clear();
     
 #ifdef HE_ENABLE_NAMES
-    glBindVertexArray(vao->vaoId); // we have to bind it so that its valid for naming
+    heGlBindVertexArray(vao->vaoId); // we have to bind it so that its valid for naming
     if(!vao->name.empty())
         glObjectLabel(GL_VERTEX_ARRAY, vao->vaoId, -1, vao->name.c_str());
-    glBindVertexArray(0);
+    heGlBindVertexArray(0);
 #endif
 };
 
+// enables the attributes of the vao, which must be bound
+void heVaoEnableAttributes(HeVao const* vao) {
+    for (uint32_t i = 0; i < (uint32_t) vao->attributeCount; ++i)
+        glEnableVertexAttribArray(i);
+};
+
 void heVaoAddVboData(HeVao* vao, HeVbo* vbo, int8_t const attributeIndex) {
     HE_CRASH_LOG();
     if(vbo->type == HE_DATA_TYPE_FLOAT) {
@@ -745,6 +1180,7 @@ void heVaoAddVboData(HeVao* vao, HeVbo* vbo, int8_t const attributeIndex) {
     }
 
     ++vao->attributeCount;
+    heVaoEnableAttributes(vao);
     
 #ifdef HE_ENABLE_NAMES
     int32_t currentVao;
@@ -769,6 +1205,7 @@ void heVaoAddVbo(HeVao* vao, HeVbo* vbo) {
         vao->verticesCount = vbo->verticesCount;
 
     ++vao->attributeCount;
+    heVaoEnableAttributes(vao);
     
 #ifdef HE_ENABLE_NAMES
     std::string name = vao->name + "[" + std::to_string(vao->vbos.size()) + "]";
@@ -839,6 +1276,7 @@ void heVaoAllocateInstancedAttribute(HeVao* vao, uint32_t const attributeIndex,
     glVertexAttribDivisor(attributeIndex, 1);
     if(attributeIndex + 1 > vao->attributeCount)
         vao->attributeCount = attributeIndex + 1;
+    heVaoEnableAttributes(vao);
 };
 
 void heVaoUpdateData(HeVao* vao, std::vector<float> const& data, uint8_t const vboIndex) {
@@ -947,16 +1385,16 @@ void heVaoUpdateDataUint(HeVao* vao, uint32_t const* data, uint8_t const vboInde
 
 void heVaoBind(HeVao const* vao) {
     HE_CRASH_LOG();
-    glBindVertexArray(vao->vaoId);
-    for (uint32_t i = 0; i < (uint32_t)vao->attributeCount; ++i)
-        glEnableVertexAttribArray(i);
+    // the enabled attributes are part of the vao, they are enabled when attributes are added as well
+    if(heGlBindVertexArray(vao->vaoId))
+        heVaoEnableAttributes(vao);
 };
 
 void heVaoUnbind(HeVao const* vao) {
     HE_CRASH_LOG();
     for (uint32_t i = 0; i < (uint32_t) vao->vbos.size(); ++i)
         glDisableVertexAttribArray(i);
-    glBindVertexArray(0);
+    heGlBindVertexArray(0);
 };
 
 void heVaoDestroy(HeVao* vao) {
@@ -964,10 +1402,13 @@ void heVaoDestroy(HeVao* vao) {
     for (HeVbo& vbos : vao->vbos)
         heVboDestroy(&vbos);
     
+    if(heGlState.vao == vao->vaoId)
+        heGlState.vao = 0;
     glDeleteVertexArrays(1, &vao->vaoId);
     vao->vaoId = 0;
     vao->verticesCount = 0;
     vao->vbos.clear();
+    vao->lods.clear();
     std::vector<HeVbo>().swap(vao->vbos);
     vao->type = HE_VAO_TYPE_NONE;
     
@@ -990,6 +1431,10 @@ void heVaoRenderInstanced(HeVao const* vao, uint32_t const count) {
 void heFboCreate(HeFbo* fbo) {
     glGenFramebuffers(1, &fbo->fboId);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo->fboId);
+    // the attachments are not created yet, so the next heFboBind must bind the fbo again to set its draw buffers
+    heGlState.drawFbo = HeGlState::UNKNOWN;
+    heGlState.readFbo = HeGlState::UNKNOWN;
+    heGlState.issuedCalls++;
     
 #ifdef HE_ENABLE_NAMES
     glObjectLabel(GL_FRAMEBUFFER, fbo->fboId, (uint32_t) fbo->name.size(), fbo->name.c_str());
@@ -1014,7 +1459,7 @@ void heFboCreateColourTextureAttachment(HeFbo* fbo, HeColourFormat const format,
         attachment->size = size;
 
     glGenTextures(1, &attachment->id);
-    glBindTexture(GL_TEXTURE_2D, attachment->id);
+    heGlBindTexture(GL_TEXTURE_2D, attachment->id);
     glTexImage2D(GL_TEXTURE_2D, 0, format, attachment->size.x, attachment->size.y, 0, f, GL_FLOAT, 0);
     if(mipCount == 0) {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -1114,7 +1559,7 @@ void heFboCreateDepthTextureAttachment(HeFbo* fbo) {
     fbo->depthAttachment.samples = 1;
     
     glGenTextures(1, &fbo->depthAttachment.id);
-    glBindTexture(GL_TEXTURE_2D, fbo->depthAttachment.id);
+    heGlBindTexture(GL_TEXTURE_2D, fbo->depthAttachment.id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, fbo->depthAttachment.size.x, fbo->depthAttachment.size.y, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -1133,39 +1578,45 @@ void heFboCreateDepthTextureAttachment(HeFbo* fbo) {
 };
 
 void heFboBind(HeFbo* fbo) {
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo->fboId);
-    glViewport(0, 0, fbo->size.x, fbo->size.y);
+    b8 bound = heGlBindFramebuffer(GL_FRAMEBUFFER, fbo->fboId);
+    heGlViewport(0, 0, fbo->size.x, fbo->size.y);
     
     if (fbo->useMultisampling)
-        glEnable(GL_MULTISAMPLE);
+        heGlSetCapability(GL_MULTISAMPLE, &heGlState.multisample, true);
     
-    // enable draw buffers
-    int8_t count = (int8_t) fbo->colourAttachments.size();
-    std::vector<uint32_t> drawBuffers;
-    for (int8_t i = 0; i < count; ++i)
-        drawBuffers.emplace_back(GL_COLOR_ATTACHMENT0 + i);
+    // enable draw buffers. They are part of the fbo, so they only have to be set when it was not bound yet
+    if (bound) {
+        int8_t count = (int8_t) fbo->colourAttachments.size();
+        uint32_t drawBuffers[32];
+        for (int8_t i = 0; i < count; ++i)
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
     
-    glDrawBuffers(count, drawBuffers.data());
+        glDrawBuffers(count, drawBuffers);
+    }
 };
 
 void heFboUnbind(hm::vec2i const& windowSize) {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, windowSize.x, windowSize.y);
+    heGlBindFramebuffer(GL_FRAMEBUFFER, 0);
+    heGlViewport(0, 0, windowSize.x, windowSize.y);
 };
 
 void heFboUnbind() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    heGlBindFramebuffer(GL_FRAMEBUFFER, 0);
 };
 
 void heFboDestroy(HeFbo* fbo) {
     for(auto& all : fbo->colourAttachments) {
         heMemoryTracker[HE_MEMORY_TYPE_FBO] -= all.memory;
         if(all.texture)
-            glDeleteTextures(1, &all.id);
+            heGlDeleteTexture(&all.id);
         else
             glDeleteRenderbuffers(1, &all.id);
         all.id = 0;
     }
+    if(heGlState.drawFbo == fbo->fboId)
+        heGlState.drawFbo = 0;
+    if(heGlState.readFbo == fbo->fboId)
+        heGlState.readFbo = 0;
     glDeleteFramebuffers(1, &fbo->fboId);
     fbo->fboId = 0;
 };
@@ -1177,7 +1628,7 @@ void heFboResize(HeFbo* fbo, hm::vec2i const& newSize) {
     if(fbo->depthAttachment.id > 0) {
         heMemoryTracker[HE_MEMORY_TYPE_FBO] -= fbo->depthAttachment.memory;
         if(fbo->depthAttachment.texture)
-            glDeleteTextures(1, &fbo->depthAttachment.id);
+            heGlDeleteTexture(&fbo->depthAttachment.id);
         else {
             glDeleteRenderbuffers(1, &fbo->depthAttachment.id);
             samples = fbo->depthAttachment.samples;
@@ -1189,11 +1640,15 @@ void heFboResize(HeFbo* fbo, hm::vec2i const& newSize) {
     for(auto& all : fbo->colourAttachments) {
         heMemoryTracker[HE_MEMORY_TYPE_FBO] -= all.memory;
         if(all.texture)
-            glDeleteTextures(1, &all.id);
+            heGlDeleteTexture(&all.id);
         else
             glDeleteRenderbuffers(1, &all.id);
         all.id = 0;
     }
+    if(heGlState.drawFbo == fbo->fboId)
+        heGlState.drawFbo = 0;
+    if(heGlState.readFbo == fbo->fboId)
+        heGlState.readFbo = 0;
     glDeleteFramebuffers(1, &fbo->fboId);
     
     hm::vec2f scaleFactor = hm::vec2f(newSize) / fbo->size;
@@ -1220,8 +1675,8 @@ void heFboResize(HeFbo* fbo, hm::vec2i const& newSize) {
 };
 
 void heFboRender(HeFbo* sourceFbo, HeFbo* targetFbo) {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo->fboId);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFbo->fboId);
+    heGlBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo->fboId);
+    heGlBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFbo->fboId);
     glBlitFramebuffer(0, 0, sourceFbo->size.x, sourceFbo->size.y, 0, 0, targetFbo->size.x, targetFbo->size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 };
 
@@ -1232,6 +1687,12 @@ void heFboRender(HeFbo* sourceFbo, hm::vec2i const& windowSize) {
     heFboRender(sourceFbo, &fake);
 };
 
+void heFboCopyDepth(HeFbo* sourceFbo, HeFbo* targetFbo) {
+    heGlBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo->fboId);
+    heGlBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFbo->fboId);
+    glBlitFramebuffer(0, 0, sourceFbo->size.x, sourceFbo->size.y, 0, 0, targetFbo->size.x, targetFbo->size.y, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+};
+
 void heFboValidate(HeFbo const* fbo) {
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
 #ifdef HE_ENABLE_NAMES
@@ -1263,7 +1724,7 @@ void heTextureCreateEmptyCubeMap(HeTexture* texture) {
     
     texture->cubeMap = true;
     glGenTextures(1, &texture->textureId);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureId);
+    heGlBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureId);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, texture->mipmapCount);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
     glTexStorage2D(GL_TEXTURE_CUBE_MAP, (texture->parameters & HE_TEXTURE_FILTER_TRILINEAR) ? texture->mipmapCount : 1, texture->format, texture->size.x, texture->size.y);
@@ -1358,8 +1819,7 @@ void heTextureLoadFromCubemapFile(HeTexture* texture, std::string const& fileNam
     }
 
     glGenTextures(1, &texture->textureId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureId);
+    heGlBindTexture(0, GL_TEXTURE_CUBE_MAP, texture->textureId);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     int32_t offset = 0;
@@ -1409,8 +1869,7 @@ void heTextureLoadFromHdrCubemapFile(HeTexture* texture, std::string const& file
     }
 
     glGenTextures(1, &texture->textureId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, texture->textureId);
+    heGlBindTexture(0, GL_TEXTURE_CUBE_MAP, texture->textureId);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, texture->mipmapCount - 1);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
@@ -1475,8 +1934,7 @@ void heTextureCreateFromBuffer(HeTexture* texture) {
 
     uint32_t unpackAlignment = 1;
     glGenTextures(1, &texture->textureId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->textureId);
+    heGlBindTexture(0, GL_TEXTURE_2D, texture->textureId);
     if(texture->format == HE_COLOUR_FORMAT_RGBA16) {
         glPixelStorei(GL_UNPACK_ALIGNMENT, 8);
         glTexImage2D(GL_TEXTURE_2D, 0, texture->format, texture->size.x, texture->size.y, 0, (texture->channels == 4) ? GL_RGBA : GL_RGB, GL_FLOAT, texture->bufferf);
@@ -1513,8 +1971,7 @@ void heTextureCreateFromCompressedBuffer(HeTexture* texture, std::vector<int32_t
     texture->mipmapCount = mipmapCount;
             
     glGenTextures(1, &texture->textureId);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->textureId);
+    heGlBindTexture(0, GL_TEXTURE_2D, texture->textureId);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
     int32_t   offset     = 0;
@@ -1548,21 +2005,16 @@ void heTextureCreateFromCompressedBuffer(HeTexture* texture, std::vector<int32_t
 void heTextureBind(HeTexture const* texture, int8_t const slot) {
     HE_CRASH_LOG();
     if(texture != nullptr) {
-        glActiveTexture(GL_TEXTURE0 + slot);
         uint32_t format = (texture->cubeMap) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
-        glBindTexture(format, texture->textureId);
-    } else {
-        glActiveTexture(GL_TEXTURE0 + slot);
-        glBindTexture(GL_TEXTURE_2D, 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    }
+        heGlBindTexture(slot, format, texture->textureId);
+    } else
+        heGlBindTexture(slot, 0, 0);
 };
 
 void heTextureBind(uint32_t const texture, int8_t const slot, b8 const cubeMap) {
     HE_CRASH_LOG();
     uint32_t format = (cubeMap) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(format, texture);
+    heGlBindTexture(slot, format, texture);
 };
 
 void heImageTextureBind(HeTexture const* texture, int8_t const slot, int8_t const level, int8_t const layer, HeAccessType const access) {
@@ -1576,15 +2028,14 @@ void heImageTextureBind(HeTexture const* texture, int8_t const slot, int8_t cons
 void heTextureUnbind(int8_t const slot, b8 const cubeMap) {
     HE_CRASH_LOG();
     uint32_t format = (cubeMap) ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(format, 0);
+    heGlBindTexture(slot, format, 0);
 };
 
 void heTextureDestroy(HeTexture* texture) {
     HE_CRASH_LOG();
     if(texture && --texture->referenceCount == 0) {
         heMemoryTracker[HE_MEMORY_TYPE_TEXTURE] -= texture->memory;
-        glDeleteTextures(1, &texture->textureId);
+        heGlDeleteTexture(&texture->textureId);
         texture->textureId = 0;
         texture->size = hm::vec2i(0);
         texture->channels  = 0;
@@ -1779,32 +2230,42 @@ void heFrameClear(hm::colour const& colour, HeFrameBufferBits const type) {
     glClear(type);
 };
 
+void heFrameClearRegion(hm::colour const& colour, HeFrameBufferBits const type, hm::vec2i const& lowerleft, hm::vec2i const& size) {
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(lowerleft.x, lowerleft.y, size.x, size.y);
+    heFrameClear(colour, type);
+    glDisable(GL_SCISSOR_TEST);
+};
+
 void heBlendMode(int8_t const mode) {
     if(mode == -1) {
-        glDisable(GL_BLEND);
+        heGlSetCapability(GL_BLEND, &heGlState.blend, false);
     } else {
-        glEnable(GL_BLEND);
+        heGlSetCapability(GL_BLEND, &heGlState.blend, true);
         switch (mode) {
         case 0:
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            heGlBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             break;
             
         case 1:
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            heGlBlendFunc(GL_SRC_ALPHA, GL_ONE);
             break;
             
         case 2:
-            glBlendFunc(GL_SRC_ALPHA, GL_ZERO);
+            heGlBlendFunc(GL_SRC_ALPHA, GL_ZERO);
             break;
         }
     }
 };
 
 void heBufferBlendMode(int8_t const attachmentIndex, int8_t const mode) {
+    // the factors of the other buffers are not changed, so the cached ones do not apply anymore
+    heGlState.blendSource      = HeGlState::UNKNOWN;
+    heGlState.blendDestination = HeGlState::UNKNOWN;
     if(mode == -1)
-        glDisable(GL_BLEND);
+        heGlSetCapability(GL_BLEND, &heGlState.blend, false);
     else {
-        glEnable(GL_BLEND);
+        heGlSetCapability(GL_BLEND, &heGlState.blend, true);
         switch (mode) {
         case 0:
             glBlendFunciARB(attachmentIndex, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -1822,22 +2283,33 @@ void heBufferBlendMode(int8_t const attachmentIndex, int8_t const mode) {
 };
 
 void heDepthEnable(b8 const depth) {
-    if (depth)
-        glEnable(GL_DEPTH_TEST);
-    else
-        glDisable(GL_DEPTH_TEST);
+    heGlSetCapability(GL_DEPTH_TEST, &heGlState.depthTest, depth);
 };
 
 void heDepthFunc(HeFragmentTestFunction const function) {
+    if(heGlStateMatches(heGlState.depthFunction, function)) {
+        if(heGlState.validate)
+            heGlStateValidate(GL_DEPTH_FUNC, function, "depth function");
+        return;
+    }
+
     glDepthFunc(function);
+    heGlState.depthFunction = function;
 };
 
 void heCullEnable(b8 const culling, b8 const backFace) {
+    heGlSetCapability(GL_CULL_FACE, &heGlState.cullFace, culling);
     if(culling) {
-        glEnable(GL_CULL_FACE);
-        glCullFace((backFace) ? GL_BACK : GL_FRONT);
-    } else
-        glDisable(GL_CULL_FACE);
+        uint32_t mode = (backFace) ? GL_BACK : GL_FRONT;
+        if(heGlStateMatches(heGlState.cullMode, mode)) {
+            if(heGlState.validate)
+                heGlStateValidate(GL_CULL_FACE_MODE, mode, "cull mode");
+            return;
+        }
+
+        glCullFace(mode);
+        heGlState.cullMode = mode;
+    }
 };
 
 void heStencilEnable(b8 const depth) {
@@ -1856,7 +2328,7 @@ void heStencilFunc(HeFragmentTestFunction const function, uint32_t const thresho
 };
 
 void heViewport(hm::vec2i const& lowerleft, hm::vec2i const& size) {
-    glViewport(lowerleft.x, lowerleft.y, size.x, size.y);
+    heGlViewport(lowerleft.x, lowerleft.y, size.x, size.y);
 };
 
 int32_t heMemoryGetUsage() {
@@ -1890,6 +2362,14 @@ uint32_t heColourFormatGetBytesPerPixel(HeColourFormat const format) {
     case HE_COLOUR_FORMAT_RGBA16:
         bytesPerPixel = 4 * 4;
         break;
+
+    case HE_COLOUR_FORMAT_R32UI:
+        bytesPerPixel = 4;
+        break;
+
+    case HE_COLOUR_FORMAT_RG32UI:
+        bytesPerPixel = 2 * 4;
+        break;
     }
     return bytesPerPixel;
 };
@@ -4,6 +4,9 @@
 #include "hm/hm.hpp"
 #include "heTypes.h"
 
+// the id of an interned uniform (or sampler) name, see heShaderGetUniformId
+typedef uint32_t HeUniformId;
+
 struct HeShaderData {
     HeDataType type;
     
@@ -28,6 +31,19 @@ struct HeUbo {
     unsigned char* buffer = nullptr;
 };
 
+// a buffer that is read as one dimensional texture (samplerBuffer) in shaders. Unlike ubos, these can be much larger
+// and be indexed freely
+struct HeTextureBuffer {
+    // the gl id of the buffer holding the data
+    uint32_t bufferId  = 0;
+    // the gl id of the texture that views the buffer
+    uint32_t textureId = 0;
+    // the format of a single texel in the buffer
+    HeColourFormat format = HE_COLOUR_FORMAT_NONE;
+    // the size of the data last uploaded, in bytes
+    uint32_t size = 0;
+};
+
 struct HeShaderProgram {
     uint32_t programId = 0;
     // a list of all files loaded for this shader. Everytime the shader is bound and hotswapping is enabled,
@@ -46,6 +62,11 @@ struct HeShaderProgram {
     std::unordered_map<std::string, int32_t> samplers;
     // maps ubos to their slot. The slot is shader dependant. This location is saved in the map for faster lookup
     std::unordered_map<std::string, int32_t> ubos;
+    // the uniform locations indexed by uniform id (see heShaderGetUniformId). All active uniforms are resolved when
+    // the program is linked, others are resolved on first use. -2 if not resolved yet
+    std::vector<int32_t> uniformLocations;
+    // the sampler slots indexed by uniform id, resolved on first use through the samplers map. -2 if not resolved yet
+    std::vector<int32_t> samplerSlots;
     // whether this is a compute shader or a normal pipeline shader
     b8 computeShader = false;
     // whether to print a debug message if we dont find a uniform.
@@ -84,12 +105,30 @@ struct HeVbo {
     std::vector<uint32_t> dataui;
 };
 
+struct HeVao;
+
+struct HeVaoLod {
+    // the simplified mesh, owned by the asset pool
+    HeVao* vao        = nullptr;
+    // the projected size (fraction of the screen height) below which this lod is used
+    float  screenSize = 0.f;
+};
+
 struct HeVao {
     HeVaoType type = HE_VAO_TYPE_NONE;
     uint32_t vaoId = 0;
     uint32_t verticesCount = 0;
     uint32_t attributeCount = 0; // amount of normal vbos plus instanced attributes
     std::vector<HeVbo> vbos;
+
+    // object space bounds of the vertices, set by the mesh loaders and used for culling
+    hm::vec3f boundsMin;
+    hm::vec3f boundsMax;
+    // radius of the bounding sphere around the center of the bounds. Negative if the bounds are unknown, instances
+    // using this vao are then never culled
+    float     boundsRadius = -1.f;
+    // lower detail versions of this mesh, from the most to the least detailed. Loaded from binary assets
+    std::vector<HeVaoLod> lods;
     
 #ifdef HE_ENABLE_NAMES
     std::string name = "";
@@ -173,6 +212,70 @@ struct HeTexture {
 #endif
 };
 
+// mirrors the gl state that the renderer changes most often (bound objects, blending, depth and culling), so that
+// calls which would not change anything are not passed to the driver. Every gl call of the gl layer goes through this
+// cache, if gl state is changed anywhere else, heGlStateInvalidate must be called afterwards
+struct HeGlState {
+    // the number of texture units and ubo binding points that are cached. Higher ones are always passed to gl
+    static const uint32_t MAX_TEXTURE_UNITS = 32;
+    static const uint32_t MAX_UBO_BINDINGS  = 16;
+    // the value of state that is not known (i.e. at startup or after an invalidate), no gl name or enum has it
+    static const uint32_t UNKNOWN           = 0xffffffff;
+
+    uint32_t program     = UNKNOWN;
+    uint32_t vao         = UNKNOWN;
+    uint32_t drawFbo     = UNKNOWN;
+    uint32_t readFbo     = UNKNOWN;
+    int32_t  viewport[4] = { -1, -1, -1, -1 };
+    // the unit that glActiveTexture was last called with (without the GL_TEXTURE0 offset)
+    uint32_t activeUnit  = UNKNOWN;
+    // the target and texture last bound per unit. A target of 0 means that the unit was cleared for all targets
+    uint32_t textureTargets[MAX_TEXTURE_UNITS];
+    uint32_t textures[MAX_TEXTURE_UNITS];
+    // the buffer bound to each ubo binding point
+    uint32_t ubos[MAX_UBO_BINDINGS];
+    // the capabilities, 0 if disabled, 1 if enabled
+    uint32_t blend       = UNKNOWN;
+    uint32_t depthTest   = UNKNOWN;
+    uint32_t cullFace    = UNKNOWN;
+    uint32_t multisample = UNKNOWN;
+    // the factors of the last glBlendFunc. Unknown after blending was set per buffer
+    uint32_t blendSource      = UNKNOWN;
+    uint32_t blendDestination = UNKNOWN;
+    uint32_t depthFunction    = UNKNOWN;
+    uint32_t cullMode         = UNKNOWN;
+
+    // if set, the cache is compared against the real gl state (queried with glGet) whenever a call is skipped and a
+    // warning is printed if they differ. This stalls the driver, only use it for debugging
+    b8 validate = false;
+    // the number of calls passed to gl and skipped since the counters were last reset
+    uint64_t issuedCalls  = 0;
+    uint64_t skippedCalls = 0;
+
+    HeGlState() {
+        for(uint32_t i = 0; i < MAX_TEXTURE_UNITS; ++i) {
+            textureTargets[i] = UNKNOWN;
+            textures[i]       = UNKNOWN;
+        }
+
+        for(uint32_t i = 0; i < MAX_UBO_BINDINGS; ++i)
+            ubos[i] = UNKNOWN;
+    };
+};
+
+// the state of the gl context the engine renders to
+extern HE_API HeGlState heGlState;
+
+
+// -- gl state
+
+// forgets all cached state (but keeps the counters and the validation flag), so that the next call of every kind is
+// passed to gl. Must be called after the gl state was changed outside of the gl layer
+extern HE_API void heGlStateInvalidate();
+// adds the issued and skipped calls since the last call as counters to the profiler and resets them. Should be called
+// once per frame
+extern HE_API void heGlStateFlushCounters();
+
 
 // -- ubos
 
@@ -193,6 +296,19 @@ extern HE_API void heUboBind(HeUbo const* ubo, uint32_t const location);
 extern HE_API void heUboDestroy(HeUbo* ubo);
 
 
+// -- texture buffers
+
+// creates a new texture buffer with given texel format. The buffer stays empty until data is uploaded
+extern HE_API void heTextureBufferCreate(HeTextureBuffer* buffer, HeColourFormat const format);
+// replaces the content of the buffer with size bytes from data. The storage is reallocated on every call so that
+// the driver does not have to wait for draw calls still reading the old data
+extern HE_API void heTextureBufferUpdate(HeTextureBuffer* buffer, void const* data, uint32_t const size);
+// binds the texture of the buffer to given texture slot
+extern HE_API void heTextureBufferBind(HeTextureBuffer const* buffer, int8_t const slot);
+// destroys the buffer and its texture
+extern HE_API void heTextureBufferDestroy(HeTextureBuffer* buffer);
+
+
 // -- Shaders
 
 // loads a compute shader from given file
@@ -246,6 +362,16 @@ extern HE_API int32_t heShaderGetUboLocation(HeShaderProgram* program, std::stri
 // returned. If the sampler does exist, it will be bound to given texture slot (leave at -1 for default slotting)
 // (glActiveTexture(GL_TEXTURE0 + requestedSlot))
 extern HE_API int32_t heShaderGetSamplerLocation(HeShaderProgram* program, std::string const& sampler, int8_t const requestedSlot = -1);
+// returns the id of given uniform or sampler name. A name gets its id the first time it is passed here and keeps it
+// for the whole runtime. Ids should be looked up once and stored (i.e. in a static), since this does a string lookup
+extern HE_API HeUniformId heShaderGetUniformId(std::string const& name);
+// returns the name that given id was created for
+extern HE_API std::string const& heShaderGetUniformName(HeUniformId const uniform);
+// gets the location of the uniform with given id in given shader. Other than the string lookup, this is just an index
+// into the location table of the shader once the uniform was resolved
+extern HE_API int32_t heShaderGetUniformLocation(HeShaderProgram* program, HeUniformId const uniform);
+// gets the texture slot of the sampler with given id in given shader, see the string version for requestedSlot
+extern HE_API int32_t heShaderGetSamplerLocation(HeShaderProgram* program, HeUniformId const sampler, int8_t const requestedSlot = -1);
 // sets all samplers (loaded in the shader) to 0
 extern HE_API void heShaderClearSamplers(HeShaderProgram const* program);
 
@@ -261,6 +387,18 @@ extern HE_API void heShaderLoadUniform(HeShaderProgram* program, std::string con
 extern HE_API void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, hm::vec4f const& value);
 extern HE_API void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, hm::colour const& value);
 extern HE_API void heShaderLoadUniform(HeShaderProgram* program, std::string const& uniformName, HeShaderData const* data);
+// the same as above, but with the id of the uniform instead of its name. These do no string operations
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, float const value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, double const value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, int32_t const value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, uint32_t const value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::mat3f const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::mat4f const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec2f const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec3f const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::vec4f const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, hm::colour const& value);
+extern HE_API void heShaderLoadUniform(HeShaderProgram* program, HeUniformId const uniform, HeShaderData const* data);
 
 
 // -- Buffers
@@ -279,6 +417,10 @@ extern HE_API void heVboCreateUint(HeVbo* vbo, std::vector<uint32_t> const& data
 extern HE_API void heVboAllocate(HeVbo* vbo, uint32_t const size, uint8_t const dimensions, HeVboUsage const usage = HE_VBO_USAGE_STATIC, HeDataType const type = HE_DATA_TYPE_FLOAT);
 // deletes the given vbo and sets its id to 0
 extern HE_API void heVboDestroy(HeVbo* vbo);
+// copies the data of given float vbo into data. If the vbo was loaded from a different thread and is not uploaded
+// yet, the waiting data is copied. Otherwise the data is read back from the gpu, so this must be called from the main
+// thread
+extern HE_API void heVboGetData(HeVbo const* vbo, std::vector<float>* data);
 
 // creates a new empty vao
 extern HE_API void heVaoCreate(HeVao* vao, HeVaoType const type = HE_VAO_TYPE_TRIANGLES);
@@ -362,6 +504,9 @@ extern HE_API void heFboResize(HeFbo* fbo, hm::vec2i const& newSize);
 extern HE_API void heFboRender(HeFbo* sourceFbo, HeFbo* targetFbo);
 // renders the source fbo directly onto the window with given size
 extern HE_API void heFboRender(HeFbo* sourceFbo, hm::vec2i const& windowSize);
+// copies the depth of the source fbo into the depth of the target fbo. Both need a depth attachment of the same
+// size and format
+extern HE_API void heFboCopyDepth(HeFbo* sourceFbo, HeFbo* targetFbo);
 // checks if the currently bound fbo was correctly set up.
 extern HE_API void heFboValidate(HeFbo const* fbo);
 // creates a wrapper texture around the given colour texture attachment of the fbo (with size, format,
@@ -475,6 +620,9 @@ extern HE_API void heTextureClampRepeat(HeTexture* texture);
 
 // clears the buffers of current fbo to given colour. Type is the different buffers to be cleared
 extern HE_API void heFrameClear(hm::colour const& colour, HeFrameBufferBits const type);
+// clears the buffers of current fbo like heFrameClear, but only in the rectangle starting at lowerleft (in pixels)
+// with given size
+extern HE_API void heFrameClearRegion(hm::colour const& colour, HeFrameBufferBits const type, hm::vec2i const& lowerleft, hm::vec2i const& size);
 // sets the gl blend mode to given mode. Possible modes:
 // -1 = disable gl blending
 //  0 = normal blending (one minus source alpha)
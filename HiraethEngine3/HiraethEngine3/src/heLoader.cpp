@@ -7,6 +7,8 @@
 #include "heBinary.h"
 #include "heWin32Layer.h"
 #include <limits>
+#include <cfloat>
+#include <tuple>
 
 void parseObjVertex(const int ids[3], HeD3MeshBuilder& mesh) {
     const hm::vec3f& vertex = mesh.vertices[ids[0]];
@@ -48,14 +50,14 @@ void parseObjTangents(const hm::vec3f (&vertices)[3], const hm::vec2f (&uvs)[3],
     }
 };
 
-void heMeshLoad(std::string const& fileName, HeVao* vao) {
+b8 heD3MeshBuilderParseObj(HeD3MeshBuilder* builder, std::string const& fileName) {
     HeTextFile file;
     heTextFileOpen(&file, fileName, 0, false);
     if(!file.open)
-        return;
+        return false;
     
     std::string string;
-    HeD3MeshBuilder mesh;
+    HeD3MeshBuilder& mesh = *builder;
     
     while (heTextFileGetLine(&file, &string)) {
         if (string.size() == 0 || string[0] == '#')
@@ -101,6 +103,422 @@ void heMeshLoad(std::string const& fileName, HeVao* vao) {
     }
 
     heTextFileClose(&file);
+    return true;
+};
+
+void heD3MeshBuilderReadBinary(HeD3MeshBuilder* builder, HeBinaryBuffer* buffer) {
+    heBinaryBufferGetFloatBuffer(buffer, &builder->verticesArray);
+    heBinaryBufferGetFloatBuffer(buffer, &builder->uvArray);
+    heBinaryBufferGetFloatBuffer(buffer, &builder->normalArray);
+    heBinaryBufferGetFloatBuffer(buffer, &builder->tangentArray);
+};
+
+void heD3MeshBuilderCalculateBounds(HeD3MeshBuilder const* builder, HeVao* vao) {
+    size_t count = builder->verticesArray.size() / 3;
+    if(count == 0) {
+        vao->boundsRadius = -1.f;
+        return;
+    }
+
+    float const* v = builder->verticesArray.data();
+    hm::vec3f min(v[0], v[1], v[2]);
+    hm::vec3f max(min);
+    for(size_t i = 1; i < count; ++i) {
+        float const* p = &v[i * 3];
+        min.x = std::min(min.x, p[0]);
+        min.y = std::min(min.y, p[1]);
+        min.z = std::min(min.z, p[2]);
+        max.x = std::max(max.x, p[0]);
+        max.y = std::max(max.y, p[1]);
+        max.z = std::max(max.z, p[2]);
+    }
+
+    // the sphere is centered on the box, the radius is the furthest vertex from that center
+    hm::vec3f center = (min + max) / 2.f;
+    float radius2    = 0.f;
+    for(size_t i = 0; i < count; ++i) {
+        float const* p = &v[i * 3];
+        radius2 = std::max(radius2, hm::length2(hm::vec3f(p[0], p[1], p[2]) - center));
+    }
+
+    vao->boundsMin    = min;
+    vao->boundsMax    = max;
+    vao->boundsRadius = std::sqrt(radius2);
+};
+
+b8 heD3MeshBuilderReadVao(HeD3MeshBuilder* builder, HeVao const* vao) {
+    if(vao->type != HE_VAO_TYPE_TRIANGLES || vao->vbos.size() < 4 || vao->vbos[0].dimensions != 3 || vao->vbos[1].dimensions != 2 ||
+       vao->vbos[2].dimensions != 3 || vao->vbos[3].dimensions != 3)
+        return false;
+
+    heVboGetData(&vao->vbos[0], &builder->verticesArray);
+    heVboGetData(&vao->vbos[1], &builder->uvArray);
+    heVboGetData(&vao->vbos[2], &builder->normalArray);
+    heVboGetData(&vao->vbos[3], &builder->tangentArray);
+
+    size_t count = builder->verticesArray.size() / 3;
+    return builder->uvArray.size() == count * 2 && builder->normalArray.size() == count * 3 && builder->tangentArray.size() == count * 3;
+};
+
+void heD3MeshBuilderAppend(HeD3MeshBuilder* builder, HeD3MeshBuilder const* source, hm::mat4f const& worldMatrix, hm::mat3f const& normalMatrix) {
+    hm::mat3f rotation(worldMatrix);
+    size_t count  = source->verticesArray.size() / 3;
+    size_t offset = builder->verticesArray.size();
+    builder->verticesArray.resize(offset + count * 3);
+    builder->normalArray.resize(offset + count * 3);
+    builder->tangentArray.resize(offset + count * 3);
+    builder->uvArray.insert(builder->uvArray.end(), source->uvArray.begin(), source->uvArray.end());
+
+    for(size_t i = 0; i < count * 3; i += 3) {
+        float const* v = &source->verticesArray[i];
+        float const* n = &source->normalArray[i];
+        float const* t = &source->tangentArray[i];
+        hm::vec3f vertex(worldMatrix * hm::vec4f(v[0], v[1], v[2], 1.f));
+        hm::vec3f normal  = hm::normalize(normalMatrix * hm::vec3f(n[0], n[1], n[2]));
+        hm::vec3f tangent = hm::normalize(rotation * hm::vec3f(t[0], t[1], t[2]));
+        memcpy(&builder->verticesArray[offset + i], &vertex.x,  3 * sizeof(float));
+        memcpy(&builder->normalArray[offset + i],   &normal.x,  3 * sizeof(float));
+        memcpy(&builder->tangentArray[offset + i],  &tangent.x, 3 * sizeof(float));
+    }
+};
+
+// a symmetric 4x4 matrix that sums the squared distances to a set of planes
+struct HeQuadric {
+    double a2 = 0., ab = 0., ac = 0., ad = 0., b2 = 0., bc = 0., bd = 0., c2 = 0., cd = 0., d2 = 0.;
+    // the summed weight of all added planes
+    double weight = 0.;
+};
+
+void heQuadricAddPlane(HeQuadric* q, hm::vec3f const& normal, float const distance, float const weight) {
+    double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    q->a2 += a * a * weight; q->ab += a * b * weight; q->ac += a * c * weight; q->ad += a * d * weight;
+    q->b2 += b * b * weight; q->bc += b * c * weight; q->bd += b * d * weight;
+    q->c2 += c * c * weight; q->cd += c * d * weight;
+    q->d2 += d * d * weight;
+    q->weight += weight;
+};
+
+void heQuadricAdd(HeQuadric* q, HeQuadric const& other) {
+    q->a2 += other.a2; q->ab += other.ab; q->ac += other.ac; q->ad += other.ad;
+    q->b2 += other.b2; q->bc += other.bc; q->bd += other.bd;
+    q->c2 += other.c2; q->cd += other.cd;
+    q->d2 += other.d2;
+    q->weight += other.weight;
+};
+
+// returns the weighted sum of squared distances from p to the planes of q
+double heQuadricError(HeQuadric const& q, hm::vec3f const& p) {
+    double x = p.x, y = p.y, z = p.z;
+    double error = q.a2 * x * x + 2. * q.ab * x * y + 2. * q.ac * x * z + 2. * q.ad * x
+                 + q.b2 * y * y + 2. * q.bc * y * z + 2. * q.bd * y
+                 + q.c2 * z * z + 2. * q.cd * z
+                 + q.d2;
+    return std::max(error, 0.);
+};
+
+// hashes the first size floats of a vertex for welding
+template<uint32_t size>
+struct HeSimplifyKey {
+    float data[size];
+
+    b8 operator==(HeSimplifyKey const& other) const {
+        return memcmp(data, other.data, sizeof(data)) == 0;
+    };
+};
+
+template<uint32_t size>
+struct HeSimplifyKeyHash {
+    size_t operator()(HeSimplifyKey<size> const& key) const {
+        uint32_t const* words = (uint32_t const*) key.data;
+        size_t hash = 2166136261u;
+        for(uint32_t i = 0; i < size; ++i)
+            hash = (hash ^ words[i]) * 16777619u;
+        return hash;
+    };
+};
+
+float heD3MeshBuilderSimplify(HeD3MeshBuilder const* source, HeD3MeshBuilder* result, uint32_t const targetTriangles, float const maxError) {
+    enum HeSimplifyKind : uint8_t {
+        HE_SIMPLIFY_KIND_MANIFOLD,
+        HE_SIMPLIFY_KIND_BORDER,
+        HE_SIMPLIFY_KIND_LOCKED
+    };
+
+    uint32_t const cornerCount = (uint32_t) (source->verticesArray.size() / 3);
+
+    // -- weld the corners into vertices (position and uv) and the vertices into positions
+
+    std::unordered_map<HeSimplifyKey<5>, uint32_t, HeSimplifyKeyHash<5>> vertexMap;
+    std::unordered_map<HeSimplifyKey<3>, uint32_t, HeSimplifyKeyHash<3>> positionMap;
+    std::vector<uint32_t>  indices(cornerCount);
+    std::vector<uint32_t>  vertexPosition;  // the position of every vertex
+    std::vector<uint32_t>  vertexCorner;    // the first corner of every vertex, for the uvs
+    std::vector<hm::vec3f> vertexNormal;    // summed normals of all corners of a vertex
+    std::vector<hm::vec3f> vertexTangent;
+    std::vector<hm::vec3f> positions;
+    std::vector<uint32_t>  positionVertices; // the number of vertices sharing a position, more than one is a seam
+    vertexMap.reserve(cornerCount);
+    positionMap.reserve(cornerCount);
+
+    for(uint32_t i = 0; i < cornerCount; ++i) {
+        float const* p = &source->verticesArray[i * 3];
+        float const* u = &source->uvArray[i * 2];
+        HeSimplifyKey<5> vertexKey = { { p[0], p[1], p[2], u[0], u[1] } };
+        auto vertex = vertexMap.emplace(vertexKey, (uint32_t) vertexPosition.size());
+        if(vertex.second) {
+            HeSimplifyKey<3> positionKey = { { p[0], p[1], p[2] } };
+            auto position = positionMap.emplace(positionKey, (uint32_t) positions.size());
+            if(position.second) {
+                positions.emplace_back(p[0], p[1], p[2]);
+                positionVertices.emplace_back(0);
+            }
+
+            positionVertices[position.first->second]++;
+            vertexPosition.emplace_back(position.first->second);
+            vertexCorner.emplace_back(i);
+            vertexNormal.emplace_back(0.f);
+            vertexTangent.emplace_back(0.f);
+        }
+
+        uint32_t v = vertex.first->second;
+        indices[i] = v;
+        vertexNormal[v]  += hm::vec3f(source->normalArray[i * 3], source->normalArray[i * 3 + 1], source->normalArray[i * 3 + 2]);
+        vertexTangent[v] += hm::vec3f(source->tangentArray[i * 3], source->tangentArray[i * 3 + 1], source->tangentArray[i * 3 + 2]);
+    }
+
+    uint32_t const positionCount = (uint32_t) positions.size();
+    uint32_t triangleCount = cornerCount / 3;
+
+    // -- error quadrics of the faces around every position
+
+    hm::vec3f boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+    for(hm::vec3f const& p : positions) {
+        boundsMin.x = std::min(boundsMin.x, p.x); boundsMax.x = std::max(boundsMax.x, p.x);
+        boundsMin.y = std::min(boundsMin.y, p.y); boundsMax.y = std::max(boundsMax.y, p.y);
+        boundsMin.z = std::min(boundsMin.z, p.z); boundsMax.z = std::max(boundsMax.z, p.z);
+    }
+    
+    float const scale = std::max(hm::length(boundsMax - boundsMin), FLT_EPSILON);
+    std::vector<HeQuadric> quadrics(positionCount);
+    for(uint32_t t = 0; t < triangleCount; ++t) {
+        hm::vec3f const& p0 = positions[vertexPosition[indices[t * 3]]];
+        hm::vec3f const& p1 = positions[vertexPosition[indices[t * 3 + 1]]];
+        hm::vec3f const& p2 = positions[vertexPosition[indices[t * 3 + 2]]];
+        hm::vec3f normal = hm::cross(p1 - p0, p2 - p0);
+        float area = hm::length(normal);
+        if(area <= 0.f)
+            continue;
+
+        normal = normal / area;
+        for(uint32_t c = 0; c < 3; ++c)
+            heQuadricAddPlane(&quadrics[vertexPosition[indices[t * 3 + c]]], normal, -hm::dot(normal, p0), area);
+    }
+
+    // -- collapse edges, in passes of independent collapses ordered by their error
+
+    struct HeSimplifyCollapse {
+        uint32_t from; // the vertex that is removed
+        uint32_t to;   // the vertex it is merged into
+        double   error;
+    };
+
+    std::vector<uint8_t>  kinds(positionCount);
+    std::vector<uint8_t>  touched(positionCount);
+    std::vector<uint32_t> adjacencyOffsets(positionCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::unordered_map<uint64_t, uint32_t> edges;
+    std::vector<HeSimplifyCollapse> collapses;
+    std::vector<uint32_t> neighbours;
+    double const errorLimit = (double) maxError * maxError;
+    double lastError = 0.;
+
+    while(triangleCount > targetTriangles) {
+        // count the triangles of every edge between positions. Positions on edges with a single triangle are on the
+        // border, positions on edges with more than two triangles or on a uv seam are locked
+        edges.clear();
+        for(uint32_t i = 0; i < (uint32_t) indices.size(); i += 3) {
+            for(uint32_t c = 0; c < 3; ++c) {
+                uint32_t a = vertexPosition[indices[i + c]], b = vertexPosition[indices[i + (c + 1) % 3]];
+                edges[((uint64_t) std::min(a, b) << 32) | std::max(a, b)]++;
+            }
+        }
+
+        for(uint32_t p = 0; p < positionCount; ++p)
+            kinds[p] = (positionVertices[p] > 1) ? HE_SIMPLIFY_KIND_LOCKED : HE_SIMPLIFY_KIND_MANIFOLD;
+
+        for(auto const& all : edges) {
+            uint32_t a = (uint32_t) (all.first >> 32), b = (uint32_t) all.first;
+            uint8_t kind = (all.second == 1) ? HE_SIMPLIFY_KIND_BORDER : (all.second > 2) ? HE_SIMPLIFY_KIND_LOCKED : HE_SIMPLIFY_KIND_MANIFOLD;
+            kinds[a] = std::max(kinds[a], kind);
+            kinds[b] = std::max(kinds[b], kind);
+        }
+
+        // the triangles around every position
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for(uint32_t i = 0; i < (uint32_t) indices.size(); ++i)
+            adjacencyOffsets[vertexPosition[indices[i]] + 1]++;
+        for(uint32_t p = 0; p < positionCount; ++p)
+            adjacencyOffsets[p + 1] += adjacencyOffsets[p];
+        adjacency.resize(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for(uint32_t i = 0; i < (uint32_t) indices.size(); ++i)
+                adjacency[fill[vertexPosition[indices[i]]]++] = i / 3;
+        }
+
+        // every edge can collapse in both directions. Border positions may only move along the border and locked
+        // ones never move
+        collapses.clear();
+        for(uint32_t i = 0; i < (uint32_t) indices.size(); i += 3) {
+            for(uint32_t c = 0; c < 3; ++c) {
+                uint32_t va = indices[i + c], vb = indices[i + (c + 1) % 3];
+                uint32_t pa = vertexPosition[va], pb = vertexPosition[vb];
+                for(uint32_t d = 0; d < 2; ++d) {
+                    if(kinds[pa] == HE_SIMPLIFY_KIND_MANIFOLD ||
+                       (kinds[pa] == HE_SIMPLIFY_KIND_BORDER && kinds[pb] != HE_SIMPLIFY_KIND_MANIFOLD &&
+                        edges[((uint64_t) std::min(pa, pb) << 32) | std::max(pa, pb)] == 1)) {
+                        HeQuadric q = quadrics[pa];
+                        heQuadricAdd(&q, quadrics[pb]);
+                        collapses.push_back({ va, vb, heQuadricError(q, positions[pb]) / std::max(q.weight, 1e-20) });
+                    }
+
+                    std::swap(va, vb);
+                    std::swap(pa, pb);
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](HeSimplifyCollapse const& a, HeSimplifyCollapse const& b) {
+            return a.error < b.error;
+        });
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        uint32_t collapsed = 0;
+        for(HeSimplifyCollapse const& all : collapses) {
+            if(triangleCount <= targetTriangles || all.error / (scale * scale) > errorLimit)
+                break;
+
+            uint32_t pa = vertexPosition[all.from], pb = vertexPosition[all.to];
+            if(touched[pa] || touched[pb])
+                continue;
+
+            // reject the collapse if any remaining triangle around from would flip or collapse into a line
+            b8 flips = false;
+            for(uint32_t j = adjacencyOffsets[pa]; j < adjacencyOffsets[pa + 1] && !flips; ++j) {
+                uint32_t const* t = &indices[adjacency[j] * 3];
+                uint32_t p[3] = { vertexPosition[t[0]], vertexPosition[t[1]], vertexPosition[t[2]] };
+                if(p[0] == pb || p[1] == pb || p[2] == pb)
+                    continue; // removed by the collapse
+
+                hm::vec3f before = hm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+                for(uint32_t c = 0; c < 3; ++c)
+                    if(p[c] == pa)
+                        p[c] = pb;
+                hm::vec3f after = hm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+                float lengthBefore = hm::length(before), lengthAfter = hm::length(after);
+                flips = hm::dot(before, after) < .25f * lengthBefore * lengthAfter || lengthAfter <= .01f * lengthBefore;
+            }
+
+            if(flips)
+                continue;
+
+            // reject the collapse if the two positions share more neighbours than the triangles on their edge, the
+            // mesh would fold onto itself (link condition)
+            neighbours.clear();
+            uint32_t edgeTriangles = 0;
+            for(uint32_t j = adjacencyOffsets[pa]; j < adjacencyOffsets[pa + 1]; ++j) {
+                uint32_t const* t = &indices[adjacency[j] * 3];
+                b8 onEdge = false;
+                for(uint32_t c = 0; c < 3; ++c) {
+                    neighbours.emplace_back(vertexPosition[t[c]]);
+                    onEdge |= vertexPosition[t[c]] == pb;
+                }
+                edgeTriangles += onEdge;
+            }
+
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            uint32_t shared = 0;
+            for(uint32_t j = adjacencyOffsets[pb]; j < adjacencyOffsets[pb + 1]; ++j) {
+                uint32_t const* t = &indices[adjacency[j] * 3];
+                for(uint32_t c = 0; c < 3; ++c) {
+                    uint32_t p = vertexPosition[t[c]];
+                    auto it = std::lower_bound(neighbours.begin(), neighbours.end(), p);
+                    if(p != pa && p != pb && it != neighbours.end() && *it == p) {
+                        shared++;
+                        neighbours.erase(it); // count every shared neighbour once
+                    }
+                }
+            }
+
+            if(shared > edgeTriangles)
+                continue;
+
+            // move all triangles of from to the position of to. The triangles on the edge become degenerate
+            for(uint32_t j = adjacencyOffsets[pa]; j < adjacencyOffsets[pa + 1]; ++j) {
+                uint32_t* t = &indices[adjacency[j] * 3];
+                for(uint32_t c = 0; c < 3; ++c) {
+                    touched[vertexPosition[t[c]]] = 1;
+                    if(t[c] == all.from)
+                        t[c] = all.to;
+                }
+
+                if(t[0] == t[1] || t[1] == t[2] || t[0] == t[2])
+                    triangleCount--;
+            }
+
+            heQuadricAdd(&quadrics[pb], quadrics[pa]);
+            lastError = std::max(lastError, all.error);
+            collapsed++;
+        }
+
+        // remove the degenerate triangles
+        uint32_t write = 0;
+        for(uint32_t i = 0; i < (uint32_t) indices.size(); i += 3) {
+            uint32_t const* t = &indices[i];
+            if(t[0] == t[1] || t[1] == t[2] || t[0] == t[2])
+                continue;
+            indices[write++] = t[0];
+            indices[write++] = t[1];
+            indices[write++] = t[2];
+        }
+
+        indices.resize(write);
+        triangleCount = write / 3;
+        if(collapsed == 0)
+            break;
+    }
+
+    // -- write the remaining triangles
+
+    result->verticesArray.clear();
+    result->uvArray.clear();
+    result->normalArray.clear();
+    result->tangentArray.clear();
+    result->verticesArray.reserve(indices.size() * 3);
+    result->uvArray.reserve(indices.size() * 2);
+    result->normalArray.reserve(indices.size() * 3);
+    result->tangentArray.reserve(indices.size() * 3);
+    for(uint32_t v : indices) {
+        // the summed directions of mirrored corners may cancel out
+        hm::vec3f const& position = positions[vertexPosition[v]];
+        hm::vec3f normal  = (hm::length2(vertexNormal[v])  > 0.f) ? hm::normalize(vertexNormal[v])  : hm::vec3f(0.f, 1.f, 0.f);
+        hm::vec3f tangent = (hm::length2(vertexTangent[v]) > 0.f) ? hm::normalize(vertexTangent[v]) : hm::vec3f(1.f, 0.f, 0.f);
+        float const* uv   = &source->uvArray[vertexCorner[v] * 2];
+        result->verticesArray.insert(result->verticesArray.end(), { position.x, position.y, position.z });
+        result->uvArray.insert(result->uvArray.end(), { uv[0], uv[1] });
+        result->normalArray.insert(result->normalArray.end(), { normal.x, normal.y, normal.z });
+        result->tangentArray.insert(result->tangentArray.end(), { tangent.x, tangent.y, tangent.z });
+    }
+
+    return (float) (std::sqrt(lastError) / scale);
+};
+
+void heMeshLoad(std::string const& fileName, HeVao* vao) {
+    HeD3MeshBuilder mesh;
+    if(!heD3MeshBuilderParseObj(&mesh, fileName))
+        return;
     
     b8 isMainThread = heIsMainThread();
     
@@ -113,6 +531,7 @@ void heMeshLoad(std::string const& fileName, HeVao* vao) {
     heVaoAddData(vao, mesh.uvArray,       2, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, mesh.normalArray,   3, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, mesh.tangentArray,  3, HE_VBO_USAGE_STATIC);
+    heD3MeshBuilderCalculateBounds(&mesh, vao);
     
     if(!isMainThread)
         heThreadLoaderRequestVao(vao);
@@ -157,7 +576,7 @@ void heD3InstanceLoad(std::string const& fileName, HeD3Instance* instance, HePhy
         std::string name = line.substr(0, pos);
         std::string tex = line.substr(pos + 1);
         HeTexture* texture = heAssetPoolGetImageTexture("res/textures/instances/" + tex, HE_TEXTURE_FILTER_TRILINEAR | HE_TEXTURE_FILTER_ANISOTROPIC | HE_TEXTURE_CLAMP_REPEAT);
-        instance->material->textures[name] = texture;
+        heMaterialSetTexture(instance->material, name, texture);
         heTextFileGetLine(&file, &line);
     }
 
@@ -212,6 +631,7 @@ void heD3InstanceLoad(std::string const& fileName, HeD3Instance* instance, HePhy
     heVaoAddData(vao, builder.uvArray,       2, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, builder.normalArray,   3, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, builder.tangentArray,  3, HE_VBO_USAGE_STATIC);
+    heD3MeshBuilderCalculateBounds(&builder, vao);
     
     if(!isMainThread)
         heThreadLoaderRequestVao(vao);
@@ -297,7 +717,7 @@ void heD3InstanceLoadBinary(std::string const& fileName, HeD3Instance* instance,
         std::string tex = line.substr(pos + 1);
 
         HeTexture* texture = heAssetPoolGetCompressedTexture("binres/textures/instances/" + tex, HE_TEXTURE_FILTER_TRILINEAR | HE_TEXTURE_FILTER_ANISOTROPIC | HE_TEXTURE_CLAMP_REPEAT);
-        instance->material->textures[name] = texture;
+        heMaterialSetTexture(instance->material, name, texture);
     }
     
     heTextureUnbind(0);    
@@ -307,10 +727,7 @@ void heD3InstanceLoadBinary(std::string const& fileName, HeD3Instance* instance,
     buffer.offset += 1; // skip \r\n
     
     HeD3MeshBuilder builder;
-    heBinaryBufferGetFloatBuffer(&buffer, &builder.verticesArray);
-    heBinaryBufferGetFloatBuffer(&buffer, &builder.uvArray);
-    heBinaryBufferGetFloatBuffer(&buffer, &builder.normalArray);
-    heBinaryBufferGetFloatBuffer(&buffer, &builder.tangentArray);
+    heD3MeshBuilderReadBinary(&builder, &buffer);
     HeVao* vao = &heAssetPool.meshPool[assetName];
     
 #ifdef HE_ENABLE_NAMES
@@ -328,18 +745,60 @@ void heD3InstanceLoadBinary(std::string const& fileName, HeD3Instance* instance,
     heVaoAddData(vao, builder.uvArray,       2, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, builder.normalArray,   3, HE_VBO_USAGE_STATIC);
     heVaoAddData(vao, builder.tangentArray,  3, HE_VBO_USAGE_STATIC);
+    heD3MeshBuilderCalculateBounds(&builder, vao);
 
     instance->mesh = vao;
     
     if(!isMainThread)
         heThreadLoaderRequestVao(vao);
     
+
+    // -- lods
+
+    int32_t chunk = -1;
+    if(heBinaryBufferAvailable(&buffer))
+        heBinaryBufferGetInt(&buffer, &chunk);
+
+    if(chunk == HE_ASSET_CHUNK_LODS) {
+        int32_t lodCount;
+        heBinaryBufferGetInt(&buffer, &lodCount);
+        vao->lods.reserve(lodCount);
+        for(int32_t i = 0; i < lodCount; ++i) {
+            HeVaoLod* lod = &vao->lods.emplace_back();
+            heBinaryBufferGetFloat(&buffer, &lod->screenSize);
+
+            HeD3MeshBuilder lodBuilder;
+            heD3MeshBuilderReadBinary(&lodBuilder, &buffer);
+            lod->vao = &heAssetPool.meshPool[assetName + "_lod" + std::to_string(i)];
+#ifdef HE_ENABLE_NAMES
+            lod->vao->name = assetName + "_lod" + std::to_string(i);
+#endif
+
+            if(isMainThread) {
+                heVaoCreate(lod->vao);
+                heVaoBind(lod->vao);
+            }
+            
+            heVaoAddData(lod->vao, lodBuilder.verticesArray, 3, HE_VBO_USAGE_STATIC);
+            heVaoAddData(lod->vao, lodBuilder.uvArray,       2, HE_VBO_USAGE_STATIC);
+            heVaoAddData(lod->vao, lodBuilder.normalArray,   3, HE_VBO_USAGE_STATIC);
+            heVaoAddData(lod->vao, lodBuilder.tangentArray,  3, HE_VBO_USAGE_STATIC);
+            heD3MeshBuilderCalculateBounds(&lodBuilder, lod->vao);
+
+            if(!isMainThread)
+                heThreadLoaderRequestVao(lod->vao);
+        }
+
+        chunk = -1;
+        if(heBinaryBufferAvailable(&buffer))
+            heBinaryBufferGetInt(&buffer, &chunk);
+    }
+    
     
     // -- physics
     
-    if(heBinaryBufferAvailable(&buffer) && physics) { // we still have data here
-        int32_t type;
-        heBinaryBufferGetInt(&buffer, &type);
+    if(chunk != -1 && physics) { // we still have data here
+        int32_t type = chunk;
         physics->type = (HePhysicsShapeType) type;
         heBinaryBufferGetFloat(&buffer, &physics->mass);
         heBinaryBufferGetFloat(&buffer, &physics->friction);
@@ -412,7 +871,7 @@ void heD3LevelLoad(std::string const& fileName, HeD3Level* level, b8 const loadP
                 heTextFileGetChar(&file, &c);
             }
             
-            HeD3Instance* instance = &level->instances.emplace_back();
+            HeD3Instance* instance = heD3LevelAddInstance(level);
             
             heTextFileGetFloats(&file, 3, &instance->transformation.position);
             heTextFileGetFloats(&file, 4, &instance->transformation.rotation);
@@ -462,10 +921,86 @@ void heD3LevelLoad(std::string const& fileName, HeD3Level* level, b8 const loadP
 	camera->position = hm::vec3f(0, 1, 0);
 	camera->rotation = hm::vec3f(0);
 	camera->viewMatrix = hm::createViewMatrix(camera->position, camera->rotation);
-    
+
+    heD3LevelBuildTree(level);
     heTextFileClose(&file);
 };
 
 void heD3LevelLoadBinary(std::string const& fileName, HeD3Level* level, b8 const loadPhysics) {
     
 };
+
+void heD3LevelBuildStaticBatches(HeD3Level* level, float const cellSize) {
+    heD3LevelClearStaticBatches(level);
+    heD3LevelUpdateBounds(level);
+
+    // group the static instances by their material and the cell that the center of their bounds falls into
+    typedef std::tuple<HeMaterial*, int32_t, int32_t, int32_t> HeD3StaticBatchKey;
+    std::map<HeD3StaticBatchKey, std::vector<uint32_t>> groups;
+    std::unordered_map<HeVao const*, HeD3MeshBuilder> meshes;
+    for(uint32_t i = 0; i < (uint32_t) level->instances.size(); ++i) {
+        HeD3Instance const* instance = &level->instances[i];
+        if(!heD3InstanceIsStatic(instance) || level->instanceBoundsExtents[i].x < 0.f)
+            continue;
+
+        auto it = meshes.find(instance->mesh);
+        if(it == meshes.end()) {
+            it = meshes.emplace(instance->mesh, HeD3MeshBuilder()).first;
+            if(!heD3MeshBuilderReadVao(&it->second, instance->mesh))
+                it->second.verticesArray.clear(); // mark as not batchable
+        }
+
+        if(it->second.verticesArray.empty())
+            continue;
+
+        hm::vec3f const& center = level->instanceBoundsCenters[i];
+        groups[HeD3StaticBatchKey(instance->material, (int32_t) std::floor(center.x / cellSize),
+                                  (int32_t) std::floor(center.y / cellSize), (int32_t) std::floor(center.z / cellSize))].emplace_back(i);
+    }
+
+    for(auto const& all : groups) {
+        // a single instance would not save any draw call
+        if(all.second.size() < 2)
+            continue;
+
+        HeD3MeshBuilder builder;
+        std::vector<uint32_t> slots;
+        hm::vec3f min(FLT_MAX);
+        hm::vec3f max(-FLT_MAX);
+        for(uint32_t index : all.second) {
+            HeD3Instance const* instance = &level->instances[index];
+            heD3MeshBuilderAppend(&builder, &meshes[instance->mesh], level->instanceWorldMatrices[index], level->instanceNormalMatrices[index]);
+            hm::vec3f instanceMin = level->instanceBoundsCenters[index] - level->instanceBoundsExtents[index];
+            hm::vec3f instanceMax = level->instanceBoundsCenters[index] + level->instanceBoundsExtents[index];
+            min.x = std::min(min.x, instanceMin.x);
+            min.y = std::min(min.y, instanceMin.y);
+            min.z = std::min(min.z, instanceMin.z);
+            max.x = std::max(max.x, instanceMax.x);
+            max.y = std::max(max.y, instanceMax.y);
+            max.z = std::max(max.z, instanceMax.z);
+            level->instanceFlags[index] |= HE_D3_INSTANCE_FLAG_BATCHED;
+            slots.emplace_back(instance->id.index);
+        }
+
+        HeD3StaticBatch* batch = &level->staticBatches.emplace_back();
+        batch->material      = std::get<0>(all.first);
+        batch->instanceCount = (uint32_t) all.second.size();
+        batch->instances     = std::move(slots);
+        batch->boundsCenter  = (min + max) / 2.f;
+        batch->boundsExtent  = (max - min) / 2.f;
+
+#ifdef HE_ENABLE_NAMES
+        batch->vao.name = "staticBatch" + std::to_string(level->staticBatches.size() - 1);
+#endif
+        
+        heVaoCreate(&batch->vao);
+        heVaoBind(&batch->vao);
+        heVaoAddData(&batch->vao, builder.verticesArray, 3, HE_VBO_USAGE_STATIC);
+        heVaoAddData(&batch->vao, builder.uvArray,       2, HE_VBO_USAGE_STATIC);
+        heVaoAddData(&batch->vao, builder.normalArray,   3, HE_VBO_USAGE_STATIC);
+        heVaoAddData(&batch->vao, builder.tangentArray,  3, HE_VBO_USAGE_STATIC);
+        heD3MeshBuilderCalculateBounds(&builder, &batch->vao);
+    }
+
+    HE_LOG("Merged static instances into " + std::to_string(level->staticBatches.size()) + " batches");
+};
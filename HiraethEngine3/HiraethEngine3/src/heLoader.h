@@ -3,6 +3,8 @@
 
 #include "heD3.h"
 
+struct HeBinaryBuffer; // forward declare to avoid include
+
 struct HeD3MeshBuilder {
     /* a list of all  */
     
@@ -21,6 +23,26 @@ struct HeD3MeshBuilder {
 };
 
 
+// parses an obj file into the data buffers of the builder without touching any gpu resources. Returns false if
+// the file could not be opened
+extern HE_API b8 heD3MeshBuilderParseObj(HeD3MeshBuilder* builder, std::string const& fileName);
+// reads the four mesh buffers (vertices, uvs, normals, tangents) of a binary h3asset into the builder. The buffer
+// must already be positioned at the start of the mesh data
+extern HE_API void heD3MeshBuilderReadBinary(HeD3MeshBuilder* builder, HeBinaryBuffer* buffer);
+// calculates the object space bounding box and sphere of the builders vertices and stores them in the vao
+extern HE_API void heD3MeshBuilderCalculateBounds(HeD3MeshBuilder const* builder, HeVao* vao);
+// reads the four mesh buffers of a vao created by the mesh loaders back into the builder. Returns false if the vao
+// does not have these buffers. Must be called from the main thread
+extern HE_API b8 heD3MeshBuilderReadVao(HeD3MeshBuilder* builder, HeVao const* vao);
+// simplifies the mesh in source by collapsing the edges with the lowest quadric error until at most targetTriangles
+// triangles are left, or until the next collapse would move the surface by more than maxError (relative to the
+// size of the mesh). Corners with the same position and uv are merged (averaging their normals and tangents), uv
+// seams and non-manifold edges are kept and borders only shrink along themselves. Stores the result in result and
+// returns the relative error of the worst collapse
+extern HE_API float heD3MeshBuilderSimplify(HeD3MeshBuilder const* source, HeD3MeshBuilder* result, uint32_t const targetTriangles, float const maxError = 1.f);
+// appends the data buffers of source to the builder. The vertices are transformed by given world matrix, the
+// normals by given normal matrix and the tangents by the rotation of the world matrix
+extern HE_API void heD3MeshBuilderAppend(HeD3MeshBuilder* builder, HeD3MeshBuilder const* source, hm::mat4f const& worldMatrix, hm::mat3f const& normalMatrix);
 // loads a 3d object from given file and stores the data in a vao from the asset pool. The name of the mesh in the
 // asset pool will be the file name. This loads the vertices, uvs, normals and tangents of the model
 extern HE_API void heMeshLoad(std::string const& fileName, HeVao* vao);
@@ -46,5 +68,9 @@ extern HE_API void heD3InstanceLoadBinary(std::string const& fileName, HeD3Insta
 extern HE_API void heD3LevelLoad(std::string const& fileName, HeD3Level* level, b8 const loadPhysics, b8 const binary);
 // loads a binary file level
 extern HE_API void heD3LevelLoadBinary(std::string const& fileName, HeD3Level* level, b8 const loadPhysics);
+// merges all static instances (see heD3InstanceIsStatic) of the level that share a material into static batches,
+// one per cell of cellSize units so that the batches can still be culled. The batches replace any existing ones and
+// are drawn instead of their instances. Should be called once after the level was loaded, from the main thread
+extern HE_API void heD3LevelBuildStaticBatches(HeD3Level* level, float const cellSize = 32.f);
 
 #endif
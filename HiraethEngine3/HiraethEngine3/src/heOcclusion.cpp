@@ -0,0 +1,243 @@
+#include "hepch.h"
+#include "heOcclusion.h"
+#include "heWorkerPool.h"
+#include "heCore.h"
+#include <xmmintrin.h>
+#include <cfloat>
+
+// vertices closer to the camera than this (in clip space w) are treated as behind the near plane
+static const float OCCLUSION_MIN_W = 1e-5f;
+
+// -- utils
+
+// projects a world space point into the buffer. Returns false if the point is behind the camera
+inline b8 heOcclusionProject(hm::mat4f const& matrix, hm::vec3f const& point, float const width, float const height, hm::vec3f* result) {
+    hm::vec4f clip = matrix * hm::vec4f(point, 1.f);
+    if(clip.w <= OCCLUSION_MIN_W)
+        return false;
+
+    float invW = 1.f / clip.w;
+    result->x = (clip.x * invW * .5f + .5f) * width;
+    result->y = (clip.y * invW * .5f + .5f) * height;
+    result->z = clip.z * invW * .5f + .5f;
+    return true;
+};
+
+// draws the part of the triangle that is inside the rows [firstRow, lastRow) into the buffer. Pixels are written if
+// their center is inside (or on an edge of) the triangle and the triangle is closer than the current depth, four
+// pixels at a time
+void heOcclusionRasterizeTriangle(HeOcclusionBuffer* buffer, hm::vec3f const* triangle, int32_t const firstRow, int32_t const lastRow) {
+    hm::vec3f a = triangle[0], b = triangle[1], c = triangle[2];
+
+    // the pixels whose centers can be inside the triangle
+    int32_t minY = std::max((int32_t) std::ceil(std::min(a.y, std::min(b.y, c.y)) - .5f), firstRow);
+    int32_t maxY = std::min((int32_t) std::floor(std::max(a.y, std::max(b.y, c.y)) - .5f), lastRow - 1);
+    if(minY > maxY)
+        return;
+
+    int32_t minX = std::max((int32_t) std::ceil(std::min(a.x, std::min(b.x, c.x)) - .5f), 0);
+    int32_t maxX = std::min((int32_t) std::floor(std::max(a.x, std::max(b.x, c.x)) - .5f), (int32_t) buffer->width - 1);
+    if(minX > maxX)
+        return;
+
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if(std::abs(area) < FLT_EPSILON)
+        return;
+
+    // make the triangle counter clockwise so that all edge functions are positive inside
+    if(area < 0.f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    // depth is linear in screen space: z = a.z + dzdx * (x - a.x) + dzdy * (y - a.y)
+    float invArea = 1.f / area;
+    float dzdx    = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) * invArea;
+    float dzdy    = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) * invArea;
+
+    // edge function of the edge from p to q: (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x)
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const ax = _mm_set1_ps(a.x), ay = _mm_set1_ps(a.y);
+    __m128 const bx = _mm_set1_ps(b.x), by = _mm_set1_ps(b.y);
+    __m128 const cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y);
+    __m128 const abx = _mm_set1_ps(b.x - a.x), aby = _mm_set1_ps(b.y - a.y);
+    __m128 const bcx = _mm_set1_ps(c.x - b.x), bcy = _mm_set1_ps(c.y - b.y);
+    __m128 const cax = _mm_set1_ps(a.x - c.x), cay = _mm_set1_ps(a.y - c.y);
+    __m128 const az  = _mm_set1_ps(a.z), vdzdx = _mm_set1_ps(dzdx), vdzdy = _mm_set1_ps(dzdy);
+
+    // pixels on an edge are written as well, so that there are no cracks between neighbouring triangles
+    // rows are stored with a width that is a multiple of four, so groups of four never leave a row
+    int32_t startX = minX & ~3;
+    for(int32_t y = minY; y <= maxY; ++y) {
+        __m128 py    = _mm_set1_ps((float) y + .5f);
+        __m128 dyA   = _mm_sub_ps(py, ay);
+        __m128 rowZ  = _mm_add_ps(az, _mm_mul_ps(vdzdy, dyA));
+        __m128 rowAB = _mm_mul_ps(abx, dyA);
+        __m128 rowBC = _mm_mul_ps(bcx, _mm_sub_ps(py, by));
+        __m128 rowCA = _mm_mul_ps(cax, _mm_sub_ps(py, cy));
+        float* row   = &buffer->depth[(size_t) y * buffer->width];
+
+        for(int32_t x = startX; x <= maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float) x), _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f));
+            __m128 e0 = _mm_sub_ps(rowAB, _mm_mul_ps(aby, _mm_sub_ps(px, ax)));
+            __m128 e1 = _mm_sub_ps(rowBC, _mm_mul_ps(bcy, _mm_sub_ps(px, bx)));
+            __m128 e2 = _mm_sub_ps(rowCA, _mm_mul_ps(cay, _mm_sub_ps(px, cx)));
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if(_mm_movemask_ps(inside) == 0)
+                continue;
+
+            __m128 z   = _mm_add_ps(rowZ, _mm_mul_ps(vdzdx, _mm_sub_ps(px, ax)));
+            __m128 old = _mm_loadu_ps(&row[x]);
+            __m128 closest = _mm_min_ps(old, z);
+            _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, closest), _mm_andnot_ps(inside, old)));
+        }
+    }
+};
+
+// updates the farthest depth of all tiles in given row of tiles
+void heOcclusionUpdateTiles(HeOcclusionBuffer* buffer, uint32_t const tileRow) {
+    uint32_t tilesX = buffer->width / HeOcclusionBuffer::TILE_SIZE;
+    for(uint32_t tx = 0; tx < tilesX; ++tx) {
+        __m128 farthest = _mm_setzero_ps();
+        for(uint32_t y = 0; y < HeOcclusionBuffer::TILE_SIZE; ++y) {
+            float const* pixels = &buffer->depth[(size_t) (tileRow * HeOcclusionBuffer::TILE_SIZE + y) * buffer->width + tx * HeOcclusionBuffer::TILE_SIZE];
+            farthest = _mm_max_ps(farthest, _mm_max_ps(_mm_loadu_ps(pixels), _mm_loadu_ps(pixels + 4)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, farthest);
+        buffer->tiles[(size_t) tileRow * tilesX + tx] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+};
+
+
+// -- occlusion buffer
+
+void heOcclusionBufferCreate(HeOcclusionBuffer* buffer, uint16_t const width, uint16_t const height) {
+    if(width % HeOcclusionBuffer::TILE_SIZE != 0 || height % HeOcclusionBuffer::TILE_SIZE != 0) {
+        HE_ERROR("Occlusion buffer size must be a multiple of the tile size");
+        return;
+    }
+
+    buffer->width  = width;
+    buffer->height = height;
+    buffer->depth.assign((size_t) width * height, 1.f);
+    buffer->tiles.assign((size_t) (width / HeOcclusionBuffer::TILE_SIZE) * (height / HeOcclusionBuffer::TILE_SIZE), 1.f);
+};
+
+void heOcclusionBufferClear(HeOcclusionBuffer* buffer, hm::mat4f const& viewProjection) {
+    buffer->viewProjection = viewProjection;
+    buffer->occluders.clear();
+    std::fill(buffer->depth.begin(), buffer->depth.end(), 1.f);
+    std::fill(buffer->tiles.begin(), buffer->tiles.end(), 1.f);
+};
+
+void heOcclusionBufferAddOccluder(HeOcclusionBuffer* buffer, std::vector<hm::vec3f> const* vertices, hm::mat4f const& transformation) {
+    HeOcclusionOccluder* occluder = &buffer->occluders.emplace_back();
+    occluder->vertices       = vertices;
+    occluder->transformation = transformation;
+};
+
+void heOcclusionBufferRender(HeOcclusionBuffer* buffer) {
+    // transform all triangles into screen space, every occluder writes to its own range
+    std::vector<uint32_t> offsets(buffer->occluders.size() + 1, 0);
+    for(size_t i = 0; i < buffer->occluders.size(); ++i)
+        offsets[i + 1] = offsets[i] + (uint32_t) buffer->occluders[i].vertices->size() / 3 * 3;
+    buffer->screenVertices.resize(offsets.back());
+
+    float width  = (float) buffer->width;
+    float height = (float) buffer->height;
+    heWorkerPoolRun(&heWorkerPool, (uint32_t) buffer->occluders.size(), 1, [&](uint32_t begin, uint32_t end) {
+        for(uint32_t i = begin; i < end; ++i) {
+            HeOcclusionOccluder const* occluder = &buffer->occluders[i];
+            hm::mat4f matrix = buffer->viewProjection * occluder->transformation;
+            hm::vec3f const* vertices = occluder->vertices->data();
+            hm::vec3f* screen = &buffer->screenVertices[offsets[i]];
+            for(uint32_t j = 0; j < offsets[i + 1] - offsets[i]; j += 3) {
+                // triangles that cross the near plane are dropped, which only makes the buffer less occluding
+                if(!heOcclusionProject(matrix, vertices[j],     width, height, &screen[j]) ||
+                   !heOcclusionProject(matrix, vertices[j + 1], width, height, &screen[j + 1]) ||
+                   !heOcclusionProject(matrix, vertices[j + 2], width, height, &screen[j + 2]))
+                    screen[j] = screen[j + 1] = screen[j + 2] = hm::vec3f(0.f);
+            }
+        }
+    });
+
+    // sort the triangles on screen into the rows of tiles they overlap
+    uint32_t tileRows = buffer->height / HeOcclusionBuffer::TILE_SIZE;
+    buffer->bins.resize(tileRows);
+    for(auto& all : buffer->bins)
+        all.clear();
+
+    for(uint32_t i = 0; i < (uint32_t) buffer->screenVertices.size(); i += 3) {
+        hm::vec3f const* v = &buffer->screenVertices[i];
+        float minX = std::min(v[0].x, std::min(v[1].x, v[2].x)), maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+        float minY = std::min(v[0].y, std::min(v[1].y, v[2].y)), maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+        if(maxX < 0.f || minX > width || maxY < 0.f || minY > height || minX == maxX || minY == maxY)
+            continue;
+
+        int32_t first = std::max((int32_t) minY, 0) / HeOcclusionBuffer::TILE_SIZE;
+        int32_t last  = std::min((int32_t) maxY, (int32_t) buffer->height - 1) / HeOcclusionBuffer::TILE_SIZE;
+        for(int32_t row = first; row <= last; ++row)
+            buffer->bins[row].emplace_back(i);
+    }
+
+    // every job owns a row of tiles, so no two jobs ever write the same pixel
+    heWorkerPoolRun(&heWorkerPool, tileRows, 1, [&](uint32_t begin, uint32_t end) {
+        for(uint32_t tileRow = begin; tileRow < end; ++tileRow) {
+            int32_t firstRow = tileRow * HeOcclusionBuffer::TILE_SIZE;
+            int32_t lastRow  = firstRow + HeOcclusionBuffer::TILE_SIZE;
+            for(uint32_t triangle : buffer->bins[tileRow])
+                heOcclusionRasterizeTriangle(buffer, &buffer->screenVertices[triangle], firstRow, lastRow);
+            heOcclusionUpdateTiles(buffer, tileRow);
+        }
+    });
+};
+
+b8 heOcclusionBufferTestBox(HeOcclusionBuffer const* buffer, hm::vec3f const& center, hm::vec3f const& extent) {
+    // screen space rectangle and closest depth of the box
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+    for(uint8_t i = 0; i < 8; ++i) {
+        hm::vec3f corner(center.x + ((i & 1) ? extent.x : -extent.x),
+                         center.y + ((i & 2) ? extent.y : -extent.y),
+                         center.z + ((i & 4) ? extent.z : -extent.z));
+        hm::vec3f screen;
+        if(!heOcclusionProject(buffer->viewProjection, corner, (float) buffer->width, (float) buffer->height, &screen))
+            return true;
+
+        minX = std::min(minX, screen.x);
+        minY = std::min(minY, screen.y);
+        maxX = std::max(maxX, screen.x);
+        maxY = std::max(maxY, screen.y);
+        minZ = std::min(minZ, screen.z);
+    }
+
+    // every pixel that the rectangle touches
+    int32_t firstX = std::max((int32_t) std::floor(minX), 0);
+    int32_t firstY = std::max((int32_t) std::floor(minY), 0);
+    int32_t lastX  = std::min((int32_t) std::floor(maxX), (int32_t) buffer->width  - 1);
+    int32_t lastY  = std::min((int32_t) std::floor(maxY), (int32_t) buffer->height - 1);
+    if(firstX > lastX || firstY > lastY)
+        return true; // not on screen, leave that to the frustum culling
+
+    int32_t const tileSize = HeOcclusionBuffer::TILE_SIZE;
+    uint32_t tilesX = buffer->width / tileSize;
+    for(int32_t ty = firstY / tileSize; ty <= lastY / tileSize; ++ty) {
+        for(int32_t tx = firstX / tileSize; tx <= lastX / tileSize; ++tx) {
+            // the whole tile is in front of the box
+            if(buffer->tiles[(size_t) ty * tilesX + tx] < minZ)
+                continue;
+
+            int32_t x0 = std::max(firstX, tx * tileSize), x1 = std::min(lastX, tx * tileSize + tileSize - 1);
+            int32_t y0 = std::max(firstY, ty * tileSize), y1 = std::min(lastY, ty * tileSize + tileSize - 1);
+            for(int32_t y = y0; y <= y1; ++y) {
+                float const* row = &buffer->depth[(size_t) y * buffer->width];
+                for(int32_t x = x0; x <= x1; ++x)
+                    if(row[x] >= minZ)
+                        return true;
+            }
+        }
+    }
+
+    return false;
+};
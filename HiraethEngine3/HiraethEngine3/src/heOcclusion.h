@@ -0,0 +1,59 @@
+#ifndef HE_OCCLUSION_H
+#define HE_OCCLUSION_H
+
+#include "heTypes.h"
+#include "hm/hm.hpp"
+
+struct HeOcclusionOccluder {
+    // the object space positions of the occluder, three per triangle
+    std::vector<hm::vec3f> const* vertices = nullptr;
+    // transforms the vertices into world space
+    hm::mat4f transformation;
+};
+
+// a small depth buffer that is rendered on the cpu and used to find objects that are completely hidden behind large
+// occluders (i.e. walls). Only pixels whose center is inside an occluder triangle are written and boxes are tested
+// with their closest depth against every pixel they touch, so hidden boxes may be reported visible but visible boxes
+// are only ever hidden if they peek through gaps smaller than a pixel. The buffer is split into tiles which store
+// the farthest depth of their pixels, so that most boxes can be rejected (or accepted) without looking at single
+// pixels
+struct HeOcclusionBuffer {
+    // the size of a tile in pixels (in both directions). The size of the buffer must be a multiple of this
+    static const uint16_t TILE_SIZE = 8;
+
+    uint16_t width  = 0;
+    uint16_t height = 0;
+    // the closest depth of any occluder per pixel (row by row, starting bottom left). Depth is in [0, 1], where 1 is
+    // the far plane (or no occluder at all)
+    std::vector<float> depth;
+    // the farthest depth of all pixels in a tile (row by row)
+    std::vector<float> tiles;
+    // the projection and view matrix of the camera that the buffer is rendered from
+    hm::mat4f viewProjection;
+
+    // the occluders added since the last clear
+    std::vector<HeOcclusionOccluder> occluders;
+    // the screen space corners (pixel x, pixel y, depth) of all occluder triangles. Triangles that cross the near
+    // plane are not drawn and stored as a single point
+    std::vector<hm::vec3f> screenVertices;
+    // the triangles (index of their first vertex in screenVertices) that overlap each row of tiles
+    std::vector<std::vector<uint32_t>> bins;
+};
+
+
+// -- occlusion buffer
+
+// allocates the buffer with given size in pixels. Both must be a multiple of the tile size
+extern HE_API void heOcclusionBufferCreate(HeOcclusionBuffer* buffer, uint16_t const width, uint16_t const height);
+// removes all occluders and resets the buffer to the far plane. Following occluders and tests use given camera
+// matrix
+extern HE_API void heOcclusionBufferClear(HeOcclusionBuffer* buffer, hm::mat4f const& viewProjection);
+// adds an occluder to the buffer. vertices must stay valid until the buffer was rendered
+extern HE_API void heOcclusionBufferAddOccluder(HeOcclusionBuffer* buffer, std::vector<hm::vec3f> const* vertices, hm::mat4f const& transformation);
+// rasterizes all occluders into the buffer on the worker pool (one job per row of tiles) and updates the tiles
+extern HE_API void heOcclusionBufferRender(HeOcclusionBuffer* buffer);
+// returns false if the given world space box (center and half size) is completely hidden behind the occluders.
+// Boxes that cross the near plane are always visible
+extern HE_API b8 heOcclusionBufferTestBox(HeOcclusionBuffer const* buffer, hm::vec3f const& center, hm::vec3f const& extent);
+
+#endif
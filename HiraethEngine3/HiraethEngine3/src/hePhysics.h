@@ -189,7 +189,7 @@ extern HE_API inline void hePhysicsActorSimpleJump(HePhysicsActorSimple* actor);
 extern HE_API inline hm::vec3f hePhysicsActorSimpleGetPosition(HePhysicsActorSimple const* actor);
 // returns the position of the eyes of this actor. The eye position depends on the eye offset in the actor
 // information. The eye position is usually where the camera should be placed
-extern HE_API inline hm::vec3f hePhysicsActorSimpleGetEyePosition(HePhysicsActorSimple const* actor);
+extern HE_API hm::vec3f hePhysicsActorSimpleGetEyePosition(HePhysicsActorSimple const* actor);
 // returns the rotation of that actor('s shape)1
 extern HE_API inline hm::quatf hePhysicsActorSimpleGetRotation(HePhysicsActorSimple const* actor);
 // returns true if the actor currently stands on solid ground
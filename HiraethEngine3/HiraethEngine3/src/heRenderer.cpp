@@ -58,7 +58,7 @@ void heRenderEngineCreate(HeRenderEngine* engine, HeWindow* window, HeRenderMode
     engine->shapes.particleVao->name = "particleVao";
     if(engine->renderMode == HE_RENDER_MODE_DEFERRED)
         engine->deferred.gBufferFbo.name = "gbufferFbo";
-    else if(engine->renderMode == HE_RENDER_MODE_FORWARD)
+    else
         engine->forward.forwardFbo.name  = "forwardFbo";
 #endif
 
@@ -124,14 +124,11 @@ void heRenderEngineCreate(HeRenderEngine* engine, HeWindow* window, HeRenderMode
     heVaoCreate(engine->shapes.particleVao);
     heVaoBind(engine->shapes.particleVao);
     heVaoAddData(engine->shapes.particleVao, { -1, 1, 1, 1, -1, -1, -1, -1, 1, 1, 1, -1 }, 2);
-    // transformation matrix
+    // instance data, see HeParticleInstance
     heVaoAllocateInstanced(engine->shapes.particleVao);
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 1, 4, HeParticleSource::FLOATS_PER_PARTICLE, 0);  // 4x4 transMat
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 2, 4, HeParticleSource::FLOATS_PER_PARTICLE, 4);
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 3, 4, HeParticleSource::FLOATS_PER_PARTICLE, 8);
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 4, 4, HeParticleSource::FLOATS_PER_PARTICLE, 12); 
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 5, 4, HeParticleSource::FLOATS_PER_PARTICLE, 16); // colour
-    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 6, 4, HeParticleSource::FLOATS_PER_PARTICLE, 20); // uvs
+    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 1, 4, HeParticleSource::FLOATS_PER_PARTICLE, 0);                        // position and size
+    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 2, 4, HeParticleSource::FLOATS_PER_PARTICLE, 4, HE_DATA_TYPE_UBYTE);  // colour
+    heVaoAllocateInstancedAttribute(engine->shapes.particleVao, 3, 2, HeParticleSource::FLOATS_PER_PARTICLE, 5, HE_DATA_TYPE_USHORT); // atlas index and intensity
     engine->particleShader = heAssetPoolGetShader("3d_particles");
     
     heUiQueueCreate(&engine->uiQueue);
@@ -158,16 +155,21 @@ void heRenderEngineCreate(HeRenderEngine* engine, HeWindow* window, HeRenderMode
         heFboCreateColourTextureAttachment(&engine->deferred.gBufferFbo, HE_COLOUR_FORMAT_RGB8);   // creates arm texture
         heFboCreateColourTextureAttachment(&engine->deferred.gBufferFbo, HE_COLOUR_FORMAT_RGB16);  // creates emission texture
 
-    } else if(engine->renderMode == HE_RENDER_MODE_FORWARD) {
+    } else {
         engine->forward.forwardFbo.size = engine->window->windowInfo.size;
         heFboCreate(&engine->forward.forwardFbo);
         heFboCreateColourBufferAttachment(&engine->forward.forwardFbo, HE_COLOUR_FORMAT_RGBA16, 4);
         heFboCreateDepthBufferAttachment(&engine->forward.forwardFbo, 4);
         heFboValidate(&engine->forward.forwardFbo);
         
-        heUboAllocate(&engine->forward.lightsUbo, "u_lights", 127 * (16 * sizeof(float)));
+        heUboAllocate(&engine->forward.lightsUbo, "u_lights", HeD3LightClusters::MAX_LIGHTS * (16 * sizeof(float)));
         heUboAllocate(&engine->forward.lightsUbo, "numLights", sizeof(int32_t));
         heUboCreate(&engine->forward.lightsUbo);
+
+        // the forward shaders declare the cluster samplers in both forward modes (they are only read if u_clustered
+        // is set), so the buffers always exist to give them a texture of the right type
+        heTextureBufferCreate(&engine->forward.clusterBuffer, HE_COLOUR_FORMAT_RG32UI);
+        heTextureBufferCreate(&engine->forward.clusterLightsBuffer, HE_COLOUR_FORMAT_R32UI);
     }
 };
 
@@ -179,7 +181,7 @@ void heRenderEngineResize(HeRenderEngine* engine) {
 
         if(engine->renderMode == HE_RENDER_MODE_DEFERRED)
             heFboResize(&engine->deferred.gBufferFbo, engine->window->windowInfo.size);
-        else if(engine->renderMode == HE_RENDER_MODE_FORWARD)
+        else
             heFboResize(&engine->forward.forwardFbo, engine->window->windowInfo.size);
         
         if(engine->postProcess.initialized) {
@@ -211,6 +213,8 @@ void heRenderEngineDestroy(HeRenderEngine* engine) {
         heFboDestroy(&engine->deferred.gBufferFbo);
     } else {
         heFboDestroy(&engine->forward.forwardFbo);
+        heTextureBufferDestroy(&engine->forward.clusterBuffer);
+        heTextureBufferDestroy(&engine->forward.clusterLightsBuffer);
     }   
 
     heUboDestroy(&engine->forward.lightsUbo);
@@ -221,6 +225,8 @@ void heRenderEngineDestroy(HeRenderEngine* engine) {
 };
 
 void heRenderEnginePrepare(HeRenderEngine* engine) {
+    // report the gl calls of the last frame
+    heGlStateFlushCounters();
     heRenderEngineResize(engine);
     heFrameClear(engine->window->windowInfo.backgroundColour, HE_FRAME_BUFFER_BIT_COLOUR | HE_FRAME_BUFFER_BIT_DEPTH);
 };
@@ -230,103 +236,203 @@ void heRenderEngineFinish(HeRenderEngine* engine) {
 };
 
 void heShaderLoadMaterial(HeRenderEngine* engine, HeShaderProgram* shader, HeMaterial const* material) {
+    static HeUniformId const emission     = heShaderGetUniformId("u_emission");
+    static HeUniformId const materialType = heShaderGetUniformId("u_materialType");
+
     if(engine->renderMode == HE_RENDER_MODE_DEFERRED)
         heShaderClearSamplers(shader);
 
-    for (const auto& textures : material->textures)
-        heTextureBind(textures.second, heShaderGetSamplerLocation(shader, "t_" + textures.first));
+    for (HeMaterialTexture const& textures : material->textureIds)
+        heTextureBind(*textures.texture, heShaderGetSamplerLocation(shader, textures.id));
     
-    for (const auto& uniforms : material->uniforms)
-        heShaderLoadUniform(shader, "u_" + uniforms.first, &uniforms.second);
+    for (HeMaterialUniform const& uniforms : material->uniformIds)
+        heShaderLoadUniform(shader, uniforms.id, uniforms.data);
 
-    heShaderLoadUniform(shader, "u_emission", material->emission);
+    heShaderLoadUniform(shader, emission, material->emission);
     if(engine->renderMode == HE_RENDER_MODE_DEFERRED)
-        heShaderLoadUniform(shader, "u_materialType", material->type);
+        heShaderLoadUniform(shader, materialType, material->type);
+};
+
+// the ids of the members of a light uniform (u_light or an element of u_lights)
+struct HeLightUniformIds {
+    HeUniformId vector;
+    HeUniformId colour;
+    HeUniformId type;
+    HeUniformId data1;
+    HeUniformId data2;
+};
+
+// returns the ids of the light uniform with given index (-1 for u_light). The names are only built the first time an
+// index is used
+HeLightUniformIds const& heShaderGetLightUniformIds(int8_t const index) {
+    static std::vector<HeLightUniformIds> ids; // u_light first, then u_lights[i]
+    uint32_t slot = (uint32_t) (index + 1);
+    while(ids.size() <= slot) {
+        std::string name = ids.empty() ? "u_light" : "u_lights[" + std::to_string(ids.size() - 1) + "]";
+        ids.emplace_back(HeLightUniformIds{ heShaderGetUniformId(name + ".vector"), heShaderGetUniformId(name + ".colour"),
+                    heShaderGetUniformId(name + ".type"), heShaderGetUniformId(name + ".data1"), heShaderGetUniformId(name + ".data2") });
+    }
+
+    return ids[slot];
 };
 
 void heShaderLoadLight(HeShaderProgram* program, HeD3LightSource const* light, int8_t const index) {
-    std::string uniformName;
-    if (index == -1)
-        uniformName = "u_light";
-    else
-        uniformName = "u_lights[" + std::to_string(index) + "]";
-    
-    heShaderLoadUniform(program, uniformName + ".vector", light->vector);
-    heShaderLoadUniform(program, uniformName + ".colour", light->colour);
-    heShaderLoadUniform(program, uniformName + ".type",   light->type);
-    heShaderLoadUniform(program, uniformName + ".data1",  hm::vec4f(light->data[0], light->data[1], light->data[2], light->data[3]));
-    heShaderLoadUniform(program, uniformName + ".data2", hm::vec4f(light->data[4], light->data[5], light->data[6], light->data[7]));
+    HeLightUniformIds const& ids = heShaderGetLightUniformIds(index);
+    heShaderLoadUniform(program, ids.vector, light->vector);
+    heShaderLoadUniform(program, ids.colour, light->colour);
+    heShaderLoadUniform(program, ids.type,   light->type);
+    heShaderLoadUniform(program, ids.data1,  hm::vec4f(light->data[0], light->data[1], light->data[2], light->data[3]));
+    heShaderLoadUniform(program, ids.data2,  hm::vec4f(light->data[4], light->data[5], light->data[6], light->data[7]));
 };
 
-void heD3ShadowMapRenderDirectional(HeRenderEngine* engine, HeD3ShadowMap* shadowMap, HeD3LightSource* source, HeD3Level* level) {
-    { // create bounding box around the shadow map
-        shadowMap->frustum.viewInfo.nearPlane = 0.1f;
-        shadowMap->frustum.viewInfo.farPlane  = shadowMap->shadowDistance;
-        shadowMap->frustum.viewInfo.fov       = level->camera.frustum.viewInfo.fov;
+// draws the instance with given index as a single caster into the currently bound shadow map
+void heD3ShadowMapRenderInstance(HeRenderEngine* engine, HeD3Level* level, uint32_t const index) {
+    static struct {
+        HeUniformId transMat = heShaderGetUniformId("u_transMat");
+        HeUniformId diffuse  = heShaderGetUniformId("t_diffuse");
+    } const ids;
+
+    HeD3Instance const* instance = &level->instances[index];
+    heD3LevelUpdateInstanceMatrices(level, index);
+    heShaderLoadUniform(engine->shadowShader, ids.transMat, level->instanceWorldMatrices[index]);
+    heTextureBind(heMaterialGetTexture(instance->material, ids.diffuse), heShaderGetSamplerLocation(engine->shadowShader, ids.diffuse));
+    HeVao* mesh = heD3InstanceGetMesh(instance);
+    heVaoBind(mesh);
+    heVaoRender(mesh);
+};
 
-        heD3FrustumUpdateWithMatrix(&shadowMap->frustum, engine->window, level->camera.position, level->camera.rotation, shadowMap->viewMatrix);
-        shadowMap->frustum.bounds[1].z += shadowMap->offset; // make sure that objects behind us cast shadows as well
-    }
+// draws a static batch into the currently bound shadow map. Batches are already in world space, so u_transMat must
+// be the identity
+void heD3ShadowMapRenderBatch(HeRenderEngine* engine, HeD3StaticBatch* batch) {
+    static struct {
+        HeUniformId diffuse = heShaderGetUniformId("t_diffuse");
+    } const ids;
 
-    { // update projection matrix
-        shadowMap->projectionMatrix = hm::mat4f(1.0f);
-        hm::vec3f dimensions(shadowMap->frustum.bounds[1] - shadowMap->frustum.bounds[0]);
+    heTextureBind(heMaterialGetTexture(batch->material, ids.diffuse), heShaderGetSamplerLocation(engine->shadowShader, ids.diffuse));
+    heVaoBind(&batch->vao);
+    heVaoRender(&batch->vao);
+};
 
-        shadowMap->projectionMatrix[0][0] =  2.f / (dimensions.x); 
-        shadowMap->projectionMatrix[1][1] =  2.f / (dimensions.y);
-        shadowMap->projectionMatrix[2][2] = -2.f / (dimensions.z); 
-        shadowMap->projectionMatrix[3][3] =  1.f; 
+uint8_t heD3ShadowMapRenderDirectional(HeRenderEngine* engine, HeD3ShadowMap* shadowMap, HeD3LightSource* source, HeD3Level* level) {
+    static struct {
+        HeUniformId viewMat  = heShaderGetUniformId("u_viewMat");
+        HeUniformId projMat  = heShaderGetUniformId("u_projMat");
+        HeUniformId transMat = heShaderGetUniformId("u_transMat");
+    } const ids;
+
+    heD3ShadowMapUpdateCascades(shadowMap, source, &level->camera);
+    heD3LevelCullShadowCasters(level, source);
+    uint8_t outdated = (shadowMap->cacheStatic) ? heD3ShadowMapUpdateCache(shadowMap, level) : 0;
+    uint8_t rebuilt  = 0;
+    
+    heShaderBind(engine->shadowShader);
+    heDepthEnable(true);
+    heDepthFunc();
+    heBlendMode();
+
+    if(outdated != 0) { // render the static casters of the outdated cascades into the cache
+        heFboBind(&shadowMap->staticFbo);
+        heCullEnable(true);
+        heShaderLoadUniform(engine->shadowShader, ids.viewMat, shadowMap->viewMatrix);
+        for(uint8_t i = 0; i < shadowMap->cascadeCount; ++i) {
+            if((outdated & (1 << i)) == 0)
+                continue;
+
+            HeD3ShadowCascade const* cascade = &shadowMap->cascades[i];
+            hm::vec2i lowerleft = hm::vec2i(i % 2, i / 2) * shadowMap->resolution;
+            heViewport(lowerleft, shadowMap->resolution);
+            heFrameClearRegion(hm::colour(0), HE_FRAME_BUFFER_BIT_DEPTH, lowerleft, shadowMap->resolution);
+            heShaderLoadUniform(engine->shadowShader, ids.projMat, cascade->projectionMatrix);
+
+            // all static casters in the box of the cascade, not only those whose shadow is currently visible
+            for(uint32_t j = 0; j < (uint32_t) level->instances.size(); ++j)
+                if(!(level->instanceFlags[j] & HE_D3_INSTANCE_FLAG_BATCHED) && heD3InstanceIsStatic(&level->instances[j]) &&
+                   heD3FrustumContainsBox(&cascade->frustum, level->instanceBoundsCenters[j], level->instanceBoundsExtents[j]))
+                    heD3ShadowMapRenderInstance(engine, level, j);
+
+            heShaderLoadUniform(engine->shadowShader, ids.transMat, hm::mat4f(1.f));
+            for(auto& all : level->staticBatches)
+                if(all.instanceCount > 0 && heD3FrustumContainsBox(&cascade->frustum, all.boundsCenter, all.boundsExtent))
+                    heD3ShadowMapRenderBatch(engine, &all);
+
+            rebuilt++;
+        }
     }
 
-    { // update view matrix
-        hm::vec3f direction = hm::normalize(source->vector);
-        hm::vec4f center    = hm::vec4f((shadowMap->frustum.bounds[0] + shadowMap->frustum.bounds[1]) / 2.f, 1.f);
-        hm::mat4f invLight  = hm::inverse(shadowMap->viewMatrix);
-        center = invLight * center;
+    { // render the other casters on top of the cache
+        if(shadowMap->cacheStatic)
+            heFboCopyDepth(&shadowMap->staticFbo, &shadowMap->depthFbo);
         
-        float yaw = (float) hm::to_degrees(std::atan(direction.x / direction.z));
-        yaw = direction.z > 0 ? yaw - 180 : yaw;
-        float pitch = hm::to_degrees(std::acos(hm::length(hm::vec2f(direction.x, direction.z))));
-        shadowMap->viewMatrix = hm::mat4f(1.f);
-        shadowMap->viewMatrix = hm::rotate(shadowMap->viewMatrix, pitch, hm::vec3f(1, 0, 0));
-        shadowMap->viewMatrix = hm::rotate(shadowMap->viewMatrix, -yaw, hm::vec3f(0, 1, 0));
-        shadowMap->viewMatrix = hm::translate(shadowMap->viewMatrix, -hm::vec3f(center));    
-    }
+        heFboBind(&shadowMap->depthFbo);
+        if(!shadowMap->cacheStatic)
+            heFrameClear(hm::colour(0), HE_FRAME_BUFFER_BIT_DEPTH);
+
+        for(uint8_t i = 0; i < shadowMap->cascadeCount; ++i) {
+            HeD3ShadowCascade const* cascade = &shadowMap->cascades[i];
+            heViewport(hm::vec2i(i % 2, i / 2) * shadowMap->resolution, shadowMap->resolution);
+            heShaderBind(engine->shadowShader);
+            heCullEnable(true);
+            heShaderLoadUniform(engine->shadowShader, ids.projMat, cascade->projectionMatrix);
+            heShaderLoadUniform(engine->shadowShader, ids.viewMat, shadowMap->viewMatrix);
+            for(uint32_t index : shadowMap->casters) {
+                if((shadowMap->cacheStatic && heD3InstanceIsStatic(&level->instances[index])) ||
+                   !heD3FrustumContainsBox(&cascade->frustum, level->instanceBoundsCenters[index], level->instanceBoundsExtents[index]))
+                    continue;
+
+                heD3ShadowMapRenderInstance(engine, level, index);
+            }
+
+            if(!shadowMap->cacheStatic) {
+                heShaderLoadUniform(engine->shadowShader, ids.transMat, hm::mat4f(1.f));
+                for(uint32_t index : shadowMap->casterBatches) {
+                    HeD3StaticBatch* batch = &level->staticBatches[index];
+                    if(heD3FrustumContainsBox(&cascade->frustum, batch->boundsCenter, batch->boundsExtent))
+                        heD3ShadowMapRenderBatch(engine, batch);
+                }
+            }
+        
+            heCullEnable(false);
+            heShaderBind(engine->particleShader);
+            heShaderLoadUniform(engine->particleShader, ids.projMat, cascade->projectionMatrix);
+            heShaderLoadUniform(engine->particleShader, ids.viewMat, shadowMap->viewMatrix);
+            heVaoBind(engine->shapes.particleVao);
+            for(auto const& all : level->particles)
+                if(all.enableShadows && heD3FrustumContainsBox(&cascade->frustum, all.boundsCenter, all.boundsExtent))
+                    heParticleSourceRenderForward(engine, &all, level);
+        }
 
-    { // update shadow space matrix
-        shadowMap->offsetMatrix = hm::translate(hm::mat4f(1.f), hm::vec3f(.5f));
-        shadowMap->offsetMatrix = hm::scale(shadowMap->offsetMatrix, hm::vec3f(.5f));
-        shadowMap->shadowSpaceMatrix = shadowMap->offsetMatrix * (shadowMap->projectionMatrix * shadowMap->viewMatrix);
+        heFboUnbind(engine->window->windowInfo.size);
     }
 
-    { // render entities in shadow map
-        heShaderBind(engine->shadowShader);
-        heFboBind(&shadowMap->depthFbo);
-        heDepthEnable(true);
-        heCullEnable(true);
-        heDepthFunc();
-        heBlendMode();
-        heFrameClear(hm::colour(0), HE_FRAME_BUFFER_BIT_DEPTH);
-        heShaderLoadUniform(engine->shadowShader, "u_projMat", shadowMap->projectionMatrix);
-        heShaderLoadUniform(engine->shadowShader, "u_viewMat", shadowMap->viewMatrix);
-        for(auto const& all : level->instances) {
-            hm::mat4f transMat = hm::createTransformationMatrix(all.transformation.position, all.transformation.rotation, all.transformation.scale);
-            heShaderLoadUniform(engine->shadowShader, "u_transMat", transMat);
-            heTextureBind(all.material->textures["diffuse"], heShaderGetSamplerLocation(engine->shadowShader, "t_diffuse"));
-            heVaoBind(all.mesh);
-            heVaoRender(all.mesh);
+    return rebuilt;
+};
+
+// loads the cascades of given shadow map into the shader. If map is nullptr, the shader does not use shadows
+void heShaderLoadShadows(HeShaderProgram* program, HeD3ShadowMap const* map) {
+    static HeUniformId const cascadeCount = heShaderGetUniformId("u_shadowCascadeCount");
+    static HeUniformId const shadowMap    = heShaderGetUniformId("t_shadowMap");
+    static HeUniformId spaces[HeD3ShadowMap::MAX_CASCADES];
+    static HeUniformId cascades[HeD3ShadowMap::MAX_CASCADES];
+    static b8 initialized = false;
+    if(!initialized) {
+        for(uint8_t i = 0; i < HeD3ShadowMap::MAX_CASCADES; ++i) {
+            spaces[i]   = heShaderGetUniformId("u_shadowSpaces[" + std::to_string(i) + "]");
+            cascades[i] = heShaderGetUniformId("u_shadowCascades[" + std::to_string(i) + "]");
         }
-        
-        heCullEnable(false);
-        heShaderBind(engine->particleShader);
-        heShaderLoadUniform(engine->particleShader, "u_projMat", shadowMap->projectionMatrix);
-        heShaderLoadUniform(engine->particleShader, "u_viewMat", shadowMap->viewMatrix);
-        heVaoBind(engine->shapes.particleVao);
-        for(auto const& all : level->particles)
-            if(all.enableShadows)
-                heParticleSourceRenderForward(engine, &all, level);
 
-        heFboUnbind(engine->window->windowInfo.size);
+        initialized = true;
+    }
+
+    if(map == nullptr) {
+        heShaderLoadUniform(program, cascadeCount, (int32_t) 0);
+        return;
+    }
+
+    heTextureBind(map->depthFbo.depthAttachment.id, heShaderGetSamplerLocation(program, shadowMap));
+    heShaderLoadUniform(program, cascadeCount, (int32_t) map->cascadeCount);
+    for(uint8_t i = 0; i < map->cascadeCount; ++i) {
+        heShaderLoadUniform(program, spaces[i], map->cascades[i].shadowSpaceMatrix);
+        heShaderLoadUniform(program, cascades[i], map->cascades[i].atlasRect);
     }
 };
 
@@ -351,27 +457,67 @@ void heD3FrustumRender(HeRenderEngine* engine, HeD3Frustum* frustum, hm::colour
 };
 
 void heD3LevelRenderDeferred(HeRenderEngine* engine, HeD3Level* level) {
+    static struct {
+        HeUniformId viewMat       = heShaderGetUniformId("u_viewMat");
+        HeUniformId projMat       = heShaderGetUniformId("u_projMat");
+        HeUniformId worldSpace    = heShaderGetUniformId("t_worldSpace");
+        HeUniformId normals       = heShaderGetUniformId("t_normals");
+        HeUniformId diffuse       = heShaderGetUniformId("t_diffuse");
+        HeUniformId arm           = heShaderGetUniformId("t_arm");
+        HeUniformId emission      = heShaderGetUniformId("t_emission");
+        HeUniformId irradiance    = heShaderGetUniformId("t_irradiance");
+        HeUniformId specular      = heShaderGetUniformId("t_specular");
+        HeUniformId brdf          = heShaderGetUniformId("t_brdf");
+        HeUniformId cameraPos     = heShaderGetUniformId("u_cameraPos");
+        HeUniformId realDepthTest = heShaderGetUniformId("u_realDepthTest");
+        HeUniformId skybox        = heShaderGetUniformId("t_skybox");
+        HeUniformId alphaTest     = heShaderGetUniformId("t_alphaTest");
+    } const ids;
+
     // render all cts into the gbuffer
     heFboBind(&engine->deferred.gBufferFbo);
     heFrameClear(hm::colour(0, 0, 0, 0), HE_FRAME_BUFFER_BIT_COLOUR | HE_FRAME_BUFFER_BIT_DEPTH);
 
     heShaderBind(engine->deferred.gBufferShader);
-    heShaderLoadUniform(engine->deferred.gBufferShader, "u_viewMat", level->camera.viewMatrix);
-    heShaderLoadUniform(engine->deferred.gBufferShader, "u_projMat", level->camera.projectionMatrix);
-
-    for(auto const& all : level->instances) {
-        if(all.mesh == nullptr)
-            continue;
+    heShaderLoadUniform(engine->deferred.gBufferShader, ids.viewMat, level->camera.viewMatrix);
+    heShaderLoadUniform(engine->deferred.gBufferShader, ids.projMat, level->camera.projectionMatrix);
+
+    // everything uses the gbuffer shader here, but the queue still groups draws by their material. Transparent
+    // materials cannot be blended into the gbuffer, they are just drawn last
+    static HeUniformId const transMat = heShaderGetUniformId("u_transMat");
+    static HeUniformId const normMat  = heShaderGetUniformId("u_normMat");
+    HeMaterial const* material = nullptr;
+    uint32_t materialChanges   = 0;
+    for(HeD3RenderItem const& item : level->renderQueue.items) {
+        HeMaterial const* itemMaterial;
+        HeVao* mesh;
+        if(!item.batch) {
+            // render instance into the gbuffer
+            HeD3Instance* instance = &level->instances[item.index];
+            heShaderLoadUniform(engine->deferred.gBufferShader, transMat, level->instanceWorldMatrices[item.index]);
+            heShaderLoadUniform(engine->deferred.gBufferShader, normMat,  level->instanceNormalMatrices[item.index]);
+            itemMaterial = instance->material;
+            mesh         = heD3InstanceGetMesh(instance);
+        } else {
+            // batches are already in world space
+            HeD3StaticBatch* batch = &level->staticBatches[item.index];
+            heShaderLoadUniform(engine->deferred.gBufferShader, transMat, hm::mat4f(1.f));
+            heShaderLoadUniform(engine->deferred.gBufferShader, normMat,  hm::mat3f(1.f));
+            itemMaterial = batch->material;
+            mesh         = &batch->vao;
+        }
 
-        // render instance into the gbuffer
-        hm::mat4f transMat = hm::createTransformationMatrix(all.transformation.position, all.transformation.rotation, all.transformation.scale);
-        heShaderLoadUniform(engine->deferred.gBufferShader, "u_transMat", transMat);
-        heShaderLoadUniform(engine->deferred.gBufferShader, "u_normMat",  hm::transpose(hm::inverse(hm::mat3f(transMat))));
-        heShaderLoadMaterial(engine, engine->deferred.gBufferShader, all.material);
+        if(itemMaterial != material) {
+            heShaderLoadMaterial(engine, engine->deferred.gBufferShader, itemMaterial);
+            material = itemMaterial;
+            materialChanges++;
+        }
         
-        heVaoBind(all.mesh);
-        heVaoRender(all.mesh);
+        heVaoBind(mesh);
+        heVaoRender(mesh);
     }
+
+    heProfilerAddCounter("material changes", materialChanges);
     
     heShaderBind(engine->deferred.gLightingShader);
     heCullEnable(false);
@@ -392,15 +538,15 @@ void heD3LevelRenderDeferred(HeRenderEngine* engine, HeD3Level* level) {
         heFboBind(&engine->hdrFbo);
         heFrameClear(hm::colour(0), HE_FRAME_BUFFER_BIT_COLOUR);
         
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_worldSpace", texCount++));
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_normals", texCount++));
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[2].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_diffuse", texCount++));
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[3].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_arm", texCount++));
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[4].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_emission", texCount++));
-        heTextureBind(level->skybox.irradiance, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_irradiance", texCount++));
-        heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_specular", texCount++));
-        heTextureBind(engine->brdfIntegration, heShaderGetSamplerLocation(engine->deferred.gLightingShader, "t_brdf", texCount++));
-        heShaderLoadUniform(engine->deferred.gLightingShader, "u_cameraPos", level->camera.position);
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.worldSpace, texCount++));
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.normals, texCount++));
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[2].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.diffuse, texCount++));
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[3].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.arm, texCount++));
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[4].id, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.emission, texCount++));
+        heTextureBind(level->skybox.irradiance, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.irradiance, texCount++));
+        heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.specular, texCount++));
+        heTextureBind(engine->brdfIntegration, heShaderGetSamplerLocation(engine->deferred.gLightingShader, ids.brdf, texCount++));
+        heShaderLoadUniform(engine->deferred.gLightingShader, ids.cameraPos, level->camera.position);
         heUiSetQuadVao(engine->shapes.quadVao);
         heVaoRender(engine->shapes.quadVao);
     } else {
@@ -413,11 +559,11 @@ void heD3LevelRenderDeferred(HeRenderEngine* engine, HeD3Level* level) {
         heDepthEnable(false);
         heVaoBind(engine->shapes.cubeVao);
         heShaderBind(engine->skyboxShader);
-        heShaderLoadUniform(engine->skyboxShader, "u_projMat", level->camera.projectionMatrix);
-        heShaderLoadUniform(engine->skyboxShader, "u_viewMat", level->camera.viewMatrix);
-        heShaderLoadUniform(engine->skyboxShader, "u_realDepthTest", false);
-        heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->skyboxShader, "t_skybox", 0));
-        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->skyboxShader, "t_alphaTest", 1));
+        heShaderLoadUniform(engine->skyboxShader, ids.projMat, level->camera.projectionMatrix);
+        heShaderLoadUniform(engine->skyboxShader, ids.viewMat, level->camera.viewMatrix);
+        heShaderLoadUniform(engine->skyboxShader, ids.realDepthTest, false);
+        heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->skyboxShader, ids.skybox, 0));
+        heTextureBind(engine->deferred.gBufferFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->skyboxShader, ids.alphaTest, 1));
         heVaoRender(engine->shapes.cubeVao);
     }
 
@@ -426,31 +572,91 @@ void heD3LevelRenderDeferred(HeRenderEngine* engine, HeD3Level* level) {
 };
 
 void heParticleSourceRenderForward(HeRenderEngine* engine, HeParticleSource const* source, HeD3Level* level) {
+    static struct {
+        HeUniformId atlas          = heShaderGetUniformId("t_atlas");
+        HeUniformId cameraRight    = heShaderGetUniformId("u_cameraRight");
+        HeUniformId cameraUp       = heShaderGetUniformId("u_cameraUp");
+        HeUniformId spriteSize     = heShaderGetUniformId("u_spriteSize");
+        HeUniformId atlasColumns   = heShaderGetUniformId("u_atlasColumns");
+        HeUniformId receiveShadows = heShaderGetUniformId("u_receiveShadows");
+    } const ids;
+
+    if(source->aliveCount == 0)
+        return;
+    
     heBlendMode(source->additive);
-    heTextureBind(source->atlas->texture, heShaderGetSamplerLocation(engine->particleShader, "t_atlas"));
-    heVaoUpdateData(engine->shapes.particleVao, source->dataBuffer, 1, source->particleCount * source->FLOATS_PER_PARTICLE);
-    heShaderLoadUniform(engine->particleShader, "u_receiveShadows", source->enableShadows);
-    heVaoRenderInstanced(engine->shapes.particleVao, source->particleCount);
+    heTextureBind(source->atlas->texture, heShaderGetSamplerLocation(engine->particleShader, ids.atlas));
+    // the camera axes that the quads are spanned along
+    hm::mat4f const& view = level->camera.viewMatrix;
+    heShaderLoadUniform(engine->particleShader, ids.cameraRight, hm::vec3f(view[0][0], view[1][0], view[2][0]));
+    heShaderLoadUniform(engine->particleShader, ids.cameraUp,    hm::vec3f(view[0][1], view[1][1], view[2][1]));
+    // the uvs of the sprites are looked up in the vertex shader
+    hm::vec4f sprite = heSpriteAtlasGetUvs(source->atlas, 0);
+    heShaderLoadUniform(engine->particleShader, ids.spriteSize,   hm::vec2f(sprite.z, sprite.w));
+    heShaderLoadUniform(engine->particleShader, ids.atlasColumns, (int32_t) source->atlas->columns);
+    heVaoUpdateData(engine->shapes.particleVao, (float const*) source->dataBuffer, 1, source->aliveCount * source->FLOATS_PER_PARTICLE);
+    heShaderLoadUniform(engine->particleShader, ids.receiveShadows, source->enableShadows);
+    heVaoRenderInstanced(engine->shapes.particleVao, source->aliveCount);
+};
+
+void heD3InstanceRenderForward(HeRenderEngine* engine, HeD3Level* level, uint32_t const index, b8 const loadMaterial) {
+    static HeUniformId const transMat = heShaderGetUniformId("u_transMat");
+    static HeUniformId const normMat  = heShaderGetUniformId("u_normMat");
+
+    HeD3Instance const* instance = &level->instances[index];
+    heD3LevelUpdateInstanceMatrices(level, index);
+    heShaderLoadUniform(instance->material->shader, transMat, level->instanceWorldMatrices[index]);
+    heShaderLoadUniform(instance->material->shader, normMat,  level->instanceNormalMatrices[index]);
+    if(loadMaterial)
+        heShaderLoadMaterial(engine, instance->material->shader, instance->material);
+    HeVao* mesh = heD3InstanceGetMesh(instance);
+    heVaoBind(mesh);
+    heVaoRender(mesh);
 };
 
-void heD3InstanceRenderForward(HeRenderEngine* engine, HeD3Instance* instance) {
-    hm::mat4f transMat = hm::createTransformationMatrix(instance->transformation.position, instance->transformation.rotation, instance->transformation.scale);
-    heShaderLoadUniform(instance->material->shader, "u_transMat", transMat);
-    heShaderLoadUniform(instance->material->shader, "u_normMat", hm::transpose(hm::inverse(hm::mat3f(transMat))));
-    heShaderLoadMaterial(engine, instance->material->shader, instance->material);
-    heVaoBind(instance->mesh);
-    heVaoRender(instance->mesh);
+void heD3StaticBatchRenderForward(HeRenderEngine* engine, HeD3StaticBatch* batch, b8 const loadMaterial) {
+    static HeUniformId const transMat = heShaderGetUniformId("u_transMat");
+    static HeUniformId const normMat  = heShaderGetUniformId("u_normMat");
+
+    // the vertices are already in world space
+    heShaderLoadUniform(batch->material->shader, transMat, hm::mat4f(1.f));
+    heShaderLoadUniform(batch->material->shader, normMat,  hm::mat3f(1.f));
+    if(loadMaterial)
+        heShaderLoadMaterial(engine, batch->material->shader, batch->material);
+    heVaoBind(&batch->vao);
+    heVaoRender(&batch->vao);
 };
 
 void heD3LevelRenderForward(HeRenderEngine* engine, HeD3Level* level) {
+    // the ids of the uniforms loaded for the skybox, the particles and every shader of the instances
+    static struct {
+        HeUniformId time          = heShaderGetUniformId("u_time");
+        HeUniformId viewMat       = heShaderGetUniformId("u_viewMat");
+        HeUniformId projMat       = heShaderGetUniformId("u_projMat");
+        HeUniformId cameraPos     = heShaderGetUniformId("u_cameraPos");
+        HeUniformId clustered     = heShaderGetUniformId("u_clustered");
+        HeUniformId clusterSize   = heShaderGetUniformId("u_clusterSize");
+        HeUniformId clusterDepth  = heShaderGetUniformId("u_clusterDepth");
+        HeUniformId clusterPlanes = heShaderGetUniformId("u_clusterPlanes");
+        HeUniformId viewportSize  = heShaderGetUniformId("u_viewportSize");
+        HeUniformId realDepthTest = heShaderGetUniformId("u_realDepthTest");
+        HeUniformId clusters      = heShaderGetUniformId("t_clusters");
+        HeUniformId clusterLights = heShaderGetUniformId("t_clusterLights");
+        HeUniformId irradiance    = heShaderGetUniformId("t_irradiance");
+        HeUniformId specular      = heShaderGetUniformId("t_specular");
+        HeUniformId brdf          = heShaderGetUniformId("t_brdf");
+        HeUniformId skybox        = heShaderGetUniformId("t_skybox");
+        HeUniformId alphaTest     = heShaderGetUniformId("t_alphaTest");
+    } const ids;
+
     { // update and render lights
         // update lights ubo
         uint32_t index   = 0;
-        uint32_t offset  = 0;
         b8 bufferChanged = false;
         for (auto lights = level->lights.begin(); lights != level->lights.end(); ++lights) {
-            if(lights->update) {
-                // put data into buffer
+            if(lights->update && index < HeD3LightClusters::MAX_LIGHTS) {
+                // put data into buffer. Every light has its fixed slot so that the clusters can index it
+                uint32_t offset = index * 16 * sizeof(float);
                 hm::vec4f c(hm::getR(&lights->colour), hm::getG(&lights->colour), hm::getB(&lights->colour), hm::getA(&lights->colour));
                 float type = (float) lights->type;
 
@@ -464,21 +670,34 @@ void heD3LevelRenderForward(HeRenderEngine* engine, HeD3Level* level) {
                 offset += 8 * sizeof(float);
                 bufferChanged = true;
                 lights->update = false;
+                lights->shadows.cacheValid = false;
             }
 
             // render shadow map
             if(lights->castShadows) {
-                if(lights->type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL)
-                    heD3ShadowMapRenderDirectional(engine, &lights->shadows, &(*lights), level);
+                if(lights->type == HE_LIGHT_SOURCE_TYPE_DIRECTIONAL) {
+                    uint8_t rebuilt = heD3ShadowMapRenderDirectional(engine, &lights->shadows, &(*lights), level);
+                    heProfilerAddCounter("shadow cascades rebuilt (light " + std::to_string(index) + ")", rebuilt);
+                }
+                heProfilerAddCounter("shadow casters (light " + std::to_string(index) + ")", lights->shadows.casters.size() + lights->shadows.casterBatches.size());
             }
                 
             index++;
         }
 
+        index = std::min(index, HeD3LightClusters::MAX_LIGHTS);
         heUboUpdateVariable(&engine->forward.lightsUbo, "numLights", &index);
         if (bufferChanged)
             heUboUploadData(&engine->forward.lightsUbo);
     }
+
+    if(engine->renderMode == HE_RENDER_MODE_FORWARD_PLUS) { // assign lights to clusters
+        heD3LevelUpdateLightClusters(level);
+        HeD3LightClusters const* clusters = &level->lightClusters;
+        heTextureBufferUpdate(&engine->forward.clusterBuffer, clusters->clusterData.data(), (uint32_t) (clusters->clusterData.size() * sizeof(uint32_t)));
+        heTextureBufferUpdate(&engine->forward.clusterLightsBuffer, clusters->lightIndices.data(), (uint32_t) (clusters->lightIndices.size() * sizeof(uint32_t)));
+        heProfilerAddCounter("cluster lights", clusters->lightIndices.size());
+    }
     
     { // prepare rendering
         heFboBind(&engine->forward.forwardFbo);
@@ -493,59 +712,89 @@ void heD3LevelRenderForward(HeRenderEngine* engine, HeD3Level* level) {
             heCullEnable(false);
             heVaoBind(engine->shapes.cubeVao);
             heShaderBind(engine->skyboxShader);
-            heShaderLoadUniform(engine->skyboxShader, "u_projMat", level->camera.projectionMatrix);
-            heShaderLoadUniform(engine->skyboxShader, "u_viewMat", level->camera.viewMatrix);
-            heShaderLoadUniform(engine->skyboxShader, "u_realDepthTest", true);
-            heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->skyboxShader, "t_skybox", 0));
-            heTextureBind(nullptr, heShaderGetSamplerLocation(engine->skyboxShader, "t_alphaTest", 1));
+            heShaderLoadUniform(engine->skyboxShader, ids.projMat, level->camera.projectionMatrix);
+            heShaderLoadUniform(engine->skyboxShader, ids.viewMat, level->camera.viewMatrix);
+            heShaderLoadUniform(engine->skyboxShader, ids.realDepthTest, true);
+            heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(engine->skyboxShader, ids.skybox, 0));
+            heTextureBind(nullptr, heShaderGetSamplerLocation(engine->skyboxShader, ids.alphaTest, 1));
             heVaoRender(engine->shapes.cubeVao);
         }
     }
     
     { // render instances
-        // map all instances to their shader
-        std::map<HeShaderProgram*, std::vector<HeD3Instance*>> shaderMap;
-        for (auto it = level->instances.begin(); it != level->instances.end(); ++it) {
-            if (it->material != nullptr && it->mesh != nullptr) {
-                shaderMap[it->material->shader].emplace_back(&(*it));
-            }
-        }
-
         heBlendMode(0);
         heDepthFunc(HE_FRAGMENT_TEST_LESS);
         heCullEnable(true);
         
-        // loop through shaders, load data and then render all instances
-        for (auto const& all : shaderMap) {
-            heShaderBind(all.first);
-            heShaderLoadUniform(all.first, "u_time", level->time);
-            heUboBind(&engine->forward.lightsUbo, heShaderGetUboLocation(all.first, "LightInformation"));
-
-            // load camera
-            heShaderLoadUniform(all.first, "u_viewMat",   level->camera.viewMatrix);
-            heShaderLoadUniform(all.first, "u_projMat",   level->camera.projectionMatrix);
-            heShaderLoadUniform(all.first, "u_cameraPos", level->camera.position);
-
-            // shadow shit
-            heTextureBind(level->lights.begin()->shadows.depthFbo.depthAttachment.id, heShaderGetSamplerLocation(all.first, "t_shadowMap"));
-            heShaderLoadUniform(all.first, "u_shadowSpace", level->lights.begin()->shadows.shadowSpaceMatrix);
-
-            // load pbr shit
-            heTextureBind(level->skybox.irradiance, heShaderGetSamplerLocation(all.first, "t_irradiance"));
-            heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(all.first, "t_specular"));
-            heTextureBind(engine->brdfIntegration, heShaderGetSamplerLocation(all.first, "t_brdf"));
-            
-            for (HeD3Instance* instances : all.second)      
-                heD3InstanceRenderForward(engine, instances);
+        // the queue is sorted by shader and material (opaque draws) or by depth (transparent draws), so the shader
+        // setup and the material are only loaded when they differ from the previous draw
+        HeShaderProgram* shader    = nullptr;
+        HeMaterial const* material = nullptr;
+        uint32_t shaderChanges     = 0;
+        uint32_t materialChanges   = 0;
+        for (HeD3RenderItem const& item : level->renderQueue.items) {
+            HeMaterial const* itemMaterial = item.batch ? level->staticBatches[item.index].material : level->instances[item.index].material;
+            if (itemMaterial->shader != shader) {
+                shader   = itemMaterial->shader;
+                material = nullptr;
+                shaderChanges++;
+
+                heShaderBind(shader);
+                heShaderLoadUniform(shader, ids.time, level->time);
+                heUboBind(&engine->forward.lightsUbo, heShaderGetUboLocation(shader, "LightInformation"));
+
+                // load camera
+                heShaderLoadUniform(shader, ids.viewMat,   level->camera.viewMatrix);
+                heShaderLoadUniform(shader, ids.projMat,   level->camera.projectionMatrix);
+                heShaderLoadUniform(shader, ids.cameraPos, level->camera.position);
+
+                // load clusters. The samplers stay active in the shader even without clustering, so they always get
+                // their own units with a texture buffer bound. Otherwise they would share unit 0 with a sampler2D,
+                // which is an invalid operation at draw time
+                heTextureBufferBind(&engine->forward.clusterBuffer, heShaderGetSamplerLocation(shader, ids.clusters));
+                heTextureBufferBind(&engine->forward.clusterLightsBuffer, heShaderGetSamplerLocation(shader, ids.clusterLights));
+                if(engine->renderMode == HE_RENDER_MODE_FORWARD_PLUS) {
+                    HeD3LightClusters const* clusters = &level->lightClusters;
+                    heShaderLoadUniform(shader, ids.clustered,    true);
+                    heShaderLoadUniform(shader, ids.clusterSize,  hm::vec3f((float) clusters->sizeX, (float) clusters->sizeY, (float) clusters->sizeZ));
+                    heShaderLoadUniform(shader, ids.clusterDepth, hm::vec2f(clusters->depthScale, clusters->depthBias));
+                    heShaderLoadUniform(shader, ids.clusterPlanes, hm::vec2f(clusters->nearPlane, clusters->farPlane));
+                    heShaderLoadUniform(shader, ids.viewportSize, hm::vec2f(engine->forward.forwardFbo.size));
+                } else
+                    heShaderLoadUniform(shader, ids.clustered, false);
+
+                // shadow shit
+                HeD3LightSource* sun = level->lights.empty() ? nullptr : &level->lights.front();
+                heShaderLoadShadows(shader, (sun != nullptr && sun->castShadows) ? &sun->shadows : nullptr);
+
+                // load pbr shit
+                heTextureBind(level->skybox.irradiance, heShaderGetSamplerLocation(shader, ids.irradiance));
+                heTextureBind(level->skybox.specular, heShaderGetSamplerLocation(shader, ids.specular));
+                heTextureBind(engine->brdfIntegration, heShaderGetSamplerLocation(shader, ids.brdf));
+            }
+
+            if (itemMaterial != material) {
+                heShaderLoadMaterial(engine, shader, itemMaterial);
+                material = itemMaterial;
+                materialChanges++;
+            }
+
+            if (item.batch)
+                heD3StaticBatchRenderForward(engine, &level->staticBatches[item.index], false);
+            else
+                heD3InstanceRenderForward(engine, level, item.index, false);
         }
+
+        heProfilerAddCounter("shader changes",   shaderChanges);
+        heProfilerAddCounter("material changes", materialChanges);
     }
     
     { // render particles
         heCullEnable(false);
         heVaoBind(engine->shapes.particleVao);    
         heShaderBind(engine->particleShader);
-        heShaderLoadUniform(engine->particleShader, "u_projMat", level->camera.projectionMatrix);
-        heShaderLoadUniform(engine->particleShader, "u_viewMat", level->camera.viewMatrix);
+        heShaderLoadUniform(engine->particleShader, ids.projMat, level->camera.projectionMatrix);
+        heShaderLoadUniform(engine->particleShader, ids.viewMat, level->camera.viewMatrix);
 
         HeD3ShadowMap* map = nullptr;
         for (auto lights = level->lights.begin(); lights != level->lights.end(); ++lights) {
@@ -555,13 +804,20 @@ void heD3LevelRenderForward(HeRenderEngine* engine, HeD3Level* level) {
             }
         }
 
-        if (map) {
-            heShaderLoadUniform(engine->particleShader, "u_shadowSpace", map->shadowSpaceMatrix);
-            heTextureBind(map->depthFbo.depthAttachment.id, heShaderGetSamplerLocation(engine->particleShader, "t_shadowMap"));
-        }
-
-        for (auto const& all : level->particles)
-            heParticleSourceRenderForward(engine, &all, level);    
+        heShaderLoadShadows(engine->particleShader, map);
+
+        // sources are blended over each other, so draw the farthest first. The particles of a source are sorted in its
+        // update if it is depth sorted
+        hm::mat4f const& view = level->camera.viewMatrix;
+        auto depth = [&view](HeParticleSource const* source) {
+            return view[0][2] * source->boundsCenter.x + view[1][2] * source->boundsCenter.y + view[2][2] * source->boundsCenter.z;
+        };
+        std::stable_sort(level->visibleParticles.begin(), level->visibleParticles.end(), [&depth](HeParticleSource const* a, HeParticleSource const* b) {
+            return depth(a) < depth(b);
+        });
+        
+        for (HeParticleSource const* all : level->visibleParticles)
+            heParticleSourceRenderForward(engine, all, level);    
     }
     
     { // finalize
@@ -580,10 +836,25 @@ void heD3LevelRender(HeRenderEngine* engine, HeD3Level* level) {
     level->camera.projectionMatrix = hm::createPerspectiveProjectionMatrix(level->camera.frustum.viewInfo.fov, engine->window->windowInfo.aspectRatio, level->camera.frustum.viewInfo.nearPlane, level->camera.frustum.viewInfo.farPlane);
     level->camera.viewMatrix = hm::createViewMatrix(level->camera.position, level->camera.rotation);
     heD3FrustumUpdate(&level->camera.frustum, engine->window, level->camera.position, level->camera.rotation);
+    heD3FrustumUpdatePlanes(&level->camera.frustum, level->camera.projectionMatrix * level->camera.viewMatrix);
+
+    uint32_t culled   = heD3LevelCullInstances(level, &level->camera.frustum);
+    uint32_t occluded = level->occlusionCulling ? heD3LevelCullOccluded(level) : 0;
+    heD3LevelSelectLods(level);
+    heD3LevelBuildRenderQueue(level);
+    heProfilerAddCounter("instances visible",  level->visibleInstances.size());
+    heProfilerAddCounter("instances culled",   culled);
+    heProfilerAddCounter("instances occluded", occluded);
+    heProfilerAddCounter("batches visible",   level->visibleBatches.size());
+    heProfilerAddCounter("particles culled",  level->particles.size() - level->visibleParticles.size());
+    uint32_t alive = 0;
+    for(HeParticleSource const* all : level->visibleParticles)
+        alive += all->aliveCount;
+    heProfilerAddCounter("particles alive",   alive);
     
     if(engine->renderMode == HE_RENDER_MODE_DEFERRED)
         heD3LevelRenderDeferred(engine, level);
-    else if(engine->renderMode == HE_RENDER_MODE_FORWARD)
+    else
         heD3LevelRenderForward(engine, level);
 };
 
@@ -610,27 +881,46 @@ void heRenderEngineFinishUi(HeRenderEngine* engine) {
 };
 
 void hePostProcessRender(HeRenderEngine* engine) {
+    static struct {
+        HeUniformId in0      = heShaderGetUniformId("t_in0");
+        HeUniformId in1      = heShaderGetUniformId("t_in1");
+        HeUniformId hdr      = heShaderGetUniformId("u_hdr");
+        HeUniformId exposure = heShaderGetUniformId("u_exposure");
+        HeUniformId gamma    = heShaderGetUniformId("u_gamma");
+    } const ids;
+
     // post process hdr buffer
     if(engine->postProcess.initialized && engine->outputTexture == 0) {
         hePostProcessBloomPass(engine);
 
         heShaderBind(engine->postProcess.combineShader);
-        heTextureBind(engine->hdrFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.combineShader, "t_in0", 0));
-        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.combineShader, "t_in1", 1));
-        heShaderLoadUniform(engine->postProcess.combineShader, "u_hdr",      true);
-        heShaderLoadUniform(engine->postProcess.combineShader, "u_exposure", heD3RenderInfo.exposure);
-        heShaderLoadUniform(engine->postProcess.combineShader, "u_gamma",    heD3RenderInfo.gamma);
+        heTextureBind(engine->hdrFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.combineShader, ids.in0, 0));
+        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.combineShader, ids.in1, 1));
+        heShaderLoadUniform(engine->postProcess.combineShader, ids.hdr,      true);
+        heShaderLoadUniform(engine->postProcess.combineShader, ids.exposure, heD3RenderInfo.exposure);
+        heShaderLoadUniform(engine->postProcess.combineShader, ids.gamma,    heD3RenderInfo.gamma);
         heUiSetQuadVao(engine->shapes.quadVao);
         heVaoRender(engine->shapes.quadVao);
     }
 };
 
 void hePostProcessBloomPass(HeRenderEngine* engine) {
+    static struct {
+        HeUniformId threshold    = heShaderGetUniformId("u_threshold");
+        HeUniformId in           = heShaderGetUniformId("t_in");
+        HeUniformId lowerTexture = heShaderGetUniformId("t_lowerTexture");
+        HeUniformId lod          = heShaderGetUniformId("u_lod");
+        HeUniformId size         = heShaderGetUniformId("u_size");
+        HeUniformId outLod0      = heShaderGetUniformId("t_outLod0");
+        HeUniformId brightPass   = heShaderGetUniformId("t_brightPass");
+        HeUniformId direction    = heShaderGetUniformId("u_direction");
+    } const ids;
+
     // bright pass filter
     heFboBind(&engine->postProcess.bloomFbo);
     heShaderBind(engine->postProcess.brightPassShader);
-    heShaderLoadUniform(engine->postProcess.brightPassShader, "u_threshold", hm::vec3f(0.2126f, 0.7152f, 0.0722f) * 0.5f);
-    heTextureBind(engine->hdrFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.brightPassShader, "t_in", 0));
+    heShaderLoadUniform(engine->postProcess.brightPassShader, ids.threshold, hm::vec3f(0.2126f, 0.7152f, 0.0722f) * 0.5f);
+    heTextureBind(engine->hdrFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.brightPassShader, ids.in, 0));
     heUiSetQuadVao(engine->shapes.quadVao);
     heVaoRender(engine->shapes.quadVao);
     heFboUnbind(engine->window->windowInfo.size);
@@ -640,7 +930,7 @@ void hePostProcessBloomPass(HeRenderEngine* engine) {
 
     // blur
     heShaderBind(engine->postProcess.gaussianBlurShader);
-    heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, "t_lowerTexture", 2));
+    heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, ids.lowerTexture, 2));
     
     int8_t lod = 4;
     hm::vec2i size = engine->postProcess.bloomFbo.size;
@@ -648,19 +938,19 @@ void hePostProcessBloomPass(HeRenderEngine* engine) {
         size /= 2;
         
     for(int8_t i = lod; i >= 0; i--) {
-        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, "u_lod", i);
-        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, "u_size", hm::vec2f(size));
+        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, ids.lod, i);
+        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, ids.size, hm::vec2f(size));
         HeTexture wrapper = heFboCreateColourTextureWrapper(&engine->postProcess.bloomFbo.colourAttachments[1]);
-        heImageTextureBind(&wrapper, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, "t_outLod0", 0), i, -1, HE_ACCESS_WRITE_ONLY);
+        heImageTextureBind(&wrapper, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, ids.outLod0, 0), i, -1, HE_ACCESS_WRITE_ONLY);
 
         // horizontal blur
-        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, "t_brightPass", 1));
-        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, "u_direction", hm::vec2f(1, 0));
+        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[0].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, ids.brightPass, 1));
+        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, ids.direction, hm::vec2f(1, 0));
         heShaderRunCompute(engine->postProcess.gaussianBlurShader, size.x / 8, size.y / 8, 1);
 
         // vertical blur
-        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, "t_brightPass", 1));
-        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, "u_direction", hm::vec2f(0, 1));
+        heTextureBind(engine->postProcess.bloomFbo.colourAttachments[1].id, heShaderGetSamplerLocation(engine->postProcess.gaussianBlurShader, ids.brightPass, 1));
+        heShaderLoadUniform(engine->postProcess.gaussianBlurShader, ids.direction, hm::vec2f(0, 1));
         heShaderRunCompute(engine->postProcess.gaussianBlurShader, size.x / 8, size.y / 8, 1);
         size *= 2;
     }
@@ -846,6 +1136,14 @@ void heUiRenderTexture(HeRenderEngine* engine, HeTexture const* texture, hm::vec
 };
 
 void heUiRenderTexture(HeRenderEngine* engine, uint32_t const texture, hm::vec2f const& position, hm::vec2f const& size, HeTextureRenderMode const mode) {
+    static struct {
+        HeUniformId transMat = heShaderGetUniformId("u_transMat");
+        HeUniformId type     = heShaderGetUniformId("u_type");
+        HeUniformId isHdr    = heShaderGetUniformId("u_isHdr");
+        HeUniformId d2Tex    = heShaderGetUniformId("t_d2Tex");
+        HeUniformId cubeTex  = heShaderGetUniformId("t_cubeTex");
+    } const ids;
+
     hm::vec2f realPosition = position; // in window space system
     hm::vec2f realSize = size; // in window space system
     if (realPosition.x >= 0)
@@ -872,7 +1170,7 @@ void heUiRenderTexture(HeRenderEngine* engine, uint32_t const texture, hm::vec2f
     realPosition.y = -realPosition.y;
     
     heShaderBind(engine->textureShader);
-    heShaderLoadUniform(engine->textureShader, "u_transMat", hm::createTransformationMatrix(realPosition, realSize));
+    heShaderLoadUniform(engine->textureShader, ids.transMat, hm::createTransformationMatrix(realPosition, realSize));
 
     int32_t type = 0; // tex2d
     if(mode & HE_TEXTURE_RENDER_CUBE_MAP)
@@ -881,15 +1179,18 @@ void heUiRenderTexture(HeRenderEngine* engine, uint32_t const texture, hm::vec2f
         type = 2;
     
     b8 isCubeMap = mode & HE_TEXTURE_RENDER_CUBE_MAP;
-    heShaderLoadUniform(engine->textureShader, "u_type", type);
-    heShaderLoadUniform(engine->textureShader, "u_isHdr", mode & HE_TEXTURE_RENDER_HDR);
-    std::string textureName = (isCubeMap) ? "t_cubeTex" : "t_d2Tex";
-    heTextureBind(texture, heShaderGetSamplerLocation(engine->textureShader, textureName, isCubeMap), isCubeMap);
+    heShaderLoadUniform(engine->textureShader, ids.type, type);
+    heShaderLoadUniform(engine->textureShader, ids.isHdr, mode & HE_TEXTURE_RENDER_HDR);
+    heTextureBind(texture, heShaderGetSamplerLocation(engine->textureShader, (isCubeMap) ? ids.cubeTex : ids.d2Tex, isCubeMap), isCubeMap);
     heUiSetQuadVao(engine->shapes.quadVao);
     heVaoRender(engine->shapes.quadVao);
 };
 
 void heUiRenderQuad(HeRenderEngine* engine, hm::vec2f const& p0, hm::vec2f const& p1, hm::vec2f const& p2, hm::vec2f const& p3, hm::colour const& colour) {
+    static struct {
+        HeUniformId colour = heShaderGetUniformId("u_colour");
+    } const ids;
+
     hm::vec2f _p0 = heSpaceScreenToClip(p0, engine->window);
     hm::vec2f _p1 = heSpaceScreenToClip(p1, engine->window);
     hm::vec2f _p2 = heSpaceScreenToClip(p2, engine->window);
@@ -897,17 +1198,23 @@ void heUiRenderQuad(HeRenderEngine* engine, hm::vec2f const& p0, hm::vec2f const
     
     heShaderBind(engine->rgbaShader);
     heUiSetQuadVao(engine->shapes.quadVao, _p0, _p1, _p2, _p3);
-    heShaderLoadUniform(engine->rgbaShader, "u_colour", colour);
+    heShaderLoadUniform(engine->rgbaShader, ids.colour, colour);
     heVaoRender(engine->shapes.quadVao);
 };
 
 void heUiRenderText(HeRenderEngine* engine, HeScaledFont const* font, std::string const& text, hm::vec2f const& position, hm::colour const& colour, HeTextAlignMode align) {
+    static struct {
+        HeUniformId atlas    = heShaderGetUniformId("t_atlas");
+        HeUniformId textSize = heShaderGetUniformId("u_textSize");
+        HeUniformId position = heShaderGetUniformId("u_position");
+    } const ids;
+
     HeUiTextMesh mesh;
     heUiTextCreateMesh(engine, &mesh, font, text, colour);
     
     heShaderBind(engine->uiQueue.textShader);
     heVaoBind(&engine->uiQueue.textVao);
-    heTextureBind(font->font->atlas, heShaderGetSamplerLocation(engine->uiQueue.textShader, "t_atlas", 0));
+    heTextureBind(font->font->atlas, heShaderGetSamplerLocation(engine->uiQueue.textShader, ids.atlas, 0));
 
     hm::vec2f realPosition = position / engine->window->windowInfo.size * 2.f;
     if(align == HE_TEXT_ALIGN_CENTER)
@@ -915,8 +1222,8 @@ void heUiRenderText(HeRenderEngine* engine, HeScaledFont const* font, std::strin
     else if(align == HE_TEXT_ALIGN_RIGHT)
         realPosition.x -= mesh.width;
     
-    heShaderLoadUniform(engine->uiQueue.textShader, "u_textSize", font->scale);
-    heShaderLoadUniform(engine->uiQueue.textShader, "u_position", realPosition);
+    heShaderLoadUniform(engine->uiQueue.textShader, ids.textSize, font->scale);
+    heShaderLoadUniform(engine->uiQueue.textShader, ids.position, realPosition);
     heVaoUpdateData(&engine->uiQueue.textVao, mesh.vertices, 0);
     heVaoUpdateDataUint(&engine->uiQueue.textVao, mesh.colours, 1);
     heVaoRender(&engine->uiQueue.textVao);
@@ -924,6 +1231,11 @@ void heUiRenderText(HeRenderEngine* engine, HeScaledFont const* font, std::strin
 
 
 void heUiQueueRenderLines(HeRenderEngine* engine, HeD3Camera const* camera) {
+    static struct {
+        HeUniformId projMat = heShaderGetUniformId("u_projMat");
+        HeUniformId viewMat = heShaderGetUniformId("u_viewMat");
+    } const ids;
+
     size_t size = engine->uiQueue.lines.size();
     if(size == 0)
         return;
@@ -1013,8 +1325,8 @@ void heUiQueueRenderLines(HeRenderEngine* engine, HeD3Camera const* camera) {
     heShaderBind(engine->uiQueue.linesShader);
 
     if(camera) {
-        heShaderLoadUniform(engine->uiQueue.linesShader, "u_projMat", camera->projectionMatrix);
-        heShaderLoadUniform(engine->uiQueue.linesShader, "u_viewMat", camera->viewMatrix);
+        heShaderLoadUniform(engine->uiQueue.linesShader, ids.projMat, camera->projectionMatrix);
+        heShaderLoadUniform(engine->uiQueue.linesShader, ids.viewMat, camera->viewMatrix);
     }
     
     heVaoBind(&engine->uiQueue.linesVao);
@@ -1031,6 +1343,12 @@ void heUiQueueRenderLines(HeRenderEngine* engine, HeD3Camera const* camera) {
 };
 
 void heUiQueueRenderTexts(HeRenderEngine* engine) {
+    static struct {
+        HeUniformId atlas    = heShaderGetUniformId("t_atlas");
+        HeUniformId textSize = heShaderGetUniformId("u_textSize");
+        HeUniformId position = heShaderGetUniformId("u_position");
+    } const ids;
+
     hm::vec2f windowSize(engine->window->windowInfo.size);
     
     heShaderBind(engine->uiQueue.textShader);
@@ -1038,7 +1356,7 @@ void heUiQueueRenderTexts(HeRenderEngine* engine) {
     
     for (auto const& all : engine->uiQueue.texts) {
         // prepare font
-        heTextureBind(all.first->font->atlas, heShaderGetSamplerLocation(engine->uiQueue.textShader, "t_atlas", 0));    
+        heTextureBind(all.first->font->atlas, heShaderGetSamplerLocation(engine->uiQueue.textShader, ids.atlas, 0));    
         
         for (HeUiText const& texts : all.second) {
             HeUiTextMesh* mesh = heUiTextFindOrCreateMesh(engine, all.first, texts.text, texts.colour);
@@ -1047,8 +1365,8 @@ void heUiQueueRenderTexts(HeRenderEngine* engine) {
             if(texts.align == HE_TEXT_ALIGN_CENTER)
                 position.x -= mesh->width / 2.f;
             
-            heShaderLoadUniform(engine->uiQueue.textShader, "u_textSize", all.first->scale);
-            heShaderLoadUniform(engine->uiQueue.textShader, "u_position", position);
+            heShaderLoadUniform(engine->uiQueue.textShader, ids.textSize, all.first->scale);
+            heShaderLoadUniform(engine->uiQueue.textShader, ids.position, position);
             heVaoUpdateData(&engine->uiQueue.textVao, mesh->vertices, 0);
             heVaoUpdateDataUint(&engine->uiQueue.textVao, mesh->colours, 1);
             heVaoRender(&engine->uiQueue.textVao);
@@ -1059,6 +1377,10 @@ void heUiQueueRenderTexts(HeRenderEngine* engine) {
 };
 
 void heUiQueueRenderQuads(HeRenderEngine* engine) {
+    static struct {
+        HeUniformId colour = heShaderGetUniformId("u_colour");
+    } const ids;
+
     hm::vec2f windowSize(engine->window->windowInfo.size);
     heShaderBind(engine->rgbaShader);
     heVaoBind(&engine->uiQueue.quadsVao);
@@ -1102,7 +1424,7 @@ void heUiQueueRenderQuads(HeRenderEngine* engine) {
         colours.emplace_back(colour);
     }
 
-    heShaderLoadUniform(engine->rgbaShader, "u_colour", hm::colour(0, 0, 0, 0));
+    heShaderLoadUniform(engine->rgbaShader, ids.colour, hm::colour(0, 0, 0, 0));
     heVaoUpdateData(&engine->uiQueue.quadsVao, vertices, 0);
     heVaoUpdateDataUint(&engine->uiQueue.quadsVao, colours, 1);
     heVaoRender(&engine->uiQueue.quadsVao);
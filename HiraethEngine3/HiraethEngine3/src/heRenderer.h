@@ -6,6 +6,7 @@
 struct HeD3Level;
 struct HeD3Camera;
 struct HeD3Instance;
+struct HeD3StaticBatch;
 struct HeD3LightSource;
 struct HeD3ShadowMap;
 struct HeD3Frustum;
@@ -135,6 +136,10 @@ struct HeRenderEngine {
     struct {
         HeFbo forwardFbo;
         HeUbo lightsUbo;
+        // forward+ only: offset and count of the lights of every cluster, and the light indices of all clusters
+        // (see HeD3LightClusters)
+        HeTextureBuffer clusterBuffer;
+        HeTextureBuffer clusterLightsBuffer;
     } forward;
     
     HeRenderMode renderMode = HE_RENDER_MODE_FORWARD;
@@ -158,25 +163,35 @@ extern HE_API void heRenderEngineDestroy(HeRenderEngine* engine);
 extern HE_API void heRenderEnginePrepare(HeRenderEngine* engine);
 // finishes up the frame by swapping the buffers
 extern HE_API void heRenderEngineFinish(HeRenderEngine* engine);
-// loads given material to given shader by uploading all textures and uniforms set in the material
+// loads given material to given shader by uploading all textures and uniforms set in the material. The uniforms are
+// loaded by id, see HeMaterial::uniformIds
 extern HE_API void heShaderLoadMaterial(HeRenderEngine* engine, HeShaderProgram* shader, HeMaterial const* material);
 // loads a 3d light source to given shader. If index is -1, the shader is assumed to only have one light as a
 // uniform called u_light. If index is greater or equal to 0, the shader is assumed to have an array of lights,
 // called u_lights[]
 extern HE_API void heShaderLoadLight(HeShaderProgram* program, HeD3LightSource const* light, int8_t const index);
-
-extern HE_API void heD3ShadowMapRenderDirectional(HeRenderEngine* engine, HeD3ShadowMap* shadowMap, HeD3LightSource* light, HeD3Level* level);
+// loads the cascades and the atlas of given shadow map into the shader. If map is nullptr, the shader will not use
+// shadows
+extern HE_API void heShaderLoadShadows(HeShaderProgram* program, HeD3ShadowMap const* map);
+
+// updates the cascades of the shadow map of a directional light and renders its casters into each of them. If the
+// map caches its static casters, only the outdated cascades of the cache are rendered again. Returns the number of
+// cascades whose cache was rebuilt
+extern HE_API uint8_t heD3ShadowMapRenderDirectional(HeRenderEngine* engine, HeD3ShadowMap* shadowMap, HeD3LightSource* light, HeD3Level* level);
 // renders the edges of the frustum using lines
 extern HE_API void heD3FrustumRender(HeRenderEngine* engine, HeD3Frustum* frustum, hm::colour const& colour);
-// renders a complete level with all its instances by mapping all instances to their shader and loading all
-// important data (camera, lights...) to these shaders
+// renders all instances and batches of the levels render queue into the gbuffer and then lights them
 extern HE_API void heD3LevelRenderDeferred(HeRenderEngine* engine, HeD3Level* level);
 // renders a particle source into the hdr fbo.
 extern HE_API void heParticleSourceRenderForward(HeRenderEngine* engine, HeParticleSource const* source, HeD3Level* level);
-// forward-renders given instance. The shader should already be set up and bound
-extern HE_API void heD3InstanceRenderForward(HeRenderEngine* engine, HeD3Instance* instance);
-// renders a complete level with all its instances by mapping all instances to their shader and loading all
-// important data (camera, lights...) to these shaders
+// forward-renders the instance with given index in the level. The shader should already be set up and bound. If
+// loadMaterial is false, the material of the instance must already be loaded into the shader
+extern HE_API void heD3InstanceRenderForward(HeRenderEngine* engine, HeD3Level* level, uint32_t const index, b8 const loadMaterial = true);
+// forward-renders given static batch with the material of the batch. The shader should already be set up and bound.
+// If loadMaterial is false, the material of the batch must already be loaded into the shader
+extern HE_API void heD3StaticBatchRenderForward(HeRenderEngine* engine, HeD3StaticBatch* batch, b8 const loadMaterial = true);
+// renders a complete level with all its instances by walking its render queue and loading all important data
+// (camera, lights...) to each shader once
 extern HE_API void heD3LevelRenderForward(HeRenderEngine* engine, HeD3Level* level);
 // renders given level either in forward or deferred mode, depending on the mode of the engine
 extern HE_API inline void heD3LevelRender(HeRenderEngine* engine, HeD3Level* level);
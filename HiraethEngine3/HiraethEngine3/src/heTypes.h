@@ -100,6 +100,8 @@ typedef enum HeKeyCode {
 
 typedef enum HeDataType {
     HE_DATA_TYPE_NONE    = 0,
+    HE_DATA_TYPE_UBYTE   = 0x1401,
+    HE_DATA_TYPE_USHORT  = 0x1403,
     HE_DATA_TYPE_INT     = 0x1404,
     HE_DATA_TYPE_UINT    = 0x1405,
     HE_DATA_TYPE_VEC2    = 0x8B50,
@@ -122,6 +124,8 @@ typedef enum HeColourFormat {
     HE_COLOUR_FORMAT_RGBA32            = 0x8814,
     HE_COLOUR_FORMAT_COMPRESSED_RGB8   = 0x84ED,
     HE_COLOUR_FORMAT_COMPRESSED_RGBA8   = 0x84EE,
+    HE_COLOUR_FORMAT_R32UI             = 0x8236,
+    HE_COLOUR_FORMAT_RG32UI            = 0x823C,
 } HeColourFormat;
 
 typedef enum HeAccessType {
@@ -146,6 +150,15 @@ typedef enum HeDebugInfoFlags {
     HE_DEBUG_INFO_MEMORY    = 0b10000
 } HeDebugInfoFlags;
 
+typedef enum HeD3InstanceFlags {
+    // the transformation changed since the matrices were last built
+    HE_D3_INSTANCE_FLAG_DIRTY    = 0b001,
+    // the instance is drawn as part of a static batch instead of on its own, see heD3LevelBuildStaticBatches
+    HE_D3_INSTANCE_FLAG_BATCHED  = 0b010,
+    // the instance is always used as an occluder when it is visible (i.e. walls), see heD3LevelCullOccluded
+    HE_D3_INSTANCE_FLAG_OCCLUDER = 0b100
+} HeD3InstanceFlags;
+
 typedef enum HePhysicsShape {
     HE_PHYSICS_SHAPE_NONE,
     HE_PHYSICS_SHAPE_CONVEX_MESH,
@@ -155,6 +168,12 @@ typedef enum HePhysicsShape {
     HE_PHYSICS_SHAPE_CAPSULE,
 } HePhysicsShapeType;
 
+// optional chunks of a binary h3asset that follow the mesh data. The physics data starts with its
+// HePhysicsShapeType instead, which is always smaller than these values
+typedef enum HeAssetChunk {
+    HE_ASSET_CHUNK_LODS = 0x100
+} HeAssetChunk;
+
 typedef enum HeVboUsage {
     // modified once and used few times
     HE_VBO_USAGE_STREAM = 0x88E0,
@@ -231,7 +250,9 @@ typedef enum HeTextureRenderMode {
 
 typedef enum HeRenderMode {
     HE_RENDER_MODE_FORWARD,
-    HE_RENDER_MODE_DEFERRED
+    HE_RENDER_MODE_DEFERRED,
+    // forward rendering where every fragment only iterates over the lights of its cluster, see HeD3LightClusters
+    HE_RENDER_MODE_FORWARD_PLUS
 } HeRenderMode;
 
 typedef enum HeTextAlignMode {
@@ -255,6 +276,19 @@ typedef enum HeParticleEmitterType {
     HE_PARTICLE_EMITTER_TYPE_POINT,
 } HeParticleEmitterType;
 
+typedef enum HeNoiseType {
+    HE_NOISE_TYPE_PERLIN,   // gradient noise on a square grid
+    HE_NOISE_TYPE_SIMPLEX,  // gradient noise on a triangle grid, fewer artifacts along the axes
+    HE_NOISE_TYPE_VALUE,    // random values on a square grid, blurrier than gradient noise
+    HE_NOISE_TYPE_CELLULAR, // the distance to the closest of randomly placed points
+} HeNoiseType;
+
+typedef enum HeNoiseFractal {
+    HE_NOISE_FRACTAL_NONE,
+    HE_NOISE_FRACTAL_FBM,    // sum of octaves with increasing frequency and decreasing amplitude
+    HE_NOISE_FRACTAL_RIDGED, // like fbm, but with sharp ridges where the noise crosses zero (i.e. mountains)
+} HeNoiseFractal;
+
 typedef enum HeWindowMode {
     HE_WINDOW_MODE_WINDOWED,
     HE_WINDOW_MODE_BORDERLESS,
@@ -1,25 +1,181 @@
 #include "hepch.h"
 #include "heUtils.h"
+#include <emmintrin.h>
+#include <cfloat>
 
 std::string SPACE_CHARS = "\t\n\v\f\r";
 
+// returns x rotated left by k bits
+inline uint32_t heRandomRotate(uint32_t const x, uint32_t const k) {
+    return (x << k) | (x >> (32 - k));
+};
+
+// returns the next number of a splitmix64 generator, which is used to turn a seed into the state of the other
+// generators
+inline uint64_t heRandomSplitMix(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+};
+
+// maps 32 random bits to [0, 1) with the 24 bits a float can hold
+inline float heRandomToUnit(uint32_t const bits) {
+    return (float) (bits >> 8) * (1.f / 16777216.f);
+};
+
+// maps 32 random bits to [low, high] by multiplying with the size of the range. This is not perfectly uniform, but
+// the bias is tiny for ranges far below 2^32
+inline int32_t heRandomToRange(uint32_t const bits, int32_t const low, int32_t const high) {
+    uint64_t range = (uint64_t) ((int64_t) high - (int64_t) low) + 1;
+    return (int32_t) ((int64_t) low + (int64_t) (((uint64_t) bits * range) >> 32));
+};
+
 void heRandomCreate(HeRandom* random, uint32_t const seed) {
-    if(seed > 0)
-        random->gen = std::mt19937(seed);
-    else {
+    uint64_t state = seed;
+    if(seed == 0) {
         std::random_device device;
-        random->gen = std::mt19937(device());    
+        state = ((uint64_t) device() << 32) | device();
     }
+
+    for(uint8_t i = 0; i < 4; i += 2) {
+        uint64_t bits = heRandomSplitMix(&state);
+        random->state[i]     = (uint32_t) bits;
+        random->state[i + 1] = (uint32_t) (bits >> 32);
+    }
+
+    for(uint8_t i = 0; i < 4; ++i) {
+        for(uint8_t j = 0; j < 4; j += 2) {
+            uint64_t bits = heRandomSplitMix(&state);
+            random->lanes[i][j]     = (uint32_t) bits;
+            random->lanes[i][j + 1] = (uint32_t) (bits >> 32);
+        }
+    }
+};
+
+uint32_t heRandomNext(HeRandom* random) {
+    uint32_t* s = random->state;
+    uint32_t const result = heRandomRotate(s[1] * 5, 7) * 9;
+    uint32_t const t      = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3]  = heRandomRotate(s[3], 11);
+    return result;
 };
 
 int32_t heRandomInt(HeRandom* random, int32_t const low, int32_t const high) {
-    random->idis = std::uniform_int_distribution<>(low, high);
-    return random->idis(random->gen);
+    return heRandomToRange(heRandomNext(random), low, high);
 };
 
 float heRandomFloat(HeRandom* random, float const low, float const high) {
-    random->fdis = std::uniform_real_distribution<float>(low, high);
-    return random->fdis(random->gen);
+    return low + heRandomToUnit(heRandomNext(random)) * (high - low);
+};
+
+// returns the next numbers of the four generators of the random (one per lane). Same steps as heRandomNext, the
+// multiplications with 5 and 9 are done with shifts since sse2 cannot multiply 32 bit integers
+inline __m128i heRandomNextLanes(HeRandom* random) {
+    __m128i s0 = _mm_loadu_si128((__m128i*) random->lanes[0]);
+    __m128i s1 = _mm_loadu_si128((__m128i*) random->lanes[1]);
+    __m128i s2 = _mm_loadu_si128((__m128i*) random->lanes[2]);
+    __m128i s3 = _mm_loadu_si128((__m128i*) random->lanes[3]);
+    
+    __m128i result = _mm_add_epi32(_mm_slli_epi32(s1, 2), s1);
+    result = _mm_or_si128(_mm_slli_epi32(result, 7), _mm_srli_epi32(result, 25));
+    result = _mm_add_epi32(_mm_slli_epi32(result, 3), result);
+
+    __m128i t = _mm_slli_epi32(s1, 9);
+    s2 = _mm_xor_si128(s2, s0);
+    s3 = _mm_xor_si128(s3, s1);
+    s1 = _mm_xor_si128(s1, s2);
+    s0 = _mm_xor_si128(s0, s3);
+    s2 = _mm_xor_si128(s2, t);
+    s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+    _mm_storeu_si128((__m128i*) random->lanes[0], s0);
+    _mm_storeu_si128((__m128i*) random->lanes[1], s1);
+    _mm_storeu_si128((__m128i*) random->lanes[2], s2);
+    _mm_storeu_si128((__m128i*) random->lanes[3], s3);
+    return result;
+};
+
+void heRandomFillInts(HeRandom* random, int32_t* values, uint32_t const count, int32_t const low, int32_t const high) {
+    // the upper half of bits * range, like heRandomToRange. sse2 only multiplies every second lane, so the even and
+    // odd lanes are done separately. A range of 2^32 wraps to 0, then the bits are used as they are
+    uint32_t const range = (uint32_t) ((int64_t) high - (int64_t) low + 1);
+    __m128i const ranges  = _mm_set1_epi32((int32_t) range);
+    __m128i const lows    = _mm_set1_epi32(low);
+    __m128i const oddMask = _mm_set_epi32(-1, 0, -1, 0);
+    uint32_t i = 0;
+    while(i < count) {
+        __m128i bits = heRandomNextLanes(random);
+        if(range != 0) {
+            __m128i even = _mm_srli_epi64(_mm_mul_epu32(bits, ranges), 32);
+            __m128i odd  = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(bits, 32), ranges), oddMask);
+            bits = _mm_or_si128(even, odd);
+        }
+
+        __m128i result = _mm_add_epi32(bits, lows);
+        if(i + 4 <= count) {
+            _mm_storeu_si128((__m128i*) &values[i], result);
+            i += 4;
+        } else {
+            int32_t rest[4];
+            _mm_storeu_si128((__m128i*) rest, result);
+            for(uint8_t j = 0; i < count; ++i, ++j)
+                values[i] = rest[j];
+        }
+    }
+};
+
+void heRandomFillFloats(HeRandom* random, float* values, uint32_t const count, float const low, float const high) {
+    __m128 const scale = _mm_set1_ps((high - low) * (1.f / 16777216.f));
+    __m128 const lows  = _mm_set1_ps(low);
+    uint32_t i = 0;
+    while(i < count) {
+        __m128 result = _mm_add_ps(lows, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(heRandomNextLanes(random), 8)), scale));
+        if(i + 4 <= count) {
+            _mm_storeu_ps(&values[i], result);
+            i += 4;
+        } else {
+            float rest[4];
+            _mm_storeu_ps(rest, result);
+            for(uint8_t j = 0; i < count; ++i, ++j)
+                values[i] = rest[j];
+        }
+    }
+};
+
+void heRandomStreamCreate(HeRandomStream* stream, uint32_t const seed, uint32_t const index) {
+    // the key should have well mixed bits and must be odd
+    uint64_t state  = ((uint64_t) seed << 32) | index;
+    stream->key     = heRandomSplitMix(&state) | 1;
+    stream->counter = 0;
+};
+
+uint32_t heRandomStreamGet(HeRandomStream const* stream, uint64_t const position) {
+    // four rounds of squaring the number and swapping its halves
+    uint64_t x = position * stream->key;
+    uint64_t const y = x;
+    uint64_t const z = y + stream->key;
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    x = x * x + z; x = (x >> 32) | (x << 32);
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    return (uint32_t) ((x * x + z) >> 32);
+};
+
+uint32_t heRandomStreamNext(HeRandomStream* stream) {
+    return heRandomStreamGet(stream, stream->counter++);
+};
+
+int32_t heRandomStreamInt(HeRandomStream* stream, int32_t const low, int32_t const high) {
+    return heRandomToRange(heRandomStreamNext(stream), low, high);
+};
+
+float heRandomStreamFloat(HeRandomStream* stream, float const low, float const high) {
+    return low + heRandomToUnit(heRandomStreamNext(stream)) * (high - low);
 };
 
 
@@ -89,6 +245,412 @@ double hePerlinNoise3D(HePerlinNoise* noise, hm::vec3d const& position) {
     return (lerp(y1, y2, w) + 1.) / 2.;
 };
 
+// the primes that the lattice coordinates are multiplied with before hashing
+static const int32_t NOISE_PRIME_X = 501125321;
+static const int32_t NOISE_PRIME_Y = 1136930381;
+static const int32_t NOISE_PRIME_Z = 1720413743;
+
+// a noise kernel, returns the noise of four positions. The 2d kernels ignore z
+typedef __m128 (*HeNoiseKernel)(__m128i const seed, __m128 const x, __m128 const y, __m128 const z);
+
+// multiplies every 32 bit lane. sse2 only multiplies every second lane into 64 bits, so even and odd lanes are done
+// separately
+inline __m128i heNoiseMultiply(__m128i const a, __m128i const b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+};
+
+// returns a where mask is set and b everywhere else
+inline __m128 heNoiseSelect(__m128 const mask, __m128 const a, __m128 const b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+};
+
+inline __m128i heNoiseFloor(__m128 const x) {
+    __m128i i = _mm_cvttps_epi32(x);
+    // truncation rounds negative numbers up, subtract one there (the mask is -1)
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(i))));
+};
+
+// 6t^5 - 15t^4 + 10t^3, see fade
+inline __m128 heNoiseFade(__m128 const t) {
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f))), _mm_set1_ps(10.f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+};
+
+inline __m128 heNoiseLerp(__m128 const a, __m128 const b, __m128 const t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+};
+
+// hashes a lattice point. The coordinates must already be multiplied with their primes
+inline __m128i heNoiseHash(__m128i const seed, __m128i const x, __m128i const y, __m128i const z) {
+    __m128i hash = _mm_xor_si128(_mm_xor_si128(seed, x), _mm_xor_si128(y, z));
+    hash = heNoiseMultiply(hash, _mm_set1_epi32(0x27d4eb2d));
+    return _mm_xor_si128(hash, _mm_srli_epi32(hash, 15));
+};
+
+// returns the random value of a hash in [-1, 1]
+inline __m128 heNoiseHashToFloat(__m128i const hash) {
+    return _mm_mul_ps(_mm_cvtepi32_ps(hash), _mm_set1_ps(1.f / 2147483648.f));
+};
+
+// the dot product of the offset and one of eight directions picked by the upper bits of the hash
+inline __m128 heNoiseGradient2D(__m128i const hash, __m128 const x, __m128 const y) {
+    __m128i h     = _mm_srli_epi32(hash, 29);
+    __m128 signX  = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 signY  = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    __m128 diagonal = _mm_mul_ps(_mm_add_ps(_mm_xor_ps(x, signX), _mm_xor_ps(y, signY)), _mm_set1_ps(.70710678f));
+    __m128 axis     = _mm_xor_ps(heNoiseSelect(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_setzero_si128())), x, y), signX);
+    return heNoiseSelect(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4))), diagonal, axis);
+};
+
+// the dot product of the offset and one of the twelve edge directions of a cube picked by the upper bits of the hash,
+// like grad
+inline __m128 heNoiseGradient3D(__m128i const hash, __m128 const x, __m128 const y, __m128 const z) {
+    __m128i h  = _mm_srli_epi32(hash, 28);
+    __m128 u   = heNoiseSelect(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8))), x, y);
+    __m128 xz  = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+    __m128 v   = heNoiseSelect(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4))), y, heNoiseSelect(xz, x, z));
+    __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+};
+
+__m128 hePerlinKernel2D(__m128i const seed, __m128 const x, __m128 const y, __m128 const /*z*/) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y);
+    __m128 fx  = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy));
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.f)),   fy1 = _mm_sub_ps(fy, _mm_set1_ps(1.f));
+    __m128i x0 = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X)), x1 = _mm_add_epi32(x0, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i y0 = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y)), y1 = _mm_add_epi32(y0, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i const z0 = _mm_setzero_si128();
+
+    __m128 a = heNoiseLerp(heNoiseGradient2D(heNoiseHash(seed, x0, y0, z0), fx, fy),  heNoiseGradient2D(heNoiseHash(seed, x1, y0, z0), fx1, fy),  heNoiseFade(fx));
+    __m128 b = heNoiseLerp(heNoiseGradient2D(heNoiseHash(seed, x0, y1, z0), fx, fy1), heNoiseGradient2D(heNoiseHash(seed, x1, y1, z0), fx1, fy1), heNoiseFade(fx));
+    return _mm_mul_ps(heNoiseLerp(a, b, heNoiseFade(fy)), _mm_set1_ps(1.4142135f));
+};
+
+__m128 hePerlinKernel3D(__m128i const seed, __m128 const x, __m128 const y, __m128 const z) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y), iz = heNoiseFloor(z);
+    __m128 fx  = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy)), fz = _mm_sub_ps(z, _mm_cvtepi32_ps(iz));
+    __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.f)),   fy1 = _mm_sub_ps(fy, _mm_set1_ps(1.f)),   fz1 = _mm_sub_ps(fz, _mm_set1_ps(1.f));
+    __m128i x0 = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X)), x1 = _mm_add_epi32(x0, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i y0 = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y)), y1 = _mm_add_epi32(y0, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i z0 = heNoiseMultiply(iz, _mm_set1_epi32(NOISE_PRIME_Z)), z1 = _mm_add_epi32(z0, _mm_set1_epi32(NOISE_PRIME_Z));
+    __m128 u = heNoiseFade(fx), v = heNoiseFade(fy), w = heNoiseFade(fz);
+
+    __m128 a = heNoiseLerp(heNoiseGradient3D(heNoiseHash(seed, x0, y0, z0), fx, fy,  fz),  heNoiseGradient3D(heNoiseHash(seed, x1, y0, z0), fx1, fy,  fz),  u);
+    __m128 b = heNoiseLerp(heNoiseGradient3D(heNoiseHash(seed, x0, y1, z0), fx, fy1, fz),  heNoiseGradient3D(heNoiseHash(seed, x1, y1, z0), fx1, fy1, fz),  u);
+    __m128 c = heNoiseLerp(heNoiseGradient3D(heNoiseHash(seed, x0, y0, z1), fx, fy,  fz1), heNoiseGradient3D(heNoiseHash(seed, x1, y0, z1), fx1, fy,  fz1), u);
+    __m128 d = heNoiseLerp(heNoiseGradient3D(heNoiseHash(seed, x0, y1, z1), fx, fy1, fz1), heNoiseGradient3D(heNoiseHash(seed, x1, y1, z1), fx1, fy1, fz1), u);
+    return _mm_mul_ps(heNoiseLerp(heNoiseLerp(a, b, v), heNoiseLerp(c, d, v), w), _mm_set1_ps(.9649214f));
+};
+
+__m128 heValueKernel2D(__m128i const seed, __m128 const x, __m128 const y, __m128 const /*z*/) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y);
+    __m128 u   = heNoiseFade(_mm_sub_ps(x, _mm_cvtepi32_ps(ix)));
+    __m128 v   = heNoiseFade(_mm_sub_ps(y, _mm_cvtepi32_ps(iy)));
+    __m128i x0 = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X)), x1 = _mm_add_epi32(x0, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i y0 = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y)), y1 = _mm_add_epi32(y0, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i const z0 = _mm_setzero_si128();
+
+    __m128 a = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y0, z0)), heNoiseHashToFloat(heNoiseHash(seed, x1, y0, z0)), u);
+    __m128 b = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y1, z0)), heNoiseHashToFloat(heNoiseHash(seed, x1, y1, z0)), u);
+    return heNoiseLerp(a, b, v);
+};
+
+__m128 heValueKernel3D(__m128i const seed, __m128 const x, __m128 const y, __m128 const z) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y), iz = heNoiseFloor(z);
+    __m128 u   = heNoiseFade(_mm_sub_ps(x, _mm_cvtepi32_ps(ix)));
+    __m128 v   = heNoiseFade(_mm_sub_ps(y, _mm_cvtepi32_ps(iy)));
+    __m128 w   = heNoiseFade(_mm_sub_ps(z, _mm_cvtepi32_ps(iz)));
+    __m128i x0 = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X)), x1 = _mm_add_epi32(x0, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i y0 = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y)), y1 = _mm_add_epi32(y0, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i z0 = heNoiseMultiply(iz, _mm_set1_epi32(NOISE_PRIME_Z)), z1 = _mm_add_epi32(z0, _mm_set1_epi32(NOISE_PRIME_Z));
+
+    __m128 a = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y0, z0)), heNoiseHashToFloat(heNoiseHash(seed, x1, y0, z0)), u);
+    __m128 b = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y1, z0)), heNoiseHashToFloat(heNoiseHash(seed, x1, y1, z0)), u);
+    __m128 c = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y0, z1)), heNoiseHashToFloat(heNoiseHash(seed, x1, y0, z1)), u);
+    __m128 d = heNoiseLerp(heNoiseHashToFloat(heNoiseHash(seed, x0, y1, z1)), heNoiseHashToFloat(heNoiseHash(seed, x1, y1, z1)), u);
+    return heNoiseLerp(heNoiseLerp(a, b, v), heNoiseLerp(c, d, v), w);
+};
+
+// the contribution of a corner of a simplex: (radius - distance^2)^4 * gradient, or 0 outside the radius
+inline __m128 heSimplexCorner2D(__m128i const hash, __m128 const x, __m128 const y) {
+    __m128 t = _mm_sub_ps(_mm_set1_ps(.5f), _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+    t = _mm_max_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    return _mm_mul_ps(_mm_mul_ps(t, t), heNoiseGradient2D(hash, x, y));
+};
+
+inline __m128 heSimplexCorner3D(__m128i const hash, __m128 const x, __m128 const y, __m128 const z) {
+    __m128 t = _mm_sub_ps(_mm_set1_ps(.6f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    t = _mm_max_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    return _mm_mul_ps(_mm_mul_ps(t, t), heNoiseGradient3D(hash, x, y, z));
+};
+
+__m128 heSimplexKernel2D(__m128i const seed, __m128 const x, __m128 const y, __m128 const /*z*/) {
+    __m128 const G2 = _mm_set1_ps(.21132487f); // (3 - sqrt(3)) / 6
+    // skew the position onto the square grid to find the cell, the first corner is the unskewed cell origin
+    __m128 s   = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(.36602540f)); // (sqrt(3) - 1) / 2
+    __m128i ix = heNoiseFloor(_mm_add_ps(x, s)), iy = heNoiseFloor(_mm_add_ps(y, s));
+    __m128 t   = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(ix, iy)), G2);
+    __m128 x0  = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(ix), t));
+    __m128 y0  = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(iy), t));
+
+    // the second corner is one step along x or y, depending on which triangle of the cell the position is in
+    __m128 lower = _mm_cmpgt_ps(x0, y0);
+    __m128 i1    = _mm_and_ps(lower, _mm_set1_ps(1.f));
+    __m128 j1    = _mm_andnot_ps(lower, _mm_set1_ps(1.f));
+    __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), G2), y1 = _mm_add_ps(_mm_sub_ps(y0, j1), G2);
+    __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_set1_ps(1.f)), _mm_add_ps(G2, G2));
+    __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_set1_ps(1.f)), _mm_add_ps(G2, G2));
+
+    __m128i px = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i py = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i stepX = _mm_and_si128(_mm_castps_si128(lower), _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i stepY = _mm_andnot_si128(_mm_castps_si128(lower), _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i const z0 = _mm_setzero_si128();
+
+    __m128 result = heSimplexCorner2D(heNoiseHash(seed, px, py, z0), x0, y0);
+    result = _mm_add_ps(result, heSimplexCorner2D(heNoiseHash(seed, _mm_add_epi32(px, stepX), _mm_add_epi32(py, stepY), z0), x1, y1));
+    result = _mm_add_ps(result, heSimplexCorner2D(heNoiseHash(seed, _mm_add_epi32(px, _mm_set1_epi32(NOISE_PRIME_X)), _mm_add_epi32(py, _mm_set1_epi32(NOISE_PRIME_Y)), z0), x2, y2));
+    return _mm_mul_ps(result, _mm_set1_ps(99.20689f));
+};
+
+__m128 heSimplexKernel3D(__m128i const seed, __m128 const x, __m128 const y, __m128 const z) {
+    __m128 const G3 = _mm_set1_ps(1.f / 6.f);
+    __m128 const one = _mm_set1_ps(1.f);
+    __m128 s   = _mm_mul_ps(_mm_add_ps(_mm_add_ps(x, y), z), _mm_set1_ps(1.f / 3.f));
+    __m128i ix = heNoiseFloor(_mm_add_ps(x, s)), iy = heNoiseFloor(_mm_add_ps(y, s)), iz = heNoiseFloor(_mm_add_ps(z, s));
+    __m128 t   = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(ix, iy), iz)), G3);
+    __m128 x0  = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(ix), t));
+    __m128 y0  = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(iy), t));
+    __m128 z0  = _mm_sub_ps(z, _mm_sub_ps(_mm_cvtepi32_ps(iz), t));
+
+    // the second corner is a step along the largest axis of the offset, the third one along the two largest
+    __m128 xy = _mm_cmpge_ps(x0, y0), yz = _mm_cmpge_ps(y0, z0), xz = _mm_cmpge_ps(x0, z0);
+    __m128 i1 = _mm_and_ps(xy, xz);
+    __m128 j1 = _mm_andnot_ps(xy, yz);
+    __m128 k1 = _mm_andnot_ps(xz, _mm_andnot_ps(yz, _mm_castsi128_ps(_mm_set1_epi32(-1))));
+    __m128 i2 = _mm_or_ps(xy, xz);
+    __m128 j2 = _mm_or_ps(_mm_andnot_ps(xy, _mm_castsi128_ps(_mm_set1_epi32(-1))), yz);
+    __m128 k2 = _mm_andnot_ps(_mm_and_ps(xz, yz), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+    __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i1, one)), G3);
+    __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j1, one)), G3);
+    __m128 z1 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k1, one)), G3);
+    __m128 x2 = _mm_add_ps(_mm_sub_ps(x0, _mm_and_ps(i2, one)), _mm_add_ps(G3, G3));
+    __m128 y2 = _mm_add_ps(_mm_sub_ps(y0, _mm_and_ps(j2, one)), _mm_add_ps(G3, G3));
+    __m128 z2 = _mm_add_ps(_mm_sub_ps(z0, _mm_and_ps(k2, one)), _mm_add_ps(G3, G3));
+    __m128 x3 = _mm_add_ps(_mm_sub_ps(x0, one), _mm_set1_ps(.5f));
+    __m128 y3 = _mm_add_ps(_mm_sub_ps(y0, one), _mm_set1_ps(.5f));
+    __m128 z3 = _mm_add_ps(_mm_sub_ps(z0, one), _mm_set1_ps(.5f));
+
+    __m128i const primeX = _mm_set1_epi32(NOISE_PRIME_X), primeY = _mm_set1_epi32(NOISE_PRIME_Y), primeZ = _mm_set1_epi32(NOISE_PRIME_Z);
+    __m128i px = heNoiseMultiply(ix, primeX), py = heNoiseMultiply(iy, primeY), pz = heNoiseMultiply(iz, primeZ);
+    __m128 result = heSimplexCorner3D(heNoiseHash(seed, px, py, pz), x0, y0, z0);
+    result = _mm_add_ps(result, heSimplexCorner3D(heNoiseHash(seed,
+                                                              _mm_add_epi32(px, _mm_and_si128(_mm_castps_si128(i1), primeX)),
+                                                              _mm_add_epi32(py, _mm_and_si128(_mm_castps_si128(j1), primeY)),
+                                                              _mm_add_epi32(pz, _mm_and_si128(_mm_castps_si128(k1), primeZ))), x1, y1, z1));
+    result = _mm_add_ps(result, heSimplexCorner3D(heNoiseHash(seed,
+                                                              _mm_add_epi32(px, _mm_and_si128(_mm_castps_si128(i2), primeX)),
+                                                              _mm_add_epi32(py, _mm_and_si128(_mm_castps_si128(j2), primeY)),
+                                                              _mm_add_epi32(pz, _mm_and_si128(_mm_castps_si128(k2), primeZ))), x2, y2, z2));
+    result = _mm_add_ps(result, heSimplexCorner3D(heNoiseHash(seed, _mm_add_epi32(px, primeX), _mm_add_epi32(py, primeY), _mm_add_epi32(pz, primeZ)), x3, y3, z3));
+    return _mm_mul_ps(result, _mm_set1_ps(32.69428f));
+};
+
+__m128 heCellularKernel2D(__m128i const seed, __m128 const x, __m128 const y, __m128 const /*z*/) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y);
+    __m128 fx  = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy));
+    __m128i px = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i py = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128 const jitter = _mm_set1_ps(.8f / 65536.f);
+    __m128 closest = _mm_set1_ps(FLT_MAX);
+
+    // every cell has one point somewhere in its center, check the cells around the position
+    for(int32_t i = -1; i <= 1; ++i) {
+        __m128i cellX = _mm_add_epi32(px, _mm_set1_epi32(i * NOISE_PRIME_X));
+        for(int32_t j = -1; j <= 1; ++j) {
+            __m128i cellY = _mm_add_epi32(py, _mm_set1_epi32(j * NOISE_PRIME_Y));
+            __m128i hash  = heNoiseHash(seed, cellX, cellY, _mm_setzero_si128());
+            __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(i + .1f), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(hash, _mm_set1_epi32(0xffff))), jitter)), fx);
+            __m128 dy = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(j + .1f), _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(hash, 16)), jitter)), fy);
+            closest = _mm_min_ps(closest, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+        }
+    }
+
+    return _mm_sub_ps(_mm_mul_ps(_mm_min_ps(_mm_sqrt_ps(closest), _mm_set1_ps(1.f)), _mm_set1_ps(2.f)), _mm_set1_ps(1.f));
+};
+
+__m128 heCellularKernel3D(__m128i const seed, __m128 const x, __m128 const y, __m128 const z) {
+    __m128i ix = heNoiseFloor(x), iy = heNoiseFloor(y), iz = heNoiseFloor(z);
+    __m128 fx  = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy)), fz = _mm_sub_ps(z, _mm_cvtepi32_ps(iz));
+    __m128i px = heNoiseMultiply(ix, _mm_set1_epi32(NOISE_PRIME_X));
+    __m128i py = heNoiseMultiply(iy, _mm_set1_epi32(NOISE_PRIME_Y));
+    __m128i pz = heNoiseMultiply(iz, _mm_set1_epi32(NOISE_PRIME_Z));
+    __m128i const mask  = _mm_set1_epi32(0x3ff);
+    __m128 const jitter = _mm_set1_ps(.8f / 1024.f);
+    __m128 closest = _mm_set1_ps(FLT_MAX);
+
+    for(int32_t i = -1; i <= 1; ++i) {
+        __m128i cellX = _mm_add_epi32(px, _mm_set1_epi32(i * NOISE_PRIME_X));
+        for(int32_t j = -1; j <= 1; ++j) {
+            __m128i cellY = _mm_add_epi32(py, _mm_set1_epi32(j * NOISE_PRIME_Y));
+            for(int32_t k = -1; k <= 1; ++k) {
+                __m128i cellZ = _mm_add_epi32(pz, _mm_set1_epi32(k * NOISE_PRIME_Z));
+                __m128i hash  = heNoiseHash(seed, cellX, cellY, cellZ);
+                __m128 dx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(i + .1f), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(hash, mask)), jitter)), fx);
+                __m128 dy = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(j + .1f), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(hash, 10), mask)), jitter)), fy);
+                __m128 dz = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(k + .1f), _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(hash, 20), mask)), jitter)), fz);
+                closest = _mm_min_ps(closest, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+            }
+        }
+    }
+
+    return _mm_sub_ps(_mm_mul_ps(_mm_min_ps(_mm_sqrt_ps(closest), _mm_set1_ps(1.f)), _mm_set1_ps(2.f)), _mm_set1_ps(1.f));
+};
+
+// samples four positions with the fractal and domain warp of the noise. z is ignored by the 2d kernels
+__m128 heNoiseSampleFour(HeNoise const* noise, HeNoiseKernel const kernel, HeNoiseKernel const warpKernel, __m128 x, __m128 y, __m128 z) {
+    x = _mm_mul_ps(x, _mm_set1_ps(noise->frequency));
+    y = _mm_mul_ps(y, _mm_set1_ps(noise->frequency));
+    z = _mm_mul_ps(z, _mm_set1_ps(noise->frequency));
+    if(noise->warpAmplitude > 0.f) {
+        // a differently seeded noise per axis, so that the axes are moved independently
+        __m128 const frequency = _mm_set1_ps(noise->warpFrequency);
+        __m128 const amplitude = _mm_set1_ps(noise->warpAmplitude);
+        __m128 wx = _mm_mul_ps(x, frequency), wy = _mm_mul_ps(y, frequency), wz = _mm_mul_ps(z, frequency);
+        __m128 offsetX = warpKernel(_mm_set1_epi32(noise->seed + 1013), wx, wy, wz);
+        __m128 offsetY = warpKernel(_mm_set1_epi32(noise->seed + 2029), wx, wy, wz);
+        __m128 offsetZ = warpKernel(_mm_set1_epi32(noise->seed + 3011), wx, wy, wz);
+        x = _mm_add_ps(x, _mm_mul_ps(offsetX, amplitude));
+        y = _mm_add_ps(y, _mm_mul_ps(offsetY, amplitude));
+        z = _mm_add_ps(z, _mm_mul_ps(offsetZ, amplitude));
+    }
+
+    if(noise->fractal == HE_NOISE_FRACTAL_NONE)
+        return kernel(_mm_set1_epi32(noise->seed), x, y, z);
+
+    __m128 sum = _mm_setzero_ps();
+    float amplitude = 1.f, total = 0.f;
+    __m128 const absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for(uint8_t i = 0; i < noise->octaves; ++i) {
+        // every octave gets its own seed, otherwise all octaves would have a feature at the origin
+        __m128 value = kernel(_mm_set1_epi32(noise->seed + i), x, y, z);
+        if(noise->fractal == HE_NOISE_FRACTAL_RIDGED)
+            value = _mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_and_ps(value, absMask), _mm_set1_ps(2.f)));
+
+        sum = _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(amplitude)));
+        total     += amplitude;
+        amplitude *= noise->gain;
+        x = _mm_mul_ps(x, _mm_set1_ps(noise->lacunarity));
+        y = _mm_mul_ps(y, _mm_set1_ps(noise->lacunarity));
+        z = _mm_mul_ps(z, _mm_set1_ps(noise->lacunarity));
+    }
+
+    return _mm_mul_ps(sum, _mm_set1_ps(total > 0.f ? 1.f / total : 0.f));
+};
+
+HeNoiseKernel heNoiseGetKernel2D(HeNoiseType const type) {
+    switch(type) {
+    case HE_NOISE_TYPE_SIMPLEX:  return heSimplexKernel2D;
+    case HE_NOISE_TYPE_VALUE:    return heValueKernel2D;
+    case HE_NOISE_TYPE_CELLULAR: return heCellularKernel2D;
+    default:                     return hePerlinKernel2D;
+    }
+};
+
+HeNoiseKernel heNoiseGetKernel3D(HeNoiseType const type) {
+    switch(type) {
+    case HE_NOISE_TYPE_SIMPLEX:  return heSimplexKernel3D;
+    case HE_NOISE_TYPE_VALUE:    return heValueKernel3D;
+    case HE_NOISE_TYPE_CELLULAR: return heCellularKernel3D;
+    default:                     return hePerlinKernel3D;
+    }
+};
+
+// stores the first count lanes of value (the last group of a row may be smaller than four)
+inline void heNoiseStore(float* values, __m128 const value, uint32_t const count) {
+    if(count >= 4) {
+        _mm_storeu_ps(values, value);
+    } else {
+        float lanes[4];
+        _mm_storeu_ps(lanes, value);
+        for(uint32_t i = 0; i < count; ++i)
+            values[i] = lanes[i];
+    }
+};
+
+// loads the first count values and fills the other lanes with zero
+inline __m128 heNoiseLoad(float const* values, uint32_t const count) {
+    if(count >= 4)
+        return _mm_loadu_ps(values);
+
+    float lanes[4] = { 0.f, 0.f, 0.f, 0.f };
+    for(uint32_t i = 0; i < count; ++i)
+        lanes[i] = values[i];
+    return _mm_loadu_ps(lanes);
+};
+
+void heNoiseSample2D(HeNoise const* noise, float const* x, float const* y, float* values, uint32_t const count) {
+    HeNoiseKernel kernel = heNoiseGetKernel2D(noise->type);
+    for(uint32_t i = 0; i < count; i += 4) {
+        uint32_t const size = count - i;
+        heNoiseStore(&values[i], heNoiseSampleFour(noise, kernel, hePerlinKernel2D, heNoiseLoad(&x[i], size), heNoiseLoad(&y[i], size), _mm_setzero_ps()), size);
+    }
+};
+
+void heNoiseSample3D(HeNoise const* noise, float const* x, float const* y, float const* z, float* values, uint32_t const count) {
+    HeNoiseKernel kernel = heNoiseGetKernel3D(noise->type);
+    for(uint32_t i = 0; i < count; i += 4) {
+        uint32_t const size = count - i;
+        heNoiseStore(&values[i], heNoiseSampleFour(noise, kernel, hePerlinKernel3D, heNoiseLoad(&x[i], size), heNoiseLoad(&y[i], size), heNoiseLoad(&z[i], size)), size);
+    }
+};
+
+float heNoiseGet2D(HeNoise const* noise, hm::vec2f const& position) {
+    float value;
+    heNoiseSample2D(noise, &position.x, &position.y, &value, 1);
+    return value;
+};
+
+float heNoiseGet3D(HeNoise const* noise, hm::vec3f const& position) {
+    float value;
+    heNoiseSample3D(noise, &position.x, &position.y, &position.z, &value, 1);
+    return value;
+};
+
+void heNoiseFillGrid2D(HeNoise const* noise, float* values, hm::vec2f const& origin, hm::vec2f const& step, uint32_t const width, uint32_t const height) {
+    HeNoiseKernel kernel = heNoiseGetKernel2D(noise->type);
+    __m128 const lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    for(uint32_t j = 0; j < height; ++j) {
+        __m128 y = _mm_set1_ps(origin.y + step.y * j);
+        for(uint32_t i = 0; i < width; i += 4) {
+            __m128 x = _mm_add_ps(_mm_set1_ps(origin.x), _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float) i), lanes), _mm_set1_ps(step.x)));
+            heNoiseStore(&values[j * width + i], heNoiseSampleFour(noise, kernel, hePerlinKernel2D, x, y, _mm_setzero_ps()), width - i);
+        }
+    }
+};
+
+void heNoiseFillGrid3D(HeNoise const* noise, float* values, hm::vec3f const& origin, hm::vec3f const& step, uint32_t const width, uint32_t const height, uint32_t const depth) {
+    HeNoiseKernel kernel = heNoiseGetKernel3D(noise->type);
+    __m128 const lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    for(uint32_t k = 0; k < depth; ++k) {
+        __m128 z = _mm_set1_ps(origin.z + step.z * k);
+        for(uint32_t j = 0; j < height; ++j) {
+            __m128 y = _mm_set1_ps(origin.y + step.y * j);
+            float* row = &values[((size_t) k * height + j) * width];
+            for(uint32_t i = 0; i < width; i += 4) {
+                __m128 x = _mm_add_ps(_mm_set1_ps(origin.x), _mm_mul_ps(_mm_add_ps(_mm_set1_ps((float) i), lanes), _mm_set1_ps(step.x)));
+                heNoiseStore(&row[i], heNoiseSampleFour(noise, kernel, hePerlinKernel3D, x, y, z), width - i);
+            }
+        }
+    }
+};
+
 
 std::vector<std::string> heStringSplit(const std::string& string, const char delimn) {
     std::vector<std::string> result;
@@ -4,12 +4,26 @@
 #include "heTypes.h"
 #include "hm/hm.hpp"
 
+// a small and fast random number generator (xoshiro128**). The default state is only meant to keep the generator
+// from getting stuck, use heRandomCreate to seed it
 struct HeRandom {
-    std::mt19937 gen;
-    std::uniform_real_distribution<float> fdis;
-    std::uniform_int_distribution<>       idis;
-    
-    HeRandom() : gen(0) {};
+    uint32_t state[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+    // the state of four more generators that run side by side in the batch functions. lanes[i] holds the i-th word
+    // of all four generators
+    uint32_t lanes[4][4] = { { 0xa4093822, 0x299f31d0, 0x082efa98, 0xec4e6c89 },
+                             { 0x452821e6, 0x38d01377, 0xbe5466cf, 0x34e90c6c },
+                             { 0xc0ac29b7, 0xc97c50dd, 0x3f84d5b5, 0xb5470917 },
+                             { 0x9216d5d9, 0x8979fb1b, 0xd1310ba6, 0x98dfb5ac } };
+};
+
+// a counter based random number generator (similar to the squares generator). The n-th number of a stream is a hash
+// of its key and n, so any number can be computed without the ones before it and streams with different keys are
+// independent. Useful for parallel jobs, which can each use their own stream and get the same numbers no matter
+// which thread runs them
+struct HeRandomStream {
+    uint64_t key     = 0;
+    // the position of the next number in the stream
+    uint64_t counter = 0;
 };
 
 struct HePerlinNoise {
@@ -33,16 +47,71 @@ struct HePerlinNoise {
     uint8_t p[512];
 };
 
+// settings for sampling noise with the heNoise functions. Every type and fractal returns values in about [-1, 1]
+struct HeNoise {
+    HeNoiseType    type      = HE_NOISE_TYPE_PERLIN;
+    HeNoiseFractal fractal   = HE_NOISE_FRACTAL_NONE;
+    // different seeds give different noise
+    uint32_t       seed      = 0;
+    // the positions are multiplied by this before sampling, i.e. the inverse of the size of a feature
+    float          frequency = 1.f;
+
+    // the number of octaves of the fractal. Every octave multiplies the frequency with the lacunarity and the
+    // amplitude with the gain
+    uint8_t        octaves    = 4;
+    float          lacunarity = 2.f;
+    float          gain       = .5f;
+
+    // if above 0, the positions are moved by perlin noise of this amplitude (domain warp), which makes the noise
+    // look swirly
+    float          warpAmplitude = 0.f;
+    float          warpFrequency = 1.f;
+};
+
 // sets up a random number generator with given seed. If seed is zero, a random seed will be used
 extern HE_API void heRandomCreate(HeRandom* random, uint32_t const seed);
-// returns a random int between low and high with that random
+// returns the next 32 random bits of that random
+extern HE_API uint32_t heRandomNext(HeRandom* random);
+// returns a random int between low and high (both inclusive) with that random
 extern HE_API int32_t heRandomInt(HeRandom* random, int32_t const low = 0, int32_t const high = 10000);
-// returns a random int between low and high with that random
+// returns a random float between low and high with that random
 extern HE_API float heRandomFloat(HeRandom* random, float const low = 0, float const high = 10000);
+// fills values with count random ints between low and high (both inclusive). Four numbers are generated at once, so
+// this is much faster than calling heRandomInt for every value. Uses its own generators, the numbers returned by
+// heRandomInt and heRandomFloat are not affected
+extern HE_API void heRandomFillInts(HeRandom* random, int32_t* values, uint32_t const count, int32_t const low, int32_t const high);
+// fills values with count random floats between low and high, see heRandomFillInts
+extern HE_API void heRandomFillFloats(HeRandom* random, float* values, uint32_t const count, float const low, float const high);
+
+// sets up a stream with given seed. Streams with the same seed but different indices (i.e. the index of a job) are
+// independent of each other
+extern HE_API void heRandomStreamCreate(HeRandomStream* stream, uint32_t const seed, uint32_t const index);
+// returns the 32 random bits at given position of the stream, without moving it
+extern HE_API uint32_t heRandomStreamGet(HeRandomStream const* stream, uint64_t const position);
+// returns the next 32 random bits of the stream
+extern HE_API uint32_t heRandomStreamNext(HeRandomStream* stream);
+// returns a random int between low and high (both inclusive) from the stream
+extern HE_API int32_t heRandomStreamInt(HeRandomStream* stream, int32_t const low, int32_t const high);
+// returns a random float between low and high from the stream
+extern HE_API float heRandomStreamFloat(HeRandomStream* stream, float const low, float const high);
 
 extern HE_API void hePerlinNoiseCreate(HePerlinNoise* noise);
 extern HE_API double hePerlinNoise3D(HePerlinNoise* noise, hm::vec3d const& position);
 
+// samples the noise at count positions (given per axis) into values. The positions are done four at a time, so this
+// is much faster than sampling one by one
+extern HE_API void heNoiseSample2D(HeNoise const* noise, float const* x, float const* y, float* values, uint32_t const count);
+extern HE_API void heNoiseSample3D(HeNoise const* noise, float const* x, float const* y, float const* z, float* values, uint32_t const count);
+// returns the noise at a single position
+extern HE_API float heNoiseGet2D(HeNoise const* noise, hm::vec2f const& position);
+extern HE_API float heNoiseGet3D(HeNoise const* noise, hm::vec3f const& position);
+// samples the noise on a grid of width * height positions, starting at origin and with step between two positions.
+// values is filled row by row
+extern HE_API void heNoiseFillGrid2D(HeNoise const* noise, float* values, hm::vec2f const& origin, hm::vec2f const& step, uint32_t const width, uint32_t const height);
+// samples the noise on a grid of width * height * depth positions, see heNoiseFillGrid2D. values is filled slice by
+// slice (z), every slice row by row
+extern HE_API void heNoiseFillGrid3D(HeNoise const* noise, float* values, hm::vec3f const& origin, hm::vec3f const& step, uint32_t const width, uint32_t const height, uint32_t const depth);
+
 // splits given string by delimn and returns the different parts of the string as vector
 extern HE_API std::vector<std::string> heStringSplit(std::string const& string, char const delimn);
 // replaces all occurences of from in input to to
@@ -50,11 +119,11 @@ extern HE_API std::string heStringReplaceAll(std::string const& input, std::stri
 // replaces all occurences of from in input to to
 extern HE_API std::string heStringReplaceAll(std::string const& input, char const from, char const to);
 // returns true if check is the beginning of base
-extern inline HE_API b8 heStringStartsWith(const std::string& base, const std::string& check);
+extern HE_API b8 heStringStartsWith(const std::string& base, const std::string& check);
 // removes all whitespace from the left of the string
-extern inline HE_API void heStringEatSpacesLeft(std::string& string);
+extern HE_API void heStringEatSpacesLeft(std::string& string);
 // removes all whitespace from the right of the string
-extern inline HE_API void heStringEatSpacesRight(std::string& string);
+extern HE_API void heStringEatSpacesRight(std::string& string);
 
 
 #endif
@@ -798,13 +798,13 @@ void heWin32TimerPrint(std::string const& id) {
     heLogCout(id + ": " + std::to_string(heWin32TimerGet()) + "ms", "[TIMER]:");
 };
 
-__int64 heWin32TimeGet() {
+int64_t heWin32TimeGet() {
     LARGE_INTEGER _int;
     QueryPerformanceCounter(&_int);
     return _int.QuadPart;
 };
 
-double heWin32TimeCalculateMs(__int64 duration) {
+double heWin32TimeCalculateMs(int64_t duration) {
     return duration * 1000.0 / heTimer.frequency.QuadPart;
 };
 
@@ -824,7 +824,7 @@ std::string heWin32ClipboardGet() {
     return std::string(s);
 };
 
-void heThreadSleep(__int64 const ms) {
+void heThreadSleep(int64_t const ms) {
     std::chrono::milliseconds duration(ms);
     std::this_thread::sleep_for(duration);    
 };
@@ -66,10 +66,10 @@ extern HE_API double heWin32TimerGet();
 // prints the latest time entry
 extern HE_API inline void heWin32TimerPrint(std::string const& id);
 // returns a time since program start (with queryPerformanceCounter)
-extern HE_API inline __int64 heWin32TimeGet();
+extern HE_API inline int64_t heWin32TimeGet();
 // calculates the given duration in cycles into milliseconds. The duration should be calculated using two different
 // heWin32TimeGet() calls
-extern HE_API inline double heWin32TimeCalculateMs(__int64 duration);
+extern HE_API inline double heWin32TimeCalculateMs(int64_t duration);
 
 
 // -- utils
@@ -77,6 +77,6 @@ extern HE_API inline double heWin32TimeCalculateMs(__int64 duration);
 // returns a string from the clipboard (if available) or an empty string if no text is in the clipboard
 extern HE_API std::string heWin32ClipboardGet();
 // sleeps the active thread for that amount of ms
-extern HE_API void heThreadSleep(__int64 const ms);
+extern HE_API void heThreadSleep(int64_t const ms);
 
 #endif
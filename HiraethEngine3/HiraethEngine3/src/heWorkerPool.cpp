@@ -0,0 +1,92 @@
+#include "hepch.h"
+#include "heWorkerPool.h"
+
+HeWorkerPool heWorkerPool;
+
+// true on the threads of a pool, so that jobs started from inside a job dont wait for themselves
+thread_local b8 heWorkerPoolIsWorker = false;
+
+// takes batches of the current job until no items are left
+void heWorkerPoolProcess(HeWorkerPool* pool) {
+    while(true) {
+        uint32_t begin = pool->nextItem.fetch_add(pool->batchSize);
+        if(begin >= pool->jobSize)
+            break;
+
+        (*pool->job)(begin, std::min(begin + pool->batchSize, pool->jobSize));
+    }
+};
+
+void heWorkerPoolThread(HeWorkerPool* pool) {
+    heWorkerPoolIsWorker = true;
+    uint64_t lastJob = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            pool->wake.wait(lock, [&]() { return !pool->running || pool->jobId != lastJob; });
+            if(!pool->running)
+                return;
+            lastJob = pool->jobId;
+        }
+
+        heWorkerPoolProcess(pool);
+
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if(--pool->busyWorkers == 0)
+            pool->finished.notify_one();
+    }
+};
+
+void heWorkerPoolCreate(HeWorkerPool* pool, uint32_t const threadCount) {
+    uint32_t count = threadCount;
+    if(count == 0)
+        count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    pool->running = true;
+    pool->threads.reserve(count);
+    for(uint32_t i = 0; i < count; ++i)
+        pool->threads.emplace_back(heWorkerPoolThread, pool);
+};
+
+void heWorkerPoolDestroy(HeWorkerPool* pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->running = false;
+    }
+
+    pool->wake.notify_all();
+    for(auto& all : pool->threads)
+        all.join();
+    pool->threads.clear();
+};
+
+void heWorkerPoolRun(HeWorkerPool* pool, uint32_t const count, uint32_t const batchSize, std::function<void(uint32_t, uint32_t)> const& func) {
+    uint32_t batch = std::max(batchSize, 1u);
+    std::unique_lock<std::mutex> jobLock(pool->jobMutex, std::defer_lock);
+    if(pool->threads.empty() || count <= batch || heWorkerPoolIsWorker || !jobLock.try_lock()) {
+        for(uint32_t begin = 0; begin < count; begin += batch)
+            func(begin, std::min(begin + batch, count));
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->job         = &func;
+        pool->jobSize     = count;
+        pool->batchSize   = batch;
+        pool->nextItem    = 0;
+        pool->busyWorkers = (uint32_t) pool->threads.size();
+        pool->jobId++;
+    }
+
+    pool->wake.notify_all();
+    heWorkerPoolProcess(pool);
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->finished.wait(lock, [&]() { return pool->busyWorkers == 0; });
+    pool->job = nullptr;
+};
+
+uint32_t heWorkerPoolGetThreadCount(HeWorkerPool const* pool) {
+    return (uint32_t) pool->threads.size() + 1;
+};
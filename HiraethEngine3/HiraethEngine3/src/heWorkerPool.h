@@ -0,0 +1,54 @@
+#ifndef HE_WORKER_POOL_H
+#define HE_WORKER_POOL_H
+
+#include "heTypes.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// a fixed set of threads that run parallel for loops. A job is split into batches of items, which the workers (and
+// the thread that started the job) take from a shared counter until all items are done. Only one job runs at a
+// time, jobs started while another one is running (i.e. from inside a job) run on the calling thread
+struct HeWorkerPool {
+    std::vector<std::thread> threads;
+    // guards the job state below and is used for waking the workers
+    std::mutex               mutex;
+    // only one job can be started at a time
+    std::mutex               jobMutex;
+    std::condition_variable  wake;
+    std::condition_variable  finished;
+
+    // the current job, called with a range of items [begin, end)
+    std::function<void(uint32_t, uint32_t)> const* job = nullptr;
+    uint32_t              jobSize     = 0;
+    uint32_t              batchSize   = 1;
+    // the first item that was not taken yet
+    std::atomic<uint32_t> nextItem    { 0 };
+    // the number of workers that did not finish the current job yet
+    uint32_t              busyWorkers = 0;
+    // increased for every job so that the workers notice a new one
+    uint64_t              jobId       = 0;
+    b8                    running     = false;
+};
+
+// the pool used by the engine (i.e. the level update). Nothing runs in parallel until it is created
+extern HE_API HeWorkerPool heWorkerPool;
+
+
+// -- worker pool
+
+// starts threadCount worker threads. If threadCount is 0, one thread less than the number of cores is started, since
+// the thread that starts a job works on it as well
+extern HE_API void heWorkerPoolCreate(HeWorkerPool* pool, uint32_t const threadCount = 0);
+// waits for the workers to finish and joins them
+extern HE_API void heWorkerPoolDestroy(HeWorkerPool* pool);
+// calls func(begin, end) for ranges of at most batchSize items until all count items are done and returns once they
+// are. Which thread gets which range is undefined, so func must only write to memory owned by its items. Without
+// workers, for a single batch or when called from inside a job, everything runs on the calling thread
+extern HE_API void heWorkerPoolRun(HeWorkerPool* pool, uint32_t const count, uint32_t const batchSize, std::function<void(uint32_t, uint32_t)> const& func);
+// returns the number of threads that work on a job (the workers and the calling thread)
+extern HE_API uint32_t heWorkerPoolGetThreadCount(HeWorkerPool const* pool);
+
+#endif
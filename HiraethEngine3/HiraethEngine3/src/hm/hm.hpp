@@ -8,4 +8,41 @@
 #include "quat.hpp"
 #include "colour.hpp"
 #include "matrixmath.hpp"
-#include "to_string.hpp"
\ No newline at end of file
+#include "to_string.hpp"
+
+// compile time checks for the constexpr parts of hm. These are evaluated by the compiler only, so a change that
+// breaks the results (or makes a function non constexpr) fails the build instead of showing up at runtime
+namespace hm {
+    namespace checks {
+        static_assert(floorPowerOfTwo(100) == 64);
+        static_assert(ceilPowerOfTwo(100) == 128);
+        static_assert(clamp(5, 0, 3) == 3);
+        static_assert(sign(-2.f) == -1);
+
+        static_assert(vec2i(1, 2) + vec2i(3, 4) == vec2i(4, 6));
+        static_assert(encodeVec2(vec2i(3, 7)) == 0x00070003);
+        static_assert(decodeVec2<int32_t>(0x00070003) == vec2i(3, 7));
+        static_assert(dot(vec3f(1.f, 2.f, 3.f), vec3f(4.f, 5.f, 6.f)) == 32.f);
+        static_assert(cross(vec3f(1.f, 0.f, 0.f), vec3f(0.f, 1.f, 0.f)).z == 1.f);
+        static_assert(length2(vec3f(2.f, 3.f, 6.f)) == 49.f);
+
+        constexpr mat4f translation = translate(mat4f(1.f), vec3f(1.f, 2.f, 3.f));
+        constexpr mat4f scaled      = scale(mat4f(1.f), vec3f(2.f));
+        static_assert(translation[3][0] == 1.f && translation[3][1] == 2.f && translation[3][2] == 3.f && translation[3][3] == 1.f);
+        static_assert((translation * vec4f(1.f, 1.f, 1.f, 1.f)).y == 3.f);
+        static_assert((scaled * translation)[3][2] == 6.f);
+        static_assert(inverse(translation)[3][2] == -3.f);
+        static_assert(inverse(scaled)[1][1] == .5f);
+        static_assert(mat4f()[0][0] == 0.f);
+        static_assert(mat3f(translation)[2][2] == 1.f);
+        static_assert(transpose(mat3f(1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f, 8.f, 9.f))[0][1] == 4.f);
+        static_assert(inverse(mat3f(2.f))[0][0] == .5f);
+        static_assert(toMat4(quatf(0.f, 0.f, 0.f, 1.f))[1][1] == 1.f);
+        static_assert(createTransformationMatrix(vec3f(1.f, 2.f, 3.f), quatf(0.f, 0.f, 0.f, 1.f), vec3f(2.f))[3][1] == 2.f);
+
+        constexpr colour red(255, 0, 0, 255);
+        static_assert(encodeColour(red) == 0xFF0000FF);
+        static_assert(decodeColour(0xFF00FF00).g == 255);
+        static_assert(getR(&red) == 1.f && getG(&red) == 0.f);
+    };
+};
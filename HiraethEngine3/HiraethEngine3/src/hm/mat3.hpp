@@ -11,9 +11,10 @@ namespace hm {
         
         col columns[3];
         
-        mat() { mat(1.f); };
-        mat(const T v) : columns{col(v, 0.f, 0.f), col(0.f, v, 0.f), col(0.f, 0.f, v)} {};        
-        mat(const T x0, const T y0, const T z0,
+        // zero matrix, use mat(1) for the identity
+        constexpr mat() : columns{} {};
+        constexpr mat(const T v) : columns{col(v, 0.f, 0.f), col(0.f, v, 0.f), col(0.f, 0.f, v)} {};        
+        constexpr mat(const T x0, const T y0, const T z0,
             const T x1, const T y1, const T z1,
             const T x2, const T y2, const T z2) :
             columns{
@@ -23,7 +24,7 @@ namespace hm {
         }
         {};
         
-        mat(const col& v0, const col& v1, const col& v2) :
+        constexpr mat(const col& v0, const col& v1, const col& v2) :
             columns{
                     (v0),
                     (v1),
@@ -31,7 +32,7 @@ namespace hm {
         }
         {};
         
-        mat(const T* ptr) :
+        constexpr mat(const T* ptr) :
             columns{
                     col(ptr[0], ptr[1], ptr[2]),
                     col(ptr[3], ptr[4], ptr[5]),
@@ -39,8 +40,8 @@ namespace hm {
         }
         {};
         
-        template<typename T>
-        mat(mat<4, 4, T> const& mat) :
+        template<typename T1>
+        constexpr mat(mat<4, 4, T1> const& mat) :
             columns{
                     col(mat[0][0], mat[0][1], mat[0][2]),
                     col(mat[1][0], mat[1][1], mat[1][2]),
@@ -50,7 +51,7 @@ namespace hm {
         
         // accessors
         
-        const col& operator[](const uint8_t index) const {
+        constexpr const col& operator[](const uint8_t index) const {
             if(index < 3)
                 return columns[index];
             
@@ -59,7 +60,7 @@ namespace hm {
             return columns[0];
         };
         
-        col& operator[](const uint8_t index) {
+        constexpr col& operator[](const uint8_t index) {
             if(index < 3)
                 return columns[index];
             
@@ -71,7 +72,7 @@ namespace hm {
         
         // operators
         
-        mat operator*(const mat& matrix) const {
+        constexpr mat operator*(const mat& matrix) const {
             const col ia0 = columns[0];
             const col ia1 = columns[1];
             const col ia2 = columns[2];
@@ -87,9 +88,9 @@ namespace hm {
             return result;            
         };
         
-        template<typename T>
-        vec<3, T> operator*(const vec<3, T>& vector) const {            
-            vec<3, T> result;
+        template<typename T1>
+        constexpr vec<3, T1> operator*(const vec<3, T1>& vector) const {            
+            vec<3, T1> result;
             result.x = vector.x * columns[0][0] + vector.y * columns[1][0] + vector.z * columns[2][0];
             result.y = vector.x * columns[0][1] + vector.y * columns[1][1] + vector.z * columns[2][1];
             result.z = vector.x * columns[0][2] + vector.y * columns[1][2] + vector.z * columns[2][2];
@@ -102,7 +103,7 @@ namespace hm {
     typedef mat<3, 3, int32_t> mat3i;
     
     template<typename T>
-    static mat<3, 3, T> transpose(mat<3, 3, T> const& matrix) {        
+    static constexpr mat<3, 3, T> transpose(mat<3, 3, T> const& matrix) {        
         mat<3, 3, T> result;
         
         result[0][0] = matrix[0][0];
@@ -119,7 +120,7 @@ namespace hm {
     };
     
     template<typename T>
-    static mat<3, 3, T> inverse(mat<3, 3, T> const& matrix) {        
+    static constexpr mat<3, 3, T> inverse(mat<3, 3, T> const& matrix) {        
         T determinant = static_cast<T>(1) / (+matrix[0][0] * (matrix[1][1] * matrix[2][2] - matrix[2][1] * matrix[1][2])
                                              -matrix[1][0] * (matrix[0][1] * matrix[2][2] - matrix[2][1] * matrix[0][2])
                                              +matrix[2][0] * (matrix[0][1] * matrix[1][2] - matrix[1][1] * matrix[0][2]));
@@ -13,9 +13,10 @@ namespace hm {
         
         col columns[4];
         
-        mat() { mat(1.f); }
+        // zero matrix, use mat(1) for the identity
+        constexpr mat() : columns{} {};
         
-        mat(const T v) :
+        constexpr mat(const T v) :
             columns {
                      col(v, 0.f, 0.f, 0.f),
                      col(0.f, v, 0.f, 0.f),
@@ -24,7 +25,7 @@ namespace hm {
         }
         {};
         
-        mat(const T x0, const T y0, const T z0, const T w0,
+        constexpr mat(const T x0, const T y0, const T z0, const T w0,
             const T x1, const T y1, const T z1, const T w1,
             const T x2, const T y2, const T z2, const T w2,
             const T x3, const T y3, const T z3, const T w3) :
@@ -36,7 +37,7 @@ namespace hm {
         }
         {};
         
-        mat(const col& v0, const col& v1, const col& v2, const col& v3) :
+        constexpr mat(const col& v0, const col& v1, const col& v2, const col& v3) :
             columns {
                      (v0),
                      (v1),
@@ -45,7 +46,7 @@ namespace hm {
         }
         {};
         
-        mat(const T* ptr) :
+        constexpr mat(const T* ptr) :
             columns {
                      col(ptr[0], ptr[1], ptr[2], ptr[3]),
                      col(ptr[4], ptr[5], ptr[6], ptr[7]),
@@ -57,7 +58,7 @@ namespace hm {
         
         // accessors
         
-        col const& operator[](const uint8_t index) const {
+        constexpr col const& operator[](const uint8_t index) const {
             if (index < 4)
                 return columns[index];
             
@@ -66,7 +67,7 @@ namespace hm {
             return columns[0];
         };
         
-        col& operator[](const uint8_t index) {
+        constexpr col& operator[](const uint8_t index) {
             if (index < 4)
                 return columns[index];
             
@@ -78,7 +79,7 @@ namespace hm {
         
         // operators
         
-        mat operator*(const mat& matrix) const {
+        constexpr mat operator*(const mat& matrix) const {
             const col ia0 = columns[0];
             const col ia1 = columns[1];
             const col ia2 = columns[2];
@@ -97,10 +98,10 @@ namespace hm {
             return result;
         };
         
-        template<typename T>
-        vec<4, T> operator*(const vec<4, T>& vector) const {
+        template<typename T1>
+        constexpr vec<4, T1> operator*(const vec<4, T1>& vector) const {
             
-            vec<4, T> result;
+            vec<4, T1> result;
             result.x = vector.x * columns[0][0] + vector.y * columns[1][0] + vector.z * columns[2][0] + vector.w * columns[3][0];
             result.y = vector.x * columns[0][1] + vector.y * columns[1][1] + vector.z * columns[2][1] + vector.w * columns[3][1];
             result.z = vector.x * columns[0][2] + vector.y * columns[1][2] + vector.z * columns[2][2] + vector.w * columns[3][2];
@@ -129,19 +130,19 @@ namespace hm {
     typedef mat<4, 4, int32_t> mat4i;
     
     template<typename T>
-    static inline mat<4, 4, T> translate(const mat<4, 4, T>& matrix, const vec<3, T>& position) {
+    static constexpr mat<4, 4, T> translate(const mat<4, 4, T>& matrix, const vec<3, T>& position) {
         mat<4, 4, T> m = matrix;
         m[3] = matrix.columns[0] * position.x + matrix.columns[1] * position.y + matrix.columns[2] * position.z + matrix.columns[3];
         return m;
     };
     
     template<typename T>
-    static inline mat<4, 4, T> translate(const mat<4, 4, T>& matrix, const vec<2, T>& position) {
+    static constexpr mat<4, 4, T> translate(const mat<4, 4, T>& matrix, const vec<2, T>& position) {
         return translate(matrix, vec<3, T>(position.x, position.y, 0));
     };
     
     template<typename T>
-    static inline mat<4, 4, T> scale(const mat<4, 4, T>& matrix, const vec<3, T>& factor) {
+    static constexpr mat<4, 4, T> scale(const mat<4, 4, T>& matrix, const vec<3, T>& factor) {
         mat<4, 4, T>  mr = matrix;
         mr[0] = mr[0] * factor.x;
         mr[1] = mr[1] * factor.y;
@@ -150,7 +151,7 @@ namespace hm {
     };
     
     template<typename T>
-    static inline mat<4, 4, T> scale(const mat<4, 4, T>& matrix, const vec<2, T>& factor) {
+    static constexpr mat<4, 4, T> scale(const mat<4, 4, T>& matrix, const vec<2, T>& factor) {
         return scale(matrix, vec<3, T>(factor.x, factor.y, 1));
     };
     
@@ -187,7 +188,7 @@ namespace hm {
     };
 
     template<typename T>
-    static mat<4, 4, T> inverse(mat<4, 4, T> const& m) {        
+    static constexpr mat<4, 4, T> inverse(mat<4, 4, T> const& m) {        
         T Coef00 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
         T Coef02 = m[1][2] * m[3][3] - m[3][2] * m[1][3];
         T Coef03 = m[1][2] * m[2][3] - m[2][2] * m[1][3];
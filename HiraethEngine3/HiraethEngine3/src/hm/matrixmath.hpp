@@ -7,7 +7,7 @@
 
 namespace hm {
     template<typename T>
-    static mat<4, 4, T> createOrthographicProjectionMatrix(vec<2, T> const& size, vec<2, T> const& center, T const depth) {        
+    static constexpr mat<4, 4, T> createOrthographicProjectionMatrix(vec<2, T> const& size, vec<2, T> const& center, T const depth) {        
         T size2x = size.x / 2;
         T size2y = size.y / 2;
         
@@ -59,7 +59,7 @@ namespace hm {
     };
     
     template<typename T>
-    static mat<4, 4, T> createTransformationMatrix(vec<3, T> const& position, quat<T> const& rotation, vec<3, T> const& scale) {        
+    static constexpr mat<4, 4, T> createTransformationMatrix(vec<3, T> const& position, quat<T> const& rotation, vec<3, T> const& scale) {        
         mat<4, 4, T> p(static_cast<T>(1));
         p = hm::translate(p, position);
         mat<4, 4, T> s(static_cast<T>(1));
@@ -78,7 +78,7 @@ namespace hm {
     };
     
     template<typename T>
-    static mat<4, 4, T> createTransformationMatrix(vec<2, T> const& position, vec<2, T> const& scale) {        
+    static constexpr mat<4, 4, T> createTransformationMatrix(vec<2, T> const& position, vec<2, T> const& scale) {        
         mat<4, 4, T> mat(static_cast<T>(1));
         mat = hm::translate(mat, position);
         mat = hm::scale(mat, scale);
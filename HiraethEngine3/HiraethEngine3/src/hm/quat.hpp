@@ -7,12 +7,12 @@ namespace hm {
     struct quat {
         T x, y, z, w;
         
-        quat() : x(0), y(0), z(0), w(0) {};
-        quat(const T x, const T y, const T z, const T w) : x(x), y(y), z(z), w(w) {};
+        constexpr quat() : x(0), y(0), z(0), w(0) {};
+        constexpr quat(const T x, const T y, const T z, const T w) : x(x), y(y), z(z), w(w) {};
         
         // operators
         
-        inline quat operator+(const quat& q) const {
+        constexpr quat operator+(const quat& q) const {
             return quat(q.x + x, q.y + y, q.z + z, q.w + w);
         };
         
@@ -24,7 +24,7 @@ namespace hm {
     
     // turns this quaternion into a rotated transformation matrix
     template<typename T>
-    static mat<4, 4, T> toMat4(const quat<T>& q) {
+    static constexpr mat<4, 4, T> toMat4(const quat<T>& q) {
         mat<4, 4, T> result(1.0f);
         T qxx(q.x * q.x);
         T qyy(q.y * q.y);
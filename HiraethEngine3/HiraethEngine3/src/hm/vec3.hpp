@@ -10,19 +10,19 @@ namespace hm {
     struct vec<3, T> {
         T x, y, z;
         
-        vec() : x(0), y(0), z(0) {};
-        vec(T v) : x(v), y(v), z(v) {};
-        vec(T x, T y, T z) : x(x), y(y), z(z) {};
+        constexpr vec() : x(0), y(0), z(0) {};
+        constexpr vec(T v) : x(v), y(v), z(v) {};
+        constexpr vec(T x, T y, T z) : x(x), y(y), z(z) {};
         template<typename T1>
-        vec(vec<2, T1> const& vec, T1 const z = 1) : x((T) vec.x), y((T) vec.y), z((T) z) {};
+        constexpr vec(vec<2, T1> const& vec, T1 const z = 1) : x((T) vec.x), y((T) vec.y), z((T) z) {};
         template<typename T1>
-        vec(vec<3, T1> const& v) : x((T) v.x), y((T) v.y), z((T) v.z) {};
+        constexpr vec(vec<3, T1> const& v) : x((T) v.x), y((T) v.y), z((T) v.z) {};
         template<typename T1>
-        vec(vec<4, T1> const& v) : x((T) v.x), y((T) v.y), z((T) v.z) {};
+        constexpr vec(vec<4, T1> const& v) : x((T) v.x), y((T) v.y), z((T) v.z) {};
         
         // accessors
         
-        T const& operator[](uint8_t const index) const {
+        constexpr T const& operator[](uint8_t const index) const {
             switch (index) {
             case 0:
                 return x;
@@ -40,7 +40,7 @@ namespace hm {
         };
         
         
-        T& operator[](uint8_t const index) {
+        constexpr T& operator[](uint8_t const index) {
             switch (index) {
             case 0:
                 return x;
@@ -61,52 +61,52 @@ namespace hm {
     // operators
 
     template<typename T>
-    inline vec<3, T> operator*(vec<3, T> const& l, vec<3, T> const& r) {
+    constexpr vec<3, T> operator*(vec<3, T> const& l, vec<3, T> const& r) {
         return vec<3, T>(l.x * r.x, l.y * r.y, l.z * r.z);
     };
         
     template<typename T>
-    inline vec<3, T> operator*(vec<3, T> const& l, T const v) {
+    constexpr vec<3, T> operator*(vec<3, T> const& l, T const v) {
         return vec<3, T>(l.x * v, l.y * v, l.z * v);
     };
 
     template<typename T>
-    inline vec<3, T> operator*(T const l, vec<3, T> const& v) {
+    constexpr vec<3, T> operator*(T const l, vec<3, T> const& v) {
         return vec<3, T>(l * v.x, l * v.y, l * v.z);
     };
         
     template<typename T>
-    inline vec<3, T> operator+(vec<3, T> const& l, vec<3, T> const& r) {
+    constexpr vec<3, T> operator+(vec<3, T> const& l, vec<3, T> const& r) {
         return vec<3, T>(l.x + r.x, l.y + r.y, l.z + r.z);
     };
         
     template<typename T>
-    inline vec<3, T> operator-(vec<3, T> const& l, vec<3, T> const& r) {
+    constexpr vec<3, T> operator-(vec<3, T> const& l, vec<3, T> const& r) {
         return vec<3, T>(l.x - r.x, l.y - r.y, l.z - r.z);
     };
         
     template<typename T>
-    inline vec<3, T> operator/(vec<3, T> const& l, vec<3, T> const& r) {
+    constexpr vec<3, T> operator/(vec<3, T> const& l, vec<3, T> const& r) {
         return vec<3, T>(l.x / r.x, l.y / r.y, l.z / r.z);
     };
 
     template<typename T>
-    inline vec<3, T> operator/(vec<3, T> const& l, T const v) {
+    constexpr vec<3, T> operator/(vec<3, T> const& l, T const v) {
         return vec<3, T>(l.x / v, l.y / v, l.z / v);
     };
 
     template<typename T>
-    inline vec<3, T> operator/(T const l, vec<3, T> const& v) {
+    constexpr vec<3, T> operator/(T const l, vec<3, T> const& v) {
         return vec<3, T>(l / v.x, l / v.y, l / v.z);
     };
         
     template<typename T>
-    inline vec<3, T> operator-(vec<3, T> const& l) {
+    constexpr vec<3, T> operator-(vec<3, T> const& l) {
         return vec<3, T>(-l.x, -l.y, -l.z);
     };
         
     template<typename T>
-    inline vec<3, T>& operator*=(vec<3, T>& l, T const v) {
+    constexpr vec<3, T>& operator*=(vec<3, T>& l, T const v) {
         l.x *= v;
         l.y *= v;
         l.z *= v;
@@ -114,7 +114,7 @@ namespace hm {
     };
 
     template<typename T>
-    inline vec<3, T>& operator+=(vec<3, T>& l, vec<3, T> const& r) {
+    constexpr vec<3, T>& operator+=(vec<3, T>& l, vec<3, T> const& r) {
         l.x += r.x;
         l.y += r.y;
         l.z += r.z;
@@ -122,7 +122,7 @@ namespace hm {
     };
         
     template<typename T>
-    inline vec<3, T>& operator-=(vec<3, T>& l, vec<3, T> const& r) {
+    constexpr vec<3, T>& operator-=(vec<3, T>& l, vec<3, T> const& r) {
         l.x -= r.x;
         l.y -= r.y;
         l.z -= r.z;
@@ -139,12 +139,12 @@ namespace hm {
     };
 
     template<typename T>
-    static inline T length2(vec<3, T> const& vector) {
+    static constexpr T length2(vec<3, T> const& vector) {
         return vector.x * vector.x + vector.y * vector.y + vector.z * vector.z;
     };
     
     template<typename T>
-    static inline vec<3, T> to_radians(vec<3, T> const& vector) {
+    static constexpr vec<3, T> to_radians(vec<3, T> const& vector) {
         return vec<3, T>(to_radians(vector.x), to_radians(vector.y), to_radians(vector.z));
     };
     
@@ -154,19 +154,19 @@ namespace hm {
     };
     
     template<typename T>
-    static inline vec<3, T> cross(vec<3, T> const& left, vec<3, T> const& right) {
+    static constexpr vec<3, T> cross(vec<3, T> const& left, vec<3, T> const& right) {
         return vec<3, T>(left.y * right.z - left.z * right.y,
                        left.z * right.x - left.x * right.z,
                        left.x * right.y - left.y * right.x);
     };
 
     template<typename T>
-    static inline T dot(vec<3, T> const& left, vec<3, T> const& right) {
+    static constexpr T dot(vec<3, T> const& left, vec<3, T> const& right) {
         return left.x * right.x + left.y * right.y + left.z * right.z; 
     };
     
     template<typename T>
-    static inline vec<3, T> project(vec<3, T> const& left, vec<3, T> const& right) {
+    static constexpr vec<3, T> project(vec<3, T> const& left, vec<3, T> const& right) {
         //return dot(left, right) * right * (static_cast<T>(1) / length2(right));
         return (dot(left, right) / length2(right)) * right;
     };
@@ -9,17 +9,17 @@ namespace hm {
     struct vec<4, T> {
         T x, y, z, w;
         
-        vec() : x(0), y(0), z(0), w(0) {};
-        vec(T const v) : x(v), y(v), z(v), w(v) {};
-        vec(T const x, T const y, T const z, T const w) : x(x), y(y), z(z), w(w) {};
+        constexpr vec() : x(0), y(0), z(0), w(0) {};
+        constexpr vec(T const v) : x(v), y(v), z(v), w(v) {};
+        constexpr vec(T const x, T const y, T const z, T const w) : x(x), y(y), z(z), w(w) {};
         template<typename T1>
-        vec(vec<3, T1> const& vec, T1 const w = 1.0f) : x((T) vec.x), y((T) vec.y), z((T) vec.z), w(w) {};
+        constexpr vec(vec<3, T1> const& vec, T1 const w = 1.0f) : x((T) vec.x), y((T) vec.y), z((T) vec.z), w(w) {};
         template<typename T1>
-        vec(vec<4, T1> const& vec) : x(vec.x), y(vec.y), z(vec.z), w(vec.w) {};
+        constexpr vec(vec<4, T1> const& vec) : x(vec.x), y(vec.y), z(vec.z), w(vec.w) {};
         
         // accessors
         
-        const T& operator[](uint8_t const index) const {
+        constexpr const T& operator[](uint8_t const index) const {
             switch (index) {
             case 0:
                 return x;
@@ -40,7 +40,7 @@ namespace hm {
         };
         
         
-        T& operator[](uint8_t const index) {
+        constexpr T& operator[](uint8_t const index) {
             switch (index) {
             case 0:
                 return x;
@@ -62,19 +62,19 @@ namespace hm {
         
         // operators
         
-        vec operator*(float const value) const {
+        constexpr vec operator*(float const value) const {
             return vec(x * value, y * value, z * value, w * value);
         };
 
-        vec operator*(vec const& v) const {
+        constexpr vec operator*(vec const& v) const {
             return vec(x * v.x, y * v.y, z * v.z, w * v.w);
         };
         
-        vec operator+(vec const& v) const {
+        constexpr vec operator+(vec const& v) const {
             return vec(x + v.x, y + v.y, z + v.z, w + v.w);
         };        
 
-        vec operator-(vec const& v) const {
+        constexpr vec operator-(vec const& v) const {
             return vec(x - v.x, y - v.y, z - v.z, w - v.w);
         };
     };
@@ -7,7 +7,7 @@
 
 void command_set_position(int index, hm::vec3f const& position) {
 	HeD3Instance* instance = heD3LevelGetInstance(heD3Level, index);
-	heD3InstanceSetPosition(instance, position);
+	heD3LevelSetInstancePosition(heD3Level, instance, position);
 };
 
 void front_command_set_position(std::vector<std::string> const& args) {
@@ -102,6 +102,11 @@ void command_toggle_profiler() {
 	 heProfilerToggleDisplay();
 };
 
+void command_toggle_gl_validation() {
+	 heGlState.validate = !heGlState.validate;
+	 HE_LOG(std::string("Gl state validation ") + (heGlState.validate ? "enabled" : "disabled"));
+};
+
 void front_command_toggle_profiler(std::vector<std::string> const& args) {
 	if(args.size() != 0) {
 		heConsolePrint("Error: toggle_profiler requires 0 arguments");
@@ -110,6 +115,14 @@ void front_command_toggle_profiler(std::vector<std::string> const& args) {
 	command_toggle_profiler();
 };
 
+void front_command_toggle_gl_validation(std::vector<std::string> const& args) {
+	if(args.size() != 0) {
+		heConsolePrint("Error: toggle_gl_validation requires 0 arguments");
+		return;
+	};
+	command_toggle_gl_validation();
+};
+
 
 void command_export_texture(std::string const& in, std::string const& out) {
      heTextureCompress(in, out);
@@ -314,6 +327,7 @@ void heRegisterCommands() {
 	heConsoleRegisterCommand("teleport", &front_command_teleport);
 	heConsoleRegisterCommand("toggle_physics_debug", &front_command_toggle_physics_debug);
 	heConsoleRegisterCommand("toggle_profiler", &front_command_toggle_profiler);
+	heConsoleRegisterCommand("toggle_gl_validation", &front_command_toggle_gl_validation);
 	heConsoleRegisterCommand("export_texture", &front_command_export_texture);
 	heConsoleRegisterCommand("export_textures", &front_command_export_textures);
 	heConsoleRegisterCommand("export_instances", &front_command_export_instances);
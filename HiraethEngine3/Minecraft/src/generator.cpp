@@ -3,21 +3,24 @@
 #include "heWin32Layer.h"
 #include "hm/hm.hpp"
 
-HePerlinNoise noise;
+HeNoise noise;
 
 void generatorCreate() {
-    hePerlinNoiseCreate(&noise);
+    noise.type      = HE_NOISE_TYPE_PERLIN;
+    noise.frequency = 1.f / 32.f;
 };
 
 void generateChunk(World* world, Chunk* chunk) {
     chunk->blockCount = 0;
     memset(chunk->layers, 0, sizeof(chunk->layers));
     
-    hm::vec3d chunkOffset(chunk->position.x * 16., 0, chunk->position.y * 16.);
+    // the noise of the whole chunk at once, indexed by [x][z]
+    float heights[CHUNK_SIZE * CHUNK_SIZE];
+    heNoiseFillGrid2D(&noise, heights, hm::vec2f(chunk->position.y * 16.f, chunk->position.x * 16.f), hm::vec2f(1.f), CHUNK_SIZE, CHUNK_SIZE);
 
     for(uint8_t x = 0; x < CHUNK_SIZE; ++x) {
         for(uint8_t z = 0; z < CHUNK_SIZE; ++z) {
-            int16_t height = (int16_t) (hePerlinNoise3D(&noise, (hm::vec3d(x, 0, z) + chunkOffset) / 32.) * 20.);
+            int16_t height = (int16_t) ((heights[x * CHUNK_SIZE + z] + 1.f) / 2.f * 20.f);
             height = hm::clamp(height, (int16_t) 0, (int16_t) 255);
             
             for(uint16_t y = 0; y <= height; ++y) {
@@ -1,5 +1,6 @@
 #include "minecraft.h"
 #include "heUi.h"
+#include "heWorkerPool.h"
 #include "heConsole.h"
 #include "heCore.h"
 #include "heWin32Layer.h"
@@ -129,6 +130,7 @@ int main() {
     windowInfo.fpsCap           = 70;
     heWindowCreate(&app.window, windowInfo);
     heRenderEngineCreate(&app.engine, &app.window, HE_RENDER_MODE_FORWARD);
+    heWorkerPoolCreate(&heWorkerPool);
     hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
     heUiCreate(&app.engine);
     
@@ -174,6 +176,7 @@ int main() {
     worldCreateThread.join();
     
     hePostProcessEngineDestroy(&app.engine.postProcess);
+    heWorkerPoolDestroy(&heWorkerPool);
     heRenderEngineDestroy(&app.engine);
     heWindowDestroy(&app.window);
     return 0;
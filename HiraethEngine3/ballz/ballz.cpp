@@ -1,5 +1,6 @@
 #include "ballz.h"
 #include "heUi.h"
+#include "heWorkerPool.h"
 #include "heConsole.h"
 #include "heCore.h"
 #include "heWin32Layer.h"
@@ -148,6 +149,7 @@ int main() {
     windowInfo.fpsCap = 70;
     heWindowCreate(&app.window, windowInfo);
     heRenderEngineCreate(&app.engine, &app.window, HE_RENDER_MODE_FORWARD);
+    heWorkerPoolCreate(&heWorkerPool);
     hePostProcessEngineCreate(&app.engine.postProcess, &app.window);
     heUiCreate(&app.engine);
 
@@ -207,6 +209,7 @@ int main() {
     app.state = GAME_STATE_DONE;
 
     hePostProcessEngineDestroy(&app.engine.postProcess);
+    heWorkerPoolDestroy(&heWorkerPool);
     heRenderEngineDestroy(&app.engine);
     heWindowDestroy(&app.window);
     return 0;
@@ -9,12 +9,10 @@ out vec2 pass_uv;
 out vec3 pass_normal;
 out vec3 pass_worldPos;
 out vec3 pass_cameraPos;
-out vec4 pass_shadowCoords;
 
 uniform mat4 u_projMat;
 uniform mat4 u_viewMat;
 uniform mat4 u_transMat;
-uniform mat4 u_shadowSpace;
 
 uniform mat3 u_normMat;
 uniform float u_time;
@@ -24,7 +22,6 @@ void main(void) {
 	vec4 worldPos = u_transMat * vec4(in_position, 1.0);
 	gl_Position = u_projMat * u_viewMat * worldPos;
 	
-	pass_shadowCoords = u_shadowSpace * worldPos;
 	pass_normal       = u_normMat * in_normal;
 	pass_worldPos     = worldPos.xyz;
 	pass_cameraPos    = (inverse(u_viewMat) * vec4(0, 0, 0, 1)).xyz;
@@ -54,7 +51,9 @@ void main(void) {
 	vec3 unitView = normalize(pass_cameraPos - pass_worldPos);
 	
 	float shadow = 1.0;
-	for(int i = 0; i < numLights; ++i) {
+	uvec2 cluster = u_clustered ? getCluster() : uvec2(0, numLights);
+	for(uint c = 0; c < cluster.y; ++c) {
+		int i = u_clustered ? getClusterLight(cluster.x + c) : int(c);
 		vec4 lightDirection = getLightVector(u_lights[i]);
 		
 		if(lightDirection == vec4(0))
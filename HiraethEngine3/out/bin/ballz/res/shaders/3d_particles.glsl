@@ -2,25 +2,32 @@
 #version 330 core
 
 layout(location = 0) in vec2 in_position;
-layout(location = 1) in mat4 in_transMat;
-layout(location = 5) in vec4 in_colour;
-layout(location = 6) in vec4 in_uvs;
+layout(location = 1) in vec4 in_positionSize; // world space position and size
+layout(location = 2) in vec4 in_colour;       // rgba in [0:255]
+layout(location = 3) in vec2 in_sprite;       // atlas index and intensity (8.8 fixed point)
 
 out vec4 pass_colour;
 out vec2 pass_uv;
-out vec4 pass_shadowCoords;
+out vec3 pass_worldPos;
 
 uniform mat4 u_projMat;
 uniform mat4 u_viewMat;
-uniform mat4 u_shadowSpace;
+uniform vec3 u_cameraRight;
+uniform vec3 u_cameraUp;
+uniform vec2 u_spriteSize;   // the size of a single sprite in the atlas, in uv space
+uniform int  u_atlasColumns;
 
 void main(void) {
-	vec4 worldPos = in_transMat * vec4(in_position, 0.0, 1.0);
-	gl_Position = u_projMat * u_viewMat * worldPos;
-	pass_colour = in_colour;
-	pass_uv = in_uvs.xy + in_uvs.zw * (in_position * 0.5 + 0.5);
+	// span the quad along the camera axes so that it always faces the camera
+	vec3 worldPos = in_positionSize.xyz + (u_cameraRight * in_position.x + u_cameraUp * in_position.y) * in_positionSize.w;
+	gl_Position = u_projMat * u_viewMat * vec4(worldPos, 1.0);
+	pass_colour = vec4(in_colour.rgb * (in_sprite.y / 256.0), in_colour.a) / 255.0;
+
+	int index = int(in_sprite.x);
+	vec2 spriteOffset = vec2(index % u_atlasColumns, index / u_atlasColumns) * u_spriteSize;
+	pass_uv = spriteOffset + u_spriteSize * (in_position * 0.5 + 0.5);
 	pass_uv.y = 1.0 - pass_uv.y;
-	pass_shadowCoords = u_shadowSpace * worldPos; 
+	pass_worldPos = worldPos;
 }
 
 #fragment
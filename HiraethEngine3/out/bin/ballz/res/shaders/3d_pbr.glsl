@@ -12,12 +12,10 @@ out vec3 pass_worldPos;
 out vec3 pass_cameraPos;
 out mat3 pass_tangSpace;
 out vec3 pass_tangent;
-out vec4 pass_shadowCoords;
 
 uniform mat4 u_projMat;
 uniform mat4 u_viewMat;
 uniform mat4 u_transMat;
-uniform mat4 u_shadowSpace;
 
 uniform mat3 u_normMat;
 uniform vec3 u_cameraPos;
@@ -44,7 +42,6 @@ void main(void) {
 	vec4 worldPos = u_transMat * vec4(in_position, 1.0);
 	gl_Position = u_projMat * u_viewMat * worldPos;
 	
-	pass_shadowCoords = u_shadowSpace * worldPos;
 	pass_normal       = u_normMat * in_normal;
 	pass_worldPos     = worldPos.xyz;
 	pass_cameraPos    = u_cameraPos;
@@ -143,7 +140,10 @@ void main(void) {
 	
 	float shadow = 1.0;
 	
-	for(int i = 0; i < numLights; ++i) { 
+	// in forward+ only the lights of the cluster of this fragment are checked
+	uvec2 cluster = u_clustered ? getCluster() : uvec2(0, numLights);
+	for(uint c = 0; c < cluster.y; ++c) {
+		int i = u_clustered ? getClusterLight(cluster.x + c) : int(c);
 		vec4 lightDirection = getLightVector(u_lights[i]);
 		
 		if(lightDirection == vec4(0))